@@ -1,34 +1,61 @@
 #include "mec_eigenharp.h"
 
+#include "mec_eigenharp_keys.h"
 #include "mec_log.h"
 #include "../mec_surfacemapper.h"
-#include "../mec_voice.h"
 #include <unistd.h>
 
+namespace mec {
 
-#include <set>
+////////////////////////////////////////////////
+// the reloadable part of the configuration, mappers are built here (off the processing thread)
+struct EigenharpStage {
+    explicit EigenharpStage(const EigenharpConfig &config) : config_(config) {
+        for (int i = 0; i < M_COUNT; i++) {
+            const EigenharpConfig::Model &m = model(i);
+            if (m.exists_ && m.hasMapping_) mappers_[i].load(m.mapping_);
+        }
+    }
+
+    enum {
+        M_PICO,
+        M_TAU,
+        M_ALPHA,
+        M_DEFAULT,
+        M_COUNT
+    };
+
+    const EigenharpConfig::Model &model(int m) const {
+        switch (m) {
+            case M_PICO :
+                return config_.pico_;
+            case M_TAU :
+                return config_.tau_;
+            case M_ALPHA :
+                return config_.alpha_;
+            default:
+                return config_.default_;
+        }
+    }
+
+    EigenharpConfig config_;
+    SurfaceMapper mappers_[M_COUNT];
+};
 
-namespace mec {
 
 ////////////////////////////////////////////////
 class EigenharpHandler : public EigenApi::Callback {
 public:
-    EigenharpHandler(EigenApi::Eigenharp* api, Preferences &p, ICallback &cb)
+    EigenharpHandler(EigenApi::Eigenharp* api, const std::shared_ptr<EigenharpStage> &stage, ICallback &cb)
             : api_(api),
-              prefs_(p),
               callback_(cb),
               valid_(true),
-              voices_(static_cast<unsigned>(p.getInt("voices", Voices::NUM_VOICES)),
-                      static_cast<unsigned>(p.getInt("velocity count", Voices::V_COUNT)),
-                      static_cast<float>(p.getDouble("velocity curve", Voices::V_CURVE_AMT )),
-                      static_cast<float>(p.getDouble("velocity scale", Voices::V_SCALE_AMT ))
-                      ),
-              pitchbendRange_((float) p.getDouble("pitchbend range", 2.0)),
-              stealVoices_(p.getBool("steal voices", true)),
-              throttle_(p.getInt("throttle", 0) == 0
-                        ? 0 : 1000000ULL /
-                              p.getInt("throttle",
-                                       0)) {
+              keys_(cb,
+                    stage->config_.velocityCount_,
+                    stage->config_.velocityCurve_,
+                    stage->config_.velocityScale_),
+              model_(-1) {
+        apply(stage);
         if (valid_) {
             LOG_0("EigenharpHandler enabling for mecapi");
         }
@@ -36,145 +63,48 @@ public:
 
     bool isValid() { return valid_; }
 
+    // called between processing cycles, voices are kept so active touches continue
+    void apply(const std::shared_ptr<EigenharpStage> &stage) {
+        stage_ = stage;
+        const EigenharpConfig &config = stage_->config_;
+        keys_.pitchbendRange(config.pitchbendRange_);
+        keys_.throttle(config.throttle_);
+        if (model_ >= 0) useModel();
+    }
+
     virtual void device(const char *dev, DeviceType dt, int rows, int cols, int ribbons, int pedals) {
         const char *dk;
         switch (dt) {
             case EigenApi::Callback::PICO:
                 dk = "pico";
+                model_ = EigenharpStage::M_PICO;
                 break;
             case EigenApi::Callback::TAU:
                 dk = "tau";
+                model_ = EigenharpStage::M_TAU;
                 break;
             case EigenApi::Callback::ALPHA:
                 dk = "alpha";
+                model_ = EigenharpStage::M_ALPHA;
                 break;
             default:
                 dk = "default";
+                model_ = EigenharpStage::M_DEFAULT;
         }
+        dev_ = dev;
 
-        LOG_1("EigenharpHandler device d: " << dev << " dt: " << (int) dt) << " dk: " << dk;
+        LOG_1("EigenharpHandler device d: " << dev << " dt: " << (int) dt << " dk: " << dk);
         LOG_1(" r: " << rows << " c: " << cols);
         LOG_1(" s: " << ribbons << " p: " << pedals);
 
-        if(prefs_.exists(dk)) {
-            Preferences device_prefs(prefs_.getSubTree(dk));
-
-            if (device_prefs.exists("leds")) {
-                Preferences leds(device_prefs.getSubTree("leds"));
-                if (leds.exists("green")) {
-                    Preferences::Array a(leds.getArray("green"));
-                    for(int i=0;i<a.getSize();i++){ api_->setLED(dev, 0, a.getInt(i),1); }
-                }
-                if (leds.exists("orange")) {
-                    Preferences::Array a(leds.getArray("orange"));
-                    for(int i=0;i<a.getSize();i++){ api_->setLED(dev, 0, a.getInt(i),3); }
-                }
-                if (leds.exists("red")) {
-                    Preferences::Array a(leds.getArray("red"));
-                    for(int i=0;i<a.getSize();i++){ api_->setLED(dev, 0, a.getInt(i),2); }
-                }
-            }
-            if (device_prefs.exists("mapping")) {
-                Preferences map(device_prefs.getSubTree("mapping"));
-                mapper_.load(map);
-            }
-        }
+        keys_.layout(rows > 0 ? (unsigned) rows : 0, cols > 0 ? (unsigned) cols : 0);
+        useModel();
     }
 
 
     virtual void key(const char *dev, unsigned long long t, unsigned course, unsigned key, bool a, unsigned p, int r,
                      int y) {
-        Voices::Voice *voice = voices_.voiceId(key);
-        float mx = bipolar(r);
-        float my = bipolar(y);
-        float mz = unipolar(p);
-        float mn = note(key, mx) + (1024 * course);
-        if (a) {
-
-            LOG_3("EigenharpHandler key device d: " << dev << " a: " << a);
-            LOG_3(" c: " << course << " k: " << key);
-            LOG_3(" r: " << r << " y: " << y << " p: " << p);
-            LOG_3(" mn: " << mn << " mx: " << mx << " my: " << my << " mz: " << mz);
-
-            if (inactiveKeys_.find(key) != inactiveKeys_.end()) {
-                // this key has been stolen, must be released to reactivate it
-                return;
-            }
-
-            if (!voice) {
-
-                voice = voices_.startVoice(key);
-
-                if (!voice && stealVoices_) {
-                    // LOG_1("voice steal required for " << key);
-                    // no available voices, steal?
-                    Voices::Voice *stolen = voices_.oldestActiveVoice();
-                    if(stolen) {
-                        if(stolen->state_ == Voices::Voice::ACTIVE) {
-                            // LOG_1("voice stolen found for " << key  << " stolen from (active) " << stolen->id_);
-                            callback_.touchOff(stolen->i_, stolen->note_, stolen->x_, stolen->y_, 0.0f);
-                        } else {
-                            // LOG_1("voice stolen found for " << key  << " stolen from (inactive) " << stolen->id_);
-                        }
-                        inactiveKeys_.insert((unsigned) stolen->id_);
-                        voices_.stopVoice(stolen);
-                        voice = voices_.startVoice(key);
-                        // if(voice) { LOG_1("voice steal found for " << key << "stolen from " << stolen->id_); }
-                   } else {
-                     LOG_1("unable to steal voice " << key);
-                   }
-                }
-            } 
-
-            if (voice) {
-                if (voice->state_ == Voices::Voice::PENDING) {
-                    voices_.addPressure(voice, mz);
-                    if (voice->state_ == Voices::Voice::ACTIVE) {
-                        LOG_2("start voice for " << key << " ch " << voice->i_);
-                        callback_.touchOn(voice->i_, mn, mx, my, voice->v_); //v_ = calculated velocity
-                        voice->t_ = t;
-                    }
-                    // dont send to callbacks until we have the minimum pressures for velocity
-                } else {
-                    if (throttle_ == 0 || (t - voice->t_) >= throttle_) {
-                        LOG_2("continue voice for " << key << " ch " << voice->i_);
-                        callback_.touchContinue(voice->i_, mn, mx, my, mz);
-                        voice->t_ = t;
-                    }
-                }
-
-                voice->note_ = mn;
-                voice->x_ = mx;
-                voice->y_ = my;
-                voice->z_ = mz;
-            } else {
-                // else no voice available
-                // LOG_2("mark inactive key " << key);
-                inactiveKeys_.insert(key);
-            }
-
-        } else {
-            if (inactiveKeys_.find(key) == inactiveKeys_.end()) {
-                if (voice) {
-                    if(voice->state_ == Voices::Voice::ACTIVE) {
-                        LOG_2("stop voice for " << key << " ch " << voice->i_);
-                        callback_.touchOff(voice->i_, mn, mx, my, mz);
-                        voices_.stopVoice(voice);
-                    }
-                    else if(voice->state_ == Voices::Voice::PENDING) {
-                        // dont send touchoff, as touchOn not sent
-                        voices_.stopVoice(voice);
-                    } else {
-                        LOG_1("voice already inactive" << key << " ch " << voice->i_);
-                    }
-                } else {
-                    LOG_1("trying to stop voice, but not found" << key);
-                }
-            } else {
-                // LOG_2("remove inactive key " << key);
-                inactiveKeys_.erase(key);
-            }
-        }
+        keys_.key(t, course, key, a, p, r, y);
     }
 
     virtual void breath(const char *dev, unsigned long long t, unsigned val) {
@@ -190,33 +120,34 @@ public:
     }
 
 private:
-    inline float clamp(float v, float mn, float mx) { return (std::max(std::min(v, mx), mn)); }
+    void useModel() {
+        const EigenharpConfig::Model &model = stage_->model(model_);
+        if (model.exists_) {
+            const char *dev = dev_.c_str();
+            for (auto led : model.greenLeds_) { api_->setLED(dev, 0, led, 1); }
+            for (auto led : model.orangeLeds_) { api_->setLED(dev, 0, led, 3); }
+            for (auto led : model.redLeds_) { api_->setLED(dev, 0, led, 2); }
+            if (model.hasMapping_) {
+                keys_.mapping(stage_->mappers_[model_]);
+            }
+        }
+    }
 
     float unipolar(int val) { return std::min(float(val) / 4096.0f, 1.0f); }
 
-    float bipolar(int val) { return clamp(float(val) / 4096.0f, -1.0f, 1.0f); }
-
-    //float   note(unsigned key, float mx) { return mapper_.noteFromKey(key) + (mx  * pitchbendRange_) ; }
-    float note(unsigned key, float mx) {
-        return mapper_.noteFromKey(key) + ((mx > 0.0 ? mx * mx : -mx * mx) * pitchbendRange_);
-    }
-    
     EigenApi::Eigenharp* api_;
-    Preferences prefs_;
+    std::shared_ptr<EigenharpStage> stage_;
     ICallback &callback_;
-    SurfaceMapper mapper_;
-    Voices voices_;
     bool valid_;
-    float pitchbendRange_;
-    bool stealVoices_;
-    unsigned long long throttle_;
-    std::set<unsigned> inactiveKeys_;
+    EigenharpKeys keys_;
+    int model_;
+    std::string dev_;
 };
 
 
 ////////////////////////////////////////////////
 Eigenharp::Eigenharp(ICallback &cb) :
-        active_(false), callback_(cb), minPollTime_(100) {
+        callback_(cb), handler_(nullptr), active_(false), minPollTime_(100) {
 }
 
 Eigenharp::~Eigenharp() {
@@ -225,20 +156,26 @@ Eigenharp::~Eigenharp() {
 
 bool Eigenharp::init(void *arg) {
     Preferences prefs(arg);
+    EigenharpConfig config;
+    config.load(prefs, "mec.eigenharp");
+    return init(config);
+}
 
+bool Eigenharp::init(const EigenharpConfig &config) {
     if (active_) {
         LOG_2("Eigenharp::init - already active deinit");
         deinit();
     }
     active_ = false;
-    std::string fwDir = prefs.getString("firmware dir", "./");
-    minPollTime_ = prefs.getInt("min poll time", 100);
-    LOG_0("Eigenharp firmware dir : " << fwDir);
-    eigenD_.reset(new EigenApi::Eigenharp(fwDir.c_str()));
+    config_ = config;
+    minPollTime_ = config.minPollTime_;
+    LOG_0("Eigenharp firmware dir : " << config.firmwareDir_);
+    eigenD_.reset(new EigenApi::Eigenharp(config.firmwareDir_.c_str()));
     eigenD_->setPollTime(minPollTime_);
-    EigenharpHandler *pCb = new EigenharpHandler(eigenD_.get(), prefs, callback_);
+    EigenharpHandler *pCb = new EigenharpHandler(eigenD_.get(), std::make_shared<EigenharpStage>(config), callback_);
     if (pCb->isValid()) {
         eigenD_->addCallback(pCb);
+        handler_ = pCb;
         if (eigenD_->start()) {
             active_ = true;
             LOG_1("Eigenharp::init - started");
@@ -253,7 +190,16 @@ bool Eigenharp::init(void *arg) {
 }
 
 bool Eigenharp::process() {
-    if (active_) eigenD_->process();
+    if (active_) {
+        std::shared_ptr<EigenharpStage> stage;
+        if (stage_.take(stage)) {
+            minPollTime_ = stage->config_.minPollTime_;
+            eigenD_->setPollTime(minPollTime_);
+            handler_->apply(stage);
+            LOG_0("Eigenharp configuration reloaded");
+        }
+        eigenD_->process();
+    }
     return true;
 }
 
@@ -262,6 +208,7 @@ void Eigenharp::deinit() {
     if (!eigenD_) return;
     eigenD_->stop();
     eigenD_.reset();
+    handler_ = nullptr;
     active_ = false;
 }
 
@@ -269,6 +216,21 @@ bool Eigenharp::isActive() {
     return active_;
 }
 
+bool Eigenharp::reload(const MecConfig &config) {
+    if (!config.eigenharp_ || !active_) return false;
+    const EigenharpConfig &c = *config.eigenharp_;
+    bool ret = true;
+    if (c.firmwareDir_ != config_.firmwareDir_
+        || c.velocityCount_ != config_.velocityCount_
+        || c.velocityCurve_ != config_.velocityCurve_
+        || c.velocityScale_ != config_.velocityScale_) {
+        LOG_0("Eigenharp firmware dir and velocity changes require a restart");
+        ret = false;
+    }
+    stage_.publish(std::make_shared<EigenharpStage>(c));
+    return ret;
+}
+
 }
 
 
@@ -6,22 +6,33 @@
 #include <eigenapi.h>
 #include <memory>
 
+#include <mec_pending.h>
+
 namespace mec {
+
+class EigenharpHandler;
+struct EigenharpStage;
+
 class Eigenharp : public Device {
 
 public:
     Eigenharp(ICallback &);
     virtual ~Eigenharp();
     virtual bool init(void *);
+    bool init(const EigenharpConfig &);
     virtual bool process();
     virtual void deinit();
     virtual bool isActive();
+    virtual bool reload(const MecConfig &);
 
 private:
     ICallback &callback_;
     std::unique_ptr<EigenApi::Eigenharp> eigenD_;
+    EigenharpHandler *handler_; // registered with eigenD_
     bool active_;
     long minPollTime_;
+    EigenharpConfig config_;
+    Pending<EigenharpStage> stage_;
 };
 
 }
@@ -0,0 +1,114 @@
+#include "mec_eigenharp_keys.h"
+
+#include "mec_log.h"
+#include "../mec_voice_allocator.h"
+
+namespace mec {
+
+const unsigned EigenharpKeys::COURSES;
+
+EigenharpKeys::EigenharpKeys(ICallback &cb, unsigned velocityCount, float velocityCurve, float velocityScale)
+    : callback_(cb),
+      voices_(VoiceAllocator::MAX_TOUCHES, velocityCount, velocityCurve, velocityScale),
+      pitchbendRange_(2.0f),
+      throttle_(0),
+      rows_(0),
+      cols_(0) {
+    compile();
+}
+
+void EigenharpKeys::layout(unsigned rows, unsigned cols) {
+    for (unsigned i = 0; i < keys_.size(); i++) {
+        Voices::Voice *voice = keys_[i];
+        if (!voice) continue;
+        if (voice->state_ == Voices::Voice::ACTIVE) {
+            callback_.touchOff(voice->i_, voice->note_, voice->x_, voice->y_, 0.0f);
+        }
+        voices_.stopVoice(voice);
+    }
+    keys_.clear();
+    ignored_.clear();
+    rows_ = rows;
+    cols_ = cols;
+    compile();
+}
+
+void EigenharpKeys::mapping(const SurfaceMapper &mapper) {
+    mapper_ = mapper;
+    compile();
+}
+
+void EigenharpKeys::compile() {
+    mapper_.compile(rows_, cols_, COURSES, map_);
+    keys_.resize(map_.size(), nullptr);
+    ignored_.resize(map_.size(), false);
+}
+
+void EigenharpKeys::key(unsigned long long t, unsigned course, unsigned key, bool a, unsigned p, int r, int y) {
+    int idx = map_.index(course, key);
+    if (idx < 0) {
+        // realtime path, only at a debug level
+        LOG_2("EigenharpKeys key not on device c: " << course << " k: " << key);
+        return;
+    }
+    Voices::Voice *voice = keys_[idx];
+    float mx = bipolar(r);
+    float my = bipolar(y);
+    float mz = unipolar(p);
+    float mn = map_.key(idx).note_ + ((mx > 0.0 ? mx * mx : -mx * mx) * pitchbendRange_);
+
+    if (a) {
+        LOG_3("EigenharpKeys key c: " << course << " k: " << key);
+        LOG_3(" r: " << r << " y: " << y << " p: " << p);
+        LOG_3(" mn: " << mn << " mx: " << mx << " my: " << my << " mz: " << mz);
+
+        if (!voice) {
+            if (ignored_[idx]) return;
+            // voice limits and stealing are applied by the api, see VoiceAllocator
+            voice = voices_.startVoice((unsigned) idx);
+            if (!voice) {
+                ignored_[idx] = true;
+                return;
+            }
+            keys_[idx] = voice;
+        }
+
+        if (voice->state_ == Voices::Voice::PENDING) {
+            voices_.addPressure(voice, mz);
+            if (voice->state_ == Voices::Voice::ACTIVE) {
+                LOG_2("start voice for " << key << " (" << map_.key(idx).row_ << "," << map_.key(idx).col_ << ")"
+                                         << " ch " << voice->i_);
+                callback_.touchOn(voice->i_, mn, mx, my, voice->v_); //v_ = calculated velocity
+                voice->t_ = t;
+            }
+            // dont send to callbacks until we have the minimum pressures for velocity
+        } else {
+            if (throttle_ == 0 || (t - voice->t_) >= throttle_) {
+                LOG_2("continue voice for " << key << " ch " << voice->i_);
+                callback_.touchContinue(voice->i_, mn, mx, my, mz);
+                voice->t_ = t;
+            }
+        }
+
+        voice->note_ = mn;
+        voice->x_ = mx;
+        voice->y_ = my;
+        voice->z_ = mz;
+    } else {
+        if (voice) {
+            if (voice->state_ == Voices::Voice::ACTIVE) {
+                LOG_2("stop voice for " << key << " ch " << voice->i_);
+                callback_.touchOff(voice->i_, mn, mx, my, mz);
+            }
+            // else pending, dont send touchoff, as touchOn not sent
+            voices_.stopVoice(voice);
+            keys_[idx] = nullptr;
+        } else if (ignored_[idx]) {
+            ignored_[idx] = false;
+        } else {
+            LOG_1("trying to stop voice, but not found" << key);
+        }
+    }
+}
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "../mec_api.h"
+#include "../mec_surfacemapper.h"
+#include "../mec_voice.h"
+
+namespace mec {
+
+// eigenharp key events to touches, kept apart from EigenApi so it can be replayed without a device (b_eigenharp)
+// state is direct mapped by (course, key), from the mapping compiled for the devices layout,
+// so a key update does no searching or mapping arithmetic
+class EigenharpKeys {
+public:
+    static const unsigned COURSES = 2; // main keys, percussion/mode keys
+
+    EigenharpKeys(ICallback &cb, unsigned velocityCount, float velocityCurve, float velocityScale);
+
+    void pitchbendRange(float range) { pitchbendRange_ = range; }
+    // maximum continues per second, per key, 0 = unthrottled
+    void throttle(unsigned perSecond) { throttle_ = perSecond == 0 ? 0 : 1000000ULL / perSecond; }
+
+    // as reported by the device, active keys are released
+    void layout(unsigned rows, unsigned cols);
+    // active keys keep their voices
+    void mapping(const SurfaceMapper &mapper);
+
+    void key(unsigned long long t, unsigned course, unsigned key, bool a, unsigned p, int r, int y);
+
+private:
+    void compile();
+
+    static float unipolar(int val) { return std::min(float(val) / 4096.0f, 1.0f); }
+
+    static float bipolar(int val) { return std::max(std::min(float(val) / 4096.0f, 1.0f), -1.0f); }
+
+    ICallback &callback_;
+    Voices voices_;
+    float pitchbendRange_;
+    unsigned long long throttle_;
+    unsigned rows_;
+    unsigned cols_;
+    SurfaceMapper mapper_;
+    SurfaceMap map_;
+    std::vector<Voices::Voice *> keys_; // by map index
+    std::vector<bool> ignored_;         // pressed when no voice was available, ignored until released
+};
+
+}
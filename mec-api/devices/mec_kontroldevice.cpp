@@ -1,16 +1,19 @@
 #include "mec_kontroldevice.h"
 
 #include "mec_log.h"
+#include "mec_metrics.h"
+#include "mec_threads.h"
 
 namespace mec {
 
 
-static const unsigned OSC_POLL_MS = 10;
+static const std::chrono::seconds PING_FREQUENCY(5);
 
 ////////////////////////////////////////////////
 KontrolDevice::KontrolDevice(ICallback &cb) :
         active_(false), callback_(cb),
-        listenPort_(0) {
+        listenPort_(0),
+        modulationRate_(Kontrol::OSCBroadcaster::MODULATION_RATE_MS) {
     model_ = Kontrol::KontrolModel::model();
 }
 
@@ -50,6 +53,7 @@ public:
 };
 
 void *kontroldevice_processor_func(void *pKontrolDevice) {
+    ThreadRegistration registration("kontrol.dev");
     KontrolDevice *pThis = static_cast<KontrolDevice *>(pKontrolDevice);
     pThis->processorRun();
     return nullptr;
@@ -58,7 +62,12 @@ void *kontroldevice_processor_func(void *pKontrolDevice) {
 
 bool KontrolDevice::init(void *arg) {
     Preferences prefs(arg);
+    KontrolDeviceConfig config;
+    config.load(prefs, "mec.kontrol");
+    return init(config);
+}
 
+bool KontrolDevice::init(const KontrolDeviceConfig &config) {
     LOG_0("KontrolDevice::init");
 
     if (active_) {
@@ -68,9 +77,17 @@ bool KontrolDevice::init(void *arg) {
 
     model_->addCallback("clienthandler", std::make_shared<KontrolDeviceClientHandler>(*this));
 
-    listenPort_ = static_cast<unsigned>(prefs.getInt("listen port", 6000));
+    listen_ = config.listen_;
+    listenPort_ = config.listenPort_;
+    modulationRate_ = config.modulationRate_;
 
-    if (listenPort_ > 0) {
+    if (!config.listen_.empty()) {
+        auto p = std::make_shared<Kontrol::OSCReceiver>(model_);
+        if (p->listen(config.listen_)) {
+            osc_receiver_ = p;
+            LOG_0("kontrol device : listening on " << config.listen_);
+        }
+    } else if (listenPort_ > 0) {
         auto p = std::make_shared<Kontrol::OSCReceiver>(model_);
         if (p->listen(listenPort_)) {
             osc_receiver_ = p;
@@ -79,7 +96,8 @@ bool KontrolDevice::init(void *arg) {
     }
 
     active_ = true;
-    processor_ = std::thread(kontroldevice_processor_func, this);
+    // only packets and pings to handle
+    if (osc_receiver_) processor_ = std::thread(kontroldevice_processor_func, this);
 
     LOG_0("KontrolDevice::init - complete");
     return active_;
@@ -100,6 +118,7 @@ void KontrolDevice::newClient(
     std::string id = "client.osc:" + host + ":" + std::to_string(port);
 
     auto client = std::make_shared<Kontrol::OSCBroadcaster>(src, keepalive, true);
+    client->modulationRate(modulationRate_);
     if (client->connect(host, port)) {
         LOG_0("KontrolDevice::new client " << client->host() << " : " << client->port() << " KA = " << keepalive);
 //        client->sendPing(listenPort_);
@@ -111,46 +130,53 @@ void KontrolDevice::newClient(
 
 
 void KontrolDevice::processorRun() {
+    Histogram &pollTime = Metrics::histogram("kontrol.poll_us");
+    Gauge &clients = Metrics::gauge("kontrol.clients");
+    auto nextPing = std::chrono::steady_clock::now();
     while (active_) {
-        if (osc_receiver_) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= nextPing) {
+            pingClients();
+            clients.set((int64_t) clients_.size());
+            nextPing = now + PING_FREQUENCY;
+        }
+
+        // until a packet arrives, or the next ping is due
+        if (osc_receiver_->wait(std::chrono::duration_cast<std::chrono::microseconds>(nextPing - now))) {
+            ScopedTimer timer(pollTime);
             osc_receiver_->poll();
+        }
+    }
+}
 
-            static const std::chrono::seconds pingFrequency(5);
-            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
-            auto dur = std::chrono::duration_cast<std::chrono::seconds>(now - lastPing_);
-            if (dur >= pingFrequency) {
-                lastPing_ = now;
-                bool inactive = false;
-                for (auto client : clients_) {
-                    if (!client->isActive()) {
-                        // not received a ping from this client
-                        inactive = true;
-                    } else {
-                        client->sendPing(osc_receiver_->port());
-                    }
-                }
-
-                // search for inactive clients and remove
-                while (inactive) {
-                    inactive = false;
-                    for (auto it = clients_.begin(); !inactive && it != clients_.end();) {
-                        auto client = *it;
-                        if (!client->isActive()) {
-                            LOG_0("KontrolDevice::Process... remove inactive client " << client->host() << " : "
-                                                                                      << client->port());
-                            Kontrol::EntityId rackId = Kontrol::Rack::createId(client->host(), client->port());
-                            client->stop();
-                            clients_.erase(it);
-                            model_->deleteRack(Kontrol::CS_LOCAL, rackId);
-                            inactive = true;
-                        } else {
-                            it++;
-                        }
-                    }
-                }
+void KontrolDevice::pingClients() {
+    bool inactive = false;
+    for (auto client : clients_) {
+        if (!client->isActive()) {
+            // not received a ping from this client
+            inactive = true;
+        } else {
+            client->sendPing(osc_receiver_->port(), osc_receiver_->endpoint());
+        }
+    }
+
+    // search for inactive clients and remove
+    while (inactive) {
+        inactive = false;
+        for (auto it = clients_.begin(); !inactive && it != clients_.end();) {
+            auto client = *it;
+            if (!client->isActive()) {
+                LOG_0("KontrolDevice::Process... remove inactive client " << client->host() << " : "
+                                                                          << client->port());
+                Kontrol::EntityId rackId = Kontrol::Rack::createId(client->host(), client->port());
+                client->stop();
+                clients_.erase(it);
+                model_->deleteRack(Kontrol::CS_LOCAL, rackId);
+                inactive = true;
+            } else {
+                it++;
             }
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(OSC_POLL_MS));
     }
 }
 
@@ -162,22 +188,34 @@ bool KontrolDevice::process() {
 
 void KontrolDevice::deinit() {
     LOG_0("KontrolDevice::deinit");
-    for (auto client : clients_) {
-        client->stop();
-    }
-    clients_.clear();
-    if (osc_receiver_) osc_receiver_->stop();
-
     active_ = false;
+    // wakes the processor
+    if (osc_receiver_) osc_receiver_->stop();
     if (processor_.joinable()) {
         processor_.join();
     }
+
+    for (auto client : clients_) {
+        client->stop();
+    }
+    clients_.clear();
 }
 
 bool KontrolDevice::isActive() {
     return active_;
 }
 
+bool KontrolDevice::reload(const MecConfig &config) {
+    if (!config.kontrol_ || !active_) return false;
+    const KontrolDeviceConfig &c = *config.kontrol_;
+    // clients are created with the modulation rate, on the processor thread
+    if (c.listen_ != listen_ || c.listenPort_ != listenPort_ || c.modulationRate_ != modulationRate_) {
+        LOG_0("KontrolDevice configuration changes require a restart");
+        return false;
+    }
+    return true;
+}
+
 }
 
 
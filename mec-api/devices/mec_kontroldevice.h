@@ -20,21 +20,26 @@ public:
     KontrolDevice(ICallback &);
     virtual ~KontrolDevice();
     virtual bool init(void *);
+    bool init(const KontrolDeviceConfig &);
     virtual bool process();
     virtual void deinit();
     virtual bool isActive();
+    virtual bool reload(const MecConfig &);
 
     void newClient(Kontrol::ChangeSource src, const std::string &host, unsigned port, unsigned keepalive);
+    // applies changes as packets are received, pings clients on a deadline
     void processorRun();
 private:
+    void pingClients();
 
     ICallback &callback_;
     bool active_;
+    std::string listen_;
     unsigned listenPort_;
+    unsigned modulationRate_;
 
     std::shared_ptr<Kontrol::KontrolModel> model_;
     std::shared_ptr<Kontrol::OSCReceiver> osc_receiver_;
-    std::chrono::steady_clock::time_point lastPing_;
     std::vector<std::shared_ptr<Kontrol::OSCBroadcaster> > clients_;
     std::thread processor_;
 };
@@ -71,7 +71,7 @@ bool findMidiPortId(unsigned &result, const std::string &portName, bool outputPo
 
 ////////////////////////////////////////////////
 MidiDevice::MidiDevice(ICallback &cb) :
-        active_(false), callback_(cb) {
+        active_(false), callback_(cb), queue_("midi.in.queue") {
 }
 
 MidiDevice::~MidiDevice() {
@@ -92,15 +92,21 @@ RtMidiIn::RtMidiCallback MidiDevice::getMidiCallback() {
 
 bool MidiDevice::init(void *arg) {
     Preferences prefs(arg);
+    MidiDeviceConfig config;
+    config.load(prefs, "mec.midi");
+    return init(config);
+}
 
+bool MidiDevice::init(const MidiDeviceConfig &config) {
     if (active_) {
         deinit();
     }
     active_ = false;
+    config_ = config;
 
     bool found = false;
 
-    std::string input_device = prefs.getString("input device");
+    const std::string &input_device = config.inputDevice_;
     if (!input_device.empty()) {
 
         try {
@@ -111,8 +117,8 @@ bool MidiDevice::init(void *arg) {
             return false;
         }
 
-        mpeMode_ = prefs.getBool("mpe", true);
-        pitchbendRange_ = (float) prefs.getDouble("pitchbend range", 48.0);
+        mpeMode_ = config.mpe_;
+        pitchbendRange_ = config.pitchbendRange_;
 
         unsigned port;
         if (findMidiPortId(port, input_device.c_str(), false)) {
@@ -139,9 +145,9 @@ bool MidiDevice::init(void *arg) {
         midiInDevice_->setCallback(getMidiCallback(), this);
     } //midi input
 
-    std::string output_device = prefs.getString("output device");
+    const std::string &output_device = config.outputDevice_;
     if (!output_device.empty()) {
-        bool virt = prefs.getBool("virtual output", false);
+        bool virt = config.virtualOutput_;
         try {
             midiOutDevice_.reset(new RtMidiOut(RtMidi::Api::UNSPECIFIED, "MEC MIDI OUT DEVICE"));
         } catch (RtMidiError &error) {
@@ -205,7 +211,29 @@ bool MidiDevice::isActive() {
     return active_;
 }
 
+bool MidiDevice::reload(const MecConfig &config) {
+    if (!config.midi_ || !active_) return false;
+    const MidiDeviceConfig &c = *config.midi_;
+    if (c.inputDevice_ != config_.inputDevice_
+        || c.outputDevice_ != config_.outputDevice_
+        || c.virtualOutput_ != config_.virtualOutput_) {
+        // not applied, the restart takes up the whole change
+        LOG_0("MidiDevice device changes require a restart");
+        return false;
+    }
+    pending_.publish(std::make_shared<MidiDeviceConfig>(c));
+    return true;
+}
+
 bool MidiDevice::midiCallback(double, std::vector<unsigned char> *message) {
+    std::shared_ptr<MidiDeviceConfig> config;
+    if (pending_.take(config)) {
+        // touches keep their start note, so continue with the new range
+        mpeMode_ = config->mpe_;
+        pitchbendRange_ = config->pitchbendRange_;
+        LOG_0("MidiDevice configuration reloaded");
+    }
+
     int status = 0, data1 = 0, data2 = 0; //data3 = 0;
     unsigned int n = message->size();
     if (n > 3) LOG_0("midiCallback unexpect midi size" << n);
@@ -10,6 +10,8 @@
 #include <memory>
 #include <vector>
 
+#include <mec_pending.h>
+
 namespace mec {
 
 class MidiDevice : public Device {
@@ -18,9 +20,11 @@ public:
     MidiDevice(ICallback &);
     virtual ~MidiDevice();
     virtual bool init(void *);
+    virtual bool init(const MidiDeviceConfig &);
     virtual bool process();
     virtual void deinit();
     virtual bool isActive();
+    virtual bool reload(const MecConfig &);
 
     virtual bool midiCallback(double deltatime, std::vector<unsigned char> *message);
 
@@ -86,6 +90,9 @@ protected:
 
     float pitchbendRange_;
     bool mpeMode_;
+
+    MidiDeviceConfig config_;
+    Pending<MidiDeviceConfig> pending_; // reloaded, applied before the next midi message
 };
 
 
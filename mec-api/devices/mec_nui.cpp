@@ -1,7 +1,8 @@
 #include "mec_nui.h"
 
 #include <algorithm>
-#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
 #include <unordered_set>
 
 #include <ip/UdpSocket.h>
@@ -11,6 +12,7 @@
 #include <readerwriterqueue.h>
 
 #include <mec_log.h>
+#include <mec_threads.h>
 
 #include "nui/nui_basemode.h"
 #include "nui/nui_menu.h"
@@ -29,27 +31,29 @@ namespace mec
 
     static const unsigned LINE_H = 10;
 
+    void *nui_thread_func(void *pNui);
+
     Nui::~Nui() { deinit(); }
 
     bool Nui::init(void *arg)
     {
         Preferences prefs(arg);
+        NuiConfig config;
+        config.load(prefs, "mec.nui");
+        return init(config);
+    }
 
-        static const auto MENU_TIMEOUT = 2000;
-        static const auto POLL_FREQ = 1;
-        static const auto POLL_SLEEP = 1000;
-        menuTimeout_ = prefs.getInt("menu timeout", MENU_TIMEOUT);
-        std::string res =
-            prefs.getString("resource path", "/home/we/norns/resources");
-        std::string splash = prefs.getString("splash", "./oracsplash4.png");
-        device_ = std::make_shared<NuiLite::NuiDevice>(res.c_str());
-        pollFreq_ = prefs.getInt("poll freq", POLL_FREQ);
-        pollSleep_ = prefs.getInt("poll sleep", POLL_SLEEP);
-        pollCount_ = 0;
+    bool Nui::init(const NuiConfig &config)
+    {
+        config_ = config;
+        menuTimeout_ = config.menuTimeout_;
+        device_ = std::make_shared<NuiLite::NuiDevice>(config.resourcePath_.c_str());
+        pollInterval_ = std::max(config.pollFreq_ * config.pollSleep_, 1u);
+        frame_.maxFps(config.maxFps_);
         if (!device_)
             return false;
 
-        unsigned parammode = prefs.getInt("param display", 0);
+        unsigned parammode = config.paramDisplay_;
 
         std::shared_ptr<NuiLite::NuiCallback> cb =
             std::make_shared<NuiDeviceCallback>(*this);
@@ -62,8 +66,7 @@ namespace mec
             deinit();
         }
         active_ = false;
-        listenRunning_ = false;
-        unsigned listenPort = prefs.getInt("listen port", 6100);
+        unsigned listenPort = config.listenPort_;
 
         auxActive_ = false;
         auxLed_ = 0;
@@ -91,27 +94,35 @@ namespace mec
 
             listen(listenPort);
         }
-        device_->drawPNG(0, 0, splash.c_str());
+        device_->drawPNG(0, 0, config.splash_.c_str());
         device_->displayText(15, 0, 1, "Connecting...");
+        // the splash stays, until the modes next draw
+        frame_.flush(changes_, true);
+        wipe_ = true;
+
+        if (active_)
+        {
+            running_ = true;
+            worker_ = std::thread(nui_thread_func, this);
+        }
         return active_;
     }
 
     void Nui::deinit()
     {
-        listenRunning_ = false;
-
-        if (readSocket_)
+        if (worker_.joinable())
         {
-            readSocket_->AsynchronousBreak();
-            receive_thread_.join();
-            OscMsg msg;
-            while (readMessageQueue_.try_dequeue(msg))
-                ;
+            running_ = false;
+            wakeup();
+            worker_.join();
         }
-        listenPort_ = 0;
-        readSocket_.reset();
 
-        device_->stop();
+        receiver_.stop();
+        for (auto p = receiver_.next(); p != nullptr; p = receiver_.next())
+            receiver_.release(p);
+
+        if (device_)
+            device_->stop();
         device_ = nullptr;
         active_ = false;
         return;
@@ -119,6 +130,22 @@ namespace mec
 
     bool Nui::isActive() { return active_; }
 
+    bool Nui::reload(const MecConfig &config)
+    {
+        if (!config.nui_ || !active_)
+            return false;
+        const NuiConfig &c = *config.nui_;
+        if (c.menuTimeout_ != config_.menuTimeout_ || c.resourcePath_ != config_.resourcePath_
+            || c.splash_ != config_.splash_ || c.pollFreq_ != config_.pollFreq_
+            || c.pollSleep_ != config_.pollSleep_ || c.paramDisplay_ != config_.paramDisplay_
+            || c.maxFps_ != config_.maxFps_ || c.listenPort_ != config_.listenPort_)
+        {
+            LOG_0("Nui configuration changes require a restart");
+            return false;
+        }
+        return true;
+    }
+
     void Nui::stop() { deinit(); }
 
     //--modes and forwarding
@@ -326,6 +353,20 @@ namespace mec
         modes_[currentMode_]->loadPreset(source, rack, preset);
     }
 
+    void Nui::queueButton(unsigned id, unsigned value)
+    {
+        DeviceEvent e = {true, id, (int)value};
+        deviceQueue_.enqueue(e);
+        wakeup();
+    }
+
+    void Nui::queueEncoder(unsigned id, int value)
+    {
+        DeviceEvent e = {false, id, value};
+        deviceQueue_.enqueue(e);
+        wakeup();
+    }
+
     void Nui::onButton(unsigned id, unsigned value)
     {
         modes_[currentMode_]->onButton(id, value);
@@ -352,51 +393,78 @@ namespace mec
 
     void Nui::clearDisplay()
     {
-        if (!device_)
-            return;
-        device_->displayClear();
+        frame_.clear();
+        frame_.clearFields();
     }
 
-    void Nui::clearParamNum(unsigned num)
+    static std::string paramField(unsigned num, const char *name)
     {
-        if (!device_)
-            return;
+        return "P" + std::to_string(num) + name;
+    }
 
-        unsigned row, col;
-        switch (num)
-        {
-        case 0:
-            row = 0, col = 0;
-            break;
-        case 1:
-            row = 0, col = 1;
-            break;
-        case 2:
-            row = 1, col = 0;
-            break;
-        case 3:
-            row = 1, col = 1;
-            break;
-        default:
-            return;
-        }
-        unsigned x = col * 64;
-        unsigned y1 = (row + 1) * 20;
-        unsigned y2 = y1 + LINE_H;
-        device_->clearRect(0, x, y1, 62 + (col * 2), LINE_H);
-        device_->clearRect(0, x, y2, 62 + (col * 2), LINE_H);
+    void Nui::clearParamNum(unsigned num)
+    {
+        frame_.field(paramField(num, "Name"), Kontrol::DisplayFrame::Text());
+        frame_.field(paramField(num, "Value"), Kontrol::DisplayFrame::Text());
     }
 
     void Nui::displayParamNum(unsigned num, const Kontrol::Parameter &param,
                               bool dispCtrl, bool selected)
     {
-        if (!device_)
+        Kontrol::DisplayFrame::Text name;
+        name.text_ = param.displayName();
+        name.inverted_ = selected;
+        frame_.field(paramField(num, "Name"), name);
+
+        Kontrol::DisplayFrame::Text value;
+        value.text_ = param.displayValue();
+        value.aux_ = param.displayUnit();
+        frame_.field(paramField(num, "Value"), value);
+    }
+
+    void Nui::displayLine(unsigned line, const char *disp)
+    {
+        frame_.line(line, disp ? disp : "");
+    }
+
+    void Nui::invertLine(unsigned line)
+    {
+        frame_.invert(line);
+    }
+
+    void Nui::displayTitle(const std::string &module, const std::string &page)
+    {
+        if (module.size() == 0 || page.size() == 0)
             return;
-        const std::string &dName = param.displayName();
-        std::string value = param.displayValue();
-        std::string unit = param.displayUnit();
+        Kontrol::DisplayFrame::Text title;
+        title.text_ = module + " > " + page;
+        frame_.field("title", title);
+    }
 
-        unsigned row, col;
+    void Nui::displayStatusBar()
+    {
+        std::string status = "";
+        if (auxActive_)
+        {
+            status += "+";
+        }
+        else
+        {
+            status += "-";
+        }
+
+        status += " |";
+        status += std::to_string(auxLed_);
+        status += "| ";
+        status += auxLine_;
+
+        Kontrol::DisplayFrame::Text text;
+        text.text_ = status;
+        frame_.field("status", text);
+    }
+
+    static bool paramPosition(unsigned num, unsigned &row, unsigned &col)
+    {
         switch (num)
         {
         case 0:
@@ -412,69 +480,106 @@ namespace mec
             row = 1, col = 1;
             break;
         default:
-            return;
+            return false;
         }
+        return true;
+    }
 
+    void Nui::drawParamName(unsigned num, const Kontrol::DisplayFrame::Text &text)
+    {
+        unsigned row, col;
+        if (!paramPosition(num, row, col))
+            return;
         unsigned x = col * 64;
         unsigned y1 = (row + 1) * 20;
-        unsigned y2 = y1 + LINE_H;
-        unsigned clr = selected ? 15 : 0;
+        if (text.text_.empty())
+        {
+            device_->clearRect(0, x, y1 - LINE_H, 62 + (col * 2), LINE_H);
+            return;
+        }
+        unsigned clr = text.inverted_ ? 15 : 0;
         device_->clearRect(5, x, y1 - LINE_H, 62 + (col * 2), LINE_H);
-        device_->drawText(clr, x + 1, y1 - 1, dName.c_str());
-        device_->clearRect(0, x, y2 - LINE_H, 62 + (col * 2), LINE_H);
-        device_->drawText(15, x + 1, y2 - 1, value);
-        device_->drawText(15, x + 1 + 40, y2 - 1, unit);
+        device_->drawText(clr, x + 1, y1 - 1, text.text_.c_str());
     }
 
-    void Nui::displayLine(unsigned line, const char *disp)
+    void Nui::drawParamValue(unsigned num, const Kontrol::DisplayFrame::Text &text)
     {
-        if (!device_)
+        unsigned row, col;
+        if (!paramPosition(num, row, col))
             return;
-        device_->clearText(0, line);
-        device_->displayText(15, line, 0, disp);
-    }
-
-    void Nui::invertLine(unsigned line)
-    {
-        if (!device_)
+        unsigned x = col * 64;
+        unsigned y2 = (row + 1) * 20 + LINE_H;
+        device_->clearRect(0, x, y2 - LINE_H, 62 + (col * 2), LINE_H);
+        if (text.text_.empty() && text.aux_.empty())
             return;
-        device_->invertText(line);
+        device_->drawText(15, x + 1, y2 - 1, text.text_);
+        device_->drawText(15, x + 1 + 40, y2 - 1, text.aux_);
     }
 
-    void Nui::displayTitle(const std::string &module, const std::string &page)
+    // only what changed since the last flush is redrawn
+    void Nui::flushDisplay()
     {
         if (!device_)
             return;
-        if (module.size() == 0 || page.size() == 0)
+        // something else is drawing, so redraw everything when it is done
+        if (yieldDisplay_)
+        {
+            wipe_ = true;
             return;
-        std::string title = module + " > " + page;
-
-        device_->clearRect(1, 0, 0, 128, LINE_H);
-        device_->drawText(15, 0, 8, title.c_str());
-    }
+        }
 
-    void Nui::displayStatusBar()
-    {
-        if (!device_)
+        bool force = false;
+        if (wipe_ && frame_.changed())
+        {
+            wipe_ = false;
+            device_->displayClear();
+            frame_.invalidate();
+            force = true;
+        }
+        if (!frame_.flush(changes_, force))
             return;
-        device_->clearRect(0, 1, 60, 128, LINE_H);
 
-        std::string status = "";
-        if (auxActive_)
+        for (const auto &l : changes_.lines_)
         {
-            status += "+";
+            if (l.text_.text_ != l.previous_.text_)
+            {
+                // clearing the line, also clears its inversion
+                device_->clearText(0, l.line_);
+                if (!l.text_.text_.empty())
+                    device_->displayText(15, l.line_, 0, l.text_.text_.c_str());
+                if (l.text_.inverted_)
+                    device_->invertText(l.line_);
+            }
+            else if (l.text_.inverted_ != l.previous_.inverted_)
+            {
+                device_->invertText(l.line_);
+            }
         }
-        else
+
+        for (const auto &f : changes_.fields_)
         {
-            status += "-";
+            const std::string &name = f.name_;
+            if (name == "title")
+            {
+                device_->clearRect(f.text_.text_.empty() ? 0 : 1, 0, 0, 128, LINE_H);
+                if (!f.text_.text_.empty())
+                    device_->drawText(15, 0, 8, f.text_.text_.c_str());
+            }
+            else if (name == "status")
+            {
+                device_->clearRect(0, 1, 60, 128, LINE_H);
+                if (!f.text_.text_.empty())
+                    device_->drawText(15, 1, 60, f.text_.text_);
+            }
+            else if (name.size() > 1 && name[0] == 'P')
+            {
+                unsigned num = (unsigned)std::strtoul(name.c_str() + 1, nullptr, 10);
+                if (name.find("Name") != std::string::npos)
+                    drawParamName(num, f.text_);
+                else
+                    drawParamValue(num, f.text_);
+            }
         }
-
-        status += " |";
-        status += std::to_string(auxLed_);
-        status += "| ";
-        status += auxLine_;
-
-        device_->drawText(15, 1, 60, status);
     }
 
     void Nui::currentModule(const Kontrol::EntityId &modId)
@@ -498,71 +603,12 @@ namespace mec
 
     // OSC
 
-    void *nui_osc_read_thread_func(void *pReceiver)
-    {
-        Nui *pThis = static_cast<Nui *>(pReceiver);
-        pThis->readSocket()->Run();
-        return nullptr;
-    }
-
     bool Nui::listen(unsigned port)
     {
-
-        if (readSocket_)
-        {
-            listenRunning_ = false;
-            readSocket_->AsynchronousBreak();
-            receive_thread_.join();
-            OscMsg msg;
-            while (readMessageQueue_.try_dequeue(msg))
-                ;
-        }
-        listenPort_ = 0;
-        readSocket_.reset();
-
-        listenPort_ = port;
-        try
-        {
-            LOG_0("listening for clients on " << port);
-            readSocket_ = std::make_shared<UdpListeningReceiveSocket>(
-                IpEndpointName(IpEndpointName::ANY_ADDRESS, listenPort_),
-                packetListener_.get());
-
-            listenRunning_ = true;
-            receive_thread_ = std::thread(nui_osc_read_thread_func, this);
-        }
-        catch (const std::runtime_error &e)
-        {
-            listenPort_ = 0;
-            return false;
-        }
-        return true;
+        LOG_0("listening for clients on " << port);
+        return receiver_.listen(port);
     }
 
-    class NuiPacketListener : public PacketListener
-    {
-    public:
-        NuiPacketListener(moodycamel::ReaderWriterQueue<Nui::OscMsg> &queue)
-            : queue_(queue) {}
-
-        virtual void ProcessPacket(const char *data, int size,
-                                   const IpEndpointName &remoteEndpoint)
-        {
-
-            Nui::OscMsg msg;
-            //        msg.origin_ = remoteEndpoint;
-            msg.size_ = (size > Nui::OscMsg::MAX_OSC_MESSAGE_SIZE
-                             ? Nui::OscMsg::MAX_OSC_MESSAGE_SIZE
-                             : size);
-            memcpy(msg.buffer_, data, (size_t)msg.size_);
-            msg.origin_ = remoteEndpoint;
-            queue_.enqueue(msg);
-        }
-
-    private:
-        moodycamel::ReaderWriterQueue<Nui::OscMsg> &queue_;
-    };
-
     // Osc implmentation
     class NuiListener : public osc::OscPacketListener
     {
@@ -715,36 +761,89 @@ namespace mec
     };
 
     Nui::Nui()
-        : readMessageQueue_(OscMsg::MAX_N_OSC_MSGS), active_(false),
-          listenRunning_(false), modulationLearnActive_(false),
-          midiLearnActive_(false)
+        : receiver_("nui.recv", MAX_N_OSC_MSGS, MAX_OSC_MESSAGE_SIZE), active_(false),
+          modulationLearnActive_(false),
+          midiLearnActive_(false), deviceQueue_(DeviceEvent::MAX_N_EVENTS),
+          wakePending_(false), running_(false),
+          frame_(NUI_NUM_TEXTLINES + 1), wipe_(true)
     {
-        packetListener_ = std::make_shared<NuiPacketListener>(readMessageQueue_);
+        receiver_.notify([this]() { wakeup(); });
         oscListener_ = std::make_shared<NuiListener>(*this);
     }
 
-    // Kontrol::KontrolCallback
     bool Nui::process()
     {
-        OscMsg msg;
-        while (readMessageQueue_.try_dequeue(msg))
+        // see run
+        return true;
+    }
+
+    void *nui_thread_func(void *pNui)
+    {
+        ThreadRegistration registration("nui");
+        Nui *pThis = static_cast<Nui *>(pNui);
+        pThis->run();
+        return nullptr;
+    }
+
+    void Nui::wakeup()
+    {
         {
-            oscListener_->ProcessPacket(msg.buffer_, msg.size_, msg.origin_);
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            wakePending_ = true;
         }
+        wakeCondition_.notify_one();
+    }
 
-        pollCount_++;
-        if ((pollCount_ % pollFreq_) == 0)
+    void Nui::dispatch()
+    {
+        for (auto p = receiver_.next(); p != nullptr; p = receiver_.next())
         {
-            modes_[currentMode_]->poll();
-            if (device_)
-                device_->process();
+            oscListener_->ProcessPacket(p->data_.get(), p->size_, p->origin_);
+            receiver_.release(p);
         }
 
-        if (pollSleep_)
+        DeviceEvent e;
+        while (deviceQueue_.try_dequeue(e))
         {
-            usleep(pollSleep_);
+            if (e.button_)
+                onButton(e.id_, (unsigned)e.value_);
+            else
+                onEncoder(e.id_, e.value_);
+        }
+    }
+
+    // events are handled as they arrive, modes and the device are polled every poll interval
+    void Nui::run()
+    {
+        auto interval = std::chrono::microseconds(pollInterval_);
+        auto next = std::chrono::steady_clock::now() + interval;
+        while (running_)
+        {
+            {
+                std::unique_lock<std::mutex> lock(wakeMutex_);
+                wakeCondition_.wait_until(lock, next, [this] { return wakePending_ || !running_; });
+                wakePending_ = false;
+            }
+            if (!running_)
+                break;
+
+            dispatch();
+            flushDisplay();
+
+            auto now = std::chrono::steady_clock::now();
+            if (now >= next)
+            {
+                modes_[currentMode_]->poll();
+                if (device_)
+                    device_->process();
+                // events from the device, if it calls back during process
+                dispatch();
+                flushDisplay();
+                next += interval;
+                if (next < now)
+                    next = now + interval; // behind, dont try to catch up
+            }
         }
-        return true;
     }
 
 } // namespace mec
@@ -3,8 +3,13 @@
 #include "../mec_device.h"
 
 #include <KontrolModel.h>
+#include <DisplayFrame.h>
+#include <PacketReceiver.h>
 
 #include <ip/UdpSocket.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <string>
 #include <readerwriterqueue.h>
 #include <thread>
@@ -17,7 +22,6 @@ namespace mec
     class NuiParamMode;
 
     class NuiListener;
-    class NuiPacketListener;
 
     enum NuiModes
     {
@@ -57,9 +61,11 @@ namespace mec
 
         // mec::Device
         bool init(void *) override;
-        bool process() override;
+        bool init(const NuiConfig &);
+        bool process() override; // non blocking, nui runs on its own thread
         void deinit() override;
         bool isActive() override;
+        bool reload(const MecConfig &) override;
 
         // Kontrol::KontrolCallback
 
@@ -114,7 +120,9 @@ namespace mec
 
         void currentPage(const Kontrol::EntityId &id) { currentPageId_ = id; }
 
-        // from fates device
+        // from fates device, queued for the nui thread
+        void queueButton(unsigned id, unsigned value);
+        void queueEncoder(unsigned id, int value);
         void onButton(unsigned id, unsigned value);
         void onEncoder(unsigned id, int value);
 
@@ -131,9 +139,6 @@ namespace mec
         void nextModule();
         void prevModule();
 
-        // OSC
-        std::shared_ptr<UdpListeningReceiveSocket> readSocket() { return readSocket_; }
-
     private:
         void navPrev();
         void navNext();
@@ -147,25 +152,37 @@ namespace mec
         /////////////////////////////////////////////////
         // OSC
         friend class NuiListener;
-        friend class NuiPacketListener;
         bool connect(const std::string &host, unsigned port);
         bool listen(unsigned port);
-        struct OscMsg
-        {
-            static const int MAX_N_OSC_MSGS = 64;
-            static const int MAX_OSC_MESSAGE_SIZE = 128;
-            int size_;
-            char buffer_[MAX_OSC_MESSAGE_SIZE];
-            IpEndpointName origin_; // only used when for recv
-        };
-        bool listenRunning_;
+        static const unsigned MAX_N_OSC_MSGS = 64;
+        static const unsigned MAX_OSC_MESSAGE_SIZE = 512;
 
-        std::shared_ptr<UdpListeningReceiveSocket> readSocket_;
-        std::shared_ptr<PacketListener> packetListener_;
+        // wakes the nui thread, which parses packets in place
+        Kontrol::PacketReceiver receiver_;
         std::shared_ptr<NuiListener> oscListener_;
-        moodycamel::ReaderWriterQueue<OscMsg> readMessageQueue_;
-        std::thread receive_thread_;
-        unsigned listenPort_;
+        /////////////////////////////////////////////////
+        // nui thread, woken by osc packets and device events, and polls modes and the device each poll interval
+        friend void *nui_thread_func(void *);
+        void run();
+        void wakeup();
+        void dispatch();
+        // draws the display changes, on the nui thread
+        void flushDisplay();
+        void drawParamName(unsigned num, const Kontrol::DisplayFrame::Text &text);
+        void drawParamValue(unsigned num, const Kontrol::DisplayFrame::Text &text);
+        struct DeviceEvent
+        {
+            static const int MAX_N_EVENTS = 64;
+            bool button_;
+            unsigned id_;
+            int value_;
+        };
+        moodycamel::ReaderWriterQueue<DeviceEvent> deviceQueue_;
+        std::thread worker_;
+        std::mutex wakeMutex_;
+        std::condition_variable wakeCondition_;
+        bool wakePending_;
+        std::atomic<bool> running_;
         /////////////////////////////////////////////////
 
         void stop() override;
@@ -175,6 +192,11 @@ namespace mec
         std::shared_ptr<NuiLite::NuiDevice> device_;
         bool active_;
 
+        // modes draw into the frame, the nui thread flushes it
+        Kontrol::DisplayFrame frame_;
+        Kontrol::DisplayFrame::Changes changes_;
+        std::atomic<bool> wipe_; // device display cleared and redrawn, when the modes next draw (e.g. over the splash)
+
         Kontrol::EntityId currentRackId_;
         Kontrol::EntityId currentModuleId_;
         Kontrol::EntityId currentPageId_;
@@ -186,10 +208,9 @@ namespace mec
         std::map<NuiModes, std::shared_ptr<NuiMode>> modes_;
         std::vector<std::string> moduleOrder_;
         unsigned menuTimeout_;
+        NuiConfig config_; // as applied by init, for reload
 
-        unsigned pollCount_;
-        unsigned pollFreq_;
-        unsigned pollSleep_;
+        unsigned pollInterval_; // us, poll freq * poll sleep
 
         bool auxActive_;
         int auxLed_;
@@ -204,12 +225,12 @@ namespace mec
 
         void onButton(unsigned id, unsigned value) override
         {
-            parent_.onButton(id, value);
+            parent_.queueButton(id, value);
         }
 
         void onEncoder(unsigned id, int value) override
         {
-            parent_.onEncoder(id, value);
+            parent_.queueEncoder(id, value);
         }
 
     private:
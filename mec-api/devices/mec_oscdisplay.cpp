@@ -8,6 +8,7 @@
 #include <osc/OscPacketListener.h>
 
 #include <mec_log.h>
+#include <mec_threads.h>
 
 namespace mec {
 
@@ -836,28 +837,6 @@ void OscDisplayModuleSelectMenu::clicked(unsigned idx) {
 
 
 // OscDisplay implmentation
-class OscDisplayPacketListener : public PacketListener {
-public:
-    OscDisplayPacketListener(moodycamel::ReaderWriterQueue<OscDisplay::OscMsg> &queue) : queue_(queue) {
-    }
-
-    virtual void ProcessPacket(const char *data, int size,
-                               const IpEndpointName &remoteEndpoint) {
-
-        OscDisplay::OscMsg msg;
-//        msg.origin_ = remoteEndpoint;
-        msg.size_ = (size > OscDisplay::OscMsg::MAX_OSC_MESSAGE_SIZE ? OscDisplay::OscMsg::MAX_OSC_MESSAGE_SIZE
-                                                                     : size);
-        memcpy(msg.buffer_, data, (size_t) msg.size_);
-        msg.origin_ = remoteEndpoint;
-        queue_.enqueue(msg);
-    }
-
-private:
-    moodycamel::ReaderWriterQueue<OscDisplay::OscMsg> &queue_;
-};
-
-
 class OscDisplayListener : public osc::OscPacketListener {
 public:
     OscDisplayListener(OscDisplay &recv) : receiver_(recv) { ; }
@@ -969,14 +948,13 @@ private:
 
 
 OscDisplay::OscDisplay() :
-        writeMessageQueue_(OscMsg::MAX_N_OSC_MSGS),
-        readMessageQueue_(OscMsg::MAX_N_OSC_MSGS),
-        active_(false),
+        frame_(OSC_NUM_TEXTLINES + 1), // menu lines are 1 based
         writeRunning_(false),
-        listenRunning_(false),
-        modulationLearnActive_(false),
-        midiLearnActive_(false) {
-    packetListener_ = std::make_shared<OscDisplayPacketListener>(readMessageQueue_);
+        active_(false),
+        writeMessageQueue_(OscMsg::MAX_N_OSC_MSGS),
+        receiver_("oscdisp.recv", OscMsg::MAX_N_OSC_MSGS, OscMsg::MAX_OSC_MESSAGE_SIZE),
+        midiLearnActive_(false),
+        modulationLearnActive_(false) {
     oscListener_ = std::make_shared<OscDisplayListener>(*this);
 }
 
@@ -989,18 +967,23 @@ OscDisplay::~OscDisplay() {
 
 bool OscDisplay::init(void *arg) {
     Preferences prefs(arg);
+    OscDisplayConfig config;
+    config.load(prefs, "mec.oscdisplay");
+    return init(config);
+}
 
+bool OscDisplay::init(const OscDisplayConfig &config) {
     if (active_) {
         LOG_2("OscDisplay::init - already active deinit");
         deinit();
     }
     active_ = false;
     writeRunning_ = false;
-    listenRunning_ = false;
-    static const auto MENU_TIMEOUT = 350;
 
-    unsigned listenPort = prefs.getInt("listen port", 6100);
-    menuTimeout_ = prefs.getInt("menu timeout", MENU_TIMEOUT);
+    config_ = config;
+    unsigned listenPort = config.listenPort_;
+    menuTimeout_ = config.menuTimeout_;
+    frame_.maxFps(config.maxFps_);
 
 
     active_ = true;
@@ -1025,7 +1008,6 @@ bool OscDisplay::init(void *arg) {
 
 void OscDisplay::deinit() {
     writeRunning_ = false;
-    listenRunning_ = false;
 
     if (writeSocket_) {
         writer_thread_.join();
@@ -1034,14 +1016,8 @@ void OscDisplay::deinit() {
     }
     writeSocket_.reset();
 
-    if (readSocket_) {
-        readSocket_->AsynchronousBreak();
-        receive_thread_.join();
-        OscMsg msg;
-        while (readMessageQueue_.try_dequeue(msg));
-    }
-    listenPort_ = 0;
-    readSocket_.reset();
+    receiver_.stop();
+    for (auto p = receiver_.next(); p != nullptr; p = receiver_.next()) receiver_.release(p);
     active_ = false;
     return;
 }
@@ -1050,13 +1026,26 @@ bool OscDisplay::isActive() {
     return active_;
 }
 
+bool OscDisplay::reload(const MecConfig &config) {
+    if (!config.oscDisplay_ || !active_) return false;
+    const OscDisplayConfig &c = *config.oscDisplay_;
+    if (c.listenPort_ != config_.listenPort_
+        || c.menuTimeout_ != config_.menuTimeout_
+        || c.maxFps_ != config_.maxFps_) {
+        LOG_0("OscDisplay configuration changes require a restart");
+        return false;
+    }
+    return true;
+}
+
 // Kontrol::KontrolCallback
 bool OscDisplay::process() {
-    OscMsg msg;
-    while (readMessageQueue_.try_dequeue(msg)) {
-        oscListener_->ProcessPacket(msg.buffer_, msg.size_, msg.origin_);
+    for (auto p = receiver_.next(); p != nullptr; p = receiver_.next()) {
+        oscListener_->ProcessPacket(p->data_.get(), p->size_, p->origin_);
+        receiver_.release(p);
     }
     modes_[currentMode_]->poll();
+    flushDisplay();
     return true;
 }
 
@@ -1066,6 +1055,7 @@ void OscDisplay::stop() {
 
 
 void *displayosc_write_thread_func(void *aObj) {
+    ThreadRegistration registration("oscdisp.write");
     LOG_2("start display osc write thead");
     OscDisplay *pThis = static_cast<OscDisplay *>(aObj);
     pThis->writePoll();
@@ -1100,6 +1090,13 @@ bool OscDisplay::connect(const std::string &hostname, unsigned port) {
     writer_thread_ = std::thread(displayosc_write_thread_func, this);
 #endif
 
+    // a new client, so send it everything
+    {
+        osc::OutboundPacketStream ops(screenBuf_, OUTPUT_BUFFER_SIZE);
+        ops << osc::BeginMessage("/clearText") << osc::EndMessage;
+        send(ops.Data(), ops.Size());
+    }
+    frame_.invalidate();
     clearDisplay();
 
     // send out current module and page
@@ -1139,44 +1136,9 @@ void OscDisplay::send(const char *data, unsigned size) {
 }
 
 
-void *displayosc_read_thread_func(void *pReceiver) {
-    OscDisplay *pThis = static_cast<OscDisplay *>(pReceiver);
-    pThis->readSocket()->Run();
-    return nullptr;
-}
-
 bool OscDisplay::listen(unsigned port) {
-
-    if (readSocket_) {
-        listenRunning_ = false;
-        readSocket_->AsynchronousBreak();
-        receive_thread_.join();
-        OscMsg msg;
-        while (readMessageQueue_.try_dequeue(msg));
-    }
-    listenPort_ = 0;
-    readSocket_.reset();
-
-
-    listenPort_ = port;
-    try {
-        LOG_0("listening for clients on " << port);
-        readSocket_ = std::make_shared<UdpListeningReceiveSocket>(
-                IpEndpointName(IpEndpointName::ANY_ADDRESS, listenPort_),
-                packetListener_.get());
-
-        listenRunning_ = true;
-#ifdef __COBALT__
-    pthread_t ph = receive_thread_.native_handle();
-    pthread_create(&ph, 0,displayosc_read_thread_func,this);
-#else
-        receive_thread_ = std::thread(displayosc_read_thread_func, this);
-#endif
-    } catch (const std::runtime_error &e) {
-        listenPort_ = 0;
-        return false;
-    }
-    return true;
+    LOG_0("listening for clients on " << port);
+    return receiver_.listen(port);
 }
 
 //--modes and forwarding
@@ -1386,19 +1348,8 @@ void OscDisplay::modulationLearn(bool b) {
 //}
 
 
-void OscDisplay::sendOscString(const std::string& topic, std::string value) {
-    osc::OutboundPacketStream ops(screenBuf_, OUTPUT_BUFFER_SIZE);
-    ops << osc::BeginMessage(topic.c_str());
-    ops << value.c_str();
-    ops << osc::EndMessage;
-    send(ops.Data(), ops.Size());
-}
-
 void OscDisplay::clearDisplay() {
-    osc::OutboundPacketStream ops(screenBuf_, OUTPUT_BUFFER_SIZE);
-    ops << osc::BeginMessage("/clearText")
-        << osc::EndMessage;
-    send(ops.Data(), ops.Size());
+    frame_.clear();
 }
 
 void OscDisplay::clearParamNum(unsigned num) {
@@ -1436,60 +1387,117 @@ void OscDisplay::clearParamNum(unsigned num) {
 
 }
 
-void OscDisplay::displayParamNum(unsigned num, const Kontrol::Parameter &param, bool dispCtrl) {
-    std::string p = "P" + std::to_string(num);
-    {
-        std::string field = "/" + p + "Desc";
-        sendOscString(field,param.displayName());
-    }
+void OscDisplay::field(const std::string &addr, const std::string &text) {
+    Kontrol::DisplayFrame::Text t;
+    t.text_ = text;
+    frame_.field(addr, t);
+}
 
-    if (dispCtrl) {
-        osc::OutboundPacketStream ops(screenBuf_, OUTPUT_BUFFER_SIZE);
-        std::string field = "/" + p + "Ctrl";
-        const char *addr = field.c_str();
-        float v = param.asFloat(param.current());
-        ops << osc::BeginMessage(addr)
-            << v
-            << osc::EndMessage;
-        send(ops.Data(), ops.Size());
-    }
+void OscDisplay::displayParamNum(unsigned num, const Kontrol::Parameter &param, bool dispCtrl) {
+    std::string p = "/P" + std::to_string(num);
+    field(p + "Desc", param.displayName());
 
-    {
-        std::string field = "/" + p + "Value";
-        std::string val= param.displayValue() + " " + param.displayUnit();
-        sendOscString(field,val);
+    // otherwise the client made the change, so already shows it
+    Kontrol::DisplayFrame::Text ctrl;
+    ctrl.value_ = param.asFloat(param.current());
+    frame_.field(p + "Ctrl", ctrl, !dispCtrl);
 
-    }
+    field(p + "Value", param.displayValue() + " " + param.displayUnit());
 }
 
 void OscDisplay::displayLine(unsigned line, const char *disp) {
-    if (writeSocket_ == nullptr) return;
-
-    if(disp && strlen(disp)>0)
-    {
-        osc::OutboundPacketStream ops(screenBuf_, OUTPUT_BUFFER_SIZE);
-        ops << osc::BeginMessage("/text");
-        ops << (int8_t) line;
-        ops << disp;
-        ops << osc::EndMessage;
-        send(ops.Data(), ops.Size());
-    }
+    frame_.line(line, disp ? disp : "");
 }
 
 void OscDisplay::invertLine(unsigned line) {
+    frame_.invert(line);
+}
+
+void OscDisplay::displayTitle(const std::string &module, const std::string &page) {
+    field("/module", module);
+    field("/page", page);
+}
+
+// bundle element size, for a message of up to an int and a string
+static unsigned oscElementSize(const std::string &addr, const std::string &str) {
+    return 4 + ((addr.size() + 4) & ~3u) + 8 + 4 + ((str.size() + 4) & ~3u);
+}
+
+void OscDisplay::flushDisplay(bool force) {
+    if (writeSocket_ == nullptr) return;
+    if (!frame_.flush(changes_, force)) return;
+
     osc::OutboundPacketStream ops(screenBuf_, OUTPUT_BUFFER_SIZE);
+    unsigned n = 0;
+    // a new bundle, if the next message may not fit
+    auto next = [&](const std::string &addr, const std::string &str) {
+        if (n > 0 && ops.Size() + oscElementSize(addr, str) > OUTPUT_BUFFER_SIZE) {
+            ops << osc::EndBundle;
+            send(ops.Data(), ops.Size());
+            n = 0;
+        }
+        if (n == 0) {
+            ops.Clear();
+            ops << osc::BeginBundleImmediate;
+        }
+        n++;
+    };
+    auto text = [&](unsigned line, const std::string &str) {
+        next("/text", str);
+        ops << osc::BeginMessage("/text") << (int8_t) line << str.c_str() << osc::EndMessage;
+    };
+    auto select = [&](unsigned line) {
+        next("/selectText", "");
+        ops << osc::BeginMessage("/selectText") << (int8_t) line << osc::EndMessage;
+    };
 
-    ops << osc::BeginMessage("/selectText")
-        << (int8_t) line
-        << osc::EndMessage;
+    try {
+        // text can only be cleared all together, so clearing a line redraws them all
+        bool redraw = false;
+        for (const auto &l : changes_.lines_) {
+            redraw |= l.text_.text_.empty() && !l.previous_.text_.empty();
+        }
 
-    send(ops.Data(), ops.Size());
+        if (redraw) {
+            next("/clearText", "");
+            ops << osc::BeginMessage("/clearText") << osc::EndMessage;
+            for (unsigned i = 0; i < changes_.frame_.size(); i++) {
+                if (!changes_.frame_[i].text_.empty()) text(i, changes_.frame_[i].text_);
+            }
+            for (unsigned i = 0; i < changes_.frame_.size(); i++) {
+                if (changes_.frame_[i].inverted_) select(i);
+            }
+        } else {
+            for (const auto &l : changes_.lines_) {
+                if (l.text_.text_ != l.previous_.text_) text(l.line_, l.text_.text_);
+            }
+            // as the modes do, deselect then select
+            for (const auto &l : changes_.lines_) {
+                if (l.previous_.inverted_ && !l.text_.inverted_) select(l.line_);
+            }
+            for (const auto &l : changes_.lines_) {
+                if (!l.previous_.inverted_ && l.text_.inverted_) select(l.line_);
+            }
+        }
 
-}
+        for (const auto &f : changes_.fields_) {
+            const std::string &addr = f.name_;
+            next(addr, f.text_.text_);
+            ops << osc::BeginMessage(addr.c_str());
+            if (addr.size() > 4 && addr.compare(addr.size() - 4, 4, "Ctrl") == 0) ops << f.text_.value_;
+            else ops << f.text_.text_.c_str();
+            ops << osc::EndMessage;
+        }
 
-void OscDisplay::displayTitle(const std::string &module, const std::string &page) {
-    sendOscString("/module",module);
-    sendOscString("/page",page);
+        if (n > 0) {
+            ops << osc::EndBundle;
+            send(ops.Data(), ops.Size());
+        }
+    } catch (const osc::Exception &e) {
+        // not (all) sent, so the next flush resends everything
+        LOG_1("OscDisplay::flushDisplay - display update too large : " << e.what());
+        frame_.invalidate();
+    }
 }
 
 
@@ -6,6 +6,8 @@
 
 
 #include <KontrolModel.h>
+#include <DisplayFrame.h>
+#include <PacketReceiver.h>
 
 #include <ip/UdpSocket.h>
 #include <string>
@@ -46,9 +48,11 @@ public:
 
     //mec::Device
     bool init(void*) override;
+    bool init(const OscDisplayConfig &);
     bool process() override;
     void deinit() override ;
     bool isActive() override;
+    bool reload(const MecConfig &) override;
 
     //Kontrol::KontrolCallback
 
@@ -77,11 +81,11 @@ public:
     void invertLine(unsigned line);
     void clearDisplay();
     void displayTitle(const std::string &module, const std::string &page);
+    // sends the display changes, as one bundle
+    void flushDisplay(bool force = false);
 
     void writePoll();
 
-    std::shared_ptr<UdpListeningReceiveSocket> readSocket() { return readSocket_; }
-
     std::shared_ptr<Kontrol::KontrolModel> model() { return Kontrol::KontrolModel::model(); }
 
     Kontrol::EntityId currentRack() { return currentRackId_; }
@@ -104,7 +108,6 @@ public:
 
     unsigned menuTimeout() {return menuTimeout_;}
 private:
-    friend class OscDisplayPacketListener;
     friend class OscDisplayListener;
 
     std::vector<std::shared_ptr<Kontrol::Module>> getModules(const std::shared_ptr<Kontrol::Rack>& rack);
@@ -112,7 +115,7 @@ private:
     bool listen(unsigned port);
     bool connect(const std::string& host, unsigned port);
 
-    void sendOscString(const std::string& topic, std::string value);
+    void field(const std::string &addr, const std::string &text);
 
     void navPrev();
     void navNext();
@@ -126,32 +129,32 @@ private:
     void send(const char *data, unsigned size);
     void stop() override;
 
+    static const unsigned int OUTPUT_BUFFER_SIZE = 1024;
+
     struct OscMsg {
         static const int MAX_N_OSC_MSGS = 64;
-        static const int MAX_OSC_MESSAGE_SIZE = 128;
+        static const int MAX_OSC_MESSAGE_SIZE = OUTPUT_BUFFER_SIZE; // display bundles
         int size_;
         char buffer_[MAX_OSC_MESSAGE_SIZE];
-        IpEndpointName origin_; // only used when for recv
     };
 
-    static const unsigned int OUTPUT_BUFFER_SIZE = 1024;
     static char screenBuf_[OUTPUT_BUFFER_SIZE];
 
+    // modes draw into the frame, process() flushes it
+    Kontrol::DisplayFrame frame_;
+    Kontrol::DisplayFrame::Changes changes_;
+
 
     bool writeRunning_;
-    bool listenRunning_;
     bool active_;
 
     std::shared_ptr<UdpTransmitSocket> writeSocket_;
     moodycamel::BlockingReaderWriterQueue<OscMsg> writeMessageQueue_;
     std::thread writer_thread_;
 
-    std::shared_ptr<UdpListeningReceiveSocket> readSocket_;
-    std::shared_ptr<PacketListener> packetListener_;
+    // parsed in place, in process()
+    Kontrol::PacketReceiver receiver_;
     std::shared_ptr<OscDisplayListener> oscListener_;
-    moodycamel::ReaderWriterQueue<OscMsg> readMessageQueue_;
-    std::thread receive_thread_;
-    unsigned listenPort_;
 
     Kontrol::EntityId currentRackId_;
     Kontrol::EntityId currentModuleId_;
@@ -166,6 +169,7 @@ private:
     std::map<OscDisplayModes, std::shared_ptr<OscDisplayMode>> modes_;
     std::vector<std::string> moduleOrder_;
     unsigned menuTimeout_;
+    OscDisplayConfig config_; // as applied by init, for reload
 
 };
 
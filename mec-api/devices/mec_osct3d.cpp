@@ -9,7 +9,9 @@
 #include <algorithm>
 
 #include "mec_log.h"
+#include "mec_threads.h"
 #include "../mec_voice.h"
+#include "../mec_voice_allocator.h"
 
 ////////////////////////////////////////////////
 // TODO
@@ -19,18 +21,17 @@ namespace mec {
 
 class OscT3DHandler : public osc::OscPacketListener {
 public:
-    OscT3DHandler(Preferences &p, MsgQueue &q)
-        : prefs_(p),
-          queue_(q),
+    OscT3DHandler(MsgQueue &q)
+        : queue_(q),
           valid_(true),
-          socket_(nullptr) {
+          socket_(nullptr),
+          voices_(VoiceAllocator::MAX_TOUCHES) {
         if (valid_) {
             LOG_0("OscT3DHandler enabling for mecapi");
         }
         for (int i = 0; i < sizeof(activeTouches_); i++) {
             activeTouches_[i] = false;
         }
-        stealVoices_ = false;
     }
 
     bool isValid() { return valid_; }
@@ -86,23 +87,9 @@ public:
         Voices::Voice *voice = voices_.voiceId(tId);
         if (mz > 0.0) {
             if (!voice) {
+                // voice limits and stealing are applied by the api, see VoiceAllocator
                 voice = voices_.startVoice(tId);
                 // LOG_1("start voice for " << tId << " ch " << voice->i_);
-
-                if (!voice && stealVoices_) {
-                    // no available voices, steal?
-                    Voices::Voice *stolen = voices_.oldestActiveVoice();
-                    MecMsg msg;
-                    msg.data_.touch_.touchId_ = stolen->i_;
-                    msg.data_.touch_.note_ = stolen->note_;
-                    msg.data_.touch_.x_ = stolen->x_;
-                    msg.data_.touch_.y_ = stolen->y_;
-                    msg.data_.touch_.z_ = 0.0f;
-                    msg.type_ = MecMsg::TOUCH_OFF;
-                    queue_.addToQueue(msg);
-                    voices_.stopVoice(stolen);
-                    voice = voices_.startVoice(tId);
-                }
             }
 
             if (voice) {
@@ -160,12 +147,10 @@ private:
 
     float note(float n) { return n; }
 
-    Preferences prefs_;
     MsgQueue &queue_;
     bool valid_;
     bool activeTouches_[16];
     UdpListeningReceiveSocket *socket_;
-    bool stealVoices_;
     Voices voices_;
 
 };
@@ -173,7 +158,7 @@ private:
 
 ////////////////////////////////////////////////
 OscT3D::OscT3D(ICallback &cb) :
-    active_(false), callback_(cb) {
+    active_(false), callback_(cb), queue_("osct3d.queue") {
 }
 
 OscT3D::~OscT3D() {
@@ -182,6 +167,7 @@ OscT3D::~OscT3D() {
 
 
 void OscT3DListen(OscT3D *self) {
+    ThreadRegistration registration("osct3d");
     self->listenProc();
 }
 
@@ -192,14 +178,19 @@ void OscT3D::listenProc() {
 
 bool OscT3D::init(void *arg) {
     Preferences prefs(arg);
+    OscT3DConfig config;
+    config.load(prefs, "mec.osct3d");
+    return init(config);
+}
 
+bool OscT3D::init(const OscT3DConfig &config) {
     if (active_) {
         deinit();
     }
     active_ = false;
-    OscT3DHandler *pCb = new OscT3DHandler(prefs, queue_);
+    OscT3DHandler *pCb = new OscT3DHandler(queue_);
 
-    port_ = (unsigned) prefs.getInt("port", 9000);
+    port_ = config.port_;
 
     if (pCb->isValid()) {
         active_ = true;
@@ -242,6 +233,16 @@ bool OscT3D::isActive() {
     return active_;
 }
 
+bool OscT3D::reload(const MecConfig &config) {
+    if (!config.oscT3D_ || !active_) return false;
+    if (config.oscT3D_->port_ != port_) {
+        LOG_0("OscT3D port change requires a restart");
+        return false;
+    }
+    // voices and steal voices are applied by the api, see VoiceAllocator
+    return true;
+}
+
 
 }
 
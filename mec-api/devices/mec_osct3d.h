@@ -19,9 +19,11 @@ public:
     OscT3D(ICallback &);
     virtual ~OscT3D();
     virtual bool init(void *);
+    bool init(const OscT3DConfig &);
     virtual bool process();
     virtual void deinit();
     virtual bool isActive();
+    virtual bool reload(const MecConfig &);
 
     void listenProc();
 
@@ -1,6 +1,7 @@
 #include "mec_push2.h"
 
 #include "mec_log.h"
+#include "mec_threads.h"
 #include "../mec_voice.h"
 #include "push2/mec_push2_param.h"
 #include "push2/mec_push2_module.h"
@@ -19,7 +20,8 @@ static const unsigned OSC_POLL_MS = 50;
 Push2::Push2(ICallback &cb) :
         MidiDevice(cb),
         modulationLearnActive_(false),
-        midiLearnActive_(false) {
+        midiLearnActive_(false),
+        displayFps_(30) {
     PaUtil_InitializeRingBuffer(&midiQueue_, sizeof(MidiMsg), MAX_N_MIDI_MSGS, msgData_);
 }
 
@@ -58,20 +60,53 @@ RtMidiIn::RtMidiCallback Push2::getMidiCallback() {
 }
 
 void *push2_processor_func(void *pDevice) {
+    ThreadRegistration registration("push2");
     Push2 *pThis = static_cast<Push2 *>(pDevice);
     pThis->processorRun();
     return nullptr;
 }
 
+void *push2_renderer_func(void *pDevice) {
+    // not realtime, unless configured, so it never competes with touch processing
+    ThreadRegistration registration("push2.render");
+    Push2 *pThis = static_cast<Push2 *>(pDevice);
+    pThis->rendererRun();
+    return nullptr;
+}
+
 
 bool Push2::init(void *arg) {
-    if (MidiDevice::init(arg)) {
+    Preferences prefs(arg);
+    Push2Config config;
+    config.load(prefs, "mec.push2");
+    return init(config);
+}
+
+bool Push2::init(const MidiDeviceConfig &config) {
+    Push2Config p2config;
+    static_cast<MidiDeviceConfig &>(p2config) = config;
+    p2config.displayFps_ = 30;
+    p2config.displayOutput_ = Push2Config::D_USB;
+    return init(p2config);
+}
 
-        Preferences prefs(arg);
+bool Push2::init(const Push2Config &config) {
+    if (MidiDevice::init(config)) {
 
         // push2 api setup
         push2Api_.reset(new Push2API::Push2());
-        push2Api_->init();
+        switch (config.displayOutput_) {
+            case Push2Config::D_FILE :
+                push2Api_->init(Push2API::Push2::O_FILE, config.displayFile_);
+                break;
+            case Push2Config::D_NULL :
+                push2Api_->init(Push2API::Push2::O_NULL);
+                break;
+            default:
+                push2Api_->init();
+                break;
+        }
+        displayFps_ = config.displayFps_;
 
         push2Api_->clearDisplay();
 
@@ -91,6 +126,7 @@ bool Push2::init(void *arg) {
 
         active_ = true;
         processor_ = std::thread(push2_processor_func, this);
+        renderer_ = std::thread(push2_renderer_func, this);
         push2Api_-> drawCell8(1,0,"Welcome to MEC",Push2API::Push2::Colour(0xFF,0xFF,0xFF));
         LOG_0("Push2::init - complete");
 
@@ -103,8 +139,6 @@ bool Push2::init(void *arg) {
 
 void Push2::processorRun() {
     while (active_) {
-        push2Api_->render();
-
         while (PaUtil_GetRingBufferReadAvailable(&midiQueue_)) {
             MidiMsg msg;
             PaUtil_ReadRingBuffer(&midiQueue_, &msg, 1);
@@ -114,6 +148,19 @@ void Push2::processorRun() {
     }
 }
 
+// frames are paced to displayFps_, and only sent when the display has changed
+void Push2::rendererRun() {
+    auto interval = std::chrono::microseconds(1000000 / displayFps_);
+    auto next = std::chrono::steady_clock::now();
+    while (active_) {
+        push2Api_->render();
+        next += interval;
+        auto now = std::chrono::steady_clock::now();
+        if (next < now) next = now; // behind, don't try to catch up
+        push2Api_->wait((unsigned) std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count());
+    }
+}
+
 bool Push2::process() {
     //FIXME: consider what thread this needs to be on!
     return MidiDevice::process();
@@ -126,6 +173,9 @@ void Push2::deinit() {
     if (processor_.joinable()) {
         processor_.join();
     }
+    if (renderer_.joinable()) {
+        renderer_.join();
+    }
 
     if (push2Api_)push2Api_->deinit();
     push2Api_.reset();
@@ -143,8 +143,11 @@ public:
 
     //MidiDevice
     bool init(void *) override;
+    bool init(const MidiDeviceConfig &) override;
+    bool init(const Push2Config &);
     bool process() override;
     void deinit() override;
+    bool reload(const MecConfig &) override { return false; } // push2 changes need a restart
     RtMidiIn::RtMidiCallback getMidiCallback() override; //override
 
     bool midiCallback(double deltatime, std::vector<unsigned char> *message) override;
@@ -178,6 +181,7 @@ public:
     void addPadMode(PushPadModes mode, std::shared_ptr<P2_PadMode>);
     void changePadMode(PushPadModes);
     void processorRun();
+    void rendererRun();
 
     void currentRack(const Kontrol::EntityId id) { rackId_ = id;}
     void currentModule(const Kontrol::EntityId id);
@@ -225,6 +229,8 @@ private:
     PaUtilRingBuffer midiQueue_; // draw midi from P2
     char msgData_[sizeof(MidiMsg) * MAX_N_MIDI_MSGS];
     std::thread processor_;
+    std::thread renderer_; // display, low priority, paced to displayFps_
+    unsigned displayFps_;
 };
 
 }
@@ -3,7 +3,7 @@
 
 #include "mec_log.h"
 #include "../mec_voice.h"
-#include <set>
+#include "../mec_voice_allocator.h"
 
 namespace mec {
 
@@ -28,13 +28,11 @@ public:
 ////////////////////////////////////////////////
 class SoundplaneHandler : public ::SPLiteCallback {
 public:
-    SoundplaneHandler(Preferences &p, 
+    SoundplaneHandler(const SoundplaneConfig &config,
 		    ICallback& cb)
-            : prefs_(p),
-              callback_(cb),
+            : callback_(cb),
               valid_(true),
-              voices_(static_cast<unsigned>(p.getInt("voices", 15))),
-              stealVoices_(p.getBool("steal voices", true)) {
+              voices_(VoiceAllocator::MAX_TOUCHES) {
         if (valid_) {
             LOG_0("SoundplaneHandler enabling for mecapi");
         }
@@ -83,6 +81,7 @@ public:
     }
 
     bool isValid() { return valid_; }
+
 //    virtual void device(const char *dev, int rows, int cols) {
 //        LOG_1("SoundplaneHandler  device d: " << dev);
 //        LOG_1(" r: " << rows << " c: " << cols);
@@ -107,23 +106,9 @@ public:
             // LOG_1(" x: " << x      << " y: "   << y    << " z: "   << z);
             // LOG_1(" mx: " << mx    << " my: "  << my   << " mz: "  << mz);
             if (!voice) {
-                if (stolenTouches_.find(touch) != stolenTouches_.end()) {
-                    // this key has been stolen, must be released to reactivate it
-                    return;
-                }
-
                 voice = voices_.startVoice(touch);
                 //LOG_1("start voice for " << touch << " ch " << voice->i_);
 
-                if (!voice && stealVoices_) {
-                    // no available voices, steal?
-                    Voices::Voice *stolen = voices_.oldestActiveVoice();
-                    callback_.touchOff(stolen->i_, stolen->note_, stolen->x_, stolen->y_, 0.0f);
-                    voices_.stopVoice(stolen);
-
-                    voice = voices_.startVoice(touch);
-                }
-
                 if (voice) {
                     callback_.touchOn(voice->i_, mn, mx, my, voice->v_); //v_ = calculated velocity
                     voice->note_ = mn;
@@ -151,7 +136,6 @@ public:
                 callback_.touchOff(voice->i_, mn, mx, my, mz);
                 voices_.stopVoice(voice);
             }
-            stolenTouches_.erase(touch);
         }
     }
 private:
@@ -159,18 +143,15 @@ private:
 
     float note(float n) { return n; }
 
-    Preferences prefs_;
     ICallback &callback_;
     Voices voices_;
     bool valid_;
-    bool stealVoices_;
-    std::set<unsigned> stolenTouches_;
 };
 
 
 ////////////////////////////////////////////////
 Soundplane::Soundplane(ICallback &cb) :
-        active_(false), callback_(cb) {
+        callback_(cb), handler_(nullptr), active_(false), voices_(0) {
 }
 
 Soundplane::~Soundplane() {
@@ -179,20 +160,26 @@ Soundplane::~Soundplane() {
 
 bool Soundplane::init(void *arg) {
     Preferences prefs(arg);
-    //prefs.print();
-    unsigned maxtouch = static_cast<unsigned>(prefs.getInt("voices", 15));
+    SoundplaneConfig config;
+    config.load(prefs, "mec.soundplane");
+    return init(config);
+}
+
+bool Soundplane::init(const SoundplaneConfig &config) {
+    unsigned maxtouch = config.voices_;
     LOG_1("max voices : " << maxtouch);
 
     if (active_) {
         deinit();
     }
     active_ = false;
+    voices_ = maxtouch;
 
     device_ = std::unique_ptr<SPLiteDevice>(new SPLiteDevice());
 
 
-    std::shared_ptr<::SPLiteCallback> callback
-        = std::shared_ptr<::SPLiteCallback>(new SoundplaneHandler(prefs, callback_));
+    handler_ = new SoundplaneHandler(config, callback_);
+    std::shared_ptr<::SPLiteCallback> callback = std::shared_ptr<::SPLiteCallback>(handler_);
     device_->addCallback(callback);
 
     device_->start();
@@ -212,6 +199,7 @@ void Soundplane::deinit() {
     LOG_0("Soundplane::reset model");
     device_->stop();
     device_.reset();
+    handler_ = nullptr;
     active_ = false;
 }
 
@@ -219,6 +207,17 @@ bool Soundplane::isActive() {
     return active_;
 }
 
+bool Soundplane::reload(const MecConfig &config) {
+    if (!config.soundplane_ || !active_) return false;
+    bool ret = true;
+    if (config.soundplane_->voices_ != voices_) {
+        LOG_0("Soundplane voices change requires a restart");
+        ret = false;
+    }
+    // steal voices is applied by the api, see VoiceAllocator
+    return ret;
+}
+
 
 }
 
@@ -12,6 +12,8 @@
 
 namespace mec {
 
+class SoundplaneHandler;
+
 
 class Soundplane : public Device {
 
@@ -19,14 +21,18 @@ public:
     Soundplane(ICallback &);
     virtual ~Soundplane();
     virtual bool init(void *);
+    bool init(const SoundplaneConfig &);
     virtual bool process();
     virtual void deinit();
     virtual bool isActive();
+    virtual bool reload(const MecConfig &);
 
 private:
     ICallback &callback_;
     std::unique_ptr<SPLiteDevice> device_;
+    SoundplaneHandler *handler_; // registered with device_
     bool active_;
+    unsigned voices_;
 };
 
 }
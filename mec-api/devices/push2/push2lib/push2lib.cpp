@@ -3,6 +3,14 @@
 
 #include <stdarg.h>
 #include <memory.h>
+#include <algorithm>
+#include <thread>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace Push2API {
 
@@ -37,10 +45,33 @@ static int perr(char const *format, ...) {
 
 cairo_surface_t *surface;
 cairo_t *cr;
-unsigned char imgBuf_[DATA_PKT_SZ];
-
-
-Push2::Push2() : headerPkt_(headerPkt), handle_(NULL) {
+alignas(16) unsigned char imgBuf_[DATA_PKT_SZ];
+
+const unsigned Push2::KEEPALIVE_MS;
+const unsigned Push2::CELL_ROWS;
+const unsigned Push2::CELL_COLS;
+const unsigned Push2::GLYPH_FIRST;
+const unsigned Push2::GLYPH_LAST;
+const unsigned Push2::NUM_GLYPHS;
+
+static const uint8_t encodeMask[16] = {0xE7, 0xF3, 0xE7, 0xFF, 0xE7, 0xF3, 0xE7, 0xFF,
+                                       0xE7, 0xF3, 0xE7, 0xFF, 0xE7, 0xF3, 0xE7, 0xFF};
+
+
+Push2::Push2() : headerPkt_(headerPkt),
+                 current_(0),
+                 dirty_(true),
+                 generation_(0),
+                 clearPending_(false),
+                 uncached_(false),
+                 output_(O_NULL),
+                 file_(NULL),
+                 handle_(NULL) {
+    for (unsigned i = 0; i < 2; i++) {
+        headerTfr_[i] = NULL;
+        dataTfr_[i] = NULL;
+        pending_[i] = 0;
+    }
     surface = cairo_image_surface_create_for_data(
             (unsigned char *) imgBuf_,
 //            (unsigned char*) dataPkt_,
@@ -50,10 +81,14 @@ Push2::Push2() : headerPkt_(headerPkt), handle_(NULL) {
             LINE
     );
     cr = cairo_create(surface);
-    memset(dataPkt_, 0, DATA_PKT_SZ);
+    memset(dataPkt_, 0, sizeof(dataPkt_));
     cairo_select_font_face(cr, "serif", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
     cairo_set_font_size(cr, 16.0);
     cairo_set_source_rgb(cr, 0.0, 0.0, 1.0);
+    for (unsigned r = 0; r < CELL_ROWS; r++) {
+        for (unsigned c = 0; c < CELL_COLS; c++) cells_[r][c].valid_ = false;
+    }
+    renderGlyphs();
 }
 
 Push2::~Push2() {
@@ -61,72 +96,338 @@ Push2::~Push2() {
     cairo_surface_destroy(surface);;
 }
 
+// cells, drawn at row * CELL_H + CELL_Y, cell * CELL_W + CELL_X, with text at TEXT_X and its baseline at TEXT_BASELINE
+static const unsigned CELL_W = WIDTH / 8;
+static const unsigned CELL_H = 24;
+static const unsigned CELL_X = 9;
+static const unsigned CELL_Y = 9;
+static const unsigned TEXT_X = 7;
+static const unsigned TEXT_BASELINE = 15;
+static const unsigned GLYPH_PAD = 2; // left of each glyphs origin, in the strip, for negative bearings
+
+// as cairo converts, (to 16 bit per channel, then truncated to 565)
+static uint16_t rgb565(double r, double g, double b) {
+    unsigned r16 = (unsigned) (r * 65535.0 + 0.5), g16 = (unsigned) (g * 65535.0 + 0.5), b16 = (unsigned) (b * 65535.0 + 0.5);
+    return (uint16_t) (((r16 >> 11) << 11) | ((g16 >> 10) << 5) | (b16 >> 11));
+}
+
+// push2 is bgr, as set in cairo
+static uint16_t pixel(const Push2::Colour &clr) {
+    return rgb565(clr.blue_, clr.green_, clr.red_);
+}
+
+static inline uint16_t blend(uint16_t d, uint16_t s, unsigned a) {
+    unsigned na = 255 - a;
+    unsigned r = ((s >> 11) * a + (d >> 11) * na) / 255;
+    unsigned g = (((s >> 5) & 0x3F) * a + ((d >> 5) & 0x3F) * na) / 255;
+    unsigned b = ((s & 0x1F) * a + (d & 0x1F) * na) / 255;
+    return (uint16_t) ((r << 11) | (g << 5) | b);
+}
+
+static inline uint16_t *pixels(unsigned x, unsigned y) {
+    return reinterpret_cast<uint16_t *>(imgBuf_ + y * LINE) + x;
+}
+
+
+void Push2::renderGlyphs() {
+    // layout, each glyph has its own slot, so it can be blended at any position
+    unsigned x = 0;
+    for (unsigned i = 0; i < NUM_GLYPHS; i++) {
+        char str[2] = {(char) (GLYPH_FIRST + i), 0};
+        cairo_text_extents_t ext;
+        cairo_text_extents(cr, str, &ext);
+        double right = ext.x_bearing + ext.width > ext.x_advance ? ext.x_bearing + ext.width : ext.x_advance;
+        glyphX_[i] = x;
+        glyphWidth_[i] = GLYPH_PAD + (unsigned) (right + 1.0) + 1;
+        glyphAdvance_[i] = ext.x_advance;
+        x += glyphWidth_[i];
+    }
+
+    cairo_surface_t *strip = cairo_image_surface_create(CAIRO_FORMAT_A8, x, CELL_H);
+    cairo_t *scr = cairo_create(strip);
+    cairo_select_font_face(scr, "serif", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
+    cairo_set_font_size(scr, 16.0);
+    cairo_set_source_rgb(scr, 1.0, 1.0, 1.0);
+    for (unsigned i = 0; i < NUM_GLYPHS; i++) {
+        char str[2] = {(char) (GLYPH_FIRST + i), 0};
+        cairo_move_to(scr, glyphX_[i] + GLYPH_PAD, TEXT_BASELINE);
+        cairo_show_text(scr, str);
+    }
+    cairo_surface_flush(strip);
+    glyphStride_ = (unsigned) cairo_image_surface_get_stride(strip);
+    const unsigned char *data = cairo_image_surface_get_data(strip);
+    if (data != NULL) glyphs_.assign(data, data + glyphStride_ * CELL_H);
+    else glyphs_.assign(glyphStride_ * CELL_H, 0);
+    cairo_destroy(scr);
+    cairo_surface_destroy(strip);
+}
+
+
+void Push2::fillCell(unsigned row, unsigned cell, uint16_t clr) {
+    unsigned x0 = cell * CELL_W + CELL_X, y0 = row * CELL_H + CELL_Y;
+    unsigned x1 = std::min(x0 + CELL_W, (unsigned) WIDTH), y1 = std::min(y0 + CELL_H, (unsigned) HEIGHT);
+    for (unsigned y = y0; y < y1; y++) {
+        uint16_t *p = pixels(x0, y);
+        for (unsigned x = x0; x < x1; x++) *p++ = clr;
+    }
+}
+
+
+// text clipped to the cell, so a cell can be redrawn without its neighbours
+void Push2::drawText(unsigned row, unsigned cell, const char *str, uint16_t clr) {
+    int x0 = cell * CELL_W + CELL_X, y0 = row * CELL_H + CELL_Y;
+    int x1 = std::min(x0 + (int) CELL_W, WIDTH), y1 = std::min(y0 + (int) CELL_H, HEIGHT);
+    double pen = x0 + TEXT_X;
+    for (const char *c = str; *c && pen < x1; c++) {
+        unsigned g = (unsigned char) *c - GLYPH_FIRST;
+        int gx = (int) (pen + 0.5) - (int) GLYPH_PAD;
+        int from = std::max(x0 - gx, 0), to = std::min(x1 - gx, (int) glyphWidth_[g]);
+        for (int y = y0; y < y1; y++) {
+            const uint8_t *a = &glyphs_[(y - y0) * glyphStride_ + glyphX_[g]];
+            uint16_t *p = pixels(gx, y);
+            for (int i = from; i < to; i++) {
+                if (a[i] == 0) continue;
+                p[i] = a[i] == 255 ? clr : blend(p[i], clr, a[i]);
+            }
+        }
+        pen += glyphAdvance_[g];
+    }
+}
+
+
+bool Push2::printable(const char *str) {
+    for (const char *c = str; *c; c++) {
+        if ((unsigned char) *c < GLYPH_FIRST || (unsigned char) *c > GLYPH_LAST) return false;
+    }
+    return true;
+}
+
+
+void Push2::drawCell(unsigned row, unsigned cell, const char *str, const Push2::Colour &clr, bool inverted) {
+    std::lock_guard<std::mutex> lock(drawLock_);
+    if (row >= CELL_ROWS || cell >= CELL_COLS) {
+        // not a cell, cairo as is
+        uncached_ = true;
+        dirty_ = true;
+        if (inverted) cairo_set_source_rgb(cr, clr.blue_, clr.green_, clr.red_); //!!
+        else cairo_set_source_rgb(cr, 0, 0, 0);
+        cairo_rectangle(cr, (cell * CELL_W + CELL_X), (row * CELL_H) + CELL_Y, CELL_W, CELL_H);
+        cairo_fill(cr);
+        if (inverted) cairo_set_source_rgb(cr, 0, 0, 0);
+        else cairo_set_source_rgb(cr, clr.blue_, clr.green_, clr.red_); //!!
+        cairo_move_to(cr, (cell * CELL_W + CELL_X + TEXT_X), row * CELL_H + CELL_Y + TEXT_BASELINE);
+        cairo_show_text(cr, str);
+        return;
+    }
+
+    Cell &c = cells_[row][cell];
+    c.generation_ = generation_;
+    if (c.valid_ && c.inverted_ == inverted && c.red_ == clr.red_ && c.green_ == clr.green_ && c.blue_ == clr.blue_
+        && c.text_ == str) {
+        return;
+    }
+    c.valid_ = true;
+    c.inverted_ = inverted;
+    c.red_ = clr.red_;
+    c.green_ = clr.green_;
+    c.blue_ = clr.blue_;
+    c.text_ = str;
+    dirty_ = true;
+
+    uint16_t fg = inverted ? 0 : pixel(clr);
+    uint16_t bg = inverted ? pixel(clr) : 0;
+    unsigned x0 = cell * CELL_W + CELL_X, y0 = row * CELL_H + CELL_Y;
+    cairo_surface_flush(surface);
+    fillCell(row, cell, bg);
+    if (printable(str)) {
+        drawText(row, cell, str, fg);
+        cairo_surface_mark_dirty_rectangle(surface, x0, y0, CELL_W, CELL_H);
+    } else {
+        cairo_surface_mark_dirty_rectangle(surface, x0, y0, CELL_W, CELL_H);
+        cairo_save(cr);
+        cairo_rectangle(cr, x0, y0, CELL_W, CELL_H);
+        cairo_clip(cr);
+        if (inverted) cairo_set_source_rgb(cr, 0, 0, 0);
+        else cairo_set_source_rgb(cr, clr.blue_, clr.green_, clr.red_); //!!
+        cairo_move_to(cr, x0 + TEXT_X, y0 + TEXT_BASELINE);
+        cairo_show_text(cr, str);
+        cairo_restore(cr);
+    }
+}
+
+
 void Push2::clearDisplay() {
-    memset(imgBuf_, 0, DATA_PKT_SZ);
-    cairo_set_source_rgb(cr, 0, 0, 0);
-    cairo_paint(cr);
-//    drawCell8(0,5,"Hello",Push2::Colour(0,0,0xFF));
-//    drawCell8(1,5,"Hello",Push2::Colour(0,0,0xFF));
-//    drawInvertedCell8(2,5,"Hello",Push2::Colour(0,0,0xFF));
-//    drawCell8(3,5,"Hello",Push2::Colour(0,0,0xFF));
-//    drawInvertedCell8(3,6,"Hello",Push2::Colour(0xFF,0,0));
-//    drawCell8(4,5,"Hello",Push2::Colour(0,0,0xFF));
-//    drawCell8(5,5,"Hello",Push2::Colour(0,0,0xFF));
+    std::lock_guard<std::mutex> lock(drawLock_);
+    if (uncached_) {
+        memset(imgBuf_, 0, DATA_PKT_SZ);
+        cairo_set_source_rgb(cr, 0, 0, 0);
+        cairo_paint(cr);
+        for (unsigned r = 0; r < CELL_ROWS; r++) {
+            for (unsigned c = 0; c < CELL_COLS; c++) cells_[r][c].valid_ = false;
+        }
+        uncached_ = false;
+        dirty_ = true;
+        return;
+    }
+    // deferred, cells redrawn the same before the next frame are kept, others are cleared then (see sweep)
+    generation_++;
+    clearPending_ = true;
 }
 
 
-void Push2::drawInvertedCell8(unsigned row, unsigned cell, const char *str, const Push2::Colour &clr) {
-    cairo_set_source_rgb(cr, clr.blue_, clr.green_, clr.red_); //!!
-    cairo_rectangle(cr,
-                    (cell * (WIDTH / 8) + 9), (row * 24) + 9,
-                    (WIDTH / 8), 24);
-    cairo_fill(cr);
+void Push2::sweep() {
+    cairo_surface_flush(surface);
+    for (unsigned r = 0; r < CELL_ROWS; r++) {
+        for (unsigned c = 0; c < CELL_COLS; c++) {
+            Cell &cell = cells_[r][c];
+            if (!cell.valid_ || cell.generation_ == generation_) continue;
+            fillCell(r, c, 0);
+            cairo_surface_mark_dirty_rectangle(surface, c * CELL_W + CELL_X, r * CELL_H + CELL_Y, CELL_W, CELL_H);
+            cell.valid_ = false;
+            dirty_ = true;
+        }
+    }
+    clearPending_ = false;
+}
 
-    cairo_set_source_rgb(cr, 0, 0, 0); //!!
-    cairo_move_to(cr, (cell * (WIDTH / 8) + 16), row * 24 + 24);
-    cairo_show_text(cr, str);
+
+void Push2::drawInvertedCell8(unsigned row, unsigned cell, const char *str, const Push2::Colour &clr) {
+    drawCell(row, cell, str, clr, true);
 }
 
 void Push2::drawCell8(unsigned row, unsigned cell, const char *str, const Push2::Colour &clr) {
-    cairo_set_source_rgb(cr, 0, 0, 0); //!!
-    cairo_rectangle(cr,
-                    (cell * (WIDTH / 8) + 9), (row * 24) + 9,
-                    (WIDTH / 8), 24);
-    cairo_fill(cr);
+    drawCell(row, cell, str, clr, false);
+}
 
-    cairo_set_source_rgb(cr, clr.blue_, clr.green_, clr.red_); //!!
-    cairo_move_to(cr, (cell * (WIDTH / 8) + 16), row * 24 + 24);
-    cairo_show_text(cr, str);
+
+void Push2::encode(const uint8_t *src, uint8_t *dst, unsigned size) {
+    unsigned i = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    uint8x16_t vmask = vld1q_u8(encodeMask);
+    for (; i + 16 <= size; i += 16) {
+        vst1q_u8(dst + i, veorq_u8(vld1q_u8(src + i), vmask));
+    }
+#elif defined(__SSE2__)
+    __m128i vmask = _mm_loadu_si128((const __m128i *) encodeMask);
+    for (; i + 16 <= size; i += 16) {
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_xor_si128(_mm_loadu_si128((const __m128i *) (src + i)), vmask));
+    }
+#endif
+    // remainder, or all without simd, a word at a time
+    // mask taken from bytes, so its in device order on any host
+    uint32_t mask;
+    memcpy(&mask, encodeMask, sizeof(mask));
+    for (; i + 4 <= size; i += 4) {
+        uint32_t w;
+        memcpy(&w, src + i, sizeof(w));
+        w ^= mask;
+        memcpy(dst + i, &w, sizeof(w));
+    }
 }
 
 
 int Push2::render() {
-    if (handle_ == NULL) return -1;
-    int tfrsize = 0;
-    int r = 0;
-
-    for (int y = 0; y < HEIGHT; y++) {
-        for (int x = 0; x < LINE; x += 4) {
-            int pixelOffset = (y * LINE) + x;
-            int destinationOffset = (y * LINE) + x;
-            // mask 0xFFE7F3E7
-            dataPkt_[destinationOffset] = imgBuf_[pixelOffset] ^ 0xE7;
-            dataPkt_[destinationOffset + 1] = imgBuf_[pixelOffset + 1] ^ 0xF3;
-            dataPkt_[destinationOffset + 2] = imgBuf_[pixelOffset + 2] ^ 0xE7;
-            dataPkt_[destinationOffset + 3] = imgBuf_[pixelOffset + 3] ^ 0xFF;
+    auto now = std::chrono::steady_clock::now();
+    unsigned buf = current_;
+    {
+        std::unique_lock<std::mutex> lock(drawLock_);
+        if (clearPending_) sweep();
+        if (dirty_) {
+            // other buffer, the last frame may still be in flight
+            buf = current_ ^ 1;
+            lock.unlock();
+            waitFor(buf);
+            lock.lock();
+            encode(imgBuf_, dataPkt_[buf], DATA_PKT_SZ);
+            dirty_ = false;
+        } else if (now - lastFrame_ < std::chrono::milliseconds(KEEPALIVE_MS)) {
+            return 0;
         }
     }
+    waitFor(buf);
+    current_ = buf;
+    lastFrame_ = now;
+    return send(buf) < 0 ? -1 : 1;
+}
 
-    CALL_CHECK(libusb_bulk_transfer(handle_, endpointOut_, headerPkt_, HDR_PKT_SZ, &tfrsize, 1000));
-    if (tfrsize != HDR_PKT_SZ) { printf("header packet short %d", tfrsize); }
-    CALL_CHECK(libusb_bulk_transfer(handle_, endpointOut_, (unsigned char *) dataPkt_, DATA_PKT_SZ, &tfrsize, 1000));
-    if (tfrsize != DATA_PKT_SZ) { printf("data packet short %d", tfrsize); }
 
-    return 0;
+int Push2::send(unsigned buf) {
+    switch (output_) {
+        case O_USB: {
+            if (handle_ == NULL) return -1;
+            int r = 0;
+            // queued on the endpoint, so the data follows its header
+            CALL_CHECK(libusb_submit_transfer(headerTfr_[buf]));
+            pending_[buf]++;
+            CALL_CHECK(libusb_submit_transfer(dataTfr_[buf]));
+            pending_[buf]++;
+            return 0;
+        }
+        case O_FILE: {
+            if (file_ == NULL) return -1;
+            if (fwrite(headerPkt_, HDR_PKT_SZ, 1, file_) != 1
+                || fwrite(dataPkt_[buf], DATA_PKT_SZ, 1, file_) != 1) {
+                perr("  Frame write failed.\n");
+                return -1;
+            }
+            return 0;
+        }
+        case O_NULL:
+        default:
+            return 0;
+    }
+}
+
+
+void LIBUSB_CALL Push2::transferComplete(libusb_transfer *transfer) {
+    if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+        perr("  Transfer failed : %d\n", transfer->status);
+    } else if (transfer->actual_length != transfer->length) {
+        perr("  Transfer short : %d\n", transfer->actual_length);
+    }
+    int *pending = static_cast<int *>(transfer->user_data);
+    (*pending)--;
+}
+
+
+void Push2::waitFor(unsigned buf) {
+    // transfers time out after a second, so this always ends
+    while (pending_[buf] > 0) {
+        struct timeval tv = {1, 0};
+        if (libusb_handle_events_timeout(NULL, &tv) < 0) break;
+    }
+}
+
+
+void Push2::wait(unsigned ms) {
+    if (output_ != O_USB || handle_ == NULL) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+        return;
+    }
+    auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    for (auto now = std::chrono::steady_clock::now(); now < until; now = std::chrono::steady_clock::now()) {
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(until - now).count();
+        struct timeval tv = {(time_t) (us / 1000000), (suseconds_t) (us % 1000000)};
+        if (libusb_handle_events_timeout(NULL, &tv) < 0) {
+            std::this_thread::sleep_until(until);
+            return;
+        }
+    }
 }
 
 
-int Push2::init() {
+int Push2::init(Output output, const std::string &file) {
+    output_ = output;
+    if (output_ == O_FILE) {
+        file_ = fopen(file.c_str(), "wb");
+        if (file_ == NULL) {
+            perr("  Failed to open %s\n", file.c_str());
+            return -1;
+        }
+        return 0;
+    }
+    if (output_ == O_NULL) return 0;
+
     const struct libusb_version *version;
     version = libusb_get_version();
     std::cout << "Using libusb " << version->major << "." << version->minor << "." << version->micro << "."
@@ -146,15 +447,41 @@ int Push2::init() {
 
     CALL_CHECK(libusb_claim_interface(handle_, iface_));
 
+    for (unsigned i = 0; i < 2; i++) {
+        headerTfr_[i] = libusb_alloc_transfer(0);
+        dataTfr_[i] = libusb_alloc_transfer(0);
+        if (headerTfr_[i] == NULL || dataTfr_[i] == NULL) {
+            perr("  Transfer allocation failed.\n");
+            return -1;
+        }
+        libusb_fill_bulk_transfer(headerTfr_[i], handle_, endpointOut_, headerPkt_, HDR_PKT_SZ,
+                                  transferComplete, &pending_[i], 1000);
+        libusb_fill_bulk_transfer(dataTfr_[i], handle_, endpointOut_, dataPkt_[i], DATA_PKT_SZ,
+                                  transferComplete, &pending_[i], 1000);
+    }
+
     return r;
 }
 
 int Push2::deinit() {
-    if (handle_ != NULL) {
-        if (iface_ != 0) libusb_release_interface(handle_, iface_);
-        libusb_close(handle_);
+    if (output_ == O_USB) {
+        for (unsigned i = 0; i < 2; i++) {
+            if (handle_ != NULL) waitFor(i);
+            if (headerTfr_[i] != NULL) libusb_free_transfer(headerTfr_[i]);
+            if (dataTfr_[i] != NULL) libusb_free_transfer(dataTfr_[i]);
+            headerTfr_[i] = dataTfr_[i] = NULL;
+        }
+        if (handle_ != NULL) {
+            if (iface_ != 0) libusb_release_interface(handle_, iface_);
+            libusb_close(handle_);
+            handle_ = NULL;
+        }
+        libusb_exit(NULL);
+    }
+    if (file_ != NULL) {
+        fclose(file_);
+        file_ = NULL;
     }
-    libusb_exit(NULL);
     return 0;
 }
 
@@ -2,7 +2,12 @@
 #define PUSH2LIB_H
 
 #include <stdint.h>
+#include <stdio.h>
 #include <libusb.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
 
 namespace Push2API {
 
@@ -29,23 +34,88 @@ public:
         }
     };
 
+    // where frames are sent, file and null allow rendering without the hardware (e.g. b_push2render)
+    enum Output {
+        O_USB,
+        O_FILE, // frames appended to a file, as they would be sent (header + data)
+        O_NULL  // frames encoded, but not sent
+    };
+
+    // the push blanks its display if no frame arrives for 2 seconds, so an unchanged frame is resent at this interval
+    static const unsigned KEEPALIVE_MS = 1000;
 
     Push2();
     virtual ~Push2();
-    int init();
+    int init(Output output = O_USB, const std::string &file = "");
+    // sends the display, if it has changed since the last frame (or is due a keep alive)
+    // returns 1 if a frame was sent, 0 if skipped, -1 on error
     int render();
+    // handles usb transfer completions for up to ms, in place of sleeping between frames
+    void wait(unsigned ms);
     int deinit();
 
 
+    // drawing may be on any thread, it marks the display changed
+    // cells are cached by content (text, colour, inverted), so redrawing an unchanged cell costs a compare
     void clearDisplay();
     void drawCell8(unsigned row, unsigned cell, const char *str, const Colour& clr);
     void drawInvertedCell8(unsigned row, unsigned cell, const char *str, const Colour& clr);
 
+    // xor with the pushs signal shaping pattern (E7 F3 E7 FF), neon/sse2 where available, size is a multiple of 4
+    static void encode(const uint8_t *src, uint8_t *dst, unsigned size);
 
 
 private:
+    static const unsigned CELL_ROWS = 6;
+    static const unsigned CELL_COLS = 8;
+    // printable ascii, pre-rendered into a strip (a cell high), and blended straight into the display
+    static const unsigned GLYPH_FIRST = 32;
+    static const unsigned GLYPH_LAST = 126;
+    static const unsigned NUM_GLYPHS = GLYPH_LAST - GLYPH_FIRST + 1;
+
+    struct Cell {
+        bool valid_;
+        bool inverted_;
+        float red_, green_, blue_;
+        std::string text_;
+        unsigned generation_; // of clearDisplay, when last drawn
+    };
+
+    void drawCell(unsigned row, unsigned cell, const char *str, const Colour &clr, bool inverted);
+    void drawText(unsigned row, unsigned cell, const char *str, uint16_t clr);
+    void fillCell(unsigned row, unsigned cell, uint16_t clr);
+    void sweep();
+    void renderGlyphs();
+    static bool printable(const char *str);
+
+    static void LIBUSB_CALL transferComplete(libusb_transfer *transfer);
+    int send(unsigned buf);
+    void waitFor(unsigned buf);
+
     uint8_t *headerPkt_;
-    unsigned char dataPkt_[DATA_PKT_SZ];
+    // double buffered, one frame is encoded while the previous is still being transferred
+    alignas(16) unsigned char dataPkt_[2][DATA_PKT_SZ];
+    libusb_transfer *headerTfr_[2];
+    libusb_transfer *dataTfr_[2];
+    int pending_[2];    // transfers in flight, per buffer
+    unsigned current_;  // buffer of the last frame
+
+    std::mutex drawLock_; // cairo surface, cells and dirty_
+    bool dirty_;
+    Cell cells_[CELL_ROWS][CELL_COLS];
+    unsigned generation_;
+    bool clearPending_; // cells not redrawn since clearDisplay are cleared before the next frame
+    bool uncached_;     // drawn outside the cells, so clearDisplay clears everything
+
+    std::vector<uint8_t> glyphs_; // alpha
+    unsigned glyphStride_;
+    unsigned glyphX_[NUM_GLYPHS];
+    unsigned glyphWidth_[NUM_GLYPHS];
+    double glyphAdvance_[NUM_GLYPHS];
+    std::chrono::steady_clock::time_point lastFrame_;
+
+    Output output_;
+    FILE *file_;
 
     libusb_device_handle *handle_;
     int iface_ = 0;
@@ -54,4 +124,4 @@ private:
 
 }
 
-#endif //PUSH2LIB_H
\ No newline at end of file
+#endif //PUSH2LIB_H
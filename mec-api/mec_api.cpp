@@ -2,8 +2,11 @@
 /////////////////////////////////////////////////////////
 
 #include "mec_prefs.h"
+#include "mec_config.h"
 #include "mec_device.h"
 #include "mec_log.h"
+#include "mec_metrics.h"
+#include "mec_voice_allocator.h"
 
 #if !DISABLE_EIGENHARP
 #   include "devices/mec_eigenharp.h"
@@ -27,6 +30,8 @@
 
 namespace mec {
 
+class DeviceCallback;
+
 /////////////////////////////////////////////////////////
 class MecApi_Impl : public ICallback, public ISurfaceCallback, public IMusicalCallback {
 public:
@@ -36,6 +41,8 @@ public:
 
     void init();
     void process();  // periodically call to process messages
+    bool reload(void *prefs);
+    unsigned voices() { return voiceBudget_; }
 
     void subscribe(ICallback *);
     void unsubscribe(ICallback *);
@@ -64,14 +71,115 @@ public:
     virtual void touchOff(const MusicalTouch &);
 
 private:
+    friend class DeviceCallback;
+
     void initDevices();
+    ICallback &deviceCallback(const std::string &name);
+    void applyVoices();
+    void addDevice(const std::string &name, const std::shared_ptr<Device> &device);
 
     std::vector<std::shared_ptr<Device>> devices_;
+    std::vector<Histogram *> processTime_;  // per device, as devices_
     std::unique_ptr<Preferences> fileprefs_; // top level prefs on file
     std::unique_ptr<Preferences> prefs_;     // api prefs
+    MecConfig config_;                       // api prefs, parsed once
     std::vector<ICallback *> callbacks_;
     std::vector<ISurfaceCallback *> surfaces_;
     std::vector<IMusicalCallback *> musicalsurfaces_;
+
+    // devices touch ids are mapped to global voices, each device calls back via its own DeviceCallback
+    VoiceAllocator voiceAllocator_;
+    std::atomic<unsigned> voiceBudget_; // from config, taken up by process()
+    std::atomic<int> stealPolicy_;
+    std::atomic<bool> voicesChanged_;   // budget, policy or device limits reloaded
+    std::vector<std::unique_ptr<DeviceCallback>> deviceCallbacks_;
+
+    Counter &touchOns_;
+    Counter &touchContinues_;
+    Counter &touchOffs_;
+    Counter &controls_;
+    Counter &voicesDropped_;
+    Counter &voicesStolen_;
+    Gauge &voicesActive_;
+};
+
+// voice limit, and whether it steals, for a device, from its config
+static void deviceVoices(const MecConfig &config, const std::string &name, unsigned &limit, bool &steal) {
+    limit = VoiceAllocator::MAX_VOICES;
+    steal = false;
+    if (name == "eigenharp" && config.eigenharp_) {
+        limit = config.eigenharp_->voices_;
+        steal = config.eigenharp_->stealVoices_;
+    } else if (name == "soundplane" && config.soundplane_) {
+        limit = config.soundplane_->voices_;
+        steal = config.soundplane_->stealVoices_;
+    } else if (name == "osct3d" && config.oscT3D_) {
+        limit = config.oscT3D_->voices_;
+        steal = config.oscT3D_->stealVoices_;
+    }
+}
+
+// a devices view of the api, maps its touch ids to global voices
+// a stolen voice is ended here, its device then finds its touch has gone, so ignores the rest of it
+class DeviceCallback : public ICallback {
+public:
+    DeviceCallback(MecApi_Impl &api, const std::string &name)
+        : api_(api), name_(name), limit_(VoiceAllocator::MAX_VOICES), steal_(false) {
+        configure(api_.config_);
+        device_ = api_.voiceAllocator_.addDevice(limit_, steal_);
+    }
+
+    // from reload, applied by apply() on the processing thread
+    void configure(const MecConfig &config) {
+        unsigned limit;
+        bool steal;
+        deviceVoices(config, name_, limit, steal);
+        limit_ = limit;
+        steal_ = steal;
+    }
+
+    void apply() { api_.voiceAllocator_.device(device_, limit_, steal_); }
+
+    void touchOn(int touchId, float note, float x, float y, float z) override {
+        AllocatedVoice stolen;
+        int voice = api_.voiceAllocator_.start(device_, touchId, note, x, y, z, &stolen);
+        if (stolen.device_ >= 0) {
+            api_.voicesStolen_.inc();
+            api_.touchOff(stolen.voice_, stolen.note_, stolen.x_, stolen.y_, 0.0f);
+        }
+        if (voice < 0) {
+            // no voice free, the rest of this touch is ignored
+            api_.voicesDropped_.inc();
+            return;
+        }
+        api_.voicesActive_.set(api_.voiceAllocator_.active());
+        api_.touchOn(voice, note, x, y, z);
+    }
+
+    void touchContinue(int touchId, float note, float x, float y, float z) override {
+        int voice = api_.voiceAllocator_.find(device_, touchId);
+        if (voice < 0) return;
+        api_.voiceAllocator_.update(voice, note, x, y, z);
+        api_.touchContinue(voice, note, x, y, z);
+    }
+
+    void touchOff(int touchId, float note, float x, float y, float z) override {
+        int voice = api_.voiceAllocator_.stop(device_, touchId);
+        if (voice < 0) return;
+        api_.voicesActive_.set(api_.voiceAllocator_.active());
+        api_.touchOff(voice, note, x, y, z);
+    }
+
+    void control(int ctrlId, float v) override { api_.control(ctrlId, v); }
+
+    void mec_control(int cmd, void *other) override { api_.mec_control(cmd, other); }
+
+private:
+    MecApi_Impl &api_;
+    std::string name_;
+    unsigned device_;
+    std::atomic<unsigned> limit_;
+    std::atomic<bool> steal_;
 };
 
 
@@ -100,6 +208,14 @@ void MecApi::process() {
     impl_->process();
 }
 
+bool MecApi::reload(void *prefs) {
+    return impl_->reload(prefs);
+}
+
+unsigned MecApi::voices() {
+    return impl_->voices();
+}
+
 void MecApi::subscribe(ICallback *p) {
     impl_->subscribe(p);
 
@@ -130,14 +246,44 @@ void MecApi::unsubscribe(IMusicalCallback *p) {
 
 /////////////////////////////////////////////////////////
 //MecApi_Impl
-MecApi_Impl::MecApi_Impl(void *prefs) {
+MecApi_Impl::MecApi_Impl(void *prefs) :
+        voiceBudget_(VoiceAllocator::DEFAULT_VOICES),
+        stealPolicy_(S_OLDEST),
+        voicesChanged_(true),
+        touchOns_(Metrics::counter("api.touch.on")),
+        touchContinues_(Metrics::counter("api.touch.continue")),
+        touchOffs_(Metrics::counter("api.touch.off")),
+        controls_(Metrics::counter("api.control")),
+        voicesDropped_(Metrics::counter("voices.dropped")),
+        voicesStolen_(Metrics::counter("voices.stolen")),
+        voicesActive_(Metrics::gauge("voices.active")) {
     fileprefs_.reset(new Preferences(prefs));
     prefs_.reset(new Preferences(fileprefs_->getSubTree("mec")));
-}
-
-MecApi_Impl::MecApi_Impl(const std::string &configFile) {
+    if (!config_.load(*prefs_)) {
+        LOG_0("MecApi configuration has errors (see above), invalid values are using their defaults");
+    }
+    voiceBudget_ = config_.voices_;
+    stealPolicy_ = config_.steal_;
+}
+
+MecApi_Impl::MecApi_Impl(const std::string &configFile) :
+        voiceBudget_(VoiceAllocator::DEFAULT_VOICES),
+        stealPolicy_(S_OLDEST),
+        voicesChanged_(true),
+        touchOns_(Metrics::counter("api.touch.on")),
+        touchContinues_(Metrics::counter("api.touch.continue")),
+        touchOffs_(Metrics::counter("api.touch.off")),
+        controls_(Metrics::counter("api.control")),
+        voicesDropped_(Metrics::counter("voices.dropped")),
+        voicesStolen_(Metrics::counter("voices.stolen")),
+        voicesActive_(Metrics::gauge("voices.active")) {
     fileprefs_.reset(new Preferences(configFile));
     prefs_.reset(new Preferences(fileprefs_->getSubTree("mec")));
+    if (!config_.load(*prefs_)) {
+        LOG_0("MecApi configuration has errors (see above), invalid values are using their defaults");
+    }
+    voiceBudget_ = config_.voices_;
+    stealPolicy_ = config_.steal_;
 }
 
 MecApi_Impl::~MecApi_Impl() {
@@ -147,6 +293,7 @@ MecApi_Impl::~MecApi_Impl() {
         (*it)->deinit();
     }
     devices_.clear();
+    processTime_.clear();
     LOG_1("devices cleared");
     prefs_.reset();
     fileprefs_.reset();
@@ -158,9 +305,52 @@ void MecApi_Impl::init() {
 }
 
 void MecApi_Impl::process() {
-    for (std::vector<std::shared_ptr<Device>>::iterator it = devices_.begin(); it != devices_.end(); ++it) {
-        (*it)->process();
+    if (voicesChanged_.exchange(false)) applyVoices();
+    for (unsigned i = 0; i < devices_.size(); i++) {
+        ScopedTimer timer(*processTime_[i]);
+        devices_[i]->process();
+    }
+}
+
+bool MecApi_Impl::reload(void *prefs) {
+    Preferences fileprefs(prefs);
+    Preferences mecprefs(fileprefs.getSubTree("mec"));
+    if (!mecprefs.valid()) {
+        LOG_0("MecApi reload : no mec configuration, ignored");
+        return false;
+    }
+    // dont apply a partially valid configuration to a running instrument
+    MecConfig config;
+    if (!config.load(mecprefs)) {
+        LOG_0("MecApi reload : invalid configuration, ignored");
+        return false;
     }
+
+    bool ret = true;
+    if ((bool) config.eigenharp_ != (bool) config_.eigenharp_
+        || (bool) config.soundplane_ != (bool) config_.soundplane_
+        || (bool) config.push2_ != (bool) config_.push2_
+        || (bool) config.oscDisplay_ != (bool) config_.oscDisplay_
+        || (bool) config.nui_ != (bool) config_.nui_
+        || (bool) config.midi_ != (bool) config_.midi_
+        || (bool) config.oscT3D_ != (bool) config_.oscT3D_
+        || (bool) config.kontrol_ != (bool) config_.kontrol_) {
+        LOG_0("MecApi reload : adding or removing devices requires a restart");
+        ret = false;
+    }
+
+    // devices_ is only changed by init, before reloads
+    for (auto device : devices_) {
+        ret &= device->reload(config);
+    }
+    voiceBudget_ = config.voices_;
+    stealPolicy_ = config.steal_;
+    for (auto &callback : deviceCallbacks_) {
+        callback->configure(config);
+    }
+    voicesChanged_ = true;
+    config_ = config;
+    return ret;
 }
 
 void MecApi_Impl::subscribe(ICallback *p) {
@@ -204,24 +394,28 @@ void MecApi_Impl::unsubscribe(IMusicalCallback *p) {
 
 
 void MecApi_Impl::touchOn(int touchId, float note, float x, float y, float z) {
+    touchOns_.inc();
     for (std::vector<ICallback *>::iterator it = callbacks_.begin(); it != callbacks_.end(); ++it) {
         (*it)->touchOn(touchId, note, x, y, z);
     }
 }
 
 void MecApi_Impl::touchContinue(int touchId, float note, float x, float y, float z) {
+    touchContinues_.inc();
     for (std::vector<ICallback *>::iterator it = callbacks_.begin(); it != callbacks_.end(); ++it) {
         (*it)->touchContinue(touchId, note, x, y, z);
     }
 }
 
 void MecApi_Impl::touchOff(int touchId, float note, float x, float y, float z) {
+    touchOffs_.inc();
     for (std::vector<ICallback *>::iterator it = callbacks_.begin(); it != callbacks_.end(); ++it) {
         (*it)->touchOff(touchId, note, x, y, z);
     }
 }
 
 void MecApi_Impl::control(int ctrlId, float v) {
+    controls_.inc();
     for (std::vector<ICallback *>::iterator it = callbacks_.begin(); it != callbacks_.end(); ++it) {
         (*it)->control(ctrlId, v);
     }
@@ -277,6 +471,28 @@ void MecApi_Impl::touchOff(const MusicalTouch &t) {
 
 
 
+ICallback &MecApi_Impl::deviceCallback(const std::string &name) {
+    deviceCallbacks_.emplace_back(new DeviceCallback(*this, name));
+    return *deviceCallbacks_.back();
+}
+
+// on the processing thread, after init or reload
+void MecApi_Impl::applyVoices() {
+    if (voiceBudget_ != voiceAllocator_.voices()) {
+        voiceAllocator_.voices(voiceBudget_);
+        LOG_0("MecApi voices " << voiceAllocator_.voices());
+    }
+    voiceAllocator_.policy((StealPolicy) stealPolicy_.load());
+    for (auto &callback : deviceCallbacks_) {
+        callback->apply();
+    }
+}
+
+void MecApi_Impl::addDevice(const std::string &name, const std::shared_ptr<Device> &device) {
+    devices_.push_back(device);
+    processTime_.push_back(&Metrics::histogram("device." + name + ".process_us"));
+}
+
 void MecApi_Impl::initDevices() {
     if (fileprefs_ == nullptr || prefs_ == nullptr) {
         LOG_1("MecApi_Impl :: invalid preferences file");
@@ -284,12 +500,12 @@ void MecApi_Impl::initDevices() {
     }
 
 #if !DISABLE_EIGENHARP
-    if (prefs_->exists("eigenharp")) {
+    if (config_.eigenharp_) {
         LOG_1("eigenharp initialise ");
-        std::shared_ptr<Device> device = std::make_shared<Eigenharp>(*this);
-        if (device->init(prefs_->getSubTree("eigenharp"))) {
+        auto device = std::make_shared<Eigenharp>(deviceCallback("eigenharp"));
+        if (device->init(*config_.eigenharp_)) {
             if (device->isActive()) {
-                devices_.push_back(device);
+                addDevice("eigenharp", device);
             } else {
                 LOG_1("eigenharp init inactive ");
                 device->deinit();
@@ -302,12 +518,12 @@ void MecApi_Impl::initDevices() {
 #endif
 
 #if !DISABLE_SOUNDPLANELITE
-    if (prefs_->exists("soundplane")) {
+    if (config_.soundplane_) {
         LOG_1("soundplane initialise");
-        std::shared_ptr<Device> device = std::make_shared<Soundplane>(*this);
-        if (device->init(prefs_->getSubTree("soundplane"))) {
+        auto device = std::make_shared<Soundplane>(deviceCallback("soundplane"));
+        if (device->init(*config_.soundplane_)) {
             if (device->isActive()) {
-                devices_.push_back(device);
+                addDevice("soundplane", device);
                 LOG_1("soundplane init active ");
             } else {
                 LOG_1("soundplane init inactive ");
@@ -321,13 +537,13 @@ void MecApi_Impl::initDevices() {
 #endif
 
 #if !DISABLE_PUSH2
-    if (prefs_->exists("push2")) {
+    if (config_.push2_) {
         LOG_1("push2 initialise ");
-        std::shared_ptr<Push2> device = std::make_shared<Push2>(*this);
+        std::shared_ptr<Push2> device = std::make_shared<Push2>(deviceCallback("push2"));
         Kontrol::KontrolModel::model()->addCallback("push2", device);
-        if (device->init(prefs_->getSubTree("push2"))) {
+        if (device->init(*config_.push2_)) {
             if (device->isActive()) {
-                devices_.push_back(device);
+                addDevice("push2", device);
             } else {
                 LOG_1("push2 init inactive ");
                 device->deinit();
@@ -341,14 +557,14 @@ void MecApi_Impl::initDevices() {
 
 
 #if !DISABLE_OSCDISPLAY
-    if (prefs_->exists("oscdisplay")) {
+    if (config_.oscDisplay_) {
         LOG_1("oscdisplay initialise ");
         std::shared_ptr<OscDisplay> device = std::make_shared<OscDisplay>();
 //        std::shared_ptr<OscDisplay> device = std::make_shared<OscDisplay>(*this);
         Kontrol::KontrolModel::model()->addCallback("oscdisplay", device);
-        if (device->init(prefs_->getSubTree("oscdisplay"))) {
+        if (device->init(*config_.oscDisplay_)) {
             if (device->isActive()) {
-                devices_.push_back(device);
+                addDevice("oscdisplay", device);
             } else {
                 LOG_1("oscdisplay init inactive ");
                 device->deinit();
@@ -362,13 +578,13 @@ void MecApi_Impl::initDevices() {
 
 
 #if !DISABLE_NUI
-    if (prefs_->exists("nui")) {
+    if (config_.nui_) {
         LOG_1("nui initialise ");
         std::shared_ptr<Nui> device = std::make_shared<Nui>();
         Kontrol::KontrolModel::model()->addCallback("nui", device);
-        if (device->init(prefs_->getSubTree("nui"))) {
+        if (device->init(*config_.nui_)) {
             if (device->isActive()) {
-                devices_.push_back(device);
+                addDevice("nui", device);
             } else {
                 LOG_1("nui init inactive ");
                 device->deinit();
@@ -382,12 +598,12 @@ void MecApi_Impl::initDevices() {
 
 
 
-    if (prefs_->exists("midi")) {
+    if (config_.midi_) {
         LOG_1("midi initialise ");
-        std::shared_ptr<Device> device = std::make_shared<MidiDevice>(*this);
-        if (device->init(prefs_->getSubTree("midi"))) {
+        auto device = std::make_shared<MidiDevice>(deviceCallback("midi"));
+        if (device->init(*config_.midi_)) {
             if (device->isActive()) {
-                devices_.push_back(device);
+                addDevice("midi", device);
             } else {
                 LOG_1("midi init inactive ");
                 device->deinit();
@@ -399,12 +615,12 @@ void MecApi_Impl::initDevices() {
     }
 
 
-    if (prefs_->exists("osct3d")) {
+    if (config_.oscT3D_) {
         LOG_1("osct3d initialise ");
-        std::shared_ptr<Device> device = std::make_shared<OscT3D>(*this);
-        if (device->init(prefs_->getSubTree("osct3d"))) {
+        auto device = std::make_shared<OscT3D>(deviceCallback("osct3d"));
+        if (device->init(*config_.oscT3D_)) {
             if (device->isActive()) {
-                devices_.push_back(device);
+                addDevice("osct3d", device);
             } else {
                 LOG_1("osct3d init inactive ");
                 device->deinit();
@@ -415,12 +631,12 @@ void MecApi_Impl::initDevices() {
         }
     }
 
-    if (prefs_->exists("kontrol")) {
+    if (config_.kontrol_) {
         LOG_1("KontrolDevice initialise ");
-        std::shared_ptr<Device> device = std::make_shared<KontrolDevice>(*this);
-        if (device->init(prefs_->getSubTree("Kontrol"))) {
+        auto device = std::make_shared<KontrolDevice>(deviceCallback("kontrol"));
+        if (device->init(*config_.kontrol_)) {
             if (device->isActive()) {
-                devices_.push_back(device);
+                addDevice("kontrol", device);
             } else {
                 LOG_1("KontrolDevice init inactive ");
                 device->deinit();
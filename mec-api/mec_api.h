@@ -115,6 +115,15 @@ public:
     void init();
     void process();  // periodically call to process messages
 
+    // apply a changed configuration (same layout as the constructor), without reopening devices
+    // call from any thread, devices take up changes between processing cycles
+    // false if the configuration was invalid (so ignored), or some of the change needs a restart
+    bool reload(void *prefs);
+
+    // touch ids passed to ICallback are global voices, 0..voices()-1, whichever device they came from
+    // (see VoiceAllocator), so may be used directly as an index, e.g. an mpe channel
+    unsigned voices();
+
     void subscribe(ICallback*);
     void unsubscribe(ICallback*);
 
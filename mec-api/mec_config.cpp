@@ -0,0 +1,199 @@
+#include "mec_config.h"
+
+#include "mec_configreader.h"
+#include "mec_log.h"
+#include "mec_voice.h"
+
+#include <OSCBroadcaster.h>
+
+namespace mec {
+
+bool MappingConfig::load(const Preferences &prefs, const std::string &path) {
+    ConfigReader r(prefs, path);
+    mode_ = M_None;
+    if (r.exists("notes")) {
+        mode_ = M_Notes;
+        r.read("notes", notes_);
+    }
+    if (r.exists("calculated")) {
+        Preferences calc(r.object("calculated"));
+        if (mode_ == M_None && calc.valid()) {
+            mode_ = M_Calculated;
+            ConfigReader c(calc, r.path("calculated"));
+            c.read("keys in col", keysInCol_, 127, 1);
+            c.read("row multiplier", rowMultiplier_, 1);
+            // sic, as in existing configurations
+            c.read("col multipler", colMultiplier_, keysInCol_);
+            c.read("note offset", noteOffset_, 0);
+            c.done();
+        }
+    }
+    r.read("percussion notes", percussionNotes_);
+    return r.done();
+}
+
+
+bool EigenharpConfig::Model::load(const Preferences &prefs, const std::string &path) {
+    ConfigReader r(prefs, path);
+    exists_ = true;
+    if (r.exists("leds")) {
+        Preferences leds(r.object("leds"));
+        ConfigReader l(leds, r.path("leds"));
+        l.read("green", greenLeds_);
+        l.read("orange", orangeLeds_);
+        l.read("red", redLeds_);
+        l.done();
+    }
+    hasMapping_ = r.exists("mapping");
+    if (hasMapping_) {
+        Preferences mapping(r.object("mapping"));
+        mapping_.load(mapping, r.path("mapping"));
+    }
+    return r.done();
+}
+
+bool EigenharpConfig::load(const Preferences &prefs, const std::string &path) {
+    ConfigReader r(prefs, path);
+    r.read("firmware dir", firmwareDir_, "./");
+    r.read("min poll time", minPollTime_, 100);
+    r.read("voices", voices_, (unsigned) Voices::NUM_VOICES, 1);
+    r.read("velocity count", velocityCount_, (unsigned) Voices::V_COUNT, 1);
+    r.read("velocity curve", velocityCurve_, Voices::V_CURVE_AMT);
+    r.read("velocity scale", velocityScale_, Voices::V_SCALE_AMT);
+    r.read("pitchbend range", pitchbendRange_, 2.0f);
+    r.read("steal voices", stealVoices_, true);
+    r.read("throttle", throttle_, 0);
+
+    struct {
+        const char *key_;
+        Model &model_;
+    } models[] = {{"pico",    pico_},
+                  {"tau",     tau_},
+                  {"alpha",   alpha_},
+                  {"default", default_}};
+    for (auto &m : models) {
+        m.model_ = Model();
+        if (r.exists(m.key_)) {
+            Preferences model(r.object(m.key_));
+            m.model_.load(model, r.path(m.key_));
+        }
+        r.known(m.key_);
+    }
+    return r.done();
+}
+
+
+bool SoundplaneConfig::load(const Preferences &prefs, const std::string &path) {
+    ConfigReader r(prefs, path);
+    r.read("voices", voices_, 15, 1);
+    r.read("steal voices", stealVoices_, true);
+    return r.done();
+}
+
+
+bool MidiDeviceConfig::load(const Preferences &prefs, const std::string &path) {
+    ConfigReader r(prefs, path);
+    read(r);
+    return r.done();
+}
+
+void MidiDeviceConfig::read(ConfigReader &r) {
+    r.read("input device", inputDevice_, "");
+    r.read("mpe", mpe_, true);
+    r.read("pitchbend range", pitchbendRange_, 48.0f, 0.0f);
+    r.read("output device", outputDevice_, "");
+    r.read("virtual output", virtualOutput_, false);
+}
+
+
+bool Push2Config::load(const Preferences &prefs, const std::string &path) {
+    bool ret = true;
+    ConfigReader r(prefs, path);
+    MidiDeviceConfig::read(r);
+    r.read("display fps", displayFps_, 30, 1, 60);
+    std::string output;
+    r.read("display output", output, "usb");
+    if (output == "usb") displayOutput_ = D_USB;
+    else if (output == "file") displayOutput_ = D_FILE;
+    else if (output == "null") displayOutput_ = D_NULL;
+    else {
+        LOG_0("config error : " << r.path("display output") << " unknown output " << output << " (usb, file, null)");
+        displayOutput_ = D_USB;
+        ret = false;
+    }
+    r.read("display file", displayFile_, "push2.frames");
+    ret &= r.done();
+    return ret;
+}
+
+
+bool OscT3DConfig::load(const Preferences &prefs, const std::string &path) {
+    ConfigReader r(prefs, path);
+    r.read("port", port_, 9000, 1, 65535);
+    r.read("voices", voices_, 15, 1);
+    r.read("steal voices", stealVoices_, false);
+    return r.done();
+}
+
+
+bool KontrolDeviceConfig::load(const Preferences &prefs, const std::string &path) {
+    ConfigReader r(prefs, path);
+    r.read("listen port", listenPort_, 6000, 0, 65535);
+    r.read("listen", listen_, "");
+    r.read("modulation rate", modulationRate_, Kontrol::OSCBroadcaster::MODULATION_RATE_MS);
+    return r.done();
+}
+
+
+bool OscDisplayConfig::load(const Preferences &prefs, const std::string &path) {
+    ConfigReader r(prefs, path);
+    r.read("listen port", listenPort_, 6100, 0, 65535);
+    r.read("menu timeout", menuTimeout_, 350);
+    r.read("max fps", maxFps_, 25, 0, 200);
+    return r.done();
+}
+
+
+bool NuiConfig::load(const Preferences &prefs, const std::string &path) {
+    ConfigReader r(prefs, path);
+    r.read("menu timeout", menuTimeout_, 2000);
+    r.read("resource path", resourcePath_, "/home/we/norns/resources");
+    r.read("splash", splash_, "./oracsplash4.png");
+    r.read("poll freq", pollFreq_, 1, 1);
+    r.read("poll sleep", pollSleep_, 1000);
+    r.read("param display", paramDisplay_, 0);
+    r.read("max fps", maxFps_, 25, 0, 200);
+    r.read("listen port", listenPort_, 6100, 0, 65535);
+    return r.done();
+}
+
+
+bool MecConfig::load(const Preferences &prefs, const std::string &path) {
+    ConfigReader r(prefs, path);
+    bool ret = true;
+    ret &= r.read("eigenharp", eigenharp_);
+    ret &= r.read("soundplane", soundplane_);
+    ret &= r.read("push2", push2_);
+    ret &= r.read("oscdisplay", oscDisplay_);
+    ret &= r.read("nui", nui_);
+    ret &= r.read("midi", midi_);
+    ret &= r.read("osct3d", oscT3D_);
+    ret &= r.read("kontrol", kontrol_);
+    r.read("voices", voices_, VoiceAllocator::DEFAULT_VOICES, 1, VoiceAllocator::MAX_BUDGET);
+    std::string steal;
+    r.read("steal", steal, "oldest");
+    if (!stealPolicy(steal, steal_)) {
+        LOG_0("config error : " << r.path("steal") << " unknown policy " << steal
+                                << " (none, oldest, quietest, highest, lowest, nearest)");
+        ret = false;
+    }
+
+    // loaded by Scales, SurfaceManager and Scaler
+    r.known("scales");
+    r.known("surfaces");
+    r.knownPrefix("scaler");
+    ret &= r.done();
+    return ret;
+}
+
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "mec_prefs.h"
+#include "mec_voice_allocator.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// typed configuration, parsed (and validated) once from mec.json
+// devices and processors use these fields directly, rather than looking up Preferences at runtime
+
+namespace mec {
+
+class ConfigReader;
+
+// key to note mapping, see SurfaceMapper
+struct MappingConfig {
+    enum Mode {
+        M_None,
+        M_Notes,
+        M_Calculated
+    } mode_;
+
+    // notes
+    std::vector<int> notes_;
+
+    // second course keys (e.g. alpha percussion), either mode
+    std::vector<int> percussionNotes_;
+
+    // calculated
+    int keysInCol_;
+    int rowMultiplier_;
+    int colMultiplier_;
+    int noteOffset_;
+
+    MappingConfig() : mode_(M_None), keysInCol_(127), rowMultiplier_(1), colMultiplier_(127), noteOffset_(0) { ; }
+
+    bool load(const Preferences &prefs, const std::string &path);
+};
+
+
+struct EigenharpConfig {
+    // per model (pico, tau, alpha) settings, applied when a device of the model is connected
+    struct Model {
+        bool exists_;
+        std::vector<int> greenLeds_;
+        std::vector<int> orangeLeds_;
+        std::vector<int> redLeds_;
+        bool hasMapping_;
+        MappingConfig mapping_;
+
+        Model() : exists_(false), hasMapping_(false) { ; }
+
+        bool load(const Preferences &prefs, const std::string &path);
+    };
+
+    std::string firmwareDir_;
+    unsigned minPollTime_;
+    unsigned voices_;
+    unsigned velocityCount_;
+    float velocityCurve_;
+    float velocityScale_;
+    float pitchbendRange_;
+    bool stealVoices_;
+    unsigned throttle_; // max rate per second, 0 = unthrottled
+
+    Model pico_;
+    Model tau_;
+    Model alpha_;
+    Model default_;
+
+    bool load(const Preferences &prefs, const std::string &path);
+};
+
+
+struct SoundplaneConfig {
+    unsigned voices_;
+    bool stealVoices_;
+
+    bool load(const Preferences &prefs, const std::string &path);
+};
+
+
+// midi device, also used by push2
+struct MidiDeviceConfig {
+    std::string inputDevice_;
+    bool mpe_;
+    float pitchbendRange_;
+    std::string outputDevice_;
+    bool virtualOutput_;
+
+    bool load(const Preferences &prefs, const std::string &path);
+
+protected:
+    void read(ConfigReader &r);
+};
+
+
+struct Push2Config : public MidiDeviceConfig {
+    enum DisplayOutput {
+        D_USB,
+        D_FILE, // frames written to display file, e.g. to run without the hardware
+        D_NULL
+    };
+
+    unsigned displayFps_; // maximum, unchanged frames are not sent
+    DisplayOutput displayOutput_;
+    std::string displayFile_;
+
+    bool load(const Preferences &prefs, const std::string &path);
+};
+
+
+struct OscT3DConfig {
+    unsigned port_;
+    unsigned voices_;
+    bool stealVoices_;
+
+    bool load(const Preferences &prefs, const std::string &path);
+};
+
+
+struct KontrolDeviceConfig {
+    unsigned listenPort_;
+    std::string listen_; // unix:/path, same host clients over an AF_UNIX socket, in place of the listen port
+    unsigned modulationRate_;
+
+    bool load(const Preferences &prefs, const std::string &path);
+};
+
+
+struct OscDisplayConfig {
+    unsigned listenPort_;
+    unsigned menuTimeout_;
+    unsigned maxFps_; // display updates per second, 0 = uncapped
+
+    bool load(const Preferences &prefs, const std::string &path);
+};
+
+
+struct NuiConfig {
+    unsigned menuTimeout_;
+    std::string resourcePath_;
+    std::string splash_;
+    // the nui thread polls modes and the device every poll freq * poll sleep us, osc and device events wake it
+    unsigned pollFreq_;
+    unsigned pollSleep_;
+    unsigned paramDisplay_;
+    unsigned maxFps_; // display updates per second, 0 = uncapped
+    unsigned listenPort_;
+
+    bool load(const Preferences &prefs, const std::string &path);
+};
+
+
+// the "mec" object, a device is only configured if present
+struct MecConfig {
+    std::shared_ptr<EigenharpConfig> eigenharp_;
+    std::shared_ptr<SoundplaneConfig> soundplane_;
+    std::shared_ptr<Push2Config> push2_;
+    std::shared_ptr<OscDisplayConfig> oscDisplay_;
+    std::shared_ptr<NuiConfig> nui_;
+    std::shared_ptr<MidiDeviceConfig> midi_;
+    std::shared_ptr<OscT3DConfig> oscT3D_;
+    std::shared_ptr<KontrolDeviceConfig> kontrol_;
+
+    unsigned voices_; // global voices (e.g. mpe channels) shared by all devices, 1..15, see VoiceAllocator
+    StealPolicy steal_; // for devices which steal voices, when they have used their voices, or all are used
+
+    bool load(const Preferences &prefs, const std::string &path = "mec");
+};
+
+}
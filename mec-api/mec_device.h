@@ -2,6 +2,7 @@
 #define MEC_DEVICE_H
 
 #include "mec_prefs.h"
+#include "mec_config.h"
 
 namespace mec {
 
@@ -12,6 +13,11 @@ public:
     virtual bool process() = 0 ;
     virtual void deinit() = 0;
     virtual bool isActive() = 0;
+
+    // apply a changed configuration without reopening the device, called off the processing thread
+    // the device takes up the new settings between processing cycles, so touches in flight continue
+    // false if (some of) the change needs a restart
+    virtual bool reload(const MecConfig &) { return false; }
 };
 
 }
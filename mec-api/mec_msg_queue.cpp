@@ -2,6 +2,7 @@
 
 #include "mec_api.h"
 #include "mec_log.h"
+#include "mec_metrics.h"
 
 #include <readerwriterqueue.h>
 namespace mec {
@@ -11,7 +12,7 @@ const int MAX_QUEUE_SIZE = 128;
 
 class MsgQueue_impl {
 public:
-    MsgQueue_impl();
+    MsgQueue_impl(const std::string &name);
     ~MsgQueue_impl();
 
     bool addToQueue(MecMsg &);
@@ -19,12 +20,15 @@ public:
 
 private:
     moodycamel::ReaderWriterQueue<MecMsg> queue_;
+    Counter &queued_;
+    Counter &dropped_;
+    Gauge &depth_;
 };
 
 
 /////////// Public Interface
-MsgQueue::MsgQueue() {
-    impl_.reset(new MsgQueue_impl());
+MsgQueue::MsgQueue(const std::string &name) {
+    impl_.reset(new MsgQueue_impl(name));
 }
 
 MsgQueue::~MsgQueue() {
@@ -96,7 +100,11 @@ bool MsgQueue::send(MecMsg& msg, ICallback &c) {
 
 /////////// Implementation
 
-MsgQueue_impl::MsgQueue_impl() : queue_(MAX_QUEUE_SIZE) {
+MsgQueue_impl::MsgQueue_impl(const std::string &name) :
+        queue_(MAX_QUEUE_SIZE),
+        queued_(Metrics::counter(name + ".queued")),
+        dropped_(Metrics::counter(name + ".dropped")),
+        depth_(Metrics::gauge(name + ".depth")) {
 }
 
 MsgQueue_impl::~MsgQueue_impl() {
@@ -104,7 +112,13 @@ MsgQueue_impl::~MsgQueue_impl() {
 }
 
 bool MsgQueue_impl::addToQueue(MecMsg &msg) {
-    return queue_.try_enqueue(msg);
+    if (!queue_.try_enqueue(msg)) {
+        dropped_.inc();
+        return false;
+    }
+    queued_.inc();
+    depth_.set((int64_t) queue_.size_approx());
+    return true;
 }
 
 bool MsgQueue_impl::nextMsg(MecMsg &msg) {
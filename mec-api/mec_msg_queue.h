@@ -2,6 +2,7 @@
 #define MECMSGQUEUE_H
 
 #include <memory>
+#include <string>
 
 namespace mec {
 
@@ -40,7 +41,8 @@ class MsgQueue_impl;
 
 class MsgQueue {
 public:
-    MsgQueue();
+    // name for metrics, name.queued, name.dropped, name.depth
+    explicit MsgQueue(const std::string &name = "msgqueue");
     ~MsgQueue();
     bool addToQueue(MecMsg&);
     bool nextMsg(MecMsg&);
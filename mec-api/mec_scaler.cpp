@@ -1,5 +1,7 @@
 #include "mec_scaler.h"
 
+#include "mec_configreader.h"
+
 namespace mec {
 
 
@@ -19,19 +21,15 @@ Scales::~Scales() {
 bool Scales::load(const Preferences &prefs) {
     if (!prefs.valid()) return false;
 
-    std::vector<std::string> keys = prefs.getKeys();
-    for (const std::string &k : keys) {
+    ConfigReader r(prefs, "scales");
+    for (const std::string &k : prefs.getKeys()) {
         ScaleArray scale;
-        Preferences::Array array(prefs.getArray(k));
-        for (unsigned i = 0; i < array.getSize(); i++) {
-            auto n = (float) array.getDouble(i);
-            scale.push_back(n);
-        }
+        r.read(k, scale);
         if (!scale.empty()) {
             scales_[k] = scale;
         }
     }
-    return true;
+    return r.done();
 }
 
 bool Scales::init(const Preferences &p) {
@@ -57,12 +55,14 @@ Scaler::~Scaler() {
 bool Scaler::load(const Preferences &prefs) {
     if (!prefs.valid()) return false;
 
-    scale_ = Scales::getScale(prefs.getString("scale", "major"));
-    tonic_ = (float) prefs.getDouble("tonic", 0.0f);
-    rowOffset_ = (float) prefs.getDouble("row offset", 0.0f);
-    columnOffset_ = (float) prefs.getDouble("column offset", 0.0f);
-
-    return true;
+    ConfigReader r(prefs, "scaler");
+    std::string scale;
+    r.read("scale", scale, "major");
+    scale_ = Scales::getScale(scale);
+    r.read("tonic", tonic_, 0.0f);
+    r.read("row offset", rowOffset_, 0.0f);
+    r.read("column offset", columnOffset_, 0.0f);
+    return r.done();
 }
 
 MusicalTouch Scaler::map(const Touch &t) const {
@@ -6,6 +6,7 @@
 // mapping between surfaces
 //
 
+#include "mec_configreader.h"
 #include "mec_log.h"
 
 #include <algorithm>
@@ -27,12 +28,14 @@ SurfaceManager::~SurfaceManager() {
 bool SurfaceManager::init(const Preferences &prefs) {
     if (!prefs.valid()) return false;
 
-    std::vector<std::string> keys = prefs.getKeys();
-    for (std::string k : keys) {
-        Preferences p(prefs.getSubTree(k));
+    ConfigReader r(prefs, "surfaces");
+    for (const std::string &k : prefs.getKeys()) {
+        Preferences p(r.object(k));
         if (p.valid()) {
+            ConfigReader s(p, r.path(k));
             std::shared_ptr<Surface> pS;
-            std::string type = p.getString("type", "");
+            std::string type;
+            s.read("type", type, "");
             if (type.size() == 0) { // plain
                 pS.reset(new Surface(k));
             } else if (type == "join") {
@@ -41,10 +44,12 @@ bool SurfaceManager::init(const Preferences &prefs) {
                 pS.reset(new SplitSurface(k));
             } else {
                 pS.reset();
-                LOG_0("SurfaceManager: surface def missing type");
+                LOG_0("config error : " << s.path("type") << " unknown surface type " << type << " (join, split)");
             }
             if (pS) {
-                if (pS->load(p)) {
+                bool loaded = pS->load(s);
+                s.done();
+                if (loaded) {
                     surfaces_[k] = pS;
                 } else {
                     pS.reset();
@@ -52,6 +57,7 @@ bool SurfaceManager::init(const Preferences &prefs) {
             }
         }
     }
+    r.done();
     return true;
 }
 
@@ -71,8 +77,8 @@ Surface::~Surface() {
     ;
 }
 
-bool Surface::load(const Preferences &prefs) {
-    return prefs.valid();
+bool Surface::load(ConfigReader &) {
+    return true;
 }
 
 Touch Surface::map(const Touch &t) const {
@@ -84,6 +90,18 @@ SurfaceID Surface::getId() {
 }
 
 
+// x, y, z, r or c, as the C_ index of the surfaces axis
+static int readAxis(ConfigReader &r) {
+    static const char *AXES[] = {"x", "y", "z", "r", "c"};
+    std::string axis;
+    r.read("axis", axis, "x");
+    for (int i = 0; i < 5; i++) {
+        if (axis == AXES[i]) return i;
+    }
+    LOG_0("config error : " << r.path("axis") << " unknown axis " << axis << " (x, y, z, r, c), using x");
+    return 0;
+}
+
 //const float UNDEFINED_SPLIT = -1.0f;
 //const float MIN_SPLIT = 0.0f;
 //const float MAX_SPLIT = 16384.0f;
@@ -100,32 +118,19 @@ SplitSurface::~SplitSurface() {
     ;
 }
 
-bool SplitSurface::load(const Preferences &prefs) {
-
-    if (!prefs.valid()) return false;
-
-    splitPoint_ = (float) prefs.getDouble("split point", 0.5);
+bool SplitSurface::load(ConfigReader &r) {
+    // split point divides, so must be positive
+    r.read("split point", splitPoint_, 0.5f, FLT_MIN);
 
-    Preferences::Array array(prefs.getArray("surfaces"));
-    for (unsigned i = 0; i < array.getSize(); i++) {
-        SurfaceID n = array.getString(i);
+    std::vector<std::string> surfaces;
+    r.read("surfaces", surfaces);
+    for (const auto &n : surfaces) {
         if (n.size() > 0) {
             surfaces_.push_back(n);
         }
     }
 
-    std::string axis = prefs.getString("axis", "");
-    if (axis.size() > 0) {
-        if (axis == "x") axis_ = C_X;
-        else if (axis == "y") axis_ = C_Y;
-        else if (axis == "z") axis_ = C_Z;
-        else if (axis == "r") axis_ = C_R;
-        else if (axis == "c") axis_ = C_C;
-        else axis_ = C_X;
-    } else {
-        axis_ = C_X;
-    }
-
+    axis_ = static_cast<decltype(axis_)>(readAxis(r));
 
     return surfaces_.size() > 0;
 }
@@ -189,32 +194,19 @@ JoinedSurface::~JoinedSurface() {
     ;
 }
 
-bool JoinedSurface::load(const Preferences &prefs) {
-    if (!prefs.valid()) return false;
-
+bool JoinedSurface::load(ConfigReader &r) {
     // temp, this will come from the source surface
-    surfaceSize_ = (float) prefs.getDouble("surface size", 1.0);
+    r.read("surface size", surfaceSize_, 1.0f);
 
-    Preferences::Array array(prefs.getArray("surfaces"));
-    for (unsigned i = 0; i < array.getSize(); i++) {
-        SurfaceID n = array.getString(i);
+    std::vector<std::string> surfaces;
+    r.read("surfaces", surfaces);
+    for (const auto &n : surfaces) {
         if (n.size() > 0) {
             surfaces_.push_back(n);
         }
     }
 
-    std::string axis = prefs.getString("axis", "");
-    if (axis.size() > 0) {
-        if (axis == "x") axis_ = C_X;
-        else if (axis == "y") axis_ = C_Y;
-        else if (axis == "z") axis_ = C_Z;
-        else if (axis == "r") axis_ = C_R;
-        else if (axis == "c") axis_ = C_C;
-        else axis_ = C_X;
-    } else {
-        axis_ = C_X;
-    }
-
+    axis_ = static_cast<decltype(axis_)>(readAxis(r));
 
     return surfaces_.size() > 0;
 }
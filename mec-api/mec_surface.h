@@ -17,6 +17,7 @@
 namespace mec {
 
 
+class ConfigReader;
 class Surface;
 
 class SurfaceManager {
@@ -37,7 +38,7 @@ public:
     virtual ~Surface();
 
     SurfaceID getId();
-    virtual bool load(const Preferences &prefs);
+    virtual bool load(ConfigReader &r);
     virtual Touch map(const Touch &) const;
 
 protected:
@@ -50,7 +51,7 @@ public:
     SplitSurface(SurfaceID surfaceId);
     virtual ~SplitSurface();
 
-    virtual bool load(const Preferences &prefs) override;
+    virtual bool load(ConfigReader &r) override;
     virtual Touch map(const Touch &) const override;
 
 private:
@@ -73,7 +74,7 @@ public:
     JoinedSurface(SurfaceID surfaceId);
     virtual ~JoinedSurface();
 
-    virtual bool load(const Preferences &prefs) override;
+    virtual bool load(ConfigReader &r) override;
     virtual Touch map(const Touch &) const override;
 
 private:
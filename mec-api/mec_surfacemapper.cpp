@@ -2,62 +2,87 @@
 
 #include "mec_log.h"
 
+#include <algorithm>
+
 namespace mec {
 
-SurfaceMapper::SurfaceMapper() : mode_(SM_NoMapping) {
+const unsigned SurfaceMapper::COURSE_KEYS;
+const int SurfaceMapper::COURSE_NOTE_OFFSET;
+
+SurfaceMapper::SurfaceMapper() : mode_(SM_NoMapping), keyInCol_(1), rowMult_(1), colMult_(1), noteOffset_(0) {
 }
 
 void SurfaceMapper::load(Preferences &prefs) {
+    MappingConfig config;
+    config.load(prefs, "mapping");
+    load(config);
+}
+
+void SurfaceMapper::load(const MappingConfig &config) {
     LOG_2("load surface mapping");
 
-    mode_ = SM_NoMapping;
-    if (prefs.exists("notes")) {
-        loadNoteArray(prefs);
-        return;
-    }
-    if (prefs.exists("calculated")) {
-        loadCalcDefinition(prefs);
-        return;
+    courseNotes_ = config.percussionNotes_;
+    switch (config.mode_) {
+        case MappingConfig::M_Notes: {
+            mode_ = SM_Notes;
+            notes_ = config.notes_;
+            LOG_2("loaded surface mapping (notes) # keys : " << notes_.size());
+            break;
+        }
+        case MappingConfig::M_Calculated: {
+            mode_ = SM_Calculated;
+            keyInCol_ = config.keysInCol_;
+            rowMult_ = config.rowMultiplier_;
+            colMult_ = config.colMultiplier_;
+            noteOffset_ = config.noteOffset_;
+            LOG_2("loaded surface mapping (calc) " << keyInCol_ << " , " << rowMult_ << " , " << colMult_ << " , "
+                                                   << noteOffset_);
+            break;
+        }
+        default:
+            mode_ = SM_NoMapping;
+            break;
     }
 }
 
-int SurfaceMapper::noteFromKey(int key) {
+int SurfaceMapper::noteFromKey(int key) const {
     switch (mode_) {
         case SM_NoMapping:
             return key;
         case SM_Notes:
-            return notes_[key % MAX_KEYS];
+            return key >= 0 && key < (int) notes_.size() ? notes_[key] : key;
         case SM_Calculated:
             return ((key / keyInCol_) * colMult_) + ((key % keyInCol_) * rowMult_) + noteOffset_;
     }
     return key;
 }
 
-void SurfaceMapper::loadNoteArray(Preferences &prefs) {
-    mode_ = SM_Notes;
-    Preferences::Array array(prefs.getArray("notes"));
-    int sz = array.getSize();
-    for (unsigned i = 0; i < sz; i++) {
-        notes_[i] = array.getInt(i);
-    }
-    for (int i = sz; i < MAX_KEYS; i++) {
-        notes_[i] = i;
-    }
-
-    LOG_2("loaded surface mapping (notes) # keys : " << sz);
+float SurfaceMapper::note(unsigned course, unsigned key) const {
+    if (course == 0) return (float) noteFromKey((int) key);
+    if (course == 1 && key < courseNotes_.size()) return (float) courseNotes_[key];
+    return (float) (noteFromKey((int) key) + (COURSE_NOTE_OFFSET * (int) course));
 }
 
-void SurfaceMapper::loadCalcDefinition(Preferences &p) {
-    Preferences prefs(p.getSubTree("calculated"));
-    mode_ = SM_Calculated;
-    keyInCol_ = prefs.getInt("keys in col", 127);
-    rowMult_ = prefs.getInt("row multiplier", 1);
-    colMult_ = prefs.getInt("col multipler", keyInCol_);
-    noteOffset_ = prefs.getInt("note offset", 0);
-
-    LOG_2("loaded surface mapping (calc) " << keyInCol_ << " , " << rowMult_ << " , " << colMult_ << " , "
-                                           << noteOffset_);
+void SurfaceMapper::compile(unsigned rows, unsigned cols, unsigned courses, SurfaceMap &map) const {
+    // unknown layout, as many keys as mapped, or could be on any device
+    unsigned mainKeys = rows * cols;
+    if (mainKeys == 0) mainKeys = std::max((unsigned) notes_.size(), 256u);
 
+    map.offsets_.clear();
+    map.keys_.clear();
+    map.offsets_.push_back(0);
+    for (unsigned c = 0; c < courses; c++) {
+        unsigned n = c == 0 ? mainKeys : COURSE_KEYS;
+        for (unsigned k = 0; k < n; k++) {
+            MappedKey key;
+            key.note_ = note(c, k);
+            key.row_ = c == 0 && rows > 0 ? (int) (k % rows) : (int) k;
+            key.col_ = c == 0 && rows > 0 ? (int) (k / rows) : 0;
+            map.keys_.push_back(key);
+        }
+        map.offsets_.push_back((unsigned) map.keys_.size());
+    }
+    LOG_2("compiled surface mapping, keys : " << map.keys_.size() << " courses : " << courses);
 }
 
-}
\ No newline at end of file
+}
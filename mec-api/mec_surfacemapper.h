@@ -2,14 +2,14 @@
 #define MEC_SURFACE_MAPPER_H
 
 #include "mec_prefs.h"
+#include "mec_config.h"
 
+#include <vector>
 
 
 // SURFACE MAPPING
 // this class will be superceded by mec::surface
 
-const int MAX_KEYS = 256;
-
 
 /*
 This class takes a devices 'key' and converts it into a midi note
@@ -17,18 +17,60 @@ This class takes a devices 'key' and converts it into a midi note
 a couple of configurations are supported so far in a preferences file
 
 an array of note values, one for each key -  "notes" : [1,2,3]
+notes for keys on the second course (e.g. percussion keys) - "percussion notes" : [1,2,3]
+
+the mapping is compiled into a SurfaceMap for a devices layout, so a key event is a single lookup
 */
 
 namespace mec {
 
+// a keys note and position, row and column on the main course, row = key on other courses
+struct MappedKey {
+    float note_;
+    int row_;
+    int col_;
+};
+
+
+// a mapping compiled for a device, dense by (course, key)
+class SurfaceMap {
+public:
+    // -1 if the key is not on the device
+    int index(unsigned course, unsigned key) const {
+        return course + 1 < offsets_.size() && key < offsets_[course + 1] - offsets_[course]
+               ? (int) (offsets_[course] + key) : -1;
+    }
+
+    const MappedKey &key(int index) const { return keys_[index]; }
+
+    unsigned size() const { return (unsigned) keys_.size(); }
+
+    unsigned courses() const { return offsets_.empty() ? 0 : (unsigned) offsets_.size() - 1; }
+
+private:
+    friend class SurfaceMapper;
+
+    std::vector<MappedKey> keys_;
+    std::vector<unsigned> offsets_; // start of each course, and end
+};
+
+
 class SurfaceMapper {
 public:
+    static const unsigned COURSE_KEYS = 16; // keys on courses after the main course
+    static const int COURSE_NOTE_OFFSET = 1024; // unmapped courses, main course note + offset per course
+
     SurfaceMapper();
-    int noteFromKey(int key);
+    // main course note
+    int noteFromKey(int key) const;
     void load(Preferences &prefs);
+    void load(const MappingConfig &config);
+
+    // main course is rows x cols (key = col * rows + row), rows = 0 if unknown, other courses have COURSE_KEYS
+    void compile(unsigned rows, unsigned cols, unsigned courses, SurfaceMap &map) const;
+
 private:
-    void loadNoteArray(Preferences &prefs);
-    void loadCalcDefinition(Preferences &prefs);
+    float note(unsigned course, unsigned key) const;
 
     enum mode {
         SM_NoMapping,
@@ -37,7 +79,10 @@ private:
     } mode_;
 
     //note mode
-    int notes_[MAX_KEYS];
+    std::vector<int> notes_;
+
+    // other courses (e.g. percussion), by key
+    std::vector<int> courseNotes_;
 
     //calc mode
     // r = k % keyInCol , c = k / keyInCol, note = (r * rowM) + (c * colM) + offset
@@ -48,4 +93,4 @@ private:
 };
 }
 
-#endif //MEC_SURFACE_MAPPER_H
\ No newline at end of file
+#endif //MEC_SURFACE_MAPPER_H
@@ -15,6 +15,7 @@ public:
     static constexpr float V_SCALE_AMT  = 4.0f;
     static constexpr float V_CURVE_AMT  = 4.0f;
     static constexpr float V_COUNT      = 4;
+    static const unsigned MAX_LOOKUP_ID = 1024;
 
     Voices( unsigned voiceCount = NUM_VOICES, 
             unsigned velCount = V_COUNT,
@@ -63,6 +64,7 @@ public:
     };
 
     Voice *voiceId(unsigned id) {
+        if (id < MAX_LOOKUP_ID) return id < ids_.size() ? ids_[id] : NULL;
         for (int i = 0; i < maxVoices_; i++) {
             if (voices_[i].id_ == id)
                 return &voices_[i];
@@ -81,6 +83,10 @@ public:
             return NULL;
         }
         voice->id_ = id;
+        if (id < MAX_LOOKUP_ID) {
+            if (id >= ids_.size()) ids_.resize(id + 1, NULL);
+            ids_[id] = voice;
+        }
         voice->state_ = Voice::PENDING;
         voice->v_ = 0;
 
@@ -141,6 +147,7 @@ public:
     void stopVoice(Voice *voice) {
         if (!voice) return;
         usedVoices_.remove(voice);
+        if (voice->id_ >= 0 && voice->id_ < (int) ids_.size()) ids_[voice->id_] = NULL;
         voice->id_ = -1;
         voice->note_ = 0;
         voice->x_ = 0;
@@ -160,6 +167,8 @@ private:
     std::vector<Voice> voices_;
     std::list<Voice *> freeVoices_;
     std::list<Voice *> usedVoices_;
+    // voice by id, for ids below MAX_LOOKUP_ID, (e.g. keys, touches) so lookup is constant per message
+    std::vector<Voice *> ids_;
     unsigned maxVoices_;
     unsigned velCount_;
     float velScale_;
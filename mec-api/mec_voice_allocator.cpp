@@ -0,0 +1,397 @@
+#include "mec_voice_allocator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mec {
+
+const unsigned StealIndex::MAX_VOICES;
+const int StealIndex::NO_VOICE;
+const int StealIndex::BUCKETS;
+const unsigned VoiceAllocator::DEFAULT_VOICES;
+const unsigned VoiceAllocator::MAX_VOICES;
+const unsigned VoiceAllocator::MAX_TOUCHES;
+const unsigned VoiceAllocator::MAX_BUDGET;
+
+bool stealPolicy(const std::string &name, StealPolicy &policy) {
+    if (name == "none") policy = S_NONE;
+    else if (name == "oldest") policy = S_OLDEST;
+    else if (name == "quietest") policy = S_QUIETEST;
+    else if (name == "highest") policy = S_HIGHEST;
+    else if (name == "lowest") policy = S_LOWEST;
+    else if (name == "nearest") policy = S_NEAREST;
+    else return false;
+    return true;
+}
+
+
+////////////////////////////////////////////////
+StealIndex::StealIndex(const AllocatedVoice *voices, StealPolicy policy)
+    : voices_(voices), policy_(policy) {
+    this->policy(policy, std::vector<int>());
+}
+
+void StealIndex::policy(StealPolicy policy, const std::vector<int> &active) {
+    policy_ = policy;
+    size_ = 0;
+    head_ = NO_VOICE;
+    tail_ = NO_VOICE;
+    for (int b = 0; b < BUCKETS; b++) buckets_[b] = NO_VOICE;
+
+    // oldest first, so the list is in start order
+    std::vector<int> ordered(active);
+    std::sort(ordered.begin(), ordered.end(), [this](int a, int b) {
+        return voices_[a].seq_ < voices_[b].seq_;
+    });
+    for (int v : ordered) add(v);
+}
+
+float StealIndex::key(int voice) const {
+    const AllocatedVoice &v = voices_[voice];
+    switch (policy_) {
+        case S_QUIETEST :
+            return v.z_;
+        case S_HIGHEST :
+            return -v.note_;
+        case S_LOWEST :
+            return v.note_;
+        default:
+            return 0.0f;
+    }
+}
+
+int StealIndex::bucket(float note) {
+    int b = (int) std::lround(note);
+    return b < 0 ? 0 : (b >= BUCKETS ? BUCKETS - 1 : b);
+}
+
+void StealIndex::add(int voice) {
+    switch (policy_) {
+        case S_NONE :
+            return;
+        case S_OLDEST : {
+            // append at tail, head is oldest
+            next_[voice] = NO_VOICE;
+            prev_[voice] = tail_;
+            if (tail_ != NO_VOICE) next_[tail_] = voice;
+            else head_ = voice;
+            tail_ = voice;
+            break;
+        }
+        case S_NEAREST : {
+            int b = bucket(voices_[voice].note_);
+            bucketOf_[voice] = b;
+            listAdd(buckets_[b], voice);
+            break;
+        }
+        default: {
+            heap_[size_] = voice;
+            heapPos_[voice] = size_;
+            size_++;
+            heapUp(size_ - 1);
+            return;
+        }
+    }
+    size_++;
+}
+
+void StealIndex::remove(int voice) {
+    switch (policy_) {
+        case S_NONE :
+            return;
+        case S_OLDEST : {
+            if (prev_[voice] != NO_VOICE) next_[prev_[voice]] = next_[voice];
+            else head_ = next_[voice];
+            if (next_[voice] != NO_VOICE) prev_[next_[voice]] = prev_[voice];
+            else tail_ = prev_[voice];
+            break;
+        }
+        case S_NEAREST : {
+            listRemove(buckets_[bucketOf_[voice]], voice);
+            break;
+        }
+        default: {
+            unsigned pos = heapPos_[voice];
+            size_--;
+            if (pos != size_) {
+                heapSwap(pos, size_);
+                heapDown(pos);
+                heapUp(pos);
+            }
+            return;
+        }
+    }
+    size_--;
+}
+
+void StealIndex::update(int voice) {
+    switch (policy_) {
+        case S_NEAREST : {
+            int b = bucket(voices_[voice].note_);
+            if (b != bucketOf_[voice]) {
+                listRemove(buckets_[bucketOf_[voice]], voice);
+                bucketOf_[voice] = b;
+                listAdd(buckets_[b], voice);
+            }
+            break;
+        }
+        case S_QUIETEST :
+        case S_HIGHEST :
+        case S_LOWEST : {
+            unsigned pos = heapPos_[voice];
+            heapDown(pos);
+            heapUp(heapPos_[voice]);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+int StealIndex::select(float note) const {
+    if (size_ == 0) return NO_VOICE;
+    switch (policy_) {
+        case S_NONE :
+            return NO_VOICE;
+        case S_OLDEST :
+            return head_;
+        case S_NEAREST : {
+            // search outward from the notes bucket, the nearest voice is in the first non empty ring, or the next
+            int b = bucket(note);
+            int best = NO_VOICE;
+            float bestDist = 0.0f;
+            int found = -1;
+            for (int d = 0; d < BUCKETS && (found < 0 || d <= found + 1); d++) {
+                int rings[2] = {b - d, b + d};
+                for (int r = 0; r < (d == 0 ? 1 : 2); r++) {
+                    if (rings[r] < 0 || rings[r] >= BUCKETS) continue;
+                    for (int v = buckets_[rings[r]]; v != NO_VOICE; v = next_[v]) {
+                        float dist = std::fabs(voices_[v].note_ - note);
+                        if (best == NO_VOICE || dist < bestDist) {
+                            best = v;
+                            bestDist = dist;
+                        }
+                        if (found < 0) found = d;
+                    }
+                }
+            }
+            return best;
+        }
+        default:
+            return heap_[0];
+    }
+}
+
+void StealIndex::listAdd(int &head, int voice) {
+    prev_[voice] = NO_VOICE;
+    next_[voice] = head;
+    if (head != NO_VOICE) prev_[head] = voice;
+    head = voice;
+}
+
+void StealIndex::listRemove(int &head, int voice) {
+    if (prev_[voice] != NO_VOICE) next_[prev_[voice]] = next_[voice];
+    else head = next_[voice];
+    if (next_[voice] != NO_VOICE) prev_[next_[voice]] = prev_[voice];
+}
+
+void StealIndex::heapUp(unsigned pos) {
+    while (pos > 0) {
+        unsigned parent = (pos - 1) / 2;
+        if (!(key(heap_[pos]) < key(heap_[parent]))) break;
+        heapSwap(pos, parent);
+        pos = parent;
+    }
+}
+
+void StealIndex::heapDown(unsigned pos) {
+    for (;;) {
+        unsigned l = pos * 2 + 1, r = l + 1, smallest = pos;
+        if (l < size_ && key(heap_[l]) < key(heap_[smallest])) smallest = l;
+        if (r < size_ && key(heap_[r]) < key(heap_[smallest])) smallest = r;
+        if (smallest == pos) break;
+        heapSwap(pos, smallest);
+        pos = smallest;
+    }
+}
+
+void StealIndex::heapSwap(unsigned a, unsigned b) {
+    int va = heap_[a], vb = heap_[b];
+    heap_[a] = vb;
+    heap_[b] = va;
+    heapPos_[vb] = a;
+    heapPos_[va] = b;
+}
+
+
+////////////////////////////////////////////////
+VoiceAllocator::VoiceAllocator(unsigned voices, StealPolicy policy)
+    : voices_(0), active_(0), seq_(0), global_(allocated_, policy), freeHead_(0), freeCount_(0) {
+    for (unsigned i = 0; i < MAX_VOICES; i++) {
+        allocated_[i].voice_ = i;
+        allocated_[i].device_ = -1;
+        allocated_[i].touch_ = -1;
+    }
+    this->voices(voices);
+}
+
+VoiceAllocator::~VoiceAllocator() {
+    ;
+}
+
+void VoiceAllocator::voices(unsigned n) {
+    if (n < 1) n = 1;
+    if (n > MAX_VOICES) n = MAX_VOICES;
+    voices_ = n;
+    freeHead_ = 0;
+    freeCount_ = 0;
+    for (unsigned i = 0; i < voices_; i++) {
+        if (allocated_[i].device_ < 0) pushFree(i);
+    }
+}
+
+void VoiceAllocator::policy(StealPolicy policy) {
+    if (policy == global_.policy()) return;
+    global_.policy(policy, activeVoices(-1));
+    for (unsigned d = 0; d < devices_.size(); d++) {
+        if (devices_[d].index_) devices_[d].index_->policy(policy, activeVoices(d));
+    }
+}
+
+unsigned VoiceAllocator::addDevice(unsigned limit, bool steal) {
+    devices_.push_back(Device());
+    Device &dev = devices_.back();
+    dev.touches_.assign(MAX_TOUCHES, -1);
+    dev.active_ = 0;
+    device((unsigned) devices_.size() - 1, limit, steal);
+    return (unsigned) devices_.size() - 1;
+}
+
+void VoiceAllocator::device(unsigned device, unsigned limit, bool steal) {
+    if (device >= devices_.size()) return;
+    Device &dev = devices_[device];
+    dev.limit_ = limit < 1 ? 1 : (limit > MAX_VOICES ? MAX_VOICES : limit);
+    dev.steal_ = steal;
+    if (steal && dev.limit_ < MAX_VOICES) {
+        if (!dev.index_) {
+            dev.index_.reset(new StealIndex(allocated_, global_.policy()));
+            dev.index_->policy(global_.policy(), activeVoices(device));
+        }
+    } else {
+        dev.index_.reset();
+    }
+}
+
+int VoiceAllocator::start(unsigned device, int touch, float note, float x, float y, float z, AllocatedVoice *stolen) {
+    if (stolen) stolen->device_ = -1;
+    if (device >= devices_.size() || touch < 0 || touch >= (int) MAX_TOUCHES) return -1;
+    Device &dev = devices_[device];
+    if (dev.touches_[touch] >= 0) return dev.touches_[touch];
+
+    int voice = -1;
+    if (dev.active_ >= dev.limit_) {
+        if (!dev.steal_ || !dev.index_) return -1;
+        voice = steal(*dev.index_, note, stolen);
+        if (voice < 0) return -1;
+    } else if (freeCount_ > 0) {
+        voice = popFree();
+    } else {
+        if (!dev.steal_) return -1;
+        voice = steal(global_, note, stolen);
+        if (voice < 0) return -1;
+    }
+
+    // a stolen voice above a reduced budget is ended, but not reused
+    if (voice >= (int) voices_) {
+        if (freeCount_ == 0) return -1;
+        voice = popFree();
+    }
+
+    AllocatedVoice &v = allocated_[voice];
+    v.device_ = device;
+    v.touch_ = touch;
+    v.note_ = note;
+    v.x_ = x;
+    v.y_ = y;
+    v.z_ = z;
+    v.seq_ = seq_++;
+    dev.touches_[touch] = voice;
+    dev.active_++;
+    active_++;
+    global_.add(voice);
+    if (dev.index_) dev.index_->add(voice);
+    return voice;
+}
+
+int VoiceAllocator::steal(StealIndex &index, float note, AllocatedVoice *stolen) {
+    int voice = index.select(note);
+    if (voice < 0) return -1;
+    if (stolen) *stolen = allocated_[voice];
+    release(voice);
+    return voice;
+}
+
+int VoiceAllocator::find(unsigned device, int touch) const {
+    if (device >= devices_.size() || touch < 0 || touch >= (int) MAX_TOUCHES) return -1;
+    return devices_[device].touches_[touch];
+}
+
+void VoiceAllocator::update(int voice, float note, float x, float y, float z) {
+    if (voice < 0 || voice >= (int) MAX_VOICES || allocated_[voice].device_ < 0) return;
+    AllocatedVoice &v = allocated_[voice];
+    bool moved = v.note_ != note || v.z_ != z;
+    v.note_ = note;
+    v.x_ = x;
+    v.y_ = y;
+    v.z_ = z;
+    if (moved) {
+        global_.update(voice);
+        Device &dev = devices_[v.device_];
+        if (dev.index_) dev.index_->update(voice);
+    }
+}
+
+int VoiceAllocator::stop(unsigned device, int touch) {
+    if (device >= devices_.size() || touch < 0 || touch >= (int) MAX_TOUCHES) return -1;
+    int voice = devices_[device].touches_[touch];
+    if (voice < 0) return -1;
+    release(voice);
+    if (voice < (int) voices_) pushFree(voice);
+    return voice;
+}
+
+// removes the voice from its owner and indexes, not the free list
+void VoiceAllocator::release(int voice) {
+    AllocatedVoice &v = allocated_[voice];
+    Device &dev = devices_[v.device_];
+    global_.remove(voice);
+    if (dev.index_) dev.index_->remove(voice);
+    dev.touches_[v.touch_] = -1;
+    dev.active_--;
+    active_--;
+    v.device_ = -1;
+    v.touch_ = -1;
+}
+
+// active voices, of a device, or all if device < 0
+std::vector<int> VoiceAllocator::activeVoices(int device) const {
+    std::vector<int> active;
+    for (unsigned i = 0; i < MAX_VOICES; i++) {
+        if (allocated_[i].device_ >= 0 && (device < 0 || allocated_[i].device_ == device)) active.push_back(i);
+    }
+    return active;
+}
+
+void VoiceAllocator::pushFree(int voice) {
+    free_[(freeHead_ + freeCount_) % MAX_VOICES] = voice;
+    freeCount_++;
+}
+
+int VoiceAllocator::popFree() {
+    int voice = free_[freeHead_];
+    freeHead_ = (freeHead_ + 1) % MAX_VOICES;
+    freeCount_--;
+    return voice;
+}
+
+}
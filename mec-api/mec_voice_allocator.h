@@ -0,0 +1,170 @@
+#ifndef MEC_VOICE_ALLOCATOR_H_
+#define MEC_VOICE_ALLOCATOR_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mec {
+
+// which active voice to take, when a new touch needs one and none are free
+enum StealPolicy {
+    S_NONE,     // new touch is ignored
+    S_OLDEST,
+    S_QUIETEST, // lowest z
+    S_HIGHEST,  // pitch
+    S_LOWEST,
+    S_NEAREST   // pitch nearest the new touch
+};
+
+// name as in config : none, oldest, quietest, highest, lowest, nearest
+bool stealPolicy(const std::string &name, StealPolicy &policy);
+
+
+// a global voice, owned by a touch of a device
+struct AllocatedVoice {
+    int voice_;     // its number
+    int device_;    // -1 = free
+    int touch_;
+    float note_;
+    float x_;
+    float y_;
+    float z_;
+    unsigned long seq_; // start order
+};
+
+
+// active voices ordered for a steal policy
+// intrusive (indexed by voice number, keys read from the allocators voices), fixed size, so never allocates
+// oldest: list O(1), quietest/highest/lowest: indexed heap O(log n), nearest: semitone buckets O(1) typically
+class StealIndex {
+public:
+    static const unsigned MAX_VOICES = 128;
+    static const int NO_VOICE = -1;
+
+    StealIndex(const AllocatedVoice *voices, StealPolicy policy);
+
+    StealPolicy policy() const { return policy_; }
+
+    // rebuilds from the active voices
+    void policy(StealPolicy policy, const std::vector<int> &active);
+
+    void add(int voice);
+    void remove(int voice);
+    // after the voices note or z changed
+    void update(int voice);
+
+    // voice to steal for a new touch at note, NO_VOICE if none (or policy is none)
+    int select(float note) const;
+
+    unsigned size() const { return size_; }
+
+private:
+    static const int BUCKETS = 128;
+
+    float key(int voice) const;
+    static int bucket(float note);
+
+    void listAdd(int &head, int voice);
+    void listRemove(int &head, int voice);
+
+    void heapUp(unsigned pos);
+    void heapDown(unsigned pos);
+    void heapSwap(unsigned a, unsigned b);
+
+    const AllocatedVoice *voices_;
+    StealPolicy policy_;
+    unsigned size_;
+
+    // list (oldest, and per bucket for nearest)
+    int next_[MAX_VOICES];
+    int prev_[MAX_VOICES];
+    int head_;
+    int tail_;
+    int buckets_[BUCKETS];
+    int bucketOf_[MAX_VOICES];
+
+    // heap (quietest, highest, lowest)
+    int heap_[MAX_VOICES];
+    unsigned heapPos_[MAX_VOICES];
+};
+
+
+// maps touches from all devices, (device, local touch id), onto one set of global voices
+// so touch ids from different devices never collide downstream, and are always < voices()
+// (e.g. an mpe member channel each)
+// stealing is done here, for all devices, using the configured policy:
+// - a device may be limited to a number of voices, stealing from its own voices when it has used them
+// - when all voices are used, a device that steals takes one from any device
+// operations are O(1), or O(log n) for heap policies, except voices(n) and policy(p)
+// not thread safe, used on the processing thread only
+class VoiceAllocator {
+public:
+    static const unsigned DEFAULT_VOICES = 15; // mpe member channels
+    static const unsigned MAX_VOICES = StealIndex::MAX_VOICES;
+    // the configured budget, mpe output has 15 member channels, so a voice beyond them would be dropped
+    static const unsigned MAX_BUDGET = 15;
+    static const unsigned MAX_TOUCHES = 128;   // local touch ids per device
+
+    explicit VoiceAllocator(unsigned voices = DEFAULT_VOICES, StealPolicy policy = S_OLDEST);
+    ~VoiceAllocator();
+
+    // voice budget, 1..MAX_VOICES
+    // if reduced, active voices above it finish normally, but are not reused
+    unsigned voices() const { return voices_; }
+    void voices(unsigned n);
+
+    StealPolicy policy() const { return global_.policy(); }
+    void policy(StealPolicy policy);
+
+    // limit, maximum voices the device may use at once, steal, whether its new touches may steal
+    unsigned addDevice(unsigned limit = MAX_VOICES, bool steal = false);
+    // changes limit and steal, a device over its new limit keeps its voices until they stop
+    void device(unsigned device, unsigned limit, bool steal);
+
+    // global voice for a new touch, the existing voice if already started, -1 if none available
+    // if a voice was stolen, stolen is set to its previous owner and values (so it can be ended), else device_ = -1
+    // (a voice may be stolen, even if -1 is returned, when the budget has been reduced)
+    int start(unsigned device, int touch, float note, float x, float y, float z, AllocatedVoice *stolen = nullptr);
+    // -1 if not started (or stolen)
+    int find(unsigned device, int touch) const;
+    void update(int voice, float note, float x, float y, float z);
+    // frees the voice, returning it, -1 if not started (or stolen)
+    int stop(unsigned device, int touch);
+
+    const AllocatedVoice &voice(int voice) const { return allocated_[voice]; }
+
+    unsigned active() const { return active_; }
+
+private:
+    struct Device {
+        std::vector<int> touches_; // [touch] = voice, -1 none
+        unsigned limit_;
+        bool steal_;
+        unsigned active_;
+        std::unique_ptr<StealIndex> index_; // steal within device, only if limited and stealing
+    };
+
+    int steal(StealIndex &index, float note, AllocatedVoice *stolen);
+    void release(int voice);
+    std::vector<int> activeVoices(int device) const;
+
+    void pushFree(int voice);
+    int popFree();
+
+    unsigned voices_;
+    unsigned active_;
+    unsigned long seq_;
+    AllocatedVoice allocated_[MAX_VOICES];
+    std::vector<Device> devices_;
+    StealIndex global_;
+
+    // free voices, fifo, so the least recently released voice (channel) is reused first
+    int free_[MAX_VOICES];
+    unsigned freeHead_;
+    unsigned freeCount_;
+};
+
+}
+
+#endif //MEC_VOICE_ALLOCATOR_H_
@@ -2,9 +2,21 @@
 #include "mec_midi_processor.h"
 
 //#include "mec_log.h"
+#include "mec_metrics.h"
 
 namespace mec {
 
+// all processors (outputs) together
+static Counter &midiMessages() {
+    static Counter &messages = Metrics::counter("midi.out.messages");
+    return messages;
+}
+
+static Counter &midiNotes() {
+    static Counter &notes = Metrics::counter("midi.out.notes");
+    return notes;
+}
+
 Midi_Processor::Midi_Processor(unsigned baseCh, float pbr) : baseChannel_(baseCh), pitchbendRange_ (pbr) {
     ;
 }
@@ -54,7 +66,9 @@ void Midi_Processor::mec_control(int , void* ) {
 bool Midi_Processor::noteOn(unsigned ch, unsigned note, unsigned vel) {
     // LOG_1( "midi note on ch " << ch << " note " << note  << " vel " << vel );
     MidiMsg msg(static_cast<char>(0x90 + ch), static_cast<char>(note), static_cast<char>(vel));
+    midiNotes().inc();
     process(msg);
+    midiMessages().inc();
     return true;
 }
 
@@ -63,6 +77,7 @@ bool Midi_Processor::noteOff(unsigned ch, unsigned note, unsigned vel) {
     // LOG_1( "midi  note off ch " << ch << " note " << note  << " vel " << vel )
     MidiMsg msg(static_cast<char>(0x80 + ch), static_cast<char>(note), static_cast<char>(vel));
     process(msg);
+    midiMessages().inc();
     return true;
 }
 
@@ -70,6 +85,7 @@ bool Midi_Processor::cc(unsigned ch, unsigned cc, unsigned v) {
     // LOG_1( "midi note off ch " << ch << " note " << note  << " vel " << vel )
     MidiMsg msg(static_cast<char>(0xB0 + ch), static_cast<char>(cc), static_cast<char>(v));
     process(msg);
+    midiMessages().inc();
     return true;
 }
 
@@ -77,6 +93,7 @@ bool Midi_Processor::pressure(unsigned ch, unsigned v) {
     // LOG_1( "midi pressure ch " << ch << " v  " << v)
     MidiMsg msg(static_cast<char>(0xD0 + ch),static_cast<char>(v));
     process(msg);
+    midiMessages().inc();
     return true;
 }
 
@@ -84,6 +101,7 @@ bool Midi_Processor::pitchbend(unsigned ch, unsigned v) {
     // LOG_1( "midi pitchbend ch " << ch << " v  " << v)
     MidiMsg msg(static_cast<char>(0xE0 + ch), static_cast<char>(v & 0x7f), static_cast<char>((v & 0x3F80) >> 7));
     process(msg);
+    midiMessages().inc();
     return true;
 }
 
@@ -24,10 +24,17 @@ MPE_Processor::~MPE_Processor() {
     ;
 }
 
+bool MPE_Processor::validVoice(int id) {
+    // ids are global voices (see MecApi::voices), one member channel each,
+    // the budget is limited to the member channels, so this is only a guard (and called per event, so not logged)
+    return id >= 0 && id + baseChannel_ < MAX_VOICE;
+}
+
 /////////////////////////
 // ICallback interface
 void MPE_Processor::touchOn(int id, float note, float x, float y, float z) {
 
+    if (!validVoice(id)) return;
     VoiceData& voice = voices_[id];
 
     unsigned ch = id + baseChannel_; // MPE starts on 2
@@ -69,6 +76,7 @@ void MPE_Processor::touchOn(int id, float note, float x, float y, float z) {
 
 void MPE_Processor::touchContinue(int id, float note, float x, float y, float z) {
 
+    if (!validVoice(id)) return;
     VoiceData& voice = voices_[id];
     unsigned ch = id + baseChannel_; // MPE starts on 2
     // unsigned mx = bipolar14bit(x);
@@ -103,6 +111,7 @@ void MPE_Processor::touchContinue(int id, float note, float x, float y, float z)
 
 void MPE_Processor::touchOff(int id, float note, float x, float y, float z) {
 
+    if (!validVoice(id)) return;
     VoiceData& voice = voices_[id];
 
     unsigned ch = id + baseChannel_; // MPE starts on 2
@@ -26,6 +26,8 @@ public:
 private:
     static constexpr unsigned MAX_VOICE=16;
 
+    bool validVoice(int id);
+
     struct VoiceData {
         unsigned    startNote_;
         unsigned    note_;      //0
@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <vector>
+
+#include <mec_api.h>
+#include <mec_surfacemapper.h>
+#include <devices/mec_eigenharp_keys.h>
+
+// eigenharp key event benchmark : replays key events through EigenharpKeys, without a device
+// events are a recording, (one event per line : t course key a p r y), or generated,
+// as an alpha would send them, every held key sampled each ms
+// compared with the previous handler : linear voice search, stolen key set, and mapping per event
+
+static const unsigned NUM_TICKS = 200000;  // ms
+static const unsigned MAX_HELD = 10;
+static const unsigned ALPHA_KEYS = 120;
+static const unsigned PERCUSSION_KEYS = 12;
+static const unsigned NUM_RUNS = 5;
+
+struct Event {
+    unsigned long long t_;
+    unsigned course_;
+    unsigned key_;
+    bool a_;
+    unsigned p_;
+    int r_;
+    int y_;
+};
+
+struct Rand {
+    unsigned long s_;
+
+    explicit Rand(unsigned long s) : s_(s) { ; }
+
+    unsigned next(unsigned n) {
+        s_ = s_ * 6364136223846793005UL + 1442695040888963407UL;
+        return (unsigned) ((s_ >> 33) % n);
+    }
+};
+
+class CountingCallback : public mec::ICallback {
+public:
+    CountingCallback() : ons_(0), continues_(0), offs_(0), sum_(0.0f) { ; }
+
+    void touchOn(int touchId, float note, float x, float y, float z) override {
+        ons_++;
+        sum_ += note;
+    }
+
+    void touchContinue(int touchId, float note, float x, float y, float z) override {
+        continues_++;
+        sum_ += note;
+    }
+
+    void touchOff(int touchId, float note, float x, float y, float z) override { offs_++; }
+
+    void control(int ctrlId, float v) override { ; }
+
+    void mec_control(int cmd, void *other) override { ; }
+
+    unsigned long ons_, continues_, offs_;
+    float sum_;
+};
+
+// the previous key handling, as it was in EigenharpHandler, for comparison
+class PreviousKeys {
+public:
+    static const unsigned NUM_VOICES = 16;
+    static const unsigned PENDING_EVENTS = 5; // velocity count + 1, as Voices
+
+    PreviousKeys(mec::ICallback &cb, const mec::SurfaceMapper &mapper) : callback_(cb), mapper_(mapper) {
+        for (unsigned i = 0; i < NUM_VOICES; i++) {
+            voices_[i].id_ = -1;
+            voices_[i].pressures_ = 0;
+        }
+    }
+
+    void key(unsigned long long t, unsigned course, unsigned key, bool a, unsigned p, int r, int y) {
+        Voice *voice = nullptr;
+        for (unsigned i = 0; i < NUM_VOICES; i++) {
+            if (voices_[i].id_ == (int) key) voice = &voices_[i];
+        }
+        float mx = std::max(std::min(float(r) / 4096.0f, 1.0f), -1.0f);
+        float my = std::max(std::min(float(y) / 4096.0f, 1.0f), -1.0f);
+        float mz = std::min(float(p) / 4096.0f, 1.0f);
+        float mn = mapper_.noteFromKey(key) + ((mx > 0.0 ? mx * mx : -mx * mx) * 2.0f) + (1024 * course);
+        if (a) {
+            if (inactiveKeys_.find(key) != inactiveKeys_.end()) return;
+            if (!voice) {
+                for (unsigned i = 0; i < NUM_VOICES && !voice; i++) {
+                    if (voices_[i].id_ < 0) voice = &voices_[i];
+                }
+                if (!voice) {
+                    inactiveKeys_.insert(key);
+                    return;
+                }
+                voice->id_ = key;
+                voice->pressures_ = 0;
+            }
+            if (voice->pressures_ < PENDING_EVENTS) {
+                if (++voice->pressures_ == PENDING_EVENTS) callback_.touchOn(voice - voices_, mn, mx, my, mz);
+            } else {
+                callback_.touchContinue(voice - voices_, mn, mx, my, mz);
+            }
+        } else {
+            if (inactiveKeys_.find(key) == inactiveKeys_.end()) {
+                if (voice) {
+                    if (voice->pressures_ >= PENDING_EVENTS) callback_.touchOff(voice - voices_, mn, mx, my, mz);
+                    voice->id_ = -1;
+                }
+            } else {
+                inactiveKeys_.erase(key);
+            }
+        }
+    }
+
+private:
+    struct Voice {
+        int id_;
+        unsigned pressures_;
+    };
+
+    mec::ICallback &callback_;
+    mec::SurfaceMapper mapper_;
+    Voice voices_[NUM_VOICES];
+    std::set<unsigned> inactiveKeys_;
+};
+
+static void generate(std::vector<Event> &events) {
+    Rand rand(1234);
+    struct Held {
+        unsigned course_, key_, remaining_, age_;
+    };
+    std::vector<Held> held;
+    for (unsigned long long t = 0; t < NUM_TICKS; t++) {
+        if (held.size() < MAX_HELD && rand.next(40) == 0) {
+            Held h;
+            h.course_ = rand.next(12) == 0 ? 1 : 0;
+            h.key_ = rand.next(h.course_ == 0 ? ALPHA_KEYS : PERCUSSION_KEYS);
+            h.remaining_ = 200 + rand.next(600);
+            h.age_ = 0;
+            bool dup = false;
+            // the previous handler did not distinguish courses
+            for (const auto &o : held) dup |= o.key_ == h.key_;
+            if (!dup) held.push_back(h);
+        }
+        for (unsigned i = 0; i < held.size();) {
+            Held &h = held[i];
+            Event e;
+            e.t_ = t * 1000;
+            e.course_ = h.course_;
+            e.key_ = h.key_;
+            e.r_ = (int) rand.next(1024) - 512;
+            e.y_ = (int) rand.next(1024) - 512;
+            if (h.remaining_ == 0) {
+                e.a_ = false;
+                e.p_ = 0;
+                events.push_back(e);
+                held.erase(held.begin() + i);
+                continue;
+            }
+            e.a_ = true;
+            e.p_ = std::min(4095u, h.age_ * 400 + rand.next(200));
+            events.push_back(e);
+            h.remaining_--;
+            h.age_++;
+            i++;
+        }
+    }
+}
+
+static bool load(const std::string &file, std::vector<Event> &events) {
+    std::ifstream in(file.c_str());
+    if (!in.good()) return false;
+    Event e;
+    while (in >> e.t_ >> e.course_ >> e.key_ >> e.a_ >> e.p_ >> e.r_ >> e.y_) {
+        events.push_back(e);
+    }
+    return true;
+}
+
+template<class Keys>
+static double replay(Keys &keys, const std::vector<Event> &events) {
+    auto start = std::chrono::steady_clock::now();
+    for (const auto &e : events) {
+        keys.key(e.t_, e.course_, e.key_, e.a_, e.p_, e.r_, e.y_);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / events.size();
+}
+
+int main(int argc, char **argv) {
+    std::vector<Event> events;
+    if (argc > 1) {
+        if (!load(argv[1], events)) {
+            std::cerr << "unable to read " << argv[1] << std::endl;
+            return 1;
+        }
+    } else {
+        generate(events);
+    }
+
+    // calculated mapping, as the alpha is usually configured (5 columns of 24 keys, in fourths)
+    mec::MappingConfig config;
+    config.mode_ = mec::MappingConfig::M_Calculated;
+    config.keysInCol_ = 24;
+    config.rowMultiplier_ = 1;
+    config.colMultiplier_ = 5;
+    config.noteOffset_ = 36;
+    mec::SurfaceMapper mapper;
+    mapper.load(config);
+
+    double previous = 0.0, current = 0.0;
+    CountingCallback previousCb, currentCb;
+    for (unsigned i = 0; i < NUM_RUNS; i++) {
+        CountingCallback pcb, ccb;
+        PreviousKeys p(pcb, mapper);
+        previous += replay(p, events);
+        mec::EigenharpKeys c(ccb, 4, 4.0f, 4.0f);
+        c.layout(24, 5);
+        c.mapping(mapper);
+        current += replay(c, events);
+        previousCb = pcb;
+        currentCb = ccb;
+    }
+
+    // same touches, (velocity differs, as the previous handler above does not calculate it)
+    assert(previousCb.ons_ == currentCb.ons_);
+    assert(previousCb.offs_ == currentCb.offs_);
+    assert(previousCb.continues_ == currentCb.continues_);
+
+    std::cout << "eigenharp key events : " << events.size() << ", touches " << currentCb.ons_
+              << ", average of " << NUM_RUNS << " runs" << std::endl;
+    std::cout << "previous : " << previous / NUM_RUNS << " ns/event" << std::endl;
+    std::cout << "current  : " << current / NUM_RUNS << " ns/event" << std::endl;
+    return 0;
+}
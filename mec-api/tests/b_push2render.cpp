@@ -0,0 +1,116 @@
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <push2lib.h>
+
+// push2 display benchmark, without the hardware : frames go to the null output, or a file if given
+// times the frame encoding, against the previous byte at a time encoding,
+// and rendering at display rate, where only some frames change (as parameters are turned)
+// then whole page redraws, as the param mode does on every change, where only one cell differs
+
+static const unsigned NUM_FRAMES = 2000;
+static const unsigned CHANGE_EVERY = 4; // frames, the display changes
+static const unsigned NUM_RUNS = 5;
+static const unsigned PAGE_ROWS = 5;
+static const unsigned PAGE_COLS = 8;
+
+// the previous encoding, as it was in Push2::render, for comparison
+static void previousEncode(const uint8_t *src, uint8_t *dst) {
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < LINE; x += 4) {
+            int offset = (y * LINE) + x;
+            dst[offset] = src[offset] ^ 0xE7;
+            dst[offset + 1] = src[offset + 1] ^ 0xF3;
+            dst[offset + 2] = src[offset + 2] ^ 0xE7;
+            dst[offset + 3] = src[offset + 3] ^ 0xFF;
+        }
+    }
+}
+
+template<class F>
+static double elapsed(F f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+int main(int argc, char **argv) {
+    std::vector<uint8_t> src(DATA_PKT_SZ), previous(DATA_PKT_SZ), current(DATA_PKT_SZ);
+    for (unsigned i = 0; i < DATA_PKT_SZ; i++) src[i] = (uint8_t) (i * 31 + (i >> 8));
+
+    previousEncode(src.data(), previous.data());
+    Push2API::Push2::encode(src.data(), current.data(), DATA_PKT_SZ);
+    assert(memcmp(previous.data(), current.data(), DATA_PKT_SZ) == 0);
+
+    double previousUs = 0.0, currentUs = 0.0;
+    for (unsigned r = 0; r < NUM_RUNS; r++) {
+        previousUs += elapsed([&] {
+            for (unsigned i = 0; i < NUM_FRAMES; i++) previousEncode(src.data(), previous.data());
+        });
+        currentUs += elapsed([&] {
+            for (unsigned i = 0; i < NUM_FRAMES; i++) Push2API::Push2::encode(src.data(), current.data(), DATA_PKT_SZ);
+        });
+    }
+    std::cout << "frame encoding, " << DATA_PKT_SZ << " bytes, average of " << NUM_RUNS << " runs" << std::endl;
+    std::cout << "previous : " << previousUs / (NUM_RUNS * NUM_FRAMES) << " us/frame" << std::endl;
+    std::cout << "current  : " << currentUs / (NUM_RUNS * NUM_FRAMES) << " us/frame" << std::endl;
+
+    Push2API::Push2 push2;
+    if (argc > 1) {
+        if (push2.init(Push2API::Push2::O_FILE, argv[1]) < 0) {
+            std::cerr << "unable to write " << argv[1] << std::endl;
+            return 1;
+        }
+    } else {
+        push2.init(Push2API::Push2::O_NULL);
+    }
+
+    unsigned sent = 0, skipped = 0;
+    Push2API::Push2::Colour clr(0xFF, 0xFF, 0xFF);
+    double drawUs = 0.0, renderUs = 0.0;
+    for (unsigned i = 0; i < NUM_FRAMES; i++) {
+        if (i % CHANGE_EVERY == 0) {
+            drawUs += elapsed([&] {
+                std::string value = std::to_string(i);
+                push2.drawCell8(2, i % 8, value.c_str(), clr);
+            });
+        }
+        int r = 0;
+        renderUs += elapsed([&] { r = push2.render(); });
+        assert(r >= 0);
+        if (r > 0) sent++;
+        else skipped++;
+    }
+
+    // each change, (and a keep alive, if a slow file output took longer than KEEPALIVE_MS)
+    assert(sent >= NUM_FRAMES / CHANGE_EVERY);
+    std::cout << "rendering, " << NUM_FRAMES << " frames, changed every " << CHANGE_EVERY << std::endl;
+    std::cout << "sent " << sent << ", skipped " << skipped << std::endl;
+    std::cout << "draw   : " << drawUs / sent << " us/cell" << std::endl;
+    std::cout << "render : " << renderUs / NUM_FRAMES << " us/frame" << std::endl;
+
+    double pageUs = 0.0;
+    sent = 0;
+    for (unsigned i = 0; i < NUM_FRAMES; i++) {
+        pageUs += elapsed([&] {
+            push2.clearDisplay();
+            for (unsigned r = 0; r < PAGE_ROWS; r++) {
+                for (unsigned c = 0; c < PAGE_COLS; c++) {
+                    std::string text = r == 2 && c == 0 ? std::to_string(i) : "  Param " + std::to_string(c);
+                    push2.drawCell8(r, c, text.c_str(), clr);
+                }
+            }
+        });
+        if (push2.render() > 0) sent++;
+    }
+    push2.deinit();
+    assert(sent >= NUM_FRAMES);
+    std::cout << "page redraws, " << PAGE_ROWS * PAGE_COLS << " cells, one changed" << std::endl;
+    std::cout << "draw   : " << pageUs / NUM_FRAMES << " us/page" << std::endl;
+    return 0;
+}
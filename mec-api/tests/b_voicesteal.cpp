@@ -0,0 +1,165 @@
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <mec_voice_allocator.h>
+
+// voice stealing benchmark : heavy chord churn, all voices used, so most chords steal
+// each cycle, a chord starts, all active touches continue (z and pitch moving), some touches stop
+// compares the allocators steal indexes, with a linear scan of the active voices for each steal (as devices did)
+
+static const unsigned NUM_CYCLES = 20000;
+static const unsigned CHORD_SIZE = 6;
+static const unsigned NUM_DEVICES = 4;
+static const unsigned NUM_TOUCHES = NUM_DEVICES * mec::VoiceAllocator::MAX_TOUCHES;
+static const unsigned RELEASE_CHANCE = 32; // 1 in, per cycle, so more touches are held than there are voices
+
+struct Rand {
+    unsigned long s_;
+
+    explicit Rand(unsigned long s) : s_(s) { ; }
+
+    unsigned next(unsigned n) {
+        s_ = s_ * 6364136223846793005UL + 1442695040888963407UL;
+        return (unsigned) ((s_ >> 33) % n);
+    }
+
+    float unit() { return (float) next(10000) / 10000.0f; }
+};
+
+// victim by linear scan, as the value the policy orders by, lower is stolen first
+static float scanKey(const mec::AllocatedVoice &v, mec::StealPolicy policy, float note) {
+    switch (policy) {
+        case mec::S_OLDEST :
+            return (float) v.seq_;
+        case mec::S_QUIETEST :
+            return v.z_;
+        case mec::S_HIGHEST :
+            return -v.note_;
+        case mec::S_LOWEST :
+            return v.note_;
+        case mec::S_NEAREST :
+            return std::fabs(v.note_ - note);
+        default:
+            return 0.0f;
+    }
+}
+
+static int scan(const mec::VoiceAllocator &alloc, mec::StealPolicy policy, float note) {
+    int best = -1;
+    float bestKey = 0.0f;
+    for (unsigned i = 0; i < alloc.voices(); i++) {
+        const mec::AllocatedVoice &v = alloc.voice(i);
+        if (v.device_ < 0) continue;
+        float key = scanKey(v, policy, note);
+        if (best < 0 || key < bestKey) {
+            best = i;
+            bestKey = key;
+        }
+    }
+    return best;
+}
+
+// touches are spread over devices, each has MAX_TOUCHES
+static unsigned device(unsigned t) { return t / mec::VoiceAllocator::MAX_TOUCHES; }
+
+static int touch(unsigned t) { return (int) (t % mec::VoiceAllocator::MAX_TOUCHES); }
+
+struct Result {
+    double eventNs_;  // per touch event (start, continue, stop)
+    double stealNs_;  // per start which stole
+    double scanNs_;   // per linear scan, only if verifying
+    unsigned steals_;
+};
+
+// optionally checks each steal against a linear scan, timing the scans
+static Result run(unsigned voices, mec::StealPolicy policy, bool verify) {
+    mec::VoiceAllocator alloc(voices, policy);
+    for (unsigned d = 0; d < NUM_DEVICES; d++) alloc.addDevice(mec::VoiceAllocator::MAX_VOICES, true);
+    Rand rand(1234);
+    std::vector<float> notes(NUM_TOUCHES, 0.0f);
+    std::vector<bool> down(NUM_TOUCHES, false);
+    unsigned long events = 0;
+    double stealTotal = 0.0, scanTotal = 0.0;
+    Result result = {0.0, 0.0, 0.0, 0};
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned c = 0; c < NUM_CYCLES; c++) {
+        float root = 36.0f + (float) rand.next(48);
+        for (unsigned n = 0; n < CHORD_SIZE; n++) {
+            unsigned t = rand.next(NUM_TOUCHES);
+            if (down[t]) continue;
+            float note = root + (float) (n * 4 + rand.next(3));
+            float z = rand.unit();
+            bool full = alloc.active() == voices;
+            int expected = -1;
+            if (verify && full) {
+                auto s = std::chrono::steady_clock::now();
+                expected = scan(alloc, policy, note);
+                scanTotal += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - s).count();
+            }
+            mec::AllocatedVoice stolen;
+            auto s = std::chrono::steady_clock::now();
+            int voice = alloc.start(device(t), touch(t), note, 0.0f, 0.0f, z, &stolen);
+            if (full) stealTotal += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - s).count();
+            assert(voice >= 0);
+            if (stolen.device_ >= 0) {
+                // ties may pick a different voice, but it must be as good a victim
+                assert(!verify || scanKey(stolen, policy, note) == scanKey(alloc.voice(expected), policy, note)
+                       || voice == expected);
+                down[stolen.device_ * mec::VoiceAllocator::MAX_TOUCHES + stolen.touch_] = false;
+                result.steals_++;
+            }
+            notes[t] = note;
+            down[t] = true;
+            events++;
+        }
+        for (unsigned t = 0; t < NUM_TOUCHES; t++) {
+            if (!down[t]) continue;
+            int voice = alloc.find(device(t), touch(t));
+            notes[t] += (rand.unit() - 0.5f) * 0.1f;
+            alloc.update(voice, notes[t], 0.0f, 0.0f, rand.unit());
+            events++;
+            if (rand.next(RELEASE_CHANCE) == 0) {
+                alloc.stop(device(t), touch(t));
+                down[t] = false;
+                events++;
+            }
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    result.eventNs_ = std::chrono::duration<double, std::nano>(end - start).count() / events;
+    if (result.steals_ > 0) {
+        result.stealNs_ = stealTotal / result.steals_;
+        result.scanNs_ = scanTotal / result.steals_;
+    }
+    return result;
+}
+
+int main(int argc, char **argv) {
+    struct {
+        mec::StealPolicy policy_;
+        const char *name_;
+    } policies[] = {{mec::S_OLDEST,   "oldest"},
+                    {mec::S_QUIETEST, "quietest"},
+                    {mec::S_HIGHEST,  "highest"},
+                    {mec::S_LOWEST,   "lowest"},
+                    {mec::S_NEAREST,  "nearest"}};
+    unsigned sizes[] = {16, 64, 128};
+
+    std::cout << "voice stealing, " << NUM_CYCLES << " cycles of " << CHORD_SIZE << " note chords" << std::endl;
+    for (unsigned voices : sizes) {
+        for (const auto &p : policies) {
+            Result verified = run(voices, p.policy_, true);
+            Result timed = run(voices, p.policy_, false);
+            std::cout << voices << " voices, " << p.name_ << " : "
+                      << timed.eventNs_ << " ns/event, "
+                      << timed.steals_ << " steals, "
+                      << timed.stealNs_ << " ns/steal, linear scan "
+                      << verified.scanNs_ << " ns/steal" << std::endl;
+        }
+    }
+    return 0;
+}
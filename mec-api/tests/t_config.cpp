@@ -0,0 +1,66 @@
+#include <cassert>
+#include <iostream>
+
+#include <mec_config.h>
+#include <mec_configreader.h>
+#include <mec_prefs.h>
+#include <mec_log.h>
+#include <mec_voice_allocator.h>
+
+int main(int argc, char **argv) {
+    LOG_0("test started");
+
+    mec::Preferences prefs("../mec-api/tests/config.json");
+    assert(prefs.valid());
+    mec::Preferences mec_prefs(prefs.getSubTree("mec"));
+    assert(mec_prefs.valid());
+
+    mec::MecConfig config;
+    // throttle is not a number, port and voices are out of range
+    assert(!config.load(mec_prefs));
+
+    // only configured devices are present, disabled (_) keys are ignored
+    assert(config.eigenharp_ != nullptr);
+    assert(config.oscT3D_ != nullptr);
+    assert(config.kontrol_ != nullptr);
+    assert(config.midi_ == nullptr);
+    assert(config.soundplane_ == nullptr);
+
+    // values read, invalid values use defaults
+    assert(config.eigenharp_->voices_ == 4);
+    assert(config.eigenharp_->pitchbendRange_ == 12.0f);
+    assert(config.eigenharp_->throttle_ == 0);
+    assert(config.eigenharp_->stealVoices_);
+    assert(config.oscT3D_->port_ == 9000);
+    assert(config.kontrol_->listenPort_ == 6001);
+    assert(config.kontrol_->listen_.empty());
+    // more voices than mpe member channels
+    assert(config.voices_ == mec::VoiceAllocator::DEFAULT_VOICES);
+
+    // per model
+    const auto &pico = config.eigenharp_->pico_;
+    assert(pico.exists_);
+    assert(!config.eigenharp_->tau_.exists_);
+    assert(pico.greenLeds_.size() == 2 && pico.greenLeds_[1] == 2);
+    assert(pico.redLeds_.empty());
+    assert(pico.hasMapping_);
+    assert(pico.mapping_.mode_ == mec::MappingConfig::M_Calculated);
+    assert(pico.mapping_.keysInCol_ == 9);
+    assert(pico.mapping_.colMultiplier_ == 5);
+    assert(pico.mapping_.noteOffset_ == 48);
+
+    // reader, errors are counted, keys are case insensitive
+    mec::Preferences kprefs(mec_prefs.getSubTree("kontrol"));
+    mec::ConfigReader r(kprefs, "mec.kontrol");
+    unsigned port;
+    float rate;
+    r.read("Listen Port", port, 0);
+    r.read("listen prot", rate, 1.0f, 0.0f, 100.0f);
+    assert(port == 6001);
+    assert(rate == 1.0f);
+    assert(r.errors() == 1);
+    assert(!r.done());
+
+    LOG_0("test completed");
+    return 0;
+}
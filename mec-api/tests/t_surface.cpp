@@ -4,6 +4,7 @@
 #include <iostream>
 
 #include <mec_surface.h>
+#include <mec_surfacemapper.h>
 #include <mec_prefs.h>
 #include <mec_log.h>
 
@@ -54,6 +55,26 @@ int main (int argc, char** argv) {
     assert(out.x_ == 1.1f);
     assert(out.surface_ == "2");
 
+    // key mapping, compiled for a 24 x 5 device (alpha) with percussion keys
+    mec::MappingConfig mc;
+    mc.mode_ = mec::MappingConfig::M_Calculated;
+    mc.keysInCol_ = 24;
+    mc.rowMultiplier_ = 1;
+    mc.colMultiplier_ = 5;
+    mc.noteOffset_ = 36;
+    mc.percussionNotes_ = {35, 38};
+    mec::SurfaceMapper mapper;
+    mapper.load(mc);
+    mec::SurfaceMap map;
+    mapper.compile(24, 5, 2, map);
+    assert(map.courses() == 2);
+    assert(map.size() == 120 + mec::SurfaceMapper::COURSE_KEYS);
+    int k = map.index(0, 25);
+    assert(k == 25 && map.key(k).note_ == 36 + 5 + 1 && map.key(k).row_ == 1 && map.key(k).col_ == 1);
+    assert(map.index(0, 120) == -1 && map.index(2, 0) == -1);
+    assert(map.key(map.index(1, 1)).note_ == 38);
+    assert(map.key(map.index(1, 2)).note_ == mapper.noteFromKey(2) + mec::SurfaceMapper::COURSE_NOTE_OFFSET);
+
     LOG_0("test completed");
     return 0;
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <iostream>
 
 #include <mec_voice.h>
+#include <mec_voice_allocator.h>
 #include <mec_prefs.h>
 #include <mec_log.h>
 
@@ -29,6 +30,80 @@ int main (int argc, char** argv) {
     voices.startVoice(4);
     assert(voices.oldestActiveVoice()->id_ == 2);
 
+    // global voices, touch ids from 2 devices do not collide
+    mec::VoiceAllocator alloc(3);
+    unsigned d1 = alloc.addDevice();
+    unsigned d2 = alloc.addDevice();
+    int a = alloc.start(d1, 0, 60.0f, 0.0f, 0.0f, 0.5f);
+    int b = alloc.start(d2, 0, 60.0f, 0.0f, 0.0f, 0.5f);
+    assert(a >= 0 && b >= 0 && a != b);
+    assert(alloc.start(d1, 0, 60.0f, 0.0f, 0.0f, 0.5f) == a);
+    assert(alloc.find(d2, 0) == b);
+    int c = alloc.start(d2, 1, 60.0f, 0.0f, 0.0f, 0.5f);
+    assert(c >= 0 && c < 3 && c != a && c != b);
+    assert(alloc.start(d1, 1, 60.0f, 0.0f, 0.0f, 0.5f) == -1); // budget used
+    assert(alloc.active() == 3);
+    assert(alloc.stop(d1, 0) == a);
+    assert(alloc.find(d1, 0) == -1);
+    assert(alloc.start(d1, 1, 60.0f, 0.0f, 0.0f, 0.5f) == a);
+    assert(alloc.start(d1, 1000, 60.0f, 0.0f, 0.0f, 0.5f) == -1);
+
+    // reduced budget, voices above it are not reused
+    alloc.voices(1);
+    assert(alloc.stop(d2, 0) == b);
+    assert(alloc.stop(d2, 1) == c);
+    assert(alloc.stop(d1, 1) == a);
+    assert(alloc.start(d1, 2, 60.0f, 0.0f, 0.0f, 0.5f) == 0);
+    assert(alloc.start(d1, 3, 60.0f, 0.0f, 0.0f, 0.5f) == -1);
+
+    // stealing, from all voices when they are used
+    mec::AllocatedVoice stolen;
+    mec::VoiceAllocator steal(3, mec::S_OLDEST);
+    unsigned s1 = steal.addDevice(mec::VoiceAllocator::MAX_VOICES, true);
+    unsigned s2 = steal.addDevice();
+    int v0 = steal.start(s1, 0, 60.0f, 0.0f, 0.0f, 0.9f);
+    int v1 = steal.start(s2, 0, 48.0f, 0.0f, 0.0f, 0.2f);
+    int v2 = steal.start(s1, 1, 72.0f, 0.0f, 0.0f, 0.5f);
+    assert(steal.start(s2, 1, 50.0f, 0.0f, 0.0f, 0.5f, &stolen) == -1); // s2 doesnt steal
+    assert(stolen.device_ == -1);
+    assert(steal.start(s1, 2, 61.0f, 0.0f, 0.0f, 0.5f, &stolen) == v0);
+    assert(stolen.device_ == (int) s1 && stolen.touch_ == 0 && stolen.voice_ == v0 && stolen.note_ == 60.0f);
+    assert(steal.find(s1, 0) == -1);
+    assert(steal.stop(s1, 0) == -1);  // stolen touch ends quietly
+
+    // policies, v0 = 61 z 0.5, v1 = 48 z 0.2, v2 = 72 z 0.5
+    steal.policy(mec::S_QUIETEST);
+    assert(steal.start(s1, 3, 70.0f, 0.0f, 0.0f, 0.5f, &stolen) == v1);
+    assert(stolen.device_ == (int) s2 && stolen.z_ == 0.2f);
+    steal.update(v1, 40.0f, 0.0f, 0.0f, 0.9f); // v1 = 40 z 0.9
+    steal.update(v2, 72.0f, 0.0f, 0.0f, 0.1f);
+    assert(steal.start(s1, 4, 70.0f, 0.0f, 0.0f, 0.5f, &stolen) == v2); // v2 = 70 z 0.5
+    steal.policy(mec::S_HIGHEST);
+    assert(steal.start(s1, 5, 65.0f, 0.0f, 0.0f, 0.5f, &stolen) == v2 && stolen.note_ == 70.0f);
+    steal.policy(mec::S_LOWEST);
+    assert(steal.start(s1, 6, 65.0f, 0.0f, 0.0f, 0.5f, &stolen) == v1 && stolen.note_ == 40.0f);
+    steal.policy(mec::S_NEAREST); // v0 = 61, v1 = 65, v2 = 65
+    steal.update(v2, 80.5f, 0.0f, 0.0f, 0.5f);
+    assert(steal.start(s1, 7, 79.0f, 0.0f, 0.0f, 0.5f, &stolen) == v2 && stolen.note_ == 80.5f);
+    assert(steal.start(s1, 8, 62.4f, 0.0f, 0.0f, 0.5f, &stolen) == v0 && stolen.note_ == 61.0f);
+    steal.policy(mec::S_NONE);
+    assert(steal.start(s1, 9, 62.0f, 0.0f, 0.0f, 0.5f, &stolen) == -1 && stolen.device_ == -1);
+    assert(steal.active() == 3);
+
+    // limited device, steals from its own voices, before any free voice
+    mec::VoiceAllocator limit(8, mec::S_OLDEST);
+    unsigned l1 = limit.addDevice(2, true);
+    int w0 = limit.start(l1, 0, 60.0f, 0.0f, 0.0f, 0.5f);
+    limit.start(l1, 1, 62.0f, 0.0f, 0.0f, 0.5f);
+    assert(limit.start(l1, 2, 64.0f, 0.0f, 0.0f, 0.5f, &stolen) == w0 && stolen.touch_ == 0);
+    limit.device(l1, 2, false);
+    assert(limit.start(l1, 3, 64.0f, 0.0f, 0.0f, 0.5f) == -1);
+    assert(limit.active() == 2);
+
+    mec::StealPolicy policy;
+    assert(mec::stealPolicy("nearest", policy) && policy == mec::S_NEAREST);
+    assert(!mec::stealPolicy("loudest", policy));
+
     LOG_0("test completed");
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "app_config.h"
+
+#include <mec_configreader.h>
+
+bool MidiOutputConfig::load(const mec::Preferences &prefs, const std::string &path) {
+    mec::ConfigReader r(prefs, path);
+    r.read("mpe", mpe_, true);
+    r.read("pitchbend range", pitchbendRange_, 48.0f, 0.0f);
+    r.read("device", device_, "");
+    unsigned virt;
+    r.read("virtual", virt, 0);
+    virtual_ = virt > 0;
+    r.known("voices"); // not used, mpe voices are determined by the device
+    return r.done();
+}
+
+bool OscOutputConfig::load(const mec::Preferences &prefs, const std::string &path) {
+    mec::ConfigReader r(prefs, path);
+    r.read("host", host_, "127.0.0.1");
+    r.read("port", port_, 3123, 1, 65535);
+    r.read("touch offset", touchOffset_, 1);
+    r.read("x offset", xOffset_, 0.5f);
+    r.read("y offset", yOffset_, 0.5f);
+    return r.done();
+}
+
+bool ConsoleOutputConfig::load(const mec::Preferences &prefs, const std::string &path) {
+    mec::ConfigReader r(prefs, path);
+    r.read("throttle", throttle_, 0);
+    return r.done();
+}
+
+bool LogConfig::load(const mec::Preferences &prefs, const std::string &path) {
+    mec::ConfigReader r(prefs, path);
+    std::string output;
+    r.read("output", output, "console");
+    r.read("file", file_, "mec.log");
+    r.read("level", level_, mec::Logger::DEFAULT_LEVEL, 0, 3);
+    output_ = mec::Logger::L_CONSOLE;
+    if (output == "file") {
+        output_ = mec::Logger::L_FILE;
+    } else if (output == "syslog") {
+        output_ = mec::Logger::L_SYSLOG;
+    } else if (output != "console") {
+        LOG_0("config error : " << r.path("output") << " expected console, file or syslog, using console");
+    }
+
+    levels_.clear();
+    mec::Preferences levels(r.object("levels"));
+    if (levels.valid()) {
+        mec::ConfigReader l(levels, r.path("levels"));
+        for (const auto &subsystem : levels.getKeys()) {
+            int level;
+            l.read(subsystem, level, level_, 0, 3);
+            levels_[subsystem] = level;
+        }
+        l.done();
+    }
+    return r.done();
+}
+
+bool StatsConfig::load(const mec::Preferences &prefs, const std::string &path) {
+    mec::ConfigReader r(prefs, path);
+    r.read("host", host_, "127.0.0.1");
+    r.read("port", port_, 0, 0, 65535);
+    r.read("interval", interval_, 1000, 10);
+    r.read("listen port", listenPort_, 0, 0, 65535);
+    return r.done();
+}
+
+bool AppConfig::load(const mec::Preferences &prefs, const std::string &path) {
+    mec::ConfigReader r(prefs, path);
+    bool ret = true;
+    r.read("realtime", realtime_, false);
+    r.read("queuedOutput", queuedOutput_, true);
+    r.read("queue poll time", queuePollTime_, 100);
+    r.read("rt output", rtOutput_, false);
+    r.read("lock time", lockTime_, 5);
+
+    mec::Preferences log(r.object("log"));
+    ret &= log_.load(log, r.path("log"));
+
+    r.read("lock memory", lockMemory_, false);
+    r.read("prefault stack", prefaultStack_, 64 * 1024, 0, 8 * 1024 * 1024);
+    threads_.clear();
+    mec::Preferences threads(r.object("threads"));
+    if (threads.valid()) {
+        mec::ConfigReader t(threads, r.path("threads"));
+        for (const auto &name : threads.getKeys()) {
+            mec::Preferences thread(t.object(name));
+            if (!thread.valid()) {
+                ret = false;
+                continue;
+            }
+            ret &= threads_[name].load(thread, t.path(name));
+        }
+        ret &= t.done();
+    }
+    if (realtime_ && threads_.find("mec") == threads_.end()) {
+        threads_["mec"] = mec::ThreadConfig(mec::ThreadConfig::P_FIFO, 95);
+    }
+    if (rtOutput_ && threads_.find("mec.queue") == threads_.end()) {
+        threads_["mec.queue"] = mec::ThreadConfig(mec::ThreadConfig::P_FIFO, 95);
+    }
+
+    ret &= r.read("stats", stats_);
+
+    mec::Preferences outputs(r.object("outputs"));
+    mec::ConfigReader o(outputs, r.path("outputs"));
+    ret &= o.read("midi", midi_);
+    ret &= o.read("osc", osc_);
+    ret &= o.read("console", console_);
+    ret &= o.done();
+    ret &= r.done();
+    return ret;
+}
@@ -0,0 +1,97 @@
+#ifndef MEC_APP_CONFIG_H
+#define MEC_APP_CONFIG_H
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include <mec_log.h>
+#include <mec_prefs.h>
+#include <mec_threads.h>
+
+// typed configuration for mec-app ("mec-app" object in mec.json), parsed once
+
+struct MidiOutputConfig {
+    bool mpe_;
+    float pitchbendRange_;
+    std::string device_;
+    bool virtual_;
+
+    bool load(const mec::Preferences &prefs, const std::string &path);
+
+    bool operator==(const MidiOutputConfig &c) const {
+        return mpe_ == c.mpe_ && pitchbendRange_ == c.pitchbendRange_ && device_ == c.device_ && virtual_ == c.virtual_;
+    }
+};
+
+struct OscOutputConfig {
+    std::string host_;
+    unsigned port_;
+    int touchOffset_;
+    float xOffset_;
+    float yOffset_;
+
+    bool load(const mec::Preferences &prefs, const std::string &path);
+
+    bool operator==(const OscOutputConfig &c) const {
+        return host_ == c.host_ && port_ == c.port_ && touchOffset_ == c.touchOffset_
+               && xOffset_ == c.xOffset_ && yOffset_ == c.yOffset_;
+    }
+};
+
+struct ConsoleOutputConfig {
+    unsigned throttle_;
+
+    bool load(const mec::Preferences &prefs, const std::string &path);
+
+    bool operator==(const ConsoleOutputConfig &c) const { return throttle_ == c.throttle_; }
+};
+
+struct LogConfig {
+    mec::Logger::Output output_;
+    std::string file_;
+    int level_;
+    std::map<std::string, int> levels_; // per subsystem, overriding level_
+
+    bool load(const mec::Preferences &prefs, const std::string &path);
+};
+
+// metrics publishing (mec::Metrics) over osc, /mec/stats/...
+struct StatsConfig {
+    std::string host_;
+    unsigned port_;         // periodic snapshots sent to host:port, 0 = only on query
+    unsigned interval_;     // ms
+    unsigned listenPort_;   // /mec/stats/query, answered to the sender, 0 = none
+
+    bool load(const mec::Preferences &prefs, const std::string &path);
+
+    bool operator==(const StatsConfig &c) const {
+        return host_ == c.host_ && port_ == c.port_ && interval_ == c.interval_ && listenPort_ == c.listenPort_;
+    }
+};
+
+struct AppConfig {
+    bool realtime_;
+    bool queuedOutput_;
+    unsigned queuePollTime_;
+    bool rtOutput_;
+    unsigned lockTime_;
+    LogConfig log_;
+
+    // scheduling per thread name, e.g. "mec", "mec.queue", see mec::ThreadRegistry
+    // realtime/rt output are shorthand for fifo 95 on mec/mec.queue
+    std::map<std::string, mec::ThreadConfig> threads_;
+    bool lockMemory_;
+    unsigned prefaultStack_;
+
+    std::shared_ptr<StatsConfig> stats_; // only if present
+
+    // outputs, only configured if present
+    std::shared_ptr<MidiOutputConfig> midi_;
+    std::shared_ptr<OscOutputConfig> osc_;
+    std::shared_ptr<ConsoleOutputConfig> console_;
+
+    bool load(const mec::Preferences &prefs, const std::string &path = "mec-app");
+};
+
+#endif //MEC_APP_CONFIG_H
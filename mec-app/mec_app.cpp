@@ -21,7 +21,6 @@ inline void sleep(unsigned int seconds) { Sleep(seconds * 1000); }
 
 #include "mec_app.h"
 #include <mec_prefs.h>
-#include <mec_utils.h>
 
 #ifndef __COBALT__
 
@@ -80,6 +79,7 @@ mecAppLock:: ~mecAppLock() {
 
 
 volatile bool keepRunning = true;
+std::string prefFile;
 
 void exitHandler() {
     LOG_0("mec_app exit handler called");
@@ -123,6 +123,7 @@ int main(int ac, char **av) {
 
     const char *pref_file = "./mec.json";
     if (ac > 1) pref_file = av[1];
+    prefFile = pref_file;
     mec::Preferences prefs(pref_file);
     if (!prefs.valid()) return -1;
 
@@ -138,13 +139,8 @@ int main(int ac, char **av) {
         pthread_t ph = mec_thread.native_handle();
         pthread_create(&ph, 0,mecapi_proc,prefs.getTree());
 #else
-        mec::Preferences app_prefs(prefs.getSubTree("mec-app"));
+        // scheduling ("realtime", "threads") is applied by the thread itself, see mecapi_proc
         mec_thread = std::thread(mecapi_proc, prefs.getTree());
-        bool rt=app_prefs.getBool("realtime",false);
-        if(rt) {
-            LOG_0("realtime mec thread");
-            makeThreadRealtime(mec_thread);
-        }
 #endif
         usleep(1000);
     }
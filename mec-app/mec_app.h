@@ -4,6 +4,7 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <string>
 
 #include <mec_log.h>
 
@@ -16,6 +17,7 @@ void getWaitTime(struct timespec& ts, int t);
 
 
 extern volatile bool keepRunning;
+extern std::string prefFile; // watched for changes
 
 class mecAppLock {
 public:
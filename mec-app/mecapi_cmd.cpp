@@ -17,17 +17,22 @@ inline void pthread_exit(void *value_ptr)
 
 #endif
 #include <string.h>
+#include <chrono>
 
 #include <osc/OscOutboundPacketStream.h>
 #include <ip/UdpSocket.h>
 
 #include "mec_app.h"
 #include "midi_output.h"
+#include "app_config.h"
+#include "metrics_publisher.h"
 
 #include <mec_api.h>
-#include <mec_utils.h>
 #include <mec_prefs.h>
 #include <mec_msg_queue.h>
+#include <mec_filewatcher.h>
+#include <mec_pending.h>
+#include <mec_threads.h>
 #include <processors/mec_mpe_processor.h>
 
 
@@ -55,9 +60,8 @@ public:
 
 class MecConsoleCallback : public MecCmdCallback {
 public:
-    MecConsoleCallback(mec::Preferences &p)
-            : prefs_(p),
-              throttle_(static_cast<unsigned>(p.getInt("throttle", 0))),
+    MecConsoleCallback(const ConsoleOutputConfig &c)
+            : throttle_(c.throttle_),
               valid_(true) {
         if (valid_) {
             LOG_0("mecapi_proc enabling for console output, throttle :  " << throttle_);
@@ -105,7 +109,6 @@ public:
     }
 
 private:
-    mec::Preferences prefs_;
     unsigned int throttle_;
     bool valid_;
 };
@@ -114,16 +117,15 @@ private:
 // this is basically T3D, but doesnt have the framemessages (/t3d/frm)
 class MecOSCCallback : public MecCmdCallback {
 public:
-    MecOSCCallback(mec::Preferences &p)
-            : prefs_(p),
-              transmitSocket_(),
+    MecOSCCallback(const OscOutputConfig &c)
+            : transmitSocket_(),
               valid_(true),
-              touchOffset_(p.getInt("touch offset",1)),
-              xOffset_(p.getDouble("x offset",0.5f)),
-              yOffset_(p.getDouble("y offset",0.5f))
+              touchOffset_(c.touchOffset_),
+              xOffset_(c.xOffset_),
+              yOffset_(c.yOffset_)
               {
         try {
-            transmitSocket_.Connect((IpEndpointName(p.getString("host", "127.0.0.1").c_str(), p.getInt("port", 3123))));
+            transmitSocket_.Connect((IpEndpointName(c.host_.c_str(), c.port_)));
         } catch(const std::runtime_error& ) {
             valid_ = false;
             LOG_0("OSC connect failed");
@@ -137,7 +139,7 @@ public:
 
     void touchOn(int touchId, float note, float x, float y, float z) {
         std::string topic = "/t3d/tch" + std::to_string(touchId+touchOffset_);
-        std::cout << topic << " - " << " touch: " << touchId << " note: " << note << " x: " << x << " y: " << y << " z: " << z << std::endl;
+        LOG_1(topic << " - " << " touch: " << touchId << " note: " << note << " x: " << x << " y: " << y << " z: " << z);
         sendMsg(topic, touchId, note, x+xOffset_, y +yOffset_, z);
     }
 
@@ -177,7 +179,6 @@ public:
 private:
     static constexpr unsigned OUTPUT_BUFFER_SIZE=1024;
 
-    mec::Preferences prefs_;
     UdpSocket transmitSocket_;
     char buffer_[OUTPUT_BUFFER_SIZE];
     bool valid_;
@@ -188,77 +189,82 @@ private:
 
 class MecMidiProcessor : public mec::Midi_Processor {
 public:
-    MecMidiProcessor(mec::Preferences &p) : prefs_(p) {
-        setPitchbendRange(static_cast<float>(p.getDouble("pitchbend range", 48.0f)));
-        std::string device = prefs_.getString("device");
-        int virt = prefs_.getInt("virtual", 0);
-        if (output_.create(device, virt > 0)) {
+    // port, if given and open, is shared (e.g. with the processor this replaces on reload)
+    MecMidiProcessor(const MidiOutputConfig &c, const std::shared_ptr<MidiOutput> &port = nullptr) {
+        setPitchbendRange(c.pitchbendRange_);
+        const std::string &device = c.device_;
+        if (port && port->isOpen()) {
+            output_ = port;
+        } else if ((output_ = std::make_shared<MidiOutput>())->create(device, c.virtual_)) {
             LOG_1("MecMidiProcessor enabling for midi to " << device);
         }
-        if (!output_.isOpen()) {
+        if (!output_->isOpen()) {
             LOG_0("MecMidiProcessor not open, so invalid for" << device);
         }
     }
 
-    bool isValid() { return output_.isOpen(); }
+    bool isValid() { return output_->isOpen(); }
+
+    const std::shared_ptr<MidiOutput> &port() const { return output_; }
 
     void process(mec::Midi_Processor::MidiMsg &m) {
-        if (output_.isOpen()) {
+        if (output_->isOpen()) {
             std::vector<unsigned char> msg;
 
             for (int i = 0; i < m.size; i++) {
                 msg.push_back((unsigned char) m.data[i]);
             }
-            output_.sendMsg(msg);
+            output_->sendMsg(msg);
         }
     }
 
 private:
-    mec::Preferences prefs_;
-    MidiOutput output_;
+    std::shared_ptr<MidiOutput> output_;
 };
 
 
 
 class MecMpeProcessor : public mec::MPE_Processor {
 public:
-    MecMpeProcessor(mec::Preferences &p) : prefs_(p) {
-        // p.getInt("voices", 15);
-        setPitchbendRange(static_cast<float>(p.getDouble("pitchbend range", 48.0f)));
-        std::string device = prefs_.getString("device");
-        int virt = prefs_.getInt("virtual", 0);
-        if (output_.create(device, virt > 0)) {
+    // port, if given and open, is shared (e.g. with the processor this replaces on reload)
+    MecMpeProcessor(const MidiOutputConfig &c, const std::shared_ptr<MidiOutput> &port = nullptr) {
+        setPitchbendRange(c.pitchbendRange_);
+        const std::string &device = c.device_;
+        if (port && port->isOpen()) {
+            output_ = port;
+        } else if ((output_ = std::make_shared<MidiOutput>())->create(device, c.virtual_)) {
             LOG_1("MecMpeProcessor enabling for midi to " << device);
             LOG_1("TODO (MecMpeProcessor) :");
             LOG_1("- MPE init, including PB range");
         }
-        if (!output_.isOpen()) {
+        if (!output_->isOpen()) {
             LOG_0("MecMpeProcessor not open, so invalid for" << device);
         }
     }
 
-    bool isValid() { return output_.isOpen(); }
+    bool isValid() { return output_->isOpen(); }
+
+    const std::shared_ptr<MidiOutput> &port() const { return output_; }
 
     void process(mec::MPE_Processor::MidiMsg &m) {
-        if (output_.isOpen()) {
+        if (output_->isOpen()) {
             std::vector<unsigned char> msg;
 
             for (int i = 0; i < m.size; i++) {
                 msg.push_back((unsigned char) m.data[i]);
             }
-            output_.sendMsg(msg);
+            output_->sendMsg(msg);
         }
     }
 
 private:
-    mec::Preferences prefs_;
-    MidiOutput output_;
+    std::shared_ptr<MidiOutput> output_;
 };
 
 
 class CallbackQueue : public mec::ICallback {
 public:
-    CallbackQueue(unsigned pt) : pollTime_(pt){
+    CallbackQueue(unsigned pt) : queue_("output.queue"), pollTime_(pt){
     }
 
     void subscribe(ICallback* pCB) {
@@ -334,7 +340,213 @@ private:
 };
 
 
+// the configured outputs, built together so they can be replaced together on reload
+struct Outputs {
+    AppConfig config_;
+    std::shared_ptr<mec::ICallback> midi_;
+    std::shared_ptr<MidiOutput> midiPort_; // of midi_
+    std::shared_ptr<mec::ICallback> osc_;
+    std::shared_ptr<mec::ICallback> console_;
+};
+
+template<class C, class T>
+static std::shared_ptr<mec::ICallback> createOutput(const std::shared_ptr<T> &config,
+                                                   const std::shared_ptr<T> &prevConfig,
+                                                   const std::shared_ptr<mec::ICallback> &prev) {
+    if (!config) return nullptr;
+    // unchanged, so keep it (and its ports and voice state)
+    if (prev && prevConfig && *config == *prevConfig) return prev;
+    auto pCb = std::make_shared<C>(*config);
+    if (!pCb->isValid()) return nullptr;
+    return pCb;
+}
+
+template<class C>
+static std::shared_ptr<mec::ICallback> createMidiOutput(const MidiOutputConfig &config,
+                                                       std::shared_ptr<MidiOutput> &port) {
+    auto pCb = std::make_shared<C>(config, port);
+    if (!pCb->isValid()) return nullptr;
+    port = pCb->port();
+    return pCb;
+}
+
+// builds outputs for config, reusing those whose configuration has not changed from prev
+std::shared_ptr<Outputs> createOutputs(const AppConfig &config, const std::shared_ptr<Outputs> &prev) {
+    auto outputs = std::make_shared<Outputs>();
+    outputs->config_ = config;
+    std::shared_ptr<MidiOutputConfig> prevMidi;
+    std::shared_ptr<OscOutputConfig> prevOsc;
+    std::shared_ptr<ConsoleOutputConfig> prevConsole;
+    std::shared_ptr<mec::ICallback> none;
+    if (prev) {
+        prevMidi = prev->config_.midi_;
+        prevOsc = prev->config_.osc_;
+        prevConsole = prev->config_.console_;
+    }
+
+    if (config.midi_) {
+        if (prev && prev->midi_ && prevMidi && *config.midi_ == *prevMidi) {
+            outputs->midi_ = prev->midi_;
+            outputs->midiPort_ = prev->midiPort_;
+        } else {
+            // the same port is shared, as it is still open (for the old outputs), and can't always be opened twice
+            std::shared_ptr<MidiOutput> port;
+            if (prev && prevMidi && prevMidi->device_ == config.midi_->device_
+                && prevMidi->virtual_ == config.midi_->virtual_) {
+                port = prev->midiPort_;
+            }
+            if (config.midi_->mpe_) {
+                outputs->midi_ = createMidiOutput<MecMpeProcessor>(*config.midi_, port);
+            } else {
+                outputs->midi_ = createMidiOutput<MecMidiProcessor>(*config.midi_, port);
+            }
+            if (outputs->midi_) outputs->midiPort_ = port;
+        }
+    }
+    outputs->osc_ = createOutput<MecOSCCallback>(config.osc_, prevOsc, prev ? prev->osc_ : none);
+    outputs->console_ = createOutput<MecConsoleCallback>(config.console_, prevConsole, prev ? prev->console_ : none);
+    return outputs;
+}
+
+
+// forwards to the current outputs
+// reloaded outputs are only taken up once no touches are active,
+// so notes started on an output always finish on it
+// touches still active after the swap timeout (e.g. a stuck note) are ended on the old outputs,
+// and their later events dropped, until they start again
+class OutputSet : public mec::ICallback {
+public:
+    static const int MAX_TOUCHES = 128;
+    static const int SWAP_TIMEOUT_MS = 5000;
+
+    OutputSet(const std::shared_ptr<Outputs> &outputs) : activeTouches_(0), waiting_(false) {
+        for (int i = 0; i < MAX_TOUCHES; i++) {
+            touching_[i] = false;
+            ended_[i] = false;
+            notes_[i] = 0.0f;
+        }
+        use(outputs);
+    }
+
+    // any thread
+    void reload(const std::shared_ptr<Outputs> &outputs) {
+        pending_.publish(outputs);
+    }
+
+    void touchOn(int touchId, float note, float x, float y, float z) override {
+        swap();
+        if (touchId >= 0 && touchId < MAX_TOUCHES) {
+            ended_[touchId] = false;
+            if (!touching_[touchId]) {
+                touching_[touchId] = true;
+                activeTouches_++;
+            }
+            notes_[touchId] = note;
+        }
+        for (auto pCb : callbacks_) pCb->touchOn(touchId, note, x, y, z);
+    }
+
+    void touchContinue(int touchId, float note, float x, float y, float z) override {
+        if (touchId >= 0 && touchId < MAX_TOUCHES) {
+            if (ended_[touchId]) return;
+            notes_[touchId] = note;
+        }
+        for (auto pCb : callbacks_) pCb->touchContinue(touchId, note, x, y, z);
+    }
+
+    void touchOff(int touchId, float note, float x, float y, float z) override {
+        if (touchId >= 0 && touchId < MAX_TOUCHES && ended_[touchId]) {
+            ended_[touchId] = false;
+            return;
+        }
+        for (auto pCb : callbacks_) pCb->touchOff(touchId, note, x, y, z);
+        if (touchId >= 0 && touchId < MAX_TOUCHES && touching_[touchId]) {
+            touching_[touchId] = false;
+            activeTouches_--;
+        }
+    }
+
+    void control(int ctrlId, float v) override {
+        swap();
+        for (auto pCb : callbacks_) pCb->control(ctrlId, v);
+    }
+
+    void mec_control(int cmd, void *other) override {
+        swap();
+        for (auto pCb : callbacks_) pCb->mec_control(cmd, other);
+    }
+
+private:
+    void use(const std::shared_ptr<Outputs> &outputs) {
+        outputs_ = outputs;
+        callbacks_.clear();
+        if (outputs_->midi_) callbacks_.push_back(outputs_->midi_.get());
+        if (outputs_->osc_) callbacks_.push_back(outputs_->osc_.get());
+        if (outputs_->console_) callbacks_.push_back(outputs_->console_.get());
+    }
+
+    void swap() {
+        if (!pending_.pending()) return;
+        if (activeTouches_ > 0) {
+            auto now = std::chrono::steady_clock::now();
+            if (!waiting_) {
+                waiting_ = true;
+                waitStart_ = now;
+                return;
+            }
+            if (now - waitStart_ < std::chrono::milliseconds(SWAP_TIMEOUT_MS)) return;
+            // still held, end them on the old outputs so none hang
+            LOG_0("mecapi_proc outputs reload, ending " << activeTouches_ << " active touches");
+            for (int i = 0; i < MAX_TOUCHES; i++) {
+                if (!touching_[i]) continue;
+                for (auto pCb : callbacks_) pCb->touchOff(i, notes_[i], 0.0f, 0.0f, 0.0f);
+                touching_[i] = false;
+                ended_[i] = true;
+            }
+            activeTouches_ = 0;
+        }
+        waiting_ = false;
+        std::shared_ptr<Outputs> outputs;
+        if (pending_.take(outputs)) {
+            use(outputs);
+            LOG_0("mecapi_proc outputs reloaded");
+        }
+    }
+
+    std::shared_ptr<Outputs> outputs_;
+    std::vector<ICallback *> callbacks_;
+    mec::Pending<Outputs> pending_;
+    bool touching_[MAX_TOUCHES];
+    bool ended_[MAX_TOUCHES]; // by a forced swap, not on the new outputs
+    float notes_[MAX_TOUCHES]; // last note per touch, to end them on a forced swap
+    int activeTouches_;
+    bool waiting_; // a reload is pending, since wait start, on active touches
+    std::chrono::steady_clock::time_point waitStart_;
+};
+
+const int OutputSet::MAX_TOUCHES;
+const int OutputSet::SWAP_TIMEOUT_MS;
+
+
+void configureLog(const LogConfig &config) {
+    mec::Logger::output(config.output_, config.file_);
+    mec::Logger::defaultLevel(config.level_);
+    for (const auto &l : config.levels_) {
+        mec::Logger::level(l.first, l.second);
+    }
+}
+
+
+void configureThreads(const AppConfig &config) {
+    auto registry = mec::ThreadRegistry::registry();
+    for (const auto &t : config.threads_) {
+        registry->config(t.first, t.second);
+    }
+}
+
+
 void *mecapi_queue_proc(void *arg) {
+    mec::ThreadRegistration registration("mec.queue");
     CallbackQueue* pCallbackQueue = static_cast<CallbackQueue*>(arg);
     while(keepRunning) {
         pCallbackQueue->process();
@@ -345,6 +557,7 @@ void *mecapi_queue_proc(void *arg) {
 
 void *mecapi_proc(void *arg) {
     static int exitCode = 0;
+    mec::ThreadRegistration registration("mec");
 
     LOG_0("mecapi_proc start");
     mec::Preferences prefs(arg);
@@ -355,12 +568,16 @@ void *mecapi_proc(void *arg) {
     }
 
     mec::Preferences app_prefs(prefs.getSubTree("mec-app"));
-    mec::Preferences api_prefs(prefs.getSubTree("mec"));
-
-    mec::Preferences outprefs(app_prefs.getSubTree("outputs"));
-
-
-    bool queuedOutput = app_prefs.getBool("queuedOutput", true);
+    AppConfig config;
+    bool configValid = config.load(app_prefs);
+    configureLog(config.log_);
+    if (!configValid) {
+        LOG_0("mec-app configuration has errors (see above), invalid values are using their defaults");
+    }
+    if (config.lockMemory_) {
+        mec::ThreadRegistry::registry()->lockMemory(config.prefaultStack_);
+    }
+    configureThreads(config);
 
 
     std::unique_ptr<mec::MecApi> mecApi;
@@ -368,64 +585,18 @@ void *mecapi_proc(void *arg) {
 
     CallbackQueue* pCallbackQueue= nullptr;
     std::thread callbackQueueThread;
-    if(queuedOutput) {
+    if(config.queuedOutput_) {
         LOG_0("mecapi_proc using queued output");
-        unsigned queuePollTime = app_prefs.getBool("queue poll time", 100);
-        pCallbackQueue = new CallbackQueue(queuePollTime);
+        pCallbackQueue = new CallbackQueue(config.queuePollTime_);
         mecApi->subscribe(pCallbackQueue);
     }
 
-    if (outprefs.exists("midi")) {
-        mec::Preferences cbprefs(outprefs.getSubTree("midi"));
-        if(cbprefs.getBool("mpe",true)) {
-            MecMpeProcessor *pCb = new MecMpeProcessor(cbprefs);
-            if (pCb->isValid()) {
-                if(pCallbackQueue) {
-                    pCallbackQueue->subscribe(pCb);
-                } else {
-                    mecApi->subscribe(pCb);
-                }
-            } else {
-                delete pCb;
-            }
-        } else {
-            MecMidiProcessor *pCb = new MecMidiProcessor(cbprefs);
-            if (pCb->isValid()) {
-                if(pCallbackQueue) {
-                    pCallbackQueue->subscribe(pCb);
-                } else {
-                    mecApi->subscribe(pCb);
-                }
-            } else {
-                delete pCb;
-            }
-        }
-    }
-    if (outprefs.exists("osc")) {
-        mec::Preferences cbprefs(outprefs.getSubTree("osc"));
-        MecOSCCallback *pCb = new MecOSCCallback(cbprefs);
-        if (pCb->isValid()) {
-            if(pCallbackQueue) {
-                pCallbackQueue->subscribe(pCb);
-            } else {
-                mecApi->subscribe(pCb);
-            }
-        } else {
-            delete pCb;
-        }
-    }
-    if (outprefs.exists("console")) {
-        mec::Preferences cbprefs(outprefs.getSubTree("console"));
-        MecConsoleCallback *pCb = new MecConsoleCallback(cbprefs);
-        if (pCb->isValid()) {
-            if(pCallbackQueue) {
-                pCallbackQueue->subscribe(pCb);
-            } else {
-                mecApi->subscribe(pCb);
-            }
-        } else {
-            delete pCb;
-        }
+    std::shared_ptr<Outputs> outputs = createOutputs(config, nullptr);
+    OutputSet outputSet(outputs);
+    if(pCallbackQueue) {
+        pCallbackQueue->subscribe(&outputSet);
+    } else {
+        mecApi->subscribe(&outputSet);
     }
 
     mecApi->init();
@@ -440,17 +611,53 @@ void *mecapi_proc(void *arg) {
 #else
         // this seems unlikely to be needed or wanted
         callbackQueueThread = std::thread(mecapi_queue_proc,pCallbackQueue);
-        bool rt=app_prefs.getBool("rt output",false);
-        if(rt) {
-            LOG_0("realtime outputQueue thread");
-            makeThreadRealtime(callbackQueueThread);
-        }
 #endif
 
     }
 
 
-    unsigned locktime=app_prefs.getInt("lock time",5);
+    MetricsPublisher metrics;
+    if (config.stats_) metrics.start(*config.stats_);
+
+    // hot reload, changes are built here on the watcher thread, and taken up between processing cycles
+    mec::FileWatcher watcher;
+    if (!prefFile.empty()) {
+        watcher.start(prefFile, [&]() {
+            mec::Preferences newPrefs(prefFile);
+            if (!newPrefs.valid()) {
+                LOG_0("mecapi_proc " << prefFile << " invalid, not reloaded");
+                return;
+            }
+            mecApi->reload(newPrefs.getTree());
+
+            mec::Preferences newAppPrefs(newPrefs.getSubTree("mec-app"));
+            AppConfig newConfig;
+            if (!newAppPrefs.valid() || !newConfig.load(newAppPrefs)) {
+                LOG_0("mecapi_proc invalid mec-app configuration, outputs not reloaded");
+                return;
+            }
+            if (newConfig.queuedOutput_ != config.queuedOutput_
+                || newConfig.queuePollTime_ != config.queuePollTime_
+                || newConfig.lockTime_ != config.lockTime_
+                || newConfig.lockMemory_ != config.lockMemory_) {
+                LOG_0("mecapi_proc queue and memory changes require a restart");
+            }
+            configureLog(newConfig.log_);
+            configureThreads(newConfig);
+            if (!newConfig.stats_) {
+                metrics.stop();
+            } else if (!config.stats_ || !(*newConfig.stats_ == *config.stats_)) {
+                metrics.start(*newConfig.stats_);
+            }
+            config.stats_ = newConfig.stats_;
+            outputs = createOutputs(newConfig, outputs);
+            outputSet.reload(outputs);
+        });
+    }
+
+    mec::ThreadRegistry::registry()->report();
+
+    unsigned locktime=config.lockTime_;
     {
         mecAppLock lock;
         while (keepRunning) {
@@ -461,6 +668,8 @@ void *mecapi_proc(void *arg) {
 
     // delete the api, so that it can clean up
     LOG_0("mecapi_proc stopping");
+    watcher.stop();
+    metrics.stop();
 
 
     if(pCallbackQueue) {
@@ -0,0 +1,143 @@
+#include "metrics_publisher.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <osc/OscOutboundPacketStream.h>
+#include <osc/OscReceivedElements.h>
+
+#include <mec_log.h>
+#include <mec_threads.h>
+
+static const char *STATS_ADDRESS = "/mec/stats/";
+static const char *QUERY_ADDRESS = "/mec/stats/query";
+
+const unsigned MetricsPublisher::OUTPUT_BUFFER_SIZE;
+
+MetricsPublisher::MetricsPublisher() {
+    ;
+}
+
+MetricsPublisher::~MetricsPublisher() {
+    stop();
+}
+
+void *metrics_publisher_thread_func(void *pPublisher) {
+    mec::ThreadRegistration registration("mec.stats");
+    MetricsPublisher *pThis = static_cast<MetricsPublisher *>(pPublisher);
+    pThis->run();
+    return nullptr;
+}
+
+bool MetricsPublisher::start(const StatsConfig &config) {
+    stop();
+    config_ = config;
+    try {
+        socket_.reset(new UdpSocket());
+        socket_->Bind(IpEndpointName(IpEndpointName::ANY_ADDRESS,
+                                     config_.listenPort_ > 0 ? (int) config_.listenPort_ : IpEndpointName::ANY_PORT));
+        if (config_.port_ > 0) destination_.reset(new IpEndpointName(config_.host_.c_str(), config_.port_));
+    } catch (const std::runtime_error &e) {
+        LOG_0("MetricsPublisher unable to start : " << e.what());
+        socket_.reset();
+        destination_.reset();
+        return false;
+    }
+
+    mux_.reset(new SocketReceiveMultiplexer());
+    mux_->AttachSocketListener(socket_.get(), this);
+    if (destination_) mux_->AttachPeriodicTimerListener((int) config_.interval_, this);
+    lastTime_ = std::chrono::steady_clock::now();
+    thread_ = std::thread(metrics_publisher_thread_func, this);
+
+    if (destination_) LOG_0("MetricsPublisher publishing to " << config_.host_ << ":" << config_.port_);
+    if (config_.listenPort_ > 0) LOG_0("MetricsPublisher listening on " << config_.listenPort_);
+    return true;
+}
+
+void MetricsPublisher::stop() {
+    if (mux_) {
+        mux_->AsynchronousBreak();
+        if (thread_.joinable()) thread_.join();
+    }
+    mux_.reset();
+    socket_.reset();
+    destination_.reset();
+    lastCounts_.clear();
+}
+
+void MetricsPublisher::run() {
+    mux_->Run();
+}
+
+void MetricsPublisher::ProcessPacket(const char *data, int size, const IpEndpointName &remoteEndpoint) {
+    try {
+        osc::OscPacketListener::ProcessPacket(data, size, remoteEndpoint);
+    } catch (osc::Exception &e) {
+        LOG_1("MetricsPublisher invalid packet : " << e.what());
+    }
+}
+
+void MetricsPublisher::ProcessMessage(const osc::ReceivedMessage &m, const IpEndpointName &remoteEndpoint) {
+    if (std::strcmp(m.AddressPattern(), QUERY_ADDRESS) != 0) return;
+    std::string prefix;
+    osc::ReceivedMessage::const_iterator arg = m.ArgumentsBegin();
+    if (arg != m.ArgumentsEnd() && arg->IsString()) prefix = arg->AsString();
+    publish(remoteEndpoint, prefix);
+}
+
+void MetricsPublisher::TimerExpired() {
+    publish(*destination_, "");
+}
+
+void MetricsPublisher::publish(const IpEndpointName &destination, const std::string &prefix) {
+    mec::Metrics::snapshot(samples_);
+
+    // rates are over the interval since the previous snapshot (periodic or query)
+    auto now = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(now - lastTime_).count();
+    lastTime_ = now;
+
+    osc::OutboundPacketStream ops(buffer_, OUTPUT_BUFFER_SIZE);
+    ops << osc::BeginBundleImmediate;
+
+    // a new message, in a new bundle if it may not fit
+    auto begin = [&](const std::string &name) {
+        std::string address = STATS_ADDRESS + name;
+        std::replace(address.begin() + strlen(STATS_ADDRESS), address.end(), '.', '/');
+        // address, type tags and value, padded, plus the message size
+        if (ops.Size() + address.size() + 24 > OUTPUT_BUFFER_SIZE) {
+            ops << osc::EndBundle;
+            socket_->SendTo(destination, ops.Data(), ops.Size());
+            ops.Clear();
+            ops << osc::BeginBundleImmediate;
+        }
+        ops << osc::BeginMessage(address.c_str());
+    };
+    auto add = [&](const std::string &name, double value) {
+        begin(name);
+        ops << value << osc::EndMessage;
+    };
+    auto addCount = [&](const std::string &name, int64_t count) {
+        begin(name);
+        ops << (osc::int64) count << osc::EndMessage;
+    };
+
+    for (const auto &s : samples_) {
+        if (s.kind_ == mec::Metrics::Sample::K_COUNTER) {
+            int64_t &last = lastCounts_[s.name_];
+            double rate = secs > 0.0 && last <= s.count_ ? double(s.count_ - last) / secs : 0.0;
+            last = s.count_;
+            if (s.name_.compare(0, prefix.size(), prefix) != 0) continue;
+            addCount(s.name_, s.count_);
+            add(s.name_ + ".rate", rate);
+        } else {
+            if (s.name_.compare(0, prefix.size(), prefix) != 0) continue;
+            add(s.name_, s.value_);
+        }
+    }
+
+    // sent even if empty, so a query is always answered
+    ops << osc::EndBundle;
+    socket_->SendTo(destination, ops.Data(), ops.Size());
+}
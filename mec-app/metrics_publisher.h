@@ -0,0 +1,57 @@
+#ifndef MEC_METRICS_PUBLISHER_H
+#define MEC_METRICS_PUBLISHER_H
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ip/UdpSocket.h>
+#include <ip/TimerListener.h>
+#include <osc/OscPacketListener.h>
+
+#include <mec_metrics.h>
+
+#include "app_config.h"
+
+// publishes mec::Metrics snapshots as osc, one message per value, in bundles
+// counters are sent as int64, so are exact, other values (and rates) as double
+// e.g. osct3d.queue.dropped as /mec/stats/osct3d/queue/dropped, counters also have .../rate (per second)
+// - periodically to host:port
+// - on request, /mec/stats/query [prefix], answered to the sender
+// runs on its own thread (mec.stats), so never touches the processing threads
+class MetricsPublisher : public osc::OscPacketListener, public TimerListener {
+public:
+    MetricsPublisher();
+    ~MetricsPublisher();
+
+    bool start(const StatsConfig &config);
+    void stop();
+
+    void run();
+
+protected:
+    void ProcessPacket(const char *data, int size, const IpEndpointName &remoteEndpoint) override;
+    void ProcessMessage(const osc::ReceivedMessage &m, const IpEndpointName &remoteEndpoint) override;
+    void TimerExpired() override;
+
+private:
+    static const unsigned OUTPUT_BUFFER_SIZE = 4096;
+
+    void publish(const IpEndpointName &destination, const std::string &prefix);
+
+    StatsConfig config_;
+    std::unique_ptr<UdpSocket> socket_;
+    std::unique_ptr<SocketReceiveMultiplexer> mux_;
+    std::unique_ptr<IpEndpointName> destination_;
+    std::thread thread_;
+
+    std::vector<mec::Metrics::Sample> samples_;
+    std::map<std::string, int64_t> lastCounts_;
+    std::chrono::steady_clock::time_point lastTime_;
+    char buffer_[OUTPUT_BUFFER_SIZE];
+};
+
+#endif //MEC_METRICS_PUBLISHER_H
@@ -0,0 +1,107 @@
+#include "DisplayFrame.h"
+
+namespace Kontrol {
+
+DisplayFrame::DisplayFrame(unsigned lines, unsigned maxFps)
+        : lines_(lines), sentLines_(lines), changed_(false) {
+    this->maxFps(maxFps);
+}
+
+void DisplayFrame::maxFps(unsigned fps) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    interval_ = fps == 0 ? std::chrono::steady_clock::duration::zero()
+                         : std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::microseconds(1000000 / fps));
+}
+
+void DisplayFrame::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &l : lines_) l = Text();
+    changed_ = true;
+}
+
+void DisplayFrame::clearFields() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &f : fields_) f.second = Text();
+    changed_ = true;
+}
+
+void DisplayFrame::line(unsigned line, const std::string &text) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (line >= lines_.size()) return;
+    lines_[line].text_ = text;
+    changed_ = true;
+}
+
+void DisplayFrame::invert(unsigned line) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (line >= lines_.size()) return;
+    lines_[line].inverted_ = !lines_[line].inverted_;
+    changed_ = true;
+}
+
+void DisplayFrame::field(const std::string &name, const Text &text, bool shown) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fields_[name] = text;
+    if (shown) sentFields_[name] = text;
+    changed_ = true;
+}
+
+bool DisplayFrame::changed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return changed_;
+}
+
+DisplayFrame::Text DisplayFrame::line(unsigned line) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return line < lines_.size() ? lines_[line] : Text();
+}
+
+DisplayFrame::Text DisplayFrame::field(const std::string &name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto f = fields_.find(name);
+    return f != fields_.end() ? f->second : Text();
+}
+
+bool DisplayFrame::flush(Changes &changes, bool force, std::chrono::steady_clock::time_point now) {
+    changes.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!changed_) return false;
+    if (!force && now - lastFlush_ < interval_) return false;
+
+    for (unsigned i = 0; i < lines_.size(); i++) {
+        if (lines_[i] != sentLines_[i]) {
+            Changes::Line l;
+            l.line_ = i;
+            l.text_ = lines_[i];
+            l.previous_ = sentLines_[i];
+            changes.lines_.push_back(l);
+            sentLines_[i] = lines_[i];
+        }
+    }
+    for (const auto &f : fields_) {
+        // unsent fields are empty on the device
+        auto &sent = sentFields_[f.first];
+        if (sent != f.second) {
+            sent = f.second;
+            Changes::Field c;
+            c.name_ = f.first;
+            c.text_ = f.second;
+            changes.fields_.push_back(c);
+        }
+    }
+    if (!changes.lines_.empty()) changes.frame_ = sentLines_;
+    changed_ = false;
+    if (changes.empty()) return false;
+    lastFlush_ = now;
+    return true;
+}
+
+void DisplayFrame::invalidate() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &l : sentLines_) l = Text();
+    sentFields_.clear();
+    changed_ = true;
+}
+
+} //namespace
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Kontrol {
+
+// text display model, shared by the display backends (e.g. oscdisplay, nui, organelle, terminal tedium)
+// modes draw into the frame, as often as they like, only the frame changes
+// a flush returns the lines and fields which differ from the last flush, so only those are sent to the device,
+// flushes are capped at a maximum rate, changes are kept until the next flush
+// drawing and flushing may be on different threads
+class DisplayFrame {
+public:
+    struct Text {
+        Text() : inverted_(false), value_(0.0f) { ; }
+
+        std::string text_;
+        std::string aux_;    // secondary text, drawn with text_ (e.g. a unit)
+        bool inverted_;      // or selected
+        float value_;        // e.g. a controls position
+
+        bool operator==(const Text &t) const {
+            return inverted_ == t.inverted_ && value_ == t.value_ && text_ == t.text_ && aux_ == t.aux_;
+        }
+
+        bool operator!=(const Text &t) const { return !(*this == t); }
+    };
+
+    struct Changes {
+        struct Line {
+            unsigned line_;
+            Text text_;
+            Text previous_; // as last sent
+        };
+
+        struct Field {
+            std::string name_;
+            Text text_;
+        };
+
+        std::vector<Line> lines_;
+        std::vector<Field> fields_;
+        std::vector<Text> frame_; // all lines, as now sent, for devices which can only redraw everything
+
+        bool empty() const { return lines_.empty() && fields_.empty(); }
+
+        void clear() {
+            lines_.clear();
+            fields_.clear();
+        }
+    };
+
+    // maxFps = 0, is uncapped
+    explicit DisplayFrame(unsigned lines, unsigned maxFps = 0);
+
+    unsigned lines() const { return (unsigned) lines_.size(); }
+
+    void maxFps(unsigned fps);
+
+    // lines empty, and not inverted, fields are unchanged
+    void clear();
+    // fields empty
+    void clearFields();
+    // lines outside the frame are ignored
+    void line(unsigned line, const std::string &text);
+    // toggles, as the devices invert
+    void invert(unsigned line);
+    // shown, the device already shows this (e.g. a control on the device made the change), so it is not sent
+    void field(const std::string &name, const Text &text, bool shown = false);
+
+    // drawn since the last flush, though maybe unchanged
+    bool changed() const;
+
+    Text line(unsigned line) const;
+    Text field(const std::string &name) const;
+
+    // changes since the last flush, false if there are none, or the last flush was within the rate cap
+    bool flush(Changes &changes, bool force = false,
+               std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    // nothing has been sent, e.g. the device has (re)connected, so the next flush has all non empty lines and fields
+    void invalidate();
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<Text> lines_;
+    std::vector<Text> sentLines_;
+    std::map<std::string, Text> fields_;
+    std::map<std::string, Text> sentFields_;
+    bool changed_; // drawn since the last flush, (maybe to the same)
+    std::chrono::steady_clock::duration interval_;
+    std::chrono::steady_clock::time_point lastFlush_;
+};
+
+} //namespace
@@ -32,20 +32,25 @@ typedef std::string EntityId;
 class Entity {
 public:
     Entity(const EntityId& id, const std::string& displayName)
-        : id_(id), displayName_(displayName) {
+        : id_(id), displayName_(displayName), version_(0) {
         ;
     }
 
     const EntityId& id() const { return id_;};
 
+    // model version of the last change to this entity, see KontrolModel::version()
+    unsigned version() const { return version_;}
+    void version(unsigned v) { version_ = v;}
+
     virtual const std::string& displayName() const { return displayName_;};
     virtual bool valid() { return !id_.empty();}
 protected:
-    Entity() {;}
+    Entity() : version_(0) {;}
     virtual ~Entity() {;}
 
     EntityId id_;
     std::string displayName_;
+    unsigned version_;
 };
 
 class Page : public Entity {
@@ -0,0 +1,172 @@
+#include "FileWriter.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
+#include <mec_log.h>
+#include <mec_threads.h>
+
+namespace Kontrol {
+
+std::shared_ptr<FileWriter> FileWriter::writer() {
+    static std::shared_ptr<FileWriter> writer_;
+    if (!writer_) {
+        writer_ = std::shared_ptr<FileWriter>(new FileWriter());
+    }
+    return writer_;
+}
+
+FileWriter::~FileWriter() {
+    stop();
+}
+
+void *file_writer_thread_func(void *pWriter) {
+    mec::ThreadRegistration registration("kontrol.write");
+    FileWriter *pThis = static_cast<FileWriter *>(pWriter);
+    pThis->writePoll();
+    return nullptr;
+}
+
+void FileWriter::write(const std::string &file, const std::string &data) {
+    write(file, [data](std::string &out) {
+        out = data;
+        return true;
+    });
+}
+
+void FileWriter::write(const std::string &file, Producer producer) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto i = pending_.find(file);
+        if (i != pending_.end()) {
+            // not yet written, replace content, but keep its place in the queue
+            i->second = std::move(producer);
+        } else {
+            order_.push_back(file);
+            pending_[file] = std::move(producer);
+        }
+        if (!running_) {
+            running_ = true;
+            writer_thread_ = std::thread(file_writer_thread_func, this);
+        }
+    }
+    condition_.notify_all();
+}
+
+void FileWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this] { return order_.empty() && !writing_; });
+}
+
+void FileWriter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    condition_.notify_all();
+    // writer thread completes pending writes before exiting
+    if (writer_thread_.joinable()) writer_thread_.join();
+}
+
+FileWriter::SyncPolicy FileWriter::syncPolicy() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return syncPolicy_;
+}
+
+void FileWriter::syncPolicy(SyncPolicy p) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    syncPolicy_ = p;
+}
+
+void FileWriter::writePoll() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        condition_.wait(lock, [this] { return !running_ || !order_.empty(); });
+        if (order_.empty()) return; // stopped, and nothing left to write
+
+        std::string file = order_.front();
+        order_.pop_front();
+        Producer producer = std::move(pending_[file]);
+        pending_.erase(file);
+        SyncPolicy policy = syncPolicy_;
+        writing_ = true;
+        lock.unlock();
+
+        std::string data;
+        if (producer(data)) writeFile(file, data, policy);
+
+        lock.lock();
+        writing_ = false;
+        condition_.notify_all();
+    }
+}
+
+bool FileWriter::writeFile(const std::string &file, const std::string &data, SyncPolicy policy) {
+    std::string dir;
+    size_t sep = file.find_last_of('/');
+    if (sep != std::string::npos) {
+        // e.g. new preset directory
+        dir = file.substr(0, sep);
+        mkdir(dir.c_str(), S_IRWXU | S_IRWXG | S_IRWXO);
+    }
+
+    std::string tmpfile = file + ".tmp";
+#ifndef _WIN32
+    int fd = open(tmpfile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        LOG_0("FileWriter::writeFile unable to write " << tmpfile);
+        return false;
+    }
+    const char *p = data.data();
+    size_t remaining = data.size();
+    while (remaining > 0) {
+        ssize_t n = ::write(fd, p, remaining);
+        if (n <= 0) break;
+        p += n;
+        remaining -= (size_t) n;
+    }
+    bool ok = remaining == 0;
+    if (ok && policy != SYNC_NONE) ok = fsync(fd) == 0;
+    if (close(fd) != 0) ok = false;
+#else
+    bool ok;
+    {
+        std::ofstream outfile(tmpfile.c_str(), std::ios::binary | std::ios::trunc);
+        outfile.write(data.data(), data.size());
+        outfile.close();
+        ok = (bool) outfile;
+    }
+    // rename does not replace existing files on windows
+    if (ok) std::remove(file.c_str());
+#endif
+    if (!ok) {
+        LOG_0("FileWriter::writeFile error writing " << tmpfile);
+        std::remove(tmpfile.c_str());
+        return false;
+    }
+
+    if (std::rename(tmpfile.c_str(), file.c_str()) != 0) {
+        LOG_0("FileWriter::writeFile unable to rename " << tmpfile);
+        std::remove(tmpfile.c_str());
+        return false;
+    }
+
+#ifndef _WIN32
+    if (policy == SYNC_DIR) {
+        int dfd = open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+        if (dfd >= 0) {
+            fsync(dfd);
+            close(dfd);
+        }
+    }
+#endif
+    return true;
+}
+
+} //namespace
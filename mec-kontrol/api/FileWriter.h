@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+namespace Kontrol {
+
+// writes files on a background thread, so callers (e.g. pd scheduler thread) never wait on the disk
+// files are written to a temp file, synced and then renamed, so a partial file is never read
+// pending writes to the same file are coalesced, only the latest content is written
+// writes are done in the order first requested, so a file can depend on files requested before it
+class FileWriter {
+public:
+    // content is produced on the writer thread, return false to skip the write
+    typedef std::function<bool(std::string &data)> Producer;
+
+    enum SyncPolicy {
+        SYNC_NONE, // rename only, fastest, content may be lost on power loss
+        SYNC_FILE, // fsync file before rename, content is complete once renamed
+        SYNC_DIR   // also fsync directory, so the rename itself survives power loss
+    };
+
+    static std::shared_ptr<FileWriter> writer();
+
+    ~FileWriter();
+
+    void write(const std::string &file, const std::string &data);
+    void write(const std::string &file, Producer producer);
+
+    // blocks until all writes requested so far are on disk, used on shutdown
+    void flush();
+
+    SyncPolicy syncPolicy();
+    void syncPolicy(SyncPolicy p);
+
+    void writePoll();
+
+private:
+    FileWriter() : syncPolicy_(SYNC_FILE), running_(false), writing_(false) { ; }
+
+    static bool writeFile(const std::string &file, const std::string &data, SyncPolicy policy);
+    void stop();
+
+    std::mutex mutex_;
+    SyncPolicy syncPolicy_;
+    std::condition_variable condition_;
+    std::deque<std::string> order_; // pending files, in request order
+    std::unordered_map<std::string, Producer> pending_; // key = file
+    bool running_;
+    bool writing_;
+    std::thread writer_thread_;
+};
+
+} //namespace
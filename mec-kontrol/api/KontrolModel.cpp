@@ -1,6 +1,8 @@
 #include "KontrolModel.h"
 #include <mec_prefs.h>
 
+#include <chrono>
+
 namespace Kontrol {
 
 
@@ -16,7 +18,30 @@ std::shared_ptr<KontrolModel> KontrolModel::model() {
 //     model_.reset();
 // }
 
-KontrolModel::KontrolModel() {
+KontrolModel::KontrolModel() : version_(0), syncHorizon_(0) {
+    // never 0, which clients use for 'no version seen'
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    epoch_ = ((unsigned) std::chrono::duration_cast<std::chrono::seconds>(now).count() & 0x7fffffff) | 1;
+}
+
+void KontrolModel::touch(Entity &entity) const {
+    entity.version(++version_);
+}
+
+void KontrolModel::touch(Parameter &param) const {
+    param.version(++version_);
+}
+
+bool KontrolModel::canSync(unsigned epoch, unsigned version) const {
+    return epoch == epoch_ && version <= version_ && version >= syncHorizon_;
+}
+
+std::vector<EntityId> KontrolModel::deletedRacks(unsigned version) const {
+    std::vector<EntityId> ret;
+    for (const auto &d : deletedRacks_) {
+        if (d.second > version) ret.push_back(d.first);
+    }
+    return ret;
 }
 
 void KontrolModel::publishMetaData() const {
@@ -48,13 +73,13 @@ void KontrolModel::publishMetaData(const std::shared_ptr<Rack> &rack) const {
 void KontrolModel::publishMetaData(const std::shared_ptr<Rack> &rack, const std::shared_ptr<Module> &module) const {
     publishModule(CS_LOCAL, *rack, *module);
 
-    for (const auto &param: module->getParams()) {
+    for (const auto &param: module->params()) {
         publishParam(CS_LOCAL, *rack, *module, *param);
     }
     for (const auto &page: module->getPages()) {
         publishPage(CS_LOCAL, *rack, *module, *page);
     }
-    for (const auto &param: module->getParams()) {
+    for (const auto &param: module->params()) {
         publishChanged(CS_LOCAL, *rack, *module, *param);
     }
 
@@ -68,8 +93,7 @@ void KontrolModel::publishPreset(const std::shared_ptr<Rack> &rack) const {
 }
 
 
-std::shared_ptr<Rack> KontrolModel::createLocalRack(unsigned port) {
-    std::string host = "127.0.0.1";
+std::shared_ptr<Rack> KontrolModel::createLocalRack(unsigned port, const std::string &host) {
     auto rackId = Rack::createId(host, port);
 
     localRack_ = createRack(CS_LOCAL, rackId, host, port);
@@ -179,6 +203,7 @@ std::shared_ptr<Rack> KontrolModel::createRack(
     std::string desc = host;
     auto rack = std::make_shared<Rack>(host, port, desc);
     racks_[rack->id()] = rack;
+    touch(*rack);
 
     publishRack(src, *rack);
     return rack;
@@ -198,6 +223,8 @@ std::shared_ptr<Module> KontrolModel::createModule(
 
     auto module = std::make_shared<Module>(moduleId, displayName, type);
     rack->addModule(module);
+    touch(*module);
+    touch(*rack);
 
     publishModule(src, *rack, *module);
     return module;
@@ -217,6 +244,7 @@ std::shared_ptr<Page> KontrolModel::createPage(
 
     auto page = module->createPage(pageId, displayName, paramIds);
     if (page != nullptr) {
+        touch(*module);
         publishPage(src, *rack, *module, *page);
     }
     return page;
@@ -234,6 +262,8 @@ std::shared_ptr<Parameter> KontrolModel::createParam(
 
     auto param = module->createParam(args);
     if (param != nullptr) {
+        touch(*param);
+        touch(*module);
         publishParam(src, *rack, *module, *param);
     }
     return param;
@@ -247,6 +277,16 @@ void KontrolModel::deleteRack(ChangeSource src, const EntityId &rackId)
     auto rack = getRack(rackId);
     if (rack)
     {
+        deletedRacks_[rackId] = ++version_;
+        if (deletedRacks_.size() > MAX_DELETE_HISTORY) {
+            // forget the oldest deletion, clients older than this will need a full publish
+            auto oldest = deletedRacks_.begin();
+            for (auto d = deletedRacks_.begin(); d != deletedRacks_.end(); d++) {
+                if (d->second < oldest->second) oldest = d;
+            }
+            syncHorizon_ = oldest->second;
+            deletedRacks_.erase(oldest);
+        }
         for (const auto &i : listeners_) {
             (i.second)->deleteRack(src, *rack);
         }
@@ -273,6 +313,7 @@ void KontrolModel::createResource(ChangeSource src,
     auto rack = getRack(rackId);
     if (rack == nullptr) return;
     rack->addResource(resType, resValue);
+    touch(*rack);
     for (const auto &i : listeners_) {
         (i.second)->resource(src, *rack, resType, resValue);
     }
@@ -291,6 +332,7 @@ std::shared_ptr<Parameter> KontrolModel::changeParam(
     if (param == nullptr) return nullptr;
 
     if (module->changeParam(paramId, v, src == CS_PRESET)) {
+        touch(*param);
         publishChanged(src, *rack, *module, *param);
     }
     return param;
@@ -306,6 +348,7 @@ void KontrolModel::assignMidiCC(ChangeSource src, const EntityId &rackId, const
     auto module = getModule(rack, moduleId);
     auto param = getParam(module, paramId);
     if (param == nullptr) return;
+    touch(*module);
 
     for (const auto &i : listeners_) {
         (i.second)->assignMidiCC(src, *rack, *module, *param, midiCC);
@@ -336,6 +379,7 @@ void KontrolModel::unassignMidiCC(ChangeSource src, const EntityId &rackId, cons
     auto module = getModule(rack, moduleId);
     auto param = getParam(module, paramId);
     if (param == nullptr) return;
+    touch(*module);
 
     for (const auto &i : listeners_) {
         (i.second)->unassignMidiCC(src, *rack, *module, *param, midiCC);
@@ -357,6 +401,7 @@ void KontrolModel::assignModulation(ChangeSource src,
     auto module = getModule(rack, moduleId);
     auto param = getParam(module, paramId);
     if (param == nullptr) return;
+    touch(*module);
 
     for (const auto &i : listeners_) {
         (i.second)->assignModulation(src, *rack, *module, *param, bus);
@@ -377,6 +422,7 @@ void KontrolModel::unassignModulation(ChangeSource src,
     auto module = getModule(rack, moduleId);
     auto param = getParam(module, paramId);
     if (param == nullptr) return;
+    touch(*module);
 
     for (const auto &i : listeners_) {
         (i.second)->unassignModulation(src, *rack, *module, *param, bus);
@@ -394,6 +440,7 @@ void KontrolModel::savePreset(ChangeSource src, const EntityId &rackId, std::str
     } else {
         rack->currentPreset(preset);
     }
+    touch(*rack);
 
     for (const auto &i : listeners_) {
         (i.second)->savePreset(src, *rack, preset);
@@ -408,6 +455,7 @@ void KontrolModel::loadPreset(ChangeSource src, const EntityId &rackId, std::str
     } else {
         rack->currentPreset(preset);
     }
+    touch(*rack);
 
     for (const auto &i : listeners_) {
         (i.second)->loadPreset(src, *rack, preset);
@@ -436,6 +484,20 @@ void KontrolModel::ping(
     }
 }
 
+void KontrolModel::sync(
+        ChangeSource src,
+        const std::string &host,
+        unsigned port,
+        unsigned keepAlive,
+        unsigned epoch,
+        unsigned version,
+        unsigned lastEpoch,
+        unsigned lastVersion) const {
+    for (const auto &i : listeners_) {
+        (i.second)->sync(src, host, port, keepAlive, epoch, version, lastEpoch, lastVersion);
+    }
+}
+
 
 void KontrolModel::loadModule(ChangeSource src,
                               const EntityId &rackId,
@@ -522,8 +584,9 @@ bool KontrolModel::loadModuleDefinitions(const EntityId &rackId, const EntityId
     std::string file;
     if(filename.at(0)=='/') file = filename;
     else file=localRack()->mainDir() + "/" + filename;
-    mec::Preferences prefs(file);
-    return loadModuleDefinitions(rackId, moduleId, prefs);
+    auto rack = getRack(rackId);
+    if (rack == nullptr) return false;
+    return rack->loadModuleDefinitions(moduleId, file);
 }
 
 bool KontrolModel::loadModuleDefinitions(const EntityId &rackId, const EntityId &moduleId,
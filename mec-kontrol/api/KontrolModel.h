@@ -3,6 +3,7 @@
 #include <unordered_map>
 #include <string>
 #include <memory>
+#include <atomic>
 
 #include "Entity.h"
 #include "Rack.h"
@@ -33,6 +34,13 @@ public:
 
     virtual void ping(ChangeSource src, const std::string &host, unsigned port, unsigned keepAlive) { ; }
 
+    // ping which also carries the peers model version (epoch, version),
+    // then the version it last saw of our model (last epoch, last version, 0 = none)
+    virtual void sync(ChangeSource src, const std::string &host, unsigned port, unsigned keepAlive,
+                      unsigned, unsigned, unsigned, unsigned) {
+        ping(src, host, port, keepAlive);
+    }
+
     virtual void assignMidiCC(ChangeSource, const Rack &, const Module &, const Parameter &, unsigned midiCC) { ; }
     virtual void unassignMidiCC(ChangeSource, const Rack &, const Module &, const Parameter &, unsigned midiCC) { ; }
 
@@ -135,6 +143,27 @@ public:
     void activeModule(ChangeSource src, const EntityId &rackId ,const EntityId &moduleId);
 
     void ping(ChangeSource src, const std::string &host, unsigned port, unsigned keepAlive) const;
+    void sync(ChangeSource src, const std::string &host, unsigned port, unsigned keepAlive,
+              unsigned epoch, unsigned version, unsigned lastEpoch, unsigned lastVersion) const;
+
+    // versioning, every change to the model is stamped on the changed entity with an increasing version,
+    // the epoch identifies this model instance, so versions from a previous run are not mistaken as current
+    static const unsigned MAX_DELETE_HISTORY = 64;
+
+    unsigned epoch() const { return epoch_; }
+
+    unsigned version() const { return version_; }
+
+    // true if changes since version can be sent as a delta, rather than a full publish,
+    // requires same epoch, and version to be within the (rack deletion) history we have kept
+    bool canSync(unsigned epoch, unsigned version) const;
+
+    // racks deleted since version
+    std::vector<EntityId> deletedRacks(unsigned version) const;
+
+    // stamp an entity with a new version, for changes made outside the model (e.g. a rack applying a preset)
+    void touch(Entity &entity) const;
+    void touch(Parameter &param) const;
 
     void assignMidiCC(ChangeSource src,
                       const EntityId &rackId,
@@ -178,7 +207,8 @@ public:
     void midiLearn(ChangeSource src, bool b);
     void modulationLearn(ChangeSource src, bool b);
 
-    std::shared_ptr<Rack> createLocalRack(unsigned port);
+    // host, or a unix:/path endpoint (port 0) for a rack which listens on a unix socket
+    std::shared_ptr<Rack> createLocalRack(unsigned port, const std::string &host = "127.0.0.1");
 
     EntityId localRackId() { if (localRack_) return localRack_->id(); else return ""; }
 
@@ -201,10 +231,16 @@ private:
     void publishMetaData(const std::shared_ptr<Rack> &rack, const std::shared_ptr<Module> &module) const;
     void publishPreset(const std::shared_ptr<Rack> &rack) const;
 
+
     KontrolModel();
     std::shared_ptr<Rack> localRack_;
     std::unordered_map<EntityId, std::shared_ptr<Rack>> racks_;
     std::unordered_map<std::string, std::shared_ptr<KontrolCallback> > listeners_; // key = source : host:ip
+
+    unsigned epoch_;
+    mutable std::atomic<unsigned> version_;
+    std::unordered_map<EntityId, unsigned> deletedRacks_; // key = rack id, value = version when deleted
+    unsigned syncHorizon_; // oldest version we can still send a delta from
 };
 
 } //namespace
@@ -29,15 +29,25 @@ std::string Module::getParamId(const EntityId& pageId, unsigned paramNum) {
 std::shared_ptr<Parameter> Module::createParam(const std::vector<ParamValue> &args) {
     auto p = Parameter::create(args);
     if (p->valid()) {
-        parameters_[p->id()] = p;
+        auto i = paramIdx_.find(p->id());
+        if (i != paramIdx_.end()) {
+            p->attach(store_, i->second);
+            params_[i->second] = p;
+        } else {
+            unsigned slot = store_->add();
+            p->attach(store_, slot);
+            paramIdx_[p->id()] = slot;
+            params_.push_back(p);
+        }
         return p;
     }
     return nullptr;
 }
 
 bool Module::changeParam(const EntityId &paramId, const ParamValue &value, bool force) {
-    auto p = parameters_[paramId];
-    if (p != nullptr) {
+    auto i = paramIdx_.find(paramId);
+    if (i != paramIdx_.end()) {
+        const auto &p = params_[i->second];
         if (p->change(value, force)) {
             return true;
         }
@@ -71,13 +81,14 @@ std::shared_ptr<Page> Module::getPage(const EntityId &pageId) {
 }
 
 std::shared_ptr<Parameter> Module::getParam(const EntityId &paramId) {
-    return parameters_[paramId];
+    auto i = paramIdx_.find(paramId);
+    return i != paramIdx_.end() ? params_[i->second] : nullptr;
 }
 
 std::shared_ptr<Parameter> Module::getParam(const EntityId & paramId) const
 {
-    auto parameter = parameters_.find(paramId);
-    return parameter != parameters_.end() ? parameter->second : nullptr;
+    auto i = paramIdx_.find(paramId);
+    return i != paramIdx_.end() ? params_[i->second] : nullptr;
 }
 
 std::vector<std::shared_ptr<Page>> Module::getPages() {
@@ -90,18 +101,14 @@ std::vector<std::shared_ptr<Page>> Module::getPages() {
 }
 
 std::vector<std::shared_ptr<Parameter>> Module::getParams() {
-    std::vector<std::shared_ptr<Parameter>> ret;
-    for (const auto &p : parameters_) {
-        if (p.second != nullptr) ret.push_back(p.second);
-    }
-    return ret;
+    return params_;
 }
 
 std::vector<std::shared_ptr<Parameter>> Module::getParams(const std::shared_ptr<Page> &page) {
     std::vector<std::shared_ptr<Parameter>> ret;
     if (page != nullptr) {
         for (const auto &pid : page->paramIds()) {
-            auto param = parameters_[pid];
+            auto param = getParam(pid);
             if (param != nullptr) ret.push_back(param);
         }
     }
@@ -110,14 +117,17 @@ std::vector<std::shared_ptr<Parameter>> Module::getParams(const std::shared_ptr<
 
 
 bool Module::loadModuleDefinitions(const mec::Preferences &module) {
+    ModuleDefinition def;
+    if (!parseModuleDefinitions(module, def)) return false;
+    return loadModuleDefinitions(def);
+}
+
+bool Module::parseModuleDefinitions(const mec::Preferences &module, ModuleDefinition &def) {
     if (!module.valid()) return false;
 
-    displayName_ = module.getString("display");
-    parameters_.clear();
-    pages_.clear();
-    pageIds_.clear();
-    midi_mapping_.clear();
-    modulation_mapping_.clear();
+    def.displayName_ = module.getString("display");
+    def.params_.clear();
+    def.pages_.clear();
 
     if (module.exists("parameters")) {
         // load parameters
@@ -149,7 +159,7 @@ bool Module::loadModuleDefinitions(const mec::Preferences &module) {
                         break;
                 }
             }
-            createParam(args);
+            def.params_.push_back(std::move(args));
         }
     }
 
@@ -163,19 +173,39 @@ bool Module::loadModuleDefinitions(const mec::Preferences &module) {
             if (!page.valid()) return false;
 
             if (page.getSize() < 2) return false; // need id, displayname
-            auto id = page.getString(0);
-            std::string displayname = page.getString(1);
-            std::vector<std::string> paramIds;
+            ModuleDefinition::PageDefinition pagedef;
+            pagedef.id_ = page.getString(0);
+            pagedef.displayName_ = page.getString(1);
             mec::Preferences::Array paramArray(page.getArray(2));
             for (unsigned int j = 0; j < paramArray.getSize(); j++) {
-                paramIds.push_back(paramArray.getString(j));
+                pagedef.paramIds_.push_back(paramArray.getString(j));
             }
-            createPage(id, displayname, paramIds);
+            def.pages_.push_back(std::move(pagedef));
         }
     }
 
     return true;
+}
 
+bool Module::loadModuleDefinitions(const ModuleDefinition &def) {
+    displayName_ = def.displayName_;
+    store_ = std::make_shared<ParamStore>();
+    store_->reserve((unsigned) def.params_.size());
+    params_.clear();
+    params_.reserve(def.params_.size());
+    paramIdx_.clear();
+    pages_.clear();
+    pageIds_.clear();
+    midi_mapping_.clear();
+    modulation_mapping_.clear();
+
+    for (const auto &args : def.params_) {
+        createParam(args);
+    }
+    for (const auto &page : def.pages_) {
+        createPage(page.id_, page.displayName_, page.paramIds_);
+    }
+    return true;
 }
 
 void Module::dumpParameters() {
@@ -192,7 +222,7 @@ void Module::dumpParameters() {
         LOG_1(page->id());
         LOG_1(page->displayName());
         for (const std::string &paramId : page->paramIds()) {
-            auto param = parameters_[paramId];
+            auto param = getParam(paramId);
             if (param == nullptr) {
                 LOG_1("Parameter not found:" << paramId);
                 continue;
@@ -231,7 +261,7 @@ void Module::dumpCurrentValues() {
         LOG_1(page->id());
         LOG_1(page->displayName());
         for (const auto &paramId : page->paramIds()) {
-            auto param = parameters_[paramId];
+            auto param = getParam(paramId);
             if (param == nullptr) {
                 LOG_1("Parameter not found:" << paramId);
                 continue;
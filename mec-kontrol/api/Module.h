@@ -25,7 +25,7 @@ public:
     Module(const std::string &id,
            const std::string &displayName,
            const std::string &type)
-            : Entity(id, displayName), type_(type) {
+            : Entity(id, displayName), type_(type), store_(std::make_shared<ParamStore>()) {
         ;
     }
 
@@ -46,6 +46,10 @@ public:
     std::shared_ptr<Parameter> getParam(const EntityId &paramId) const;
     std::vector<std::shared_ptr<Page>> getPages();
     std::vector<std::shared_ptr<Parameter>> getParams();
+    // in definition order, params()[i] is the handle onto store() slot i
+    const std::vector<std::shared_ptr<Parameter>> &params() const { return params_; }
+    // parameter fields in parallel arrays, for bulk operations
+    const ParamStore &store() const { return *store_; }
     std::vector<std::shared_ptr<Parameter>> getParams(const std::shared_ptr<Page> &);
 
     // unsigned    getPageCount() { return pageIds_.size();}
@@ -57,6 +61,8 @@ public:
     std::string type() const { return type_; };
 
     bool loadModuleDefinitions(const mec::Preferences &prefs);
+    bool loadModuleDefinitions(const ModuleDefinition &def);
+    static bool parseModuleDefinitions(const mec::Preferences &prefs, ModuleDefinition &def);
     void dumpParameters();
     void dumpCurrentValues();
 
@@ -77,7 +83,9 @@ private:
     std::string type_;
 
     std::vector<std::string> pageIds_; // ordered list of page id, for presentation
-    std::unordered_map<std::string, std::shared_ptr<Parameter> > parameters_; // key = paramId
+    std::shared_ptr<ParamStore> store_; // replaced (not cleared) on reload, as old handles may still be held
+    std::vector<std::shared_ptr<Parameter> > params_; // definition order
+    std::unordered_map<std::string, unsigned> paramIdx_; // key = paramId, value = index in params_ and store_
     std::unordered_map<std::string, std::shared_ptr<Page> > pages_; // key = pageId
     MidiMap midi_mapping_; // key CC id, value = paramId
     ModulationMap modulation_mapping_; // key bus id, value = paramId
@@ -2,6 +2,11 @@
 
 #include <osc/OscOutboundPacketStream.h>
 #include <mec_log.h>
+#include <mec_metrics.h>
+#include <mec_threads.h>
+
+#include <algorithm>
+#include <cstring>
 
 namespace Kontrol {
 
@@ -15,7 +20,13 @@ OSCBroadcaster::OSCBroadcaster(Kontrol::ChangeSource src, unsigned keepAlive, bo
         port_(0),
         changeSource_(src),
         keepAliveTime_(keepAlive),
-        messageQueue_(OscMsg::MAX_N_OSC_MSGS) {
+        pool_({128, 256, 512, MAX_PACKET_SIZE}, MAX_N_OSC_MSGS),
+        messageQueue_(MAX_N_OSC_MSGS),
+        transferId_(0),
+        modulationRate_(MODULATION_RATE_MS),
+        modulationPending_(false),
+        peerEpoch_(0),
+        peerVersion_(0) {
 }
 
 OSCBroadcaster::~OSCBroadcaster() {
@@ -24,6 +35,7 @@ OSCBroadcaster::~OSCBroadcaster() {
 
 
 void *osc_broadcaster_write_thread_func(void *pBroadcaster) {
+    mec::ThreadRegistration registration("kontrol.send");
     OSCBroadcaster *pThis = static_cast<OSCBroadcaster *>(pBroadcaster);
     pThis->writePoll();
     return nullptr;
@@ -34,10 +46,16 @@ bool OSCBroadcaster::connect(const std::string &host, unsigned port) {
     try {
         host_ = host;
         port_ = port;
-        socket_ = std::shared_ptr<UdpTransmitSocket>(new UdpTransmitSocket(IpEndpointName(host.c_str(), port_)));
+        if (isUnixEndpoint(host)) {
+            unixSocket_ = std::make_shared<UnixTransmitSocket>(unixPath(host));
+        } else {
+            socket_ = std::shared_ptr<UdpTransmitSocket>(new UdpTransmitSocket(IpEndpointName(host.c_str(), port_)));
+        }
     } catch (const std::runtime_error &e) {
+        LOG_1("OSCBroadcaster::connect - unable to connect to " << host << " : " << e.what());
         port_ = 0;
         socket_.reset();
+        unixSocket_.reset();
         return false;
     }
     running_ = true;
@@ -52,33 +70,67 @@ bool OSCBroadcaster::connect(const std::string &host, unsigned port) {
 
 void OSCBroadcaster::stop() {
     running_ = false;
-    if (socket_) {
+    if (connected()) {
         writer_thread_.join();
         flush();
     }
     port_ = 0;
     socket_.reset();
+    unixSocket_.reset();
 }
 
 
+void OSCBroadcaster::transmit(const char *data, unsigned size) {
+    static mec::Counter &messages = mec::Metrics::counter("kontrol.send.messages");
+    static mec::Counter &bytes = mec::Metrics::counter("kontrol.send.bytes");
+    if (unixSocket_) {
+        unixSocket_->Send(data, size);
+    } else {
+        socket_->Send(data, size);
+    }
+    messages.inc();
+    bytes.inc(size);
+}
+
 void OSCBroadcaster::writePoll() {
     while (running_) {
-        OscMsg msg;
-        if (messageQueue_.wait_dequeue_timed(msg, std::chrono::milliseconds(POLL_TIMEOUT_MS))) {
-            socket_->Send(msg.buffer_, (size_t) msg.size_);
+        SlabPool::Buffer *msg = nullptr;
+        unsigned rate = modulationRate_;
+        unsigned timeout = rate > 0 ? std::min(rate, (unsigned) POLL_TIMEOUT_MS) : POLL_TIMEOUT_MS;
+        if (messageQueue_.wait_dequeue_timed(msg, std::chrono::milliseconds(timeout))) {
+            transmit(msg->data_.get(), msg->size_);
+            pool_.release(msg);
         }
+        flushModulation(false);
     }
 }
 
 void OSCBroadcaster::flush() {
-    OscMsg msg;
+    SlabPool::Buffer *msg = nullptr;
     while (messageQueue_.try_dequeue(msg)) {
-        socket_->Send(msg.buffer_, (size_t) msg.size_);
+        transmit(msg->data_.get(), msg->size_);
+        pool_.release(msg);
     }
+    flushModulation(true);
+}
+
+void OSCBroadcaster::flushModulation(bool force) {
+    std::lock_guard<std::mutex> lock(modulationMutex_);
+    if (pendingModulation_.empty()) return;
+
+    auto now = std::chrono::steady_clock::now();
+    if (!force && now - lastModulationFlush_ < std::chrono::milliseconds(modulationRate_.load())) return;
+    lastModulationFlush_ = now;
+
+    for (const auto &p : pendingModulation_) {
+        transmit(p.second.data(), (unsigned) p.second.size());
+    }
+    pendingModulation_.clear();
+    modulationPending_ = false;
 }
 
 bool OSCBroadcaster::isActive() {
-    if (!socket_) return false;
+    if (!connected()) return false;
     if (keepAliveTime_ == 0) return true;
 #ifdef __COBALT__
     struct timespec now;
@@ -98,29 +150,77 @@ bool OSCBroadcaster::isActive() {
 
 
 void OSCBroadcaster::send(const char *data, unsigned size) {
-//    {
-//        static unsigned maxsize = 0;
-//        if(size>maxsize) {
-//            maxsize = size;
-//            LOG_0("OSCBroadcaster MAXSIZE " << maxsize);
-//        }
-//    }
-    OscMsg msg;
-    msg.size_ = (size > OscMsg::MAX_OSC_MESSAGE_SIZE ? OscMsg::MAX_OSC_MESSAGE_SIZE : size);
-    memcpy(msg.buffer_, data, (size_t) msg.size_);
+    static mec::Counter &queued = mec::Metrics::counter("kontrol.send.queued");
+    static mec::Gauge &depth = mec::Metrics::gauge("kontrol.send.depth");
+    static mec::Gauge &buffers = mec::Metrics::gauge("kontrol.send.buffers");
+    if (size > MAX_PACKET_SIZE) {
+        sendChunked(data, size);
+        return;
+    }
+    SlabPool::Buffer *msg = pool_.acquire(size);
+    memcpy(msg->data_.get(), data, (size_t) size);
     messageQueue_.enqueue(msg);
+    queued.inc();
+    depth.set((int64_t) messageQueue_.size_approx());
+    buffers.set((int64_t) pool_.buffers());
+}
+
+// the message is split into /Kontrol/chunk packets, built directly in pooled buffers,
+// the receiver reassembles them, in one buffer, then parses the message as if it were received whole
+void OSCBroadcaster::sendChunked(const char *data, unsigned size) {
+    static mec::Counter &queued = mec::Metrics::counter("kontrol.send.queued");
+    static mec::Counter &chunked = mec::Metrics::counter("kontrol.send.chunked");
+    transferId_++;
+    for (unsigned offset = 0; offset < size; offset += CHUNK_SIZE) {
+        unsigned n = std::min(size - offset, (unsigned) CHUNK_SIZE);
+        SlabPool::Buffer *msg = pool_.acquire(MAX_PACKET_SIZE);
+        osc::OutboundPacketStream ops(msg->data_.get(), msg->capacity_);
+        ops << osc::BeginBundleImmediate
+            << osc::BeginMessage("/Kontrol/chunk")
+            << (int32_t) transferId_
+            << (int32_t) size
+            << (int32_t) offset
+            << osc::Blob(data + offset, (osc::osc_bundle_element_size_t) n)
+            << osc::EndMessage
+            << osc::EndBundle;
+        msg->size_ = (unsigned) ops.Size();
+        messageQueue_.enqueue(msg);
+        queued.inc();
+    }
+    chunked.inc();
 }
 
-void OSCBroadcaster::sendPing(unsigned port) {
-    if (!socket_) return;
+void OSCBroadcaster::sendPing(unsigned port, const std::string &endpoint) {
+    if (!connected()) return;
 
+    auto model = KontrolModel::model();
     osc::OutboundPacketStream ops(buffer_, OUTPUT_BUFFER_SIZE);
 
-    ops << osc::BeginBundleImmediate
-        << osc::BeginMessage("/Kontrol/ping")
-        << (int32_t) port
-        << (int32_t) keepAliveTime_
-        << osc::EndMessage
+    ops << osc::BeginBundleImmediate;
+    if (!isActive()) {
+        // peer is not receiving our changes, so don't let it think its up to date with our version
+        ops << osc::BeginMessage("/Kontrol/ping")
+            << (int32_t) port
+            << (int32_t) keepAliveTime_;
+    } else if (peerEpoch_ == 0) {
+        ops << osc::BeginMessage("/Kontrol/ping")
+            << (int32_t) port
+            << (int32_t) keepAliveTime_
+            << (int32_t) model->epoch()
+            << (int32_t) model->version();
+    } else {
+        // we have seen the peers model, so it only needs to send us changes since then
+        ops << osc::BeginMessage("/Kontrol/sync")
+            << (int32_t) port
+            << (int32_t) keepAliveTime_
+            << (int32_t) model->epoch()
+            << (int32_t) model->version()
+            << (int32_t) peerEpoch_
+            << (int32_t) peerVersion_;
+    }
+    // replies to our unix socket, rather than the senders address
+    if (!endpoint.empty()) ops << endpoint.c_str();
+    ops << osc::EndMessage
         << osc::EndBundle;
 
     send(ops.Data(), ops.Size());
@@ -131,9 +231,19 @@ bool OSCBroadcaster::broadcastChange(ChangeSource src) {
 }
 
 
+
 void OSCBroadcaster::ping(ChangeSource src, const std::string &host, unsigned port, unsigned keepAlive) {
+    sync(src, host, port, keepAlive, 0, 0, 0, 0);
+}
+
+void OSCBroadcaster::sync(ChangeSource src, const std::string &host, unsigned port, unsigned keepAlive,
+                          unsigned epoch, unsigned version, unsigned lastEpoch, unsigned lastVersion) {
     if ((port_ == port) && (host_ == host)) {
         changeSource_ = src;
+        if (epoch != 0) {
+            peerEpoch_ = epoch;
+            peerVersion_ = version;
+        }
 
         keepAliveTime_ = keepAlive;
         bool wasActive = isActive();
@@ -142,43 +252,30 @@ void OSCBroadcaster::ping(ChangeSource src, const std::string &host, unsigned po
 #else
         lastPing_ = std::chrono::steady_clock::now();
 #endif
+        auto model = KontrolModel::model();
+        bool delta = lastEpoch != 0 && model->canSync(lastEpoch, lastVersion);
         if (!master_) {
             if (!wasActive) {
 		// std::cerr << " !master : publishing meta data, from " << host  << ":" << port << std::endl;
-                KontrolModel::model()->publishMetaData();
+                if (delta) {
+                    publishDelta(lastVersion);
+                } else {
+                    model->publishMetaData();
+                }
             }
         } else {
             if (keepAliveTime_ == 0 || !wasActive) {
-
-                EntityId rackId = Rack::createId(host_, port_);
-                publishStart(CS_LOCAL, KontrolModel::model()->getRacks().size());
-                for (const auto &r:KontrolModel::model()->getRacks()) {
-                    if (rackId != r->id()) {
-                        std::cerr << " publishing meta data to " << rackId << " for " << r->id() << std::endl;
-                        rack(CS_LOCAL, *r);
-                        for (const auto &m : r->getModules()) {
-                            module(CS_LOCAL, *r, *m);
-                            for (const auto &p :  m->getParams()) {
-                                param(CS_LOCAL, *r, *m, *p);
-                            }
-                            for (const auto &p : m->getPages()) {
-                                if (p != nullptr) {
-                                    page(CS_LOCAL, *r, *m, *p);
-                                }
-                            }
-                            for (const auto &p :  m->getParams()) {
-                                changed(CS_LOCAL, *r, *m, *p);
-                            }
-                            for (const auto &midiMap : m->getMidiMapping()) {
-                                for (const auto &j : midiMap.second) {
-                                    auto parameter = m->getParam(j);
-                                    if (parameter) {
-                                        assignMidiCC(CS_LOCAL, *r, *m, *parameter, midiMap.first);
-                                    }
-                                }
-                            }
+                if (delta) {
+                    publishDelta(lastVersion);
+                } else {
+                    EntityId rackId = Rack::createId(host_, port_);
+                    publishStart(CS_LOCAL, model->getRacks().size());
+                    for (const auto &r : model->getRacks()) {
+                        if (rackId != r->id()) {
+                            LOG_1(" publishing meta data to " << rackId << " for " << r->id());
+                            publishRack(r, 0);
+                            publishRackFinished(CS_LOCAL, *r);
                         }
-                        publishRackFinished(CS_LOCAL, *r);
                     }
                 }
             }
@@ -186,6 +283,76 @@ void OSCBroadcaster::ping(ChangeSource src, const std::string &host, unsigned po
     }
 }
 
+static bool changedSince(const std::shared_ptr<Rack> &rack, unsigned version) {
+    if (rack->version() > version) return true;
+    for (const auto &m : rack->getModules()) {
+        if (m->version() > version) return true;
+        if (m->store().changedSince(version)) return true;
+    }
+    return false;
+}
+
+void OSCBroadcaster::publishDelta(unsigned since) {
+    auto model = KontrolModel::model();
+    EntityId rackId = Rack::createId(host_, port_);
+
+    for (const auto &id : model->deletedRacks(since)) {
+        if (id != rackId) sendDeleteRack(id);
+    }
+
+    std::vector<std::shared_ptr<Rack>> racks;
+    if (master_) {
+        for (const auto &r : model->getRacks()) {
+            if (rackId != r->id() && changedSince(r, since)) racks.push_back(r);
+        }
+    } else {
+        auto r = model->getLocalRack();
+        if (r && changedSince(r, since)) racks.push_back(r);
+    }
+
+    publishStart(CS_LOCAL, racks.size());
+    for (const auto &r : racks) {
+        publishRack(r, since);
+        publishRackFinished(CS_LOCAL, *r);
+    }
+}
+
+void OSCBroadcaster::publishRack(const std::shared_ptr<Rack> &r, unsigned since) {
+    // since = 0, everything, otherwise only entities changed since then
+    bool fullRack = since == 0 || r->version() > since;
+    if (fullRack) rack(CS_LOCAL, *r);
+    for (const auto &m : r->getModules()) {
+        if (fullRack || m->version() > since) {
+            module(CS_LOCAL, *r, *m);
+            for (const auto &p :  m->params()) {
+                param(CS_LOCAL, *r, *m, *p);
+            }
+            for (const auto &p : m->getPages()) {
+                if (p != nullptr) {
+                    page(CS_LOCAL, *r, *m, *p);
+                }
+            }
+            for (const auto &p :  m->params()) {
+                changed(CS_LOCAL, *r, *m, *p);
+            }
+            for (const auto &midiMap : m->getMidiMapping()) {
+                for (const auto &j : midiMap.second) {
+                    auto parameter = m->getParam(j);
+                    if (parameter) {
+                        assignMidiCC(CS_LOCAL, *r, *m, *parameter, midiMap.first);
+                    }
+                }
+            }
+        } else {
+            const auto &store = m->store();
+            const auto &params = m->params();
+            for (unsigned i = 0; i < store.size(); i++) {
+                if (store.versions_[i] > since) changed(CS_LOCAL, *r, *m, *params[i]);
+            }
+        }
+    }
+}
+
 void OSCBroadcaster::assignMidiCC(ChangeSource src, const Rack &rack, const Module &module, const Parameter &p,
                                   unsigned midiCC) {
     if (!broadcastChange(src)) return;
@@ -490,6 +657,21 @@ void OSCBroadcaster::changed(ChangeSource src, const Rack &rack, const Module &m
     ops << osc::EndMessage
         << osc::EndBundle;
 
+    if (modulationRate_ > 0) {
+        // modulation changes are coalesced, only the latest value is sent by the writer thread
+        if (src.type() == ChangeSource::MODULATION && ops.Size() <= MAX_PACKET_SIZE) {
+            std::lock_guard<std::mutex> lock(modulationMutex_);
+            pendingModulation_[&p].assign(ops.Data(), ops.Size());
+            modulationPending_ = true;
+            return;
+        }
+        // any other change supersedes pending modulation
+        if (modulationPending_) {
+            std::lock_guard<std::mutex> lock(modulationMutex_);
+            pendingModulation_.erase(&p);
+        }
+    }
+
     send(ops.Data(), ops.Size());
 }
 
@@ -516,11 +698,15 @@ void OSCBroadcaster::deleteRack(ChangeSource src, const Rack &rack) {
     if (!broadcastChange(src)) return;
     if (!isActive()) return;
 
+    sendDeleteRack(rack.id());
+}
+
+void OSCBroadcaster::sendDeleteRack(const EntityId &rackId) {
     osc::OutboundPacketStream ops(buffer_, OUTPUT_BUFFER_SIZE);
 
     ops << osc::BeginBundleImmediate
         << osc::BeginMessage("/Kontrol/deleteRack")
-        << rack.id().c_str();
+        << rackId.c_str();
 
     ops << osc::EndMessage
         << osc::EndBundle;
@@ -2,6 +2,8 @@
 
 #include "KontrolModel.h"
 #include "ChangeSource.h"
+#include "SlabPool.h"
+#include "UnixSocket.h"
 
 #include <memory>
 #include <ip/UdpSocket.h>
@@ -10,20 +12,29 @@
 #include <mutex>
 #include <readerwriterqueue.h>
 #include <condition_variable>
+#include <unordered_map>
+#include <atomic>
 
 namespace Kontrol {
 
 
 class OSCBroadcaster : public KontrolCallback {
 public:
-    static const unsigned int OUTPUT_BUFFER_SIZE = 1024;
+    // largest message, messages larger than MAX_PACKET_SIZE are sent as /Kontrol/chunk packets,
+    // reassembled by the receiver
+    static const unsigned int OUTPUT_BUFFER_SIZE = 65536;
+    static const unsigned int MAX_PACKET_SIZE = 1024;
+    static const unsigned int CHUNK_SIZE = MAX_PACKET_SIZE - 128; // chunk header
+    static const unsigned int MODULATION_RATE_MS = 50;
 
     OSCBroadcaster(Kontrol::ChangeSource src, unsigned keepAlive, bool master);
     ~OSCBroadcaster();
+    // host may be a unix:/path endpoint, with port 0
     bool connect(const std::string &host, unsigned port);
     void stop() override;
 
-    void sendPing(unsigned port);
+    // our receivers port, and endpoint if it listens on a unix socket
+    void sendPing(unsigned port, const std::string &endpoint = std::string());
 
     // KontrolCallback
     void rack(ChangeSource, const Rack &) override;
@@ -35,6 +46,8 @@ public:
     void deleteRack(ChangeSource, const Rack &) override;
     void activeModule(ChangeSource source, const Rack &rack, const Module &module) override;
     void ping(ChangeSource src, const std::string &host, unsigned port, unsigned keepAlive) override;
+    void sync(ChangeSource src, const std::string &host, unsigned port, unsigned keepAlive,
+              unsigned epoch, unsigned version, unsigned lastEpoch, unsigned lastVersion) override;
     void assignMidiCC(ChangeSource, const Rack &, const Module &, const Parameter &, unsigned midiCC) override;
     void unassignMidiCC(ChangeSource, const Rack &, const Module &, const Parameter &, unsigned midiCC) override;
     void savePreset(ChangeSource, const Rack &, std::string preset) override;
@@ -60,24 +73,32 @@ public:
 
     unsigned port() { return port_; }
 
+    // minimum interval between sending modulation changes, latest value per param is sent, 0 = unthrottled
+    unsigned modulationRate() { return modulationRate_; }
+
+    void modulationRate(unsigned ms) { modulationRate_ = ms; }
 
 protected:
     void send(const char *data, unsigned size);
+    void sendChunked(const char *data, unsigned size);
     bool broadcastChange(ChangeSource src);
 
 private:
+    bool connected() const { return socket_ || unixSocket_; }
+    void transmit(const char *data, unsigned size);
     void flush();
+    void flushModulation(bool force);
+    void publishDelta(unsigned since);
+    void publishRack(const std::shared_ptr<Rack> &rack, unsigned since);
+    void sendDeleteRack(const EntityId &rackId);
 
-    struct OscMsg {
-        static const int MAX_N_OSC_MSGS = 128;
-        static const int MAX_OSC_MESSAGE_SIZE = 512;
-        int size_;
-        char buffer_[MAX_OSC_MESSAGE_SIZE];
-    };
+    // initial buffers in each size class
+    static const unsigned MAX_N_OSC_MSGS = 128;
 
     std::string host_;
     unsigned int port_;
     std::shared_ptr<UdpTransmitSocket> socket_;
+    std::shared_ptr<UnixTransmitSocket> unixSocket_;
     char buffer_[OUTPUT_BUFFER_SIZE];
 #ifdef __COBALT__
     struct timespec lastPing_;
@@ -86,13 +107,26 @@ private:
 #endif
     unsigned keepAliveTime_;
 
-    moodycamel::BlockingReaderWriterQueue<OscMsg> messageQueue_;
+    // packets are built into buffer_, copied once into a pooled buffer and queued, the writer thread releases them
+    SlabPool pool_;
+    moodycamel::BlockingReaderWriterQueue<SlabPool::Buffer *> messageQueue_;
+    unsigned transferId_;
     bool master_;
 
     bool running_;
     std::thread writer_thread_;
 
     ChangeSource changeSource_;
+
+    std::atomic<unsigned> modulationRate_; // set on the caller (e.g. pd) thread, read by the writer
+    std::mutex modulationMutex_;
+    std::unordered_map<const Parameter *, std::string> pendingModulation_; // value = packet
+    std::atomic<bool> modulationPending_; // so other changes only lock when there may be something to supersede
+    std::chrono::steady_clock::time_point lastModulationFlush_;
+
+    // last model version seen from peer, 0 = none
+    unsigned peerEpoch_;
+    unsigned peerVersion_;
 };
 
 } //namespace
@@ -1,52 +1,41 @@
 #include "OSCReceiver.h"
+#include "OSCBroadcaster.h"
 
 #include <osc/OscReceivedElements.h>
 #include <osc/OscPacketListener.h>
 
 #include <mec_log.h>
+#include <mec_metrics.h>
+#include <mec_threads.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
 
 namespace Kontrol {
 
-class KontrolPacketListener : public PacketListener {
+class KontrolOSCListener : public osc::OscPacketListener {
 public:
-    KontrolPacketListener(moodycamel::ReaderWriterQueue<OSCReceiver::OscMsg>& queue) : queue_(queue) {
-    }
+    KontrolOSCListener(OSCReceiver &recv) : receiver_(recv), unixSender_(nullptr) { ; }
 
-    virtual void ProcessPacket(const char *data, int size,
-                               const IpEndpointName &remoteEndpoint) {
-
-//        {
-//            static unsigned maxsize = 0;
-//            if(size>maxsize) {
-//                maxsize = size;
-//                LOG_0("KontrolPacketListener MAXSIZE " << maxsize);
-//            }
-//        }
-        OSCReceiver::OscMsg msg;
-        msg.origin_ = remoteEndpoint;
-        msg.size_ = (size > OSCReceiver::OscMsg::MAX_OSC_MESSAGE_SIZE ? OSCReceiver::OscMsg::MAX_OSC_MESSAGE_SIZE
-                                                                      : size);
-        memcpy(msg.buffer_, data, (size_t) msg.size_);
-        queue_.enqueue(msg);
+    void process(const PacketReceiver::Packet &packet) {
+        unixSender_ = packet.sender_.empty() ? nullptr : &packet.sender_;
+        ProcessPacket(packet.data_.get(), (int) packet.size_, packet.origin_);
+        unixSender_ = nullptr;
     }
 
-private:
-    moodycamel::ReaderWriterQueue<OSCReceiver::OscMsg>& queue_;
-};
-
-
-class KontrolOSCListener : public osc::OscPacketListener {
-public:
-    KontrolOSCListener(OSCReceiver &recv) : receiver_(recv) { ; }
-
 
     virtual void ProcessMessage(const osc::ReceivedMessage &m,
                                 const IpEndpointName &remoteEndpoint) {
         try {
             char host[IpEndpointName::ADDRESS_STRING_LENGTH];
             remoteEndpoint.AddressAsString(host);
-            ChangeSource changedSrc = ChangeSource::createRemoteSource(host, remoteEndpoint.port);
+            // unix senders share an origin, they are told apart by their socket address
+            ChangeSource changedSrc = unixSender_ != nullptr
+                                      ? ChangeSource::createRemoteSource(unixEndpoint(*unixSender_), 0)
+                                      : ChangeSource::createRemoteSource(host, remoteEndpoint.port);
             // std::err << "received osc message: " << m.AddressPattern() << std::endl;
             if (std::strcmp(m.AddressPattern(), "/Kontrol/changed") == 0) {
                 osc::ReceivedMessage::const_iterator arg = m.ArgumentsBegin();
@@ -117,10 +106,44 @@ public:
                 osc::ReceivedMessage::const_iterator arg = m.ArgumentsBegin();
                 unsigned port = (unsigned) (arg++)->AsInt32();
                 unsigned keepAlive = 0;
-                if (arg != m.ArgumentsEnd()) {
+                if (arg != m.ArgumentsEnd() && arg->IsInt32()) {
                     keepAlive = (unsigned) (arg++)->AsInt32();
                 }
-                receiver_.ping(changedSrc, std::string(host), port, keepAlive);
+                // epoch and version come as a pair
+                bool versioned = false;
+                if (arg != m.ArgumentsEnd() && arg->IsInt32()) {
+                    osc::ReceivedMessage::const_iterator next = arg;
+                    ++next;
+                    versioned = next != m.ArgumentsEnd() && next->IsInt32();
+                }
+                unsigned epoch = 0, version = 0;
+                if (versioned) {
+                    // newer clients also send their model version
+                    epoch = (unsigned) (arg++)->AsInt32();
+                    version = (unsigned) (arg++)->AsInt32();
+                }
+                std::string replyHost = replyEndpoint(arg, m, host, port);
+                if (versioned) {
+                    receiver_.sync(changedSrc, replyHost, port, keepAlive, epoch, version, 0, 0);
+                } else {
+                    receiver_.ping(changedSrc, replyHost, port, keepAlive);
+                }
+            } else if (std::strcmp(m.AddressPattern(), "/Kontrol/sync") == 0) {
+                // port keepAlive epoch version lastEpoch lastVersion [endpoint]
+                static const unsigned SYNC_ARGS = 6;
+                unsigned values[SYNC_ARGS];
+                unsigned n = 0;
+                osc::ReceivedMessage::const_iterator arg = m.ArgumentsBegin();
+                while (n < SYNC_ARGS && arg != m.ArgumentsEnd() && arg->IsInt32()) {
+                    values[n++] = (unsigned) (arg++)->AsInt32();
+                }
+                if (n < SYNC_ARGS) {
+                    LOG_1("invalid /Kontrol/sync, expected " << SYNC_ARGS << " int args, from " << host);
+                } else {
+                    unsigned port = values[0];
+                    std::string replyHost = replyEndpoint(arg, m, host, port);
+                    receiver_.sync(changedSrc, replyHost, port, values[1], values[2], values[3], values[4], values[5]);
+                }
             } else if (std::strcmp(m.AddressPattern(), "/Kontrol/activeModule") == 0) {
                     osc::ReceivedMessage::const_iterator arg = m.ArgumentsBegin();
                     const char *rackId = (arg++)->AsString();
@@ -205,20 +228,126 @@ public:
                 osc::ReceivedMessage::const_iterator arg = m.ArgumentsBegin();
                 bool b = (arg++)->AsBool();
                 receiver_.modulationLearn(changedSrc, b);
+            } else if (std::strcmp(m.AddressPattern(), "/Kontrol/chunk") == 0) {
+                osc::ReceivedMessage::const_iterator arg = m.ArgumentsBegin();
+                int32_t id = (arg++)->AsInt32();
+                int32_t size = (arg++)->AsInt32();
+                int32_t offset = (arg++)->AsInt32();
+                const void *data;
+                osc::osc_bundle_element_size_t n;
+                (arg++)->AsBlob(data, n);
+                chunk(remoteEndpoint, id, size, offset, static_cast<const char *>(data), n);
             }
         } catch (osc::Exception &e) {
+            static mec::Counter &errors = mec::Metrics::counter("kontrol.recv.errors");
+            errors.inc();
             // std::err << "error while parsing message: "
             //     << m.AddressPattern() << ": " << e.what() << "\n";
         }
     }
 
 private:
+    // clients listening on a unix socket, send it after the ping arguments, they are replied to there, port = 0
+    static std::string replyEndpoint(osc::ReceivedMessage::const_iterator &arg, const osc::ReceivedMessage &m,
+                                     const char *host, unsigned &port) {
+        if (arg != m.ArgumentsEnd() && arg->IsString()) {
+            port = 0;
+            return std::string((arg++)->AsString());
+        }
+        return std::string(host);
+    }
+
+    // a message sent in chunks of CHUNK_SIZE, reassembled in place
+    struct Transfer {
+        Transfer() : id_(0), size_(0), missing_(0) { ; }
+
+        int32_t id_;
+        int32_t size_;
+        unsigned missing_; // chunks yet to arrive, 0 = complete
+        std::vector<bool> chunks_; // arrived, by chunk index
+        std::vector<char> data_;
+        std::chrono::steady_clock::time_point last_;
+    };
+
+    static const int32_t MAX_TRANSFER_SIZE = 1024 * 1024;
+    static const int32_t CHUNK_SIZE = OSCBroadcaster::CHUNK_SIZE;
+    static const unsigned TRANSFER_TIMEOUT_MS = 2000;
+
+    void chunk(const IpEndpointName &origin, int32_t id, int32_t size, int32_t offset, const char *data, int32_t n) {
+        static mec::Counter &transfers = mec::Metrics::counter("kontrol.recv.chunked");
+        static mec::Counter &dropped = mec::Metrics::counter("kontrol.recv.chunks.dropped");
+        static mec::Counter &duplicates = mec::Metrics::counter("kontrol.recv.chunks.duplicate");
+        if (size <= 0 || size > MAX_TRANSFER_SIZE || offset < 0 || offset >= size || offset % CHUNK_SIZE != 0
+            || n != std::min(size - offset, CHUNK_SIZE)) {
+            dropped.inc();
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        std::string key = unixSender_ != nullptr
+                          ? *unixSender_
+                          : std::to_string(((uint64_t) origin.address << 16) | (uint64_t) (origin.port & 0xffff));
+        auto it = transfers_.find(key);
+        if (it == transfers_.end() || it->second.id_ != id || it->second.size_ != size) {
+            // a new transfer, replaces an incomplete one from the sender, which has lost chunks
+            if (it != transfers_.end()) {
+                if (it->second.missing_ > 0) dropped.inc();
+                transfers_.erase(it);
+            }
+            expire(now);
+            Transfer &t = transfers_[key];
+            unsigned nchunks = (unsigned) ((size + CHUNK_SIZE - 1) / CHUNK_SIZE);
+            t.id_ = id;
+            t.size_ = size;
+            t.missing_ = nchunks;
+            t.chunks_.assign(nchunks, false);
+            t.data_.resize((size_t) size);
+            it = transfers_.find(key);
+        }
+        Transfer &t = it->second;
+        unsigned idx = (unsigned) (offset / CHUNK_SIZE);
+        if (t.missing_ == 0 || t.chunks_[idx]) {
+            duplicates.inc();
+            return;
+        }
+        memcpy(t.data_.data() + offset, data, (size_t) n);
+        t.chunks_[idx] = true;
+        t.last_ = now;
+        if (--t.missing_ > 0) return;
+
+        transfers.inc();
+        // complete, the buffers are released, the id is kept to drop late duplicates
+        std::vector<char> msg;
+        msg.swap(t.data_);
+        std::vector<bool>().swap(t.chunks_);
+        ProcessPacket(msg.data(), (int) msg.size(), origin);
+    }
+
+    // releases transfers which have not received a chunk for a while, e.g. the sender has gone
+    void expire(std::chrono::steady_clock::time_point now) {
+        static mec::Counter &dropped = mec::Metrics::counter("kontrol.recv.chunks.dropped");
+        for (auto it = transfers_.begin(); it != transfers_.end();) {
+            if (now - it->second.last_ > std::chrono::milliseconds(TRANSFER_TIMEOUT_MS)) {
+                if (it->second.missing_ > 0) dropped.inc();
+                it = transfers_.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+
     OSCReceiver &receiver_;
+    const std::string *unixSender_; // of the packet being processed, nullptr for udp
+    std::unordered_map<std::string, Transfer> transfers_; // key = unix sender, or udp address and port
 };
 
+const int32_t KontrolOSCListener::MAX_TRANSFER_SIZE;
+const int32_t KontrolOSCListener::CHUNK_SIZE;
+const unsigned KontrolOSCListener::TRANSFER_TIMEOUT_MS;
+
 OSCReceiver::OSCReceiver(const std::shared_ptr<KontrolModel> &param)
-        : model_(param), port_(0), messageQueue_(OscMsg::MAX_N_OSC_MSGS) {
-    packetListener_ = std::make_shared<KontrolPacketListener>(messageQueue_);
+        : model_(param),
+          receiver_("kontrol.recv", MAX_N_OSC_MSGS, MAX_OSC_MESSAGE_SIZE),
+          pending_(nullptr) {
     oscListener_ = std::make_shared<KontrolOSCListener>(*this);
 }
 
@@ -226,45 +355,49 @@ OSCReceiver::~OSCReceiver() {
     stop();
 }
 
-void *osc_receiver_read_thread_func(void *pReceiver) {
-    auto *pThis = static_cast<OSCReceiver *>(pReceiver);
-    pThis->socket()->Run();
-    return nullptr;
+bool OSCReceiver::listen(unsigned port) {
+    return receiver_.listen(port);
 }
 
-bool OSCReceiver::listen(unsigned port) {
-    stop();
-    port_ = port;
-    try {
-        socket_ = std::make_shared<UdpListeningReceiveSocket>(
-                IpEndpointName(IpEndpointName::ANY_ADDRESS, port_),
-                packetListener_.get());
-
-        receive_thread_ = std::thread(osc_receiver_read_thread_func, this);
-    } catch (const std::runtime_error &e) {
+bool OSCReceiver::listen(const std::string &endpoint) {
+    if (!isUnixEndpoint(endpoint)) {
+        LOG_1("OSCReceiver::listen - not a unix endpoint " << endpoint);
         return false;
     }
-    return true;
+    return receiver_.listenUnix(unixPath(endpoint));
+}
+
+std::string OSCReceiver::endpoint() const {
+    std::string path = receiver_.path();
+    return path.empty() ? path : unixEndpoint(path);
 }
 
 void OSCReceiver::stop() {
-    if (socket_) {
-        socket_->AsynchronousBreak();
-        receive_thread_.join();
-        OscMsg msg;
-        while(messageQueue_.try_dequeue(msg));
-    }
-    port_ = 0;
-    socket_.reset();
+    receiver_.stop();
+}
+
+// parsed in place, from the receive buffer
+void OSCReceiver::process(PacketReceiver::Packet *packet) {
+    oscListener_->process(*packet);
+    receiver_.release(packet);
 }
 
 void OSCReceiver::poll() {
-    OscMsg msg;
-    while (messageQueue_.try_dequeue(msg)) {
-        oscListener_->ProcessPacket(msg.buffer_, msg.size_, msg.origin_);
+    if (pending_ != nullptr) {
+        process(pending_);
+        pending_ = nullptr;
+    }
+    PacketReceiver::Packet *packet;
+    while ((packet = receiver_.next()) != nullptr) {
+        process(packet);
     }
 }
 
+bool OSCReceiver::wait(std::chrono::microseconds timeout) {
+    if (pending_ == nullptr) pending_ = receiver_.wait(timeout);
+    return pending_ != nullptr;
+}
+
 void OSCReceiver::createRack(
         ChangeSource src,
         const EntityId &rackId,
@@ -333,6 +466,17 @@ void OSCReceiver::ping(ChangeSource src,
     model_->ping(src, host, port, keepalive);
 }
 
+void OSCReceiver::sync(ChangeSource src,
+                       const std::string &host,
+                       unsigned port,
+                       unsigned keepalive,
+                       unsigned epoch,
+                       unsigned version,
+                       unsigned lastEpoch,
+                       unsigned lastVersion) {
+    model_->sync(src, host, port, keepalive, epoch, version, lastEpoch, lastVersion);
+}
+
 void OSCReceiver::activeModule(ChangeSource src,
                     const EntityId &rackId,
                     const EntityId &moduleId) {
@@ -1,27 +1,32 @@
 #pragma once
 
 #include "KontrolModel.h"
+#include <chrono>
 #include <thread>
 #include <memory>
 
-#include <ip/UdpSocket.h>
-#include <readerwriterqueue.h>
+#include "PacketReceiver.h"
 
 namespace Kontrol {
 
 
 class KontrolOSCListener;
 
-class KontrolPacketListener;
-
 
 class OSCReceiver {
 public:
     OSCReceiver(const std::shared_ptr<KontrolModel> &param);
     ~OSCReceiver();
     bool listen(unsigned port = 9000);
+    // unix:/path, AF_UNIX datagrams, for same host clients
+    bool listen(const std::string &endpoint);
+    // processes received packets, non blocking, for hosts which poll on their own clock (e.g. pd)
     void poll();
+    // blocks until a packet is received, or the timeout, true if there is a packet to poll
+    // (for a thread which only handles packets, so changes are applied as they arrive)
+    bool wait(std::chrono::microseconds timeout);
 
+    // also wakes a waiting thread
     void stop();
 
     void createRack(
@@ -75,6 +80,8 @@ public:
                         const EntityId &moduleId);
 
     void ping(ChangeSource src, const std::string &host, unsigned port, unsigned keepalive);
+    void sync(ChangeSource src, const std::string &host, unsigned port, unsigned keepalive,
+              unsigned epoch, unsigned version, unsigned lastEpoch, unsigned lastVersion);
 
     void assignMidiCC(ChangeSource src,
                       const EntityId &rackId,
@@ -118,28 +125,22 @@ public:
     void midiLearn(ChangeSource src, bool b);
     void modulationLearn(ChangeSource src, bool b);
 
-    unsigned int port() { return port_; }
+    unsigned int port() { return receiver_.port(); }
 
-    std::shared_ptr<UdpListeningReceiveSocket> socket() { return socket_; }
+    // unix:/path, if listening on a unix socket, otherwise empty
+    std::string endpoint() const;
 
 private:
-    friend class KontrolPacketListener;
+    // initial receive buffers, more are added if needed
+    static const unsigned MAX_N_OSC_MSGS = 128;
+    static const unsigned MAX_OSC_MESSAGE_SIZE = 2048;
 
-    struct OscMsg {
-        static const int MAX_N_OSC_MSGS = 128;
-        static const int MAX_OSC_MESSAGE_SIZE = 512;
-        IpEndpointName origin_;
-        int size_;
-        char buffer_[MAX_OSC_MESSAGE_SIZE];
-    };
+    void process(PacketReceiver::Packet *packet);
 
     std::shared_ptr<KontrolModel> model_;
-    unsigned int port_;
-    std::thread receive_thread_;
-    std::shared_ptr<UdpListeningReceiveSocket> socket_;
-    std::shared_ptr<PacketListener> packetListener_;
+    PacketReceiver receiver_;
     std::shared_ptr<KontrolOSCListener> oscListener_;
-    moodycamel::ReaderWriterQueue<OscMsg> messageQueue_;
+    PacketReceiver::Packet *pending_; // received by wait, processed by the next poll
 };
 
 } //namespace
\ No newline at end of file
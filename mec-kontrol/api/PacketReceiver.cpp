@@ -0,0 +1,228 @@
+#include "PacketReceiver.h"
+
+#include <algorithm>
+#include <cerrno>
+
+#include <mec_log.h>
+#include <mec_metrics.h>
+#include <mec_threads.h>
+
+namespace Kontrol {
+
+// stop resends its wake, until the receive thread has exited
+static const std::chrono::milliseconds WAKE_RETRY(50);
+// receive errors back off, up to
+static const unsigned MAX_BACKOFF_MS = 1000;
+
+const unsigned PacketReceiver::MAX_GROWTH;
+
+PacketReceiver::PacketReceiver(const std::string &name, unsigned count, unsigned size)
+        : name_(name),
+          bufferSize_(size),
+          maxCount_(std::max(count, 1u) * MAX_GROWTH),
+          port_(0),
+          running_(false),
+          exited_(true),
+          free_(count),
+          received_(count) {
+    overflow_.size_ = 0;
+    overflow_.data_.reset(new char[bufferSize_ + 1]);
+    for (unsigned i = 0; i < count; i++) {
+        spare_.push_back(acquire());
+    }
+}
+
+PacketReceiver::~PacketReceiver() {
+    stop();
+}
+
+void *packet_receiver_thread_func(void *pReceiver) {
+    auto *pThis = static_cast<PacketReceiver *>(pReceiver);
+    pThis->run();
+    return nullptr;
+}
+
+bool PacketReceiver::listen(unsigned port) {
+    stop();
+    drain();
+    try {
+        socket_ = std::make_shared<UdpReceiveSocket>(IpEndpointName(IpEndpointName::ANY_ADDRESS, port));
+    } catch (const std::runtime_error &e) {
+        LOG_1("PacketReceiver::listen - unable to listen on " << port << " : " << e.what());
+        return false;
+    }
+    port_ = port;
+    running_ = true;
+    exited_ = false;
+    thread_ = std::thread(packet_receiver_thread_func, this);
+    return true;
+}
+
+bool PacketReceiver::listenUnix(const std::string &path) {
+    stop();
+    drain();
+    try {
+        unixSocket_ = std::make_shared<UnixReceiveSocket>(path);
+    } catch (const std::runtime_error &e) {
+        LOG_1("PacketReceiver::listenUnix - unable to listen on " << path << " : " << e.what());
+        return false;
+    }
+    running_ = true;
+    exited_ = false;
+    thread_ = std::thread(packet_receiver_thread_func, this);
+    return true;
+}
+
+// the receive thread may be blocked in recv, so wake it with an empty packet
+void PacketReceiver::wake() {
+    try {
+        if (unixSocket_) {
+            UnixTransmitSocket wake(unixSocket_->path());
+            wake.Send("", 0);
+        } else {
+            UdpTransmitSocket wake(IpEndpointName("127.0.0.1", port_));
+            wake.Send("", 0);
+        }
+    } catch (const std::runtime_error &e) {
+        LOG_1("PacketReceiver::stop - unable to wake receive thread : " << e.what());
+    }
+}
+
+void PacketReceiver::stop() {
+    if (!socket_ && !unixSocket_) return;
+    running_ = false;
+    // a wake may be lost (or not sent), so it is resent until the thread exits
+    // unix sockets also time out their receive, see UnixReceiveSocket
+    auto resend = std::chrono::steady_clock::now();
+    unsigned wakes = 0;
+    while (!exited_) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= resend) {
+            if (wakes == 1) LOG_1("PacketReceiver::stop - " << name_ << " not woken, resending");
+            wake();
+            wakes++;
+            resend = now + WAKE_RETRY;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    thread_.join();
+    socket_.reset();
+    unixSocket_.reset();
+    port_ = 0;
+}
+
+// not listening, so the receive thread has exited
+void PacketReceiver::drain() {
+    Packet *p = nullptr;
+    while (received_.try_dequeue(p)) {
+        if (p != nullptr) spare_.push_back(p);
+    }
+    while (free_.try_dequeue(p)) spare_.push_back(p);
+}
+
+// a spare buffer, those released by the consumer, or a new one, up to the limit
+PacketReceiver::Packet *PacketReceiver::acquire() {
+    if (spare_.empty()) {
+        Packet *p = nullptr;
+        while (free_.try_dequeue(p)) spare_.push_back(p);
+    }
+    if (!spare_.empty()) {
+        Packet *p = spare_.back();
+        spare_.pop_back();
+        return p;
+    }
+    if (packets_.size() >= maxCount_) return nullptr;
+    std::unique_ptr<Packet> p(new Packet);
+    p->size_ = 0;
+    // one spare byte, to detect packets which are too large
+    p->data_.reset(new char[bufferSize_ + 1]);
+    packets_.push_back(std::move(p));
+    return packets_.back().get();
+}
+
+// one spare byte, so a packet which is too large is truncated to more than bufferSize_
+// both return 0 on a failed recv, leaving its errno
+std::size_t PacketReceiver::receive(Packet *p, int &err) {
+    std::size_t size;
+    errno = 0;
+    if (unixSocket_) {
+        size = unixSocket_->ReceiveFrom(p->origin_, p->sender_, p->data_.get(), bufferSize_ + 1);
+    } else {
+        size = socket_->ReceiveFrom(p->origin_, p->data_.get(), bufferSize_ + 1);
+        p->sender_.clear();
+    }
+    err = size == 0 ? errno : 0;
+    // a receive timeout, or a signal, is not an error
+    if (err == EAGAIN || err == EWOULDBLOCK || err == EINTR) err = 0;
+    return size;
+}
+
+void PacketReceiver::run() {
+    mec::ThreadRegistration registration(name_);
+    mec::Counter &packets = mec::Metrics::counter(name_ + ".packets");
+    mec::Counter &dropped = mec::Metrics::counter(name_ + ".dropped");
+    mec::Gauge &depth = mec::Metrics::gauge(name_ + ".depth");
+    mec::Gauge &buffers = mec::Metrics::gauge(name_ + ".buffers");
+    mec::Counter &full = mec::Metrics::counter(name_ + ".full");
+    mec::Counter &errors = mec::Metrics::counter(name_ + ".errors");
+
+    Packet *p = acquire();
+    unsigned backoff = 0; // ms
+    while (running_) {
+        // at the limit, so received into overflow and dropped, until the consumer releases buffers
+        if (p == nullptr) p = acquire();
+        Packet *into = p != nullptr ? p : &overflow_;
+        int err = 0;
+        into->size_ = (unsigned) receive(into, err);
+        if (!running_) continue;
+        if (err != 0) {
+            // e.g. the socket has failed, so don't spin on it
+            errors.inc();
+            if (backoff == 0) LOG_0("PacketReceiver " << name_ << " receive error " << err);
+            backoff = std::min(std::max(backoff * 2, 1u), MAX_BACKOFF_MS);
+            std::this_thread::sleep_for(std::chrono::milliseconds(backoff));
+            continue;
+        }
+        backoff = 0;
+        if (into->size_ == 0) continue;
+        if (into->size_ > bufferSize_) {
+            dropped.inc();
+            continue;
+        }
+        if (p == nullptr) {
+            full.inc();
+            continue;
+        }
+        received_.enqueue(p);
+        packets.inc();
+        depth.set((int64_t) received_.size_approx());
+        buffers.set((int64_t) packets_.size());
+        if (notify_) notify_();
+        p = acquire();
+    }
+    if (p != nullptr) spare_.push_back(p);
+    // wakes the consumer
+    received_.enqueue(nullptr);
+    if (notify_) notify_();
+    exited_ = true;
+}
+
+PacketReceiver::Packet *PacketReceiver::next() {
+    Packet *p = nullptr;
+    while (received_.try_dequeue(p)) {
+        if (p != nullptr) return p;
+    }
+    return nullptr;
+}
+
+PacketReceiver::Packet *PacketReceiver::wait(std::chrono::microseconds timeout) {
+    Packet *p = nullptr;
+    if (received_.wait_dequeue_timed(p, timeout)) return p;
+    return nullptr;
+}
+
+void PacketReceiver::release(Packet *packet) {
+    if (packet != nullptr) free_.enqueue(packet);
+}
+
+} //namespace
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ip/UdpSocket.h>
+#include <readerwriterqueue.h>
+
+#include "UnixSocket.h"
+
+namespace Kontrol {
+
+// udp (or unix datagram) packets, received on their own thread, straight into pooled buffers
+// only the buffer is queued, the consumer parses it in place, then releases it back to the pool,
+// so a packet is never copied
+// one consumer thread, the pool grows if all its buffers are in use (e.g. a burst as a rack is published),
+// up to MAX_GROWTH times its initial count, then packets are dropped until buffers are released
+class PacketReceiver {
+public:
+    struct Packet {
+        IpEndpointName origin_;
+        std::string sender_; // unix sending socket, which identifies it (origin is shared), empty for udp
+        unsigned size_;
+        std::unique_ptr<char[]> data_;
+    };
+
+    static const unsigned MAX_GROWTH = 8;
+
+    // name, of the receive thread and its metrics (e.g. kontrol.recv)
+    // packets larger than size are dropped
+    PacketReceiver(const std::string &name, unsigned count, unsigned size);
+    ~PacketReceiver();
+
+    bool listen(unsigned port);
+    // AF_UNIX datagrams, for same host clients
+    bool listenUnix(const std::string &path);
+    // also wakes a consumer in wait
+    void stop();
+
+    bool listening() const { return running_; }
+
+    unsigned port() const { return port_; }
+
+    // unix socket path, empty for udp
+    std::string path() const { return unixSocket_ ? unixSocket_->path() : std::string(); }
+
+    unsigned bufferSize() const { return bufferSize_; }
+
+    // called on the receive thread, after a packet is queued (e.g. to wake the consumer), set before listen
+    void notify(const std::function<void()> &fn) { notify_ = fn; }
+
+    // consumer, packets must be released once parsed
+    Packet *next();
+    // nullptr on timeout, or stop
+    Packet *wait(std::chrono::microseconds timeout);
+    void release(Packet *packet);
+
+private:
+    friend void *packet_receiver_thread_func(void *);
+    void run();
+    // 0 on a wake, or a receive error (err set, 0 if none)
+    std::size_t receive(Packet *p, int &err);
+    // nullptr if the pool is at its limit
+    Packet *acquire();
+    void wake();
+    // before a (re)listen, queued packets (and stop's wake) are returned to the pool
+    void drain();
+
+    std::string name_;
+    unsigned bufferSize_;
+    unsigned maxCount_;
+    unsigned port_;
+    std::atomic<bool> running_;
+    std::atomic<bool> exited_; // receive thread
+    std::shared_ptr<UdpReceiveSocket> socket_;
+    std::shared_ptr<UnixReceiveSocket> unixSocket_;
+    std::thread thread_;
+    std::function<void()> notify_;
+
+    std::vector<std::unique_ptr<Packet>> packets_; // all of them, grown by the receive thread
+    Packet overflow_;                              // received into, and dropped, when the pool is at its limit
+    std::vector<Packet *> spare_;                  // receive thread
+    moodycamel::ReaderWriterQueue<Packet *> free_; // consumer to receive thread
+    moodycamel::BlockingReaderWriterQueue<Packet *> received_;
+};
+
+} //namespace
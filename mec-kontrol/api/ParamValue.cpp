@@ -1,7 +1,63 @@
 #include "ParamValue.h"
 
+#include <atomic>
+#include <functional>
+#include <mutex>
+
 namespace Kontrol {
 
+// string values are rare (e.g. file names), so are kept for the life of the process,
+// a ParamValue holds no reference count, so an entry can never be known to be unused.
+// already interned strings are found without locking, in an open addressed table whose
+// slots are only ever filled, the lock is taken only to add a new string.
+// the table is bounded, so free form values (e.g. from osc) can't grow it,
+// once full, strings are held by their values instead
+static const unsigned INTERN_SLOTS = 4096;
+static const unsigned INTERN_PROBES = 32; // beyond this, strings are not interned
+static std::atomic<const std::string *> internSlots[INTERN_SLOTS];
+
+static const std::string *internFind(const std::string &value, std::size_t hash, unsigned &slot) {
+    for (unsigned i = 0; i < INTERN_PROBES; i++) {
+        slot = (unsigned) ((hash + i) % INTERN_SLOTS);
+        const std::string *s = internSlots[slot].load(std::memory_order_acquire);
+        if (s == nullptr || *s == value) return s;
+    }
+    slot = INTERN_SLOTS; // no free slot within the probe limit
+    return nullptr;
+}
+
+const std::string *ParamValue::intern(const std::string &value) {
+    static std::mutex poolMutex;
+    if (value.empty()) return nullptr;
+
+    std::size_t hash = std::hash<std::string>()(value);
+    unsigned slot;
+    const std::string *s = internFind(value, hash, slot);
+    // found, or no room, without locking
+    if (s != nullptr || slot == INTERN_SLOTS) return s;
+
+    std::lock_guard<std::mutex> lock(poolMutex);
+    // another thread may have added it, or taken the slot
+    s = internFind(value, hash, slot);
+    if (s != nullptr || slot == INTERN_SLOTS) return s;
+    s = new std::string(value);
+    internSlots[slot].store(s, std::memory_order_release);
+    return s;
+}
+
+void ParamValue::setString(const std::string &value) {
+    strValue_ = intern(value);
+    if (strValue_ == nullptr && !value.empty()) {
+        owned_ = std::make_shared<const std::string>(value);
+        strValue_ = owned_.get();
+    }
+}
+
+const std::string &ParamValue::nullString() {
+    static const std::string sNullString;
+    return sNullString;
+}
+
 int operator>(const ParamValue &lhs, const ParamValue &rhs) {
     if (lhs.type() != rhs.type()) return lhs.type() > rhs.type();
     switch (lhs.type()) {
@@ -39,7 +95,7 @@ bool operator==(const ParamValue &lhs, const ParamValue &rhs) {
             return lhs.floatValue() == rhs.floatValue();
         }
         case ParamValue::T_String:
-            return lhs.stringValue() == rhs.stringValue();
+            return lhs.sameString(rhs);
         default:;
     }
     return lhs.stringValue() == rhs.stringValue();
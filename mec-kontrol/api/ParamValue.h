@@ -2,11 +2,15 @@
 
 #include <string>
 #include <limits>
+#include <memory>
 
 static const float PV_INITVALUE=std::numeric_limits<float>::max();
 
 namespace Kontrol {
 
+// compact tagged value, floats are held inline, strings are interned (while the table has room)
+// so a ParamValue never allocates for floats, or for strings already interned
+// strings which don't fit in the table are held (shared) by the value, and freed with it
 class ParamValue {
 public:
     enum Type {
@@ -14,26 +18,32 @@ public:
         T_String
     };
 
-    ParamValue(const ParamValue& p) : type_(p.type_), strValue_(p.strValue_), floatValue_(p.floatValue_) {;}
-    ParamValue& operator=(const ParamValue& p)  {
-        type_ = p.type_;
-        strValue_ = p.strValue_;
-        floatValue_ = p.floatValue_;
-        return *this;
-    }
+    ParamValue() : type_(T_Float), floatValue_(PV_INITVALUE), strValue_(nullptr) {;}
+    ParamValue(float value) : type_(T_Float), floatValue_(value), strValue_(nullptr) {;}
+    ParamValue(const char* value) : type_(T_String), floatValue_(PV_INITVALUE), strValue_(nullptr) { setString(value); }
+    ParamValue(const std::string& value) : type_(T_String), floatValue_(PV_INITVALUE), strValue_(nullptr) { setString(value); }
 
-    ParamValue() { type_ = T_Float; floatValue_ = PV_INITVALUE; strValue_ = "";}
-    ParamValue(const char* value) { type_ = T_String; strValue_ = value; floatValue_ = PV_INITVALUE;}
-    ParamValue(const std::string& value) { type_ = T_String; strValue_ = value; floatValue_ = PV_INITVALUE; }
-    ParamValue(float value) { type_ = T_Float; floatValue_ = value; strValue_ = "";}
     Type type() const { return type_;}
-    const std::string& stringValue() const {return strValue_;}
+    const std::string& stringValue() const {return strValue_ != nullptr ? *strValue_ : nullString();}
     float  floatValue() const {return floatValue_;}
 
+    // interned strings are unique, so can be compared by address, held strings by content
+    bool sameString(const ParamValue& p) const {
+        if (strValue_ == p.strValue_) return true;
+        if (!owned_ && !p.owned_) return false;
+        return strValue_ != nullptr && p.strValue_ != nullptr && *strValue_ == *p.strValue_;
+    }
+
 private:
+    void setString(const std::string& value);
+    // nullptr if empty, or the table has no room for it
+    static const std::string* intern(const std::string& value);
+    static const std::string& nullString();
+
     Type type_;
-    std::string strValue_;
     float floatValue_;
+    const std::string* strValue_; // interned, or owned_
+    std::shared_ptr<const std::string> owned_;
 };
 
 
@@ -14,9 +14,56 @@ static void throwError(const std::string &id, const char *what) {
 }
 
 
+unsigned ParamStore::add() {
+    ids_.push_back(EntityId());
+    types_.push_back(PT_Invalid);
+    current_.push_back(ParamValue(PV_INITVALUE));
+    min_.push_back(0.0f);
+    max_.push_back(0.0f);
+    def_.push_back(0.0f);
+    versions_.push_back(0);
+    return size() - 1;
+}
+
+void ParamStore::reserve(unsigned n) {
+    ids_.reserve(n);
+    types_.reserve(n);
+    current_.reserve(n);
+    min_.reserve(n);
+    max_.reserve(n);
+    def_.reserve(n);
+    versions_.reserve(n);
+}
+
+void ParamStore::assign(unsigned slot, const ParamStore &src, unsigned srcSlot) {
+    ids_[slot] = src.ids_[srcSlot];
+    types_[slot] = src.types_[srcSlot];
+    current_[slot] = src.current_[srcSlot];
+    min_[slot] = src.min_[srcSlot];
+    max_[slot] = src.max_[srcSlot];
+    def_[slot] = src.def_[srcSlot];
+    versions_[slot] = src.versions_[srcSlot];
+}
+
+bool ParamStore::changedSince(unsigned version) const {
+    for (unsigned v : versions_) {
+        if (v > version) return true;
+    }
+    return false;
+}
+
+
 // Parameter : type id displayname
-Parameter::Parameter(ParameterType type) : Entity("", ""), type_(type), current_(PV_INITVALUE) {
-    ;
+Parameter::Parameter(ParameterType type) : Entity("", ""), store_(std::make_shared<ParamStore>()), slot_(0) {
+    slot_ = store_->add();
+    store_->types_[slot_] = type;
+}
+
+void Parameter::attach(const std::shared_ptr<ParamStore> &store, unsigned slot) {
+    store->assign(slot, *store_, slot_);
+    store->ids_[slot] = id_;
+    store_ = store;
+    slot_ = slot;
 }
 
 void Parameter::init(const std::vector<ParamValue> &args, unsigned &pos) {
@@ -47,13 +94,13 @@ std::shared_ptr<Parameter> createParameter(const std::string &t) {
     else if (t == PTS_Pitch) return std::make_shared<Parameter_Pitch>(PT_Pitch);
     else if (t == PTS_Pan) return std::make_shared<Parameter_Pan>(PT_Pan);
 
-    std::cerr << "parameter type not found: " << t << std::endl;
+    LOG_0("parameter type not found: " << t);
 
     return std::make_shared<Parameter>(PT_Invalid);
 }
 
 void Parameter::createArgs(std::vector<ParamValue> &args) const {
-    switch (type_) {
+    switch (type()) {
         case PT_Float:
             args.push_back(ParamValue(PTS_Float));
             break;
@@ -98,8 +145,8 @@ std::shared_ptr<Parameter> Parameter::create(const std::vector<ParamValue> &args
         if (p->type() != PT_Invalid) p->init(args, pos);
     } catch (const std::runtime_error &e) {
         // perhaps report here why
-        std::cerr << "error: " << e.what() << std::endl;
-        p->type_ = PT_Invalid;
+        LOG_0("error: " << e.what());
+        p->store_->types_[p->slot_] = PT_Invalid;
     }
 
     return p;
@@ -118,26 +165,26 @@ const std::string &Parameter::displayUnit() const {
 
 
 ParamValue Parameter::calcRelative(float f) {
-    switch (current_.type()) {
+    switch (current().type()) {
         case ParamValue::T_Float : {
-            float v = current_.floatValue() + f;
+            float v = current().floatValue() + f;
             return calcFloat(v);
         }
         case ParamValue::T_String:
         default:;
     }
-    return current_;
+    return current();
 }
 
 ParamValue Parameter::calcFloat(float f) {
-    switch (current_.type()) {
+    switch (current().type()) {
         case ParamValue::T_Float : {
             return ParamValue(f);
         }
         case ParamValue::T_String:
         default:;
     }
-    return current_;
+    return current();
 }
 
 ParamValue Parameter::calcMinimum() const {
@@ -161,8 +208,9 @@ float Parameter::asFloat(const ParamValue& pv) const {
 }
 
 bool Parameter::change(const ParamValue &c, bool force) {
-    if (force || current_ != c) {
-        current_ = c;
+    ParamValue &current = store_->current_[slot_];
+    if (force || current != c) {
+        current = c;
         return true;
     }
     return false;
@@ -190,28 +238,28 @@ Parameter_Float::Parameter_Float(ParameterType type) : Parameter(type) {
 
 void Parameter_Float::init(const std::vector<ParamValue> &args, unsigned &pos) {
     Parameter::init(args, pos);
-    if (args.size() > pos && args[pos].type() == ParamValue::T_Float) min_ = args[pos++].floatValue();
+    if (args.size() > pos && args[pos].type() == ParamValue::T_Float) store_->min_[slot_] = args[pos++].floatValue();
     else
         throwError(id(), "missing min");
-    if (args.size() > pos && args[pos].type() == ParamValue::T_Float) max_ = args[pos++].floatValue();
+    if (args.size() > pos && args[pos].type() == ParamValue::T_Float) store_->max_[slot_] = args[pos++].floatValue();
     else
         throwError(id(), "missing max");
-    if (args.size() > pos && args[pos].type() == ParamValue::T_Float) def_ = args[pos++].floatValue();
+    if (args.size() > pos && args[pos].type() == ParamValue::T_Float) store_->def_[slot_] = args[pos++].floatValue();
     else
         throwError(id(), "missing def");
-    change(def_, true);
+    change(def(), true);
 }
 
 void Parameter_Float::createArgs(std::vector<ParamValue> &args) const {
     Parameter::createArgs(args);
-    args.push_back(ParamValue(min_));
-    args.push_back(ParamValue(max_));
-    args.push_back(ParamValue(def_));
+    args.push_back(ParamValue(min()));
+    args.push_back(ParamValue(max()));
+    args.push_back(ParamValue(def()));
 }
 
 std::string Parameter_Float::displayValue() const {
     char numbuf[11];
-    sprintf(numbuf, "%.1f", current_.floatValue());
+    sprintf(numbuf, "%.1f", current().floatValue());
     return std::string(numbuf);
 }
 
@@ -252,7 +300,7 @@ float Parameter_Float::asFloat(const ParamValue& v) const {
 
 
 bool Parameter_Float::change(const ParamValue &c, bool force) {
-    switch (current_.type()) {
+    switch (current().type()) {
         case ParamValue::T_Float  : {
             float v = c.floatValue();
             v = std::max(v, min());
@@ -272,7 +320,7 @@ Parameter_Boolean::Parameter_Boolean(ParameterType type) : Parameter(type) {
 
 
 std::string Parameter_Boolean::displayValue() const {
-    if (current_.floatValue() > 0.5) {
+    if (current().floatValue() > 0.5) {
         return "on";
     } else {
         return "off";
@@ -282,19 +330,20 @@ std::string Parameter_Boolean::displayValue() const {
 void Parameter_Boolean::init(const std::vector<ParamValue> &args, unsigned &pos) {
     Parameter::init(args, pos);
     if (args.size() > pos && args[pos].type() == ParamValue::T_Float) {
-        def_ = args[pos++].floatValue() > 0.5;
-        change(def_, true);
+        store_->def_[slot_] = args[pos++].floatValue() > 0.5 ? 1.0f : 0.0f;
+        store_->max_[slot_] = 1.0f;
+        change(store_->def_[slot_], true);
     } else
         throwError(id(), "missing def");
 }
 
 void Parameter_Boolean::createArgs(std::vector<ParamValue> &args) const {
     Parameter::createArgs(args);
-    args.push_back((float) def_);
+    args.push_back(ParamValue(def() ? 1.0f : 0.0f));
 }
 
 bool Parameter_Boolean::change(const ParamValue &c, bool force) {
-    switch (current_.type()) {
+    switch (current().type()) {
         case ParamValue::T_Float  : {
             float v = c.floatValue() > 0.5f ? 1.0f : 0.0f;
             return Parameter::change(ParamValue(v), force);
@@ -306,13 +355,13 @@ bool Parameter_Boolean::change(const ParamValue &c, bool force) {
 }
 
 ParamValue Parameter_Boolean::calcRelative(float f) {
-    if (current_.floatValue() > 0.5 && f < -0.0001) {
+    if (current().floatValue() > 0.5 && f < -0.0001) {
         return ParamValue(0.0);
     }
-    if (current_.floatValue() <= 0.5 && f > 0.0001) {
+    if (current().floatValue() <= 0.5 && f > 0.0001) {
         return ParamValue(1.0);
     }
-    return current_;
+    return current();
 }
 
 ParamValue Parameter_Boolean::calcFloat(float f) {
@@ -354,34 +403,38 @@ const std::string &Parameter_Time::displayUnit() const {
 
 void Parameter_Int::init(const std::vector<ParamValue> &args, unsigned &pos) {
     Parameter::init(args, pos);
-    if (args.size() > pos && args[pos].type() == ParamValue::T_Float) min_ = static_cast<int>(args[pos++].floatValue());
+    // held as floats in the store, truncated as before
+    if (args.size() > pos && args[pos].type() == ParamValue::T_Float)
+        store_->min_[slot_] = (float) static_cast<int>(args[pos++].floatValue());
     else
         throwError(id(), "missing min");
-    if (args.size() > pos && args[pos].type() == ParamValue::T_Float) max_ = static_cast<int>(args[pos++].floatValue());
+    if (args.size() > pos && args[pos].type() == ParamValue::T_Float)
+        store_->max_[slot_] = (float) static_cast<int>(args[pos++].floatValue());
     else
         throwError(id(), "missing max");
-    if (args.size() > pos && args[pos].type() == ParamValue::T_Float) def_ = static_cast<int>(args[pos++].floatValue());
+    if (args.size() > pos && args[pos].type() == ParamValue::T_Float)
+        store_->def_[slot_] = (float) static_cast<int>(args[pos++].floatValue());
     else
         throwError(id(), "missing def");
-    change(def_, true);
+    change((float) def(), true);
 }
 
 void Parameter_Int::createArgs(std::vector<ParamValue> &args) const {
     Parameter::createArgs(args);
-    args.push_back(ParamValue(min_));
-    args.push_back(ParamValue(max_));
-    args.push_back(ParamValue(def_));
+    args.push_back(ParamValue((float) min()));
+    args.push_back(ParamValue((float) max()));
+    args.push_back(ParamValue((float) def()));
 }
 
 std::string Parameter_Int::displayValue() const {
     char numbuf[11];
-    sprintf(numbuf, "%d", (int) current_.floatValue());
+    sprintf(numbuf, "%d", (int) current().floatValue());
     return std::string(numbuf);
 }
 
 
 bool Parameter_Int::change(const ParamValue &c, bool force) {
-    switch (current_.type()) {
+    switch (current().type()) {
         case ParamValue::T_Float  : {
             int v = static_cast<int>(c.floatValue());
             v = std::max(v, min());
@@ -445,7 +498,7 @@ const std::string &Parameter_Pitch::displayUnit() const {
 
 std::string Parameter_Pan::displayValue() const {
     char buf[11];
-    float c = current_.floatValue();
+    float c = current().floatValue();
     if(c==0.5f) {
         sprintf(buf, "C");
     } else if (c>0.5f) {
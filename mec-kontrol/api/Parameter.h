@@ -22,6 +22,25 @@ enum ParameterType {
     PT_Pan
 };
 
+// parameter fields, in parallel arrays, one slot per parameter
+// a module keeps its parameters in one store, in definition order, so bulk operations
+// (presets, snapshots, delta sync) are linear scans, a Parameter is a handle onto its slot
+struct ParamStore {
+    unsigned add();
+    void reserve(unsigned n);
+    void assign(unsigned slot, const ParamStore &src, unsigned srcSlot);
+    unsigned size() const { return (unsigned) types_.size(); }
+    bool changedSince(unsigned version) const;
+
+    std::vector<EntityId> ids_;
+    std::vector<ParameterType> types_;
+    std::vector<ParamValue> current_;
+    std::vector<float> min_;
+    std::vector<float> max_;
+    std::vector<float> def_;
+    std::vector<unsigned> versions_;
+};
+
 class Parameter : public Entity {
 public:
     static std::shared_ptr<Parameter> create(const std::vector<ParamValue> &args);
@@ -29,12 +48,19 @@ public:
     Parameter(ParameterType type);
     virtual void createArgs(std::vector<ParamValue> &args) const;
 
-    ParameterType type() const { return type_; };
+    ParameterType type() const { return store_->types_[slot_]; };
+
+    // move this parameter into a (module) store, at slot
+    void attach(const std::shared_ptr<ParamStore> &store, unsigned slot);
+
+    // versions are held in the store, hides Entity::version
+    unsigned version() const { return store_->versions_[slot_]; }
+    void version(unsigned v) { store_->versions_[slot_] = v; }
 
     virtual std::string displayValue() const;
     virtual const std::string &displayUnit() const;
 
-    ParamValue current() const { return current_; }
+    ParamValue current() const { return store_->current_[slot_]; }
 
     virtual bool change(const ParamValue &c, bool force);
     virtual ParamValue calcRelative(float f);
@@ -46,15 +72,16 @@ public:
 
     virtual float asFloat (const ParamValue& v) const;
 
-    virtual bool valid() { return Entity::valid() && type_ != PT_Invalid; }
+    virtual bool valid() { return Entity::valid() && type() != PT_Invalid; }
 
     void dump() const;
 
 protected:
     virtual void init(const std::vector<ParamValue> &args, unsigned &pos);
 
-    ParameterType type_;
-    ParamValue current_;
+    // a parameter starts in a store of its own, until attached to its module
+    std::shared_ptr<ParamStore> store_;
+    unsigned slot_;
 };
 
 
@@ -78,15 +105,11 @@ public:
 protected:
     void init(const std::vector<ParamValue> &args, unsigned &pos) override;
 
-    int def() const { return def_; }
+    int def() const { return static_cast<int>(store_->def_[slot_]); }
 
-    int min() const { return min_; }
+    int min() const { return static_cast<int>(store_->min_[slot_]); }
 
-    int max() const { return max_; }
-
-    int min_;
-    int max_;
-    int def_;
+    int max() const { return static_cast<int>(store_->max_[slot_]); }
 };
 
 
@@ -109,15 +132,11 @@ public:
 protected:
     void init(const std::vector<ParamValue> &args, unsigned &pos) override;
 
-    float def() const { return def_; }
-
-    float min() const { return min_; }
+    float def() const { return store_->def_[slot_]; }
 
-    float max() const { return max_; }
+    float min() const { return store_->min_[slot_]; }
 
-    float min_;
-    float max_;
-    float def_;
+    float max() const { return store_->max_[slot_]; }
 };
 
 class Parameter_Boolean : public Parameter {
@@ -139,9 +158,7 @@ public:
 protected:
     void init(const std::vector<ParamValue> &args, unsigned &pos) override;
 
-    bool def() const { return def_; }
-
-    bool def_;
+    bool def() const { return store_->def_[slot_] > 0.5f; }
 };
 
 class Parameter_Percent : public Parameter_Float {
@@ -0,0 +1,123 @@
+#include "PresetCache.h"
+
+#include <mec_log.h>
+#include <mec_threads.h>
+
+namespace Kontrol {
+
+const unsigned PresetCache::REFRESH_MS;
+
+PresetCache::~PresetCache() {
+    stop();
+}
+
+void *preset_cache_refresh_thread_func(void *pCache) {
+    mec::ThreadRegistration registration("preset.cache");
+    PresetCache *pThis = static_cast<PresetCache *>(pCache);
+    pThis->refreshPoll();
+    return nullptr;
+}
+
+void PresetCache::start(const std::vector<std::string> &presetIds) {
+    stop();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &presetId : presetIds) {
+            // placeholder, loaded by refresh thread
+            presets_.insert({presetId, CachedPreset()});
+        }
+    }
+    running_ = true;
+    refresh_thread_ = std::thread(preset_cache_refresh_thread_func, this);
+}
+
+void PresetCache::stop() {
+    {
+        std::lock_guard<std::mutex> lock(runMutex_);
+        running_ = false;
+    }
+    runCondition_.notify_all();
+    if (refresh_thread_.joinable()) refresh_thread_.join();
+}
+
+std::shared_ptr<const RackPreset> PresetCache::load(const std::string &presetId, FileStamp &stamp) const {
+    std::string filename = presetFile(presetId);
+    stamp = FileStamp::of(filename);
+    auto preset = std::make_shared<RackPreset>();
+    if (!Rack::parsePreset(filename, *preset)) return nullptr;
+    return preset;
+}
+
+std::shared_ptr<const RackPreset> PresetCache::get(const std::string &presetId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto i = presets_.find(presetId);
+    return i != presets_.end() ? i->second.preset_ : nullptr;
+}
+
+std::shared_ptr<const RackPreset> PresetCache::preload(const std::string &presetId) {
+    FileStamp stamp;
+    auto preset = load(presetId, stamp);
+    if (preset != nullptr) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        presets_[presetId] = CachedPreset{stamp, preset};
+    }
+    return preset;
+}
+
+void PresetCache::put(const std::string &presetId, const std::shared_ptr<const RackPreset> &preset) {
+    FileStamp stamp = FileStamp::of(presetFile(presetId));
+    std::lock_guard<std::mutex> lock(mutex_);
+    presets_[presetId] = CachedPreset{stamp, preset};
+}
+
+void PresetCache::refresh(const std::string &presetId) {
+    FileStamp current = FileStamp::of(presetFile(presetId));
+    FileStamp cached;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto i = presets_.find(presetId);
+        if (i == presets_.end()) return;
+        if (i->second.preset_ != nullptr && i->second.stamp_ == current) return;
+        cached = i->second.stamp_;
+    }
+
+    // parse outside of lock, so get() is never blocked on file io
+    FileStamp stamp;
+    auto preset = load(presetId, stamp);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto i = presets_.find(presetId);
+    // only replace if not updated (e.g. by put) whilst we were loading
+    if (i != presets_.end() && i->second.stamp_ == cached) {
+        if (preset != nullptr) {
+            i->second = CachedPreset{stamp, preset};
+        } else if (i->second.preset_ != nullptr) {
+            LOG_1("PresetCache::refresh preset no longer valid, keeping cached : " << presetId);
+        }
+    }
+}
+
+void PresetCache::refreshPoll() {
+    bool first = true;
+    while (true) {
+        // preload everything straight away, then check for changes periodically
+        if (!first) {
+            std::unique_lock<std::mutex> lock(runMutex_);
+            runCondition_.wait_for(lock, std::chrono::milliseconds(REFRESH_MS), [this] { return !running_; });
+            if (!running_) return;
+        }
+        first = false;
+
+        std::vector<std::string> presetIds;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto &p : presets_) presetIds.push_back(p.first);
+        }
+        for (const auto &presetId : presetIds) {
+            if (!running_) return;
+            refresh(presetId);
+        }
+    }
+}
+
+} //namespace
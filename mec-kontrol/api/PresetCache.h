@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Rack.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <unordered_map>
+
+namespace Kontrol {
+
+// presets of the local rack, parsed once and kept in memory, so switching presets does not touch the disk
+// presets are immutable once cached, a background thread preloads them all when started,
+// then re-parses any whose file changes
+class PresetCache {
+public:
+    static const unsigned REFRESH_MS = 2000;
+
+    PresetCache(const std::string &presetsDir) : presetsDir_(presetsDir), running_(false) { ; }
+
+    ~PresetCache();
+
+    const std::string &presetsDir() const { return presetsDir_; }
+
+    void start(const std::vector<std::string> &presetIds);
+    void stop();
+
+    // cached preset, never loads on the callers thread,
+    // nullptr if its not cached (yet, e.g. before the preload has finished, or a new preset), see preload
+    std::shared_ptr<const RackPreset> get(const std::string &presetId);
+
+    // load now, and cache, e.g. the preset needed at startup, or one which get() missed
+    // nullptr if there is no valid preset
+    std::shared_ptr<const RackPreset> preload(const std::string &presetId);
+
+    // replace cached preset, e.g. after saving
+    void put(const std::string &presetId, const std::shared_ptr<const RackPreset> &preset);
+
+    void refreshPoll();
+
+private:
+    struct CachedPreset {
+        FileStamp stamp_;
+        std::shared_ptr<const RackPreset> preset_;
+    };
+
+    std::string presetFile(const std::string &presetId) const { return presetsDir_ + "/" + presetId + "/params.json"; }
+
+    std::shared_ptr<const RackPreset> load(const std::string &presetId, FileStamp &stamp) const;
+    void refresh(const std::string &presetId);
+
+    std::string presetsDir_;
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, CachedPreset> presets_; // key = preset id
+
+    std::atomic<bool> running_;
+    std::mutex runMutex_;
+    std::condition_variable runCondition_;
+    std::thread refresh_thread_;
+};
+
+} //namespace
@@ -1,13 +1,18 @@
 #include "Rack.h"
 #include "Module.h"
 #include "KontrolModel.h"
+#include "Snapshot.h"
+#include "PresetCache.h"
+#include "FileWriter.h"
 
 #include <algorithm>
+#include <cmath>
 #include <limits>
 #include <string.h>
 #include <iostream>
 #include <map>
 #include <fstream>
+#include <cstdlib>
 
 
 // for saving presets only , later moved to Preferences
@@ -56,6 +61,8 @@ inline std::shared_ptr<KontrolModel> Rack::model() {
 void Rack::addModule(const std::shared_ptr<Module> &module) {
     if (module != nullptr) {
         modules_[module->id()] = module;
+        rebuildMidiCCTargets();
+        rebuildModulationTargets();
     }
 }
 
@@ -73,18 +80,104 @@ std::shared_ptr<Module> Rack::getModule(const EntityId &moduleId) {
 
 
 bool Rack::loadModuleDefinitions(const EntityId &moduleId, const mec::Preferences &prefs) {
-    bool ret = false;
     auto module = getModule(moduleId);
-    if (module != nullptr) {
-        if (module->loadModuleDefinitions(prefs)) {
-            publishMetaData(module);
-            ret = true;
+    if (module == nullptr) return false;
+
+    // not from a file, so cannot be cached
+    moduleDefinitions_.erase(moduleId);
+    ModuleDefinition def;
+    if (!Module::parseModuleDefinitions(prefs, def)) return false;
+    return applyModuleDefinitions(module, def);
+}
+
+bool Rack::loadModuleDefinitions(const EntityId &moduleId, const std::string &filename) {
+    auto module = getModule(moduleId);
+    if (module == nullptr) return false;
+
+    moduleDefinitions_.erase(moduleId);
+    FileStamp stamp = FileStamp::of(filename);
+    auto snap = snapshot();
+    if (snap) {
+        auto cached = snap->modules_.find(moduleId);
+        if (cached != snap->modules_.end()
+            && cached->second.moduleType_ == module->type()
+            && cached->second.file_ == filename
+            && cached->second.stamp_ == stamp) {
+            moduleDefinitions_[moduleId] = cached->second;
+            return applyModuleDefinitions(module, cached->second);
         }
     }
+
+    mec::Preferences prefs(filename);
+    ModuleDefinition def;
+    if (!Module::parseModuleDefinitions(prefs, def)) return false;
+    def.moduleType_ = module->type();
+    def.file_ = filename;
+    def.stamp_ = stamp;
+    moduleDefinitions_[moduleId] = def;
+    return applyModuleDefinitions(module, def);
+}
+
+bool Rack::applyModuleDefinitions(const std::shared_ptr<Module> &module, const ModuleDefinition &def) {
+    bool ret = module->loadModuleDefinitions(def);
+    // parameters are replaced, so clients syncing a delta need the whole module
+    model()->touch(*module);
+    if (ret) publishMetaData(module);
+    // definitions replace parameters, and clear mappings
+    rebuildMidiCCTargets();
+    rebuildModulationTargets();
     return ret;
 }
 
 
+std::shared_ptr<RackSnapshot> Rack::snapshot() {
+    if (!snapshotLoaded_) {
+        snapshotLoaded_ = true;
+        auto snap = std::make_shared<RackSnapshot>();
+        if (snap->load(snapshotFile())) snapshot_ = snap;
+    }
+    return snapshot_;
+}
+
+bool Rack::saveSnapshot() {
+    // state is taken now, file stamps when written, i.e. after any settings/preset writes requested before it
+    auto snap = std::make_shared<RackSnapshot>();
+    std::shared_ptr<const RackPreset> rackPreset;
+    if (!settingsFile_.empty()) {
+        snap->settingsFile_ = settingsFile_;
+        snap->settingsPreset_ = settingsPreset_;
+        snap->presets_ = presets_;
+        // rackPreset_ holds the last loaded/saved preset, only useful if its the one loaded at startup
+        if (!settingsPreset_.empty() && currentPreset_ == settingsPreset_ && rackPreset_) {
+            snap->presetCached_ = true;
+            rackPreset = rackPreset_;
+        }
+    }
+    snap->modules_ = moduleDefinitions_;
+
+    std::string settingsFile = dataDir_ + "/" + settingsFile_;
+    std::string presetsDir = dataDir_ + "/presets";
+    std::string presetFile = this->presetFile(currentPreset_);
+    FileWriter::writer()->write(snapshotFile(), [snap, rackPreset, settingsFile, presetsDir, presetFile](std::string &data) {
+        if (!snap->settingsFile_.empty()) {
+            snap->settingsStamp_ = FileStamp::of(settingsFile);
+            snap->presetsDirStamp_ = FileStamp::of(presetsDir);
+        }
+        if (rackPreset) {
+            snap->presetStamp_ = FileStamp::of(presetFile);
+            snap->rackPreset_ = *rackPreset;
+        }
+        snap->save(data);
+        return true;
+    });
+    return true;
+}
+
+void Rack::flushSaves() {
+    FileWriter::writer()->flush();
+}
+
+
 
 
 bool Rack::saveSettings() {
@@ -100,16 +193,45 @@ bool Rack::loadSettings(const std::string &filename) {
     bool ret = false;
     settingsFile_ = filename;
 
-    // load rack preferences
     std::string rackPrefFile = dataDir_+ "/" + filename;
+    std::string presetsdir = dataDir_ + "/presets";
+
+    // warm start, if settings and presets are unchanged since snapshot
+    auto snap = snapshot();
+    if (snap
+        && snap->settingsFile_ == filename
+        && snap->settingsStamp_ == FileStamp::of(rackPrefFile)
+        && snap->presetsDirStamp_ == FileStamp::of(presetsdir)) {
+        currentPreset_ = settingsPreset_ = snap->settingsPreset_;
+        presets_ = snap->presets_;
+        for (const auto &presetId : presets_) {
+            addResource("preset", presetId);
+        }
+        if (currentPreset_.length() > 0) {
+            if (snap->presetCached_ && snap->presetStamp_ == FileStamp::of(presetFile(currentPreset_))) {
+                rackPreset_ = std::make_shared<RackPreset>(snap->rackPreset_);
+                presetCache()->put(currentPreset_, rackPreset_);
+                applyRackPreset(false);
+                model()->loadPreset(CS_LOCAL, id(), currentPreset());
+            } else {
+                presetCache()->preload(currentPreset_);
+                loadFilePreset(currentPreset_, false);
+            }
+        }
+        presetCache()->start(presets_);
+        model()->publishMetaData();
+        return ret;
+    }
+
+    // load rack preferences
     mec::Preferences rackPrefs(rackPrefFile);
     if(rackPrefs.valid()) {
         currentPreset_ = rackPrefs.getString("currentPreset", currentPreset_);
     }
+    settingsPreset_ = currentPreset_;
 
     // load presets
     presets_.clear();
-    std::string presetsdir = dataDir_ + "/presets";
     std::setlocale(LC_ALL, "en_US.UTF-8");
 
     struct stat st;
@@ -132,25 +254,32 @@ bool Rack::loadSettings(const std::string &filename) {
         }
     }
 
-    if(currentPreset().length()>0) loadFilePreset(currentPreset_);
+    if(currentPreset().length()>0) {
+        presetCache()->preload(currentPreset_);
+        loadFilePreset(currentPreset_, false);
+    }
 
+    // remaining presets are loaded in the background
+    presetCache()->start(presets_);
     model()->publishMetaData();
     return ret;
 }
 
 
 bool Rack::saveSettings(const std::string &filename) {
-    {
-        std::string rackPrefFile = dataDir_+ "/" + filename;
-        std::ofstream outfile(rackPrefFile.c_str());
+    std::string rackPrefFile = dataDir_ + "/" + filename;
+    std::string preset = currentPreset_;
+    FileWriter::writer()->write(rackPrefFile, [preset](std::string &data) {
         cJSON *root = cJSON_CreateObject();
-
-        cJSON_AddStringToObject(root, "currentPreset", currentPreset_.c_str());
-        const char *text = cJSON_Print(root);
-        outfile << text << std::endl;
-        outfile.close();
+        cJSON_AddStringToObject(root, "currentPreset", preset.c_str());
+        char *text = cJSON_Print(root);
+        data = std::string(text) + "\n";
+        free(text);
         cJSON_Delete(root);
-    }
+        return true;
+    });
+    if (filename == settingsFile_) settingsPreset_ = currentPreset_;
+    saveSnapshot();
     return true;
 }
 
@@ -166,16 +295,16 @@ std::vector<std::string> Rack::getPresetList() {
 bool Rack::savePreset(std::string presetId) {
     bool ret = false;
 
-    // store preset in rackPreset_
+    // store preset in rackPreset_, as a new preset, since the previous may be shared with the cache
+    auto rackPreset = rackPreset_ ? std::make_shared<RackPreset>(*rackPreset_) : std::make_shared<RackPreset>();
     for (const auto &m : modules_) {
         auto module = m.second;
         if (module != nullptr) {
             auto moduleId = module->id();
-            ModulePreset modulePreset = rackPreset_[moduleId];
-            ret |= updateModulePreset(module, modulePreset);
-            rackPreset_[moduleId] = modulePreset;
+            ret |= updateModulePreset(module, (*rackPreset)[moduleId]);
         }
     }
+    rackPreset_ = rackPreset;
 
     //FIXME: probably presets_ should not exist, should use resources
     //also new preset ID, should not be done on client, but on server
@@ -194,113 +323,150 @@ bool Rack::savePreset(std::string presetId) {
 
     //save rackPreset_ to file
     saveFilePreset(presetId);
+    presetCache()->put(presetId, rackPreset_);
 
     currentPreset_ = presetId;
     model()->savePreset(CS_LOCAL, id(), currentPreset());
+    saveSnapshot();
 
     //    dumpSettings();
     return ret;
 }
 
 bool Rack::loadPreset(std::string presetId) {
-    bool ret = loadFilePreset(presetId);
+    bool ret = loadFilePreset(presetId, true);
     return ret;
 }
 
-bool Rack::loadFilePreset(const std::string& presetId) {
-    bool ret = false;
-
-    std::string dir = dataDir_ + "/presets/"+presetId;
-    std::string filename = dir+"/params.json";
+std::shared_ptr<PresetCache> Rack::presetCache() {
+    std::string presetsdir = dataDir_ + "/presets";
+    if (!presetCache_ || presetCache_->presetsDir() != presetsdir) {
+        presetCache_ = std::make_shared<PresetCache>(presetsdir);
+    }
+    return presetCache_;
+}
 
-    rackPreset_.clear();
+bool Rack::parsePreset(const std::string &filename, RackPreset &rackPreset) {
+    bool ret = false;
     mec::Preferences preset(filename);
     if(!preset.valid()) return false;
 
-    // load preset from file
     for (const std::string &moduleId :preset.getKeys()) {
         mec::Preferences modulepresetspref(preset.getSubTree(moduleId));
         if (modulepresetspref.valid()) {
-            ret |= loadModulePreset(rackPreset_, moduleId, modulepresetspref);
+            ret |= loadModulePreset(rackPreset, moduleId, modulepresetspref);
         }
     }
+    return ret;
+}
+
+bool Rack::loadFilePreset(const std::string& presetId, bool changedOnly) {
+    auto cache = presetCache();
+    auto preset = cache->get(presetId);
+    // not cached yet (e.g. before the background preload has finished, or a new preset), so load it now
+    if (preset == nullptr) preset = cache->preload(presetId);
+    if (preset == nullptr) {
+        // rackPreset_ is left as the last applied, for later changed only applies
+        LOG_1("Rack::loadFilePreset preset not available : " << presetId);
+        return false;
+    }
+    rackPreset_ = preset;
 
+    bool ret = applyRackPreset(changedOnly);
+    currentPreset_ = presetId;
+    model()->loadPreset(CS_LOCAL, id(), currentPreset());
+    return ret;
+}
+
+bool Rack::applyRackPreset(bool changedOnly) {
+    bool ret = false;
+    bool mappingChanged = !changedOnly;
     // publish it
     for (const auto &m : modules_) {
         auto module = m.second;
         if (module != nullptr) {
             auto moduleId = module->id();
-            if (rackPreset_.count(moduleId) > 0) {
-                ModulePreset modulePreset = rackPreset_[moduleId];
+            auto mp = rackPreset_->find(moduleId);
+            if (mp != rackPreset_->end()) {
+                const ModulePreset &modulePreset = mp->second;
+                bool moduleChanged = false;
                 if (module->type() != modulePreset.moduleType()) {
                     model()->loadModule(CS_PRESET, id(), module->id(), modulePreset.moduleType());
                     module = getModule(moduleId);
+                    moduleChanged = true;
                 }
 
-                ret |= applyModulePreset(module, modulePreset);
+                ret |= applyModulePreset(module, modulePreset, changedOnly && !moduleChanged);
+
+                bool moduleMappingChanged = false;
+                if (module->getMidiMapping() != modulePreset.midiMap()) {
+                    module->setMidiMapping(modulePreset.midiMap());
+                    moduleMappingChanged = true;
+                }
+                if (module->getModulationMapping() != modulePreset.modulationMap()) {
+                    module->setModulationMapping(modulePreset.modulationMap());
+                    moduleMappingChanged = true;
+                }
+                // values are stamped by changeParam, mappings are not
+                if (moduleMappingChanged || moduleChanged) model()->touch(*module);
+                mappingChanged |= moduleMappingChanged || moduleChanged;
             }
         }
     }
-    currentPreset_ = presetId;
-    model()->loadPreset(CS_LOCAL, id(), currentPreset());
+    if (mappingChanged) {
+        rebuildMidiCCTargets();
+        rebuildModulationTargets();
+    }
     return ret;
 }
 
 bool Rack::saveFilePreset(const std::string& presetId) {
     bool ret = true;
 
-    std::string dir = dataDir_ + "/presets/"+presetId;
-    std::string filename = dir+"/params.json";
-    mkdir(dir.c_str(),S_IRWXU|S_IRWXG|S_IRWXO);
-
-    std::ofstream outfile(filename.c_str());
-    cJSON *root = cJSON_CreateObject();
-
     // store modules sorted, so easier to find ;)
     std::set<EntityId> moduleIds;
-    for (const auto &mp : rackPreset_) {
+    for (const auto &mp : *rackPreset_) {
         // check module exists still, useful if renaming
         if(getModule(mp.first)) {
             moduleIds.insert(mp.first);
         }
     }
 
-    for (const auto &mid : moduleIds) {
-        auto mp = rackPreset_.find(mid);
-        if(mp!=rackPreset_.end()) {
-            auto moduleId = mp->first;
-            auto modulePreset = mp->second;
-            cJSON *mjson = cJSON_CreateObject();
-            cJSON_AddItemToObject(root, moduleId.c_str(), mjson);
-            saveModulePreset(modulePreset, mjson);
+    // rackPreset_ is immutable, so can be serialised by the writer thread
+    std::shared_ptr<const RackPreset> rackPreset = rackPreset_;
+    FileWriter::writer()->write(presetFile(presetId), [rackPreset, moduleIds](std::string &data) {
+        cJSON *root = cJSON_CreateObject();
+        for (const auto &mid : moduleIds) {
+            auto mp = rackPreset->find(mid);
+            if(mp!=rackPreset->end()) {
+                const auto &moduleId = mp->first;
+                const auto &modulePreset = mp->second;
+                cJSON *mjson = cJSON_CreateObject();
+                cJSON_AddItemToObject(root, moduleId.c_str(), mjson);
+                saveModulePreset(modulePreset, mjson);
+            }
         }
-    }
 
-    // const char* text = cJSON_PrintUnformatted(root);
-    const char *text = cJSON_Print(root);
-    outfile << text << std::endl;
-    outfile.close();
-    cJSON_Delete(root);
+        // char* text = cJSON_PrintUnformatted(root);
+        char *text = cJSON_Print(root);
+        data = std::string(text) + "\n";
+        free(text);
+        cJSON_Delete(root);
+        return true;
+    });
     return ret;
 }
 
 
 bool Rack::changeMidiCC(unsigned midiCC, unsigned midiValue) {
+    if (midiCC >= MAX_MIDI_CC) return false;
     bool ret = false;
-    for (const auto &m : modules_) {
-        auto module = m.second;
-        if (module != nullptr) {
-            std::vector<EntityId> mmvec = module->getParamsForCC(midiCC);
-            for (const auto &paramId : mmvec) {
-                auto param = module->getParam(paramId);
-                if (param != nullptr) {
-                    ParamValue pv = param->calcMidi(midiValue);
-                    if (pv != param->current()) {
-                        model()->changeParam(CS_MIDI, id(), module->id(), param->id(), pv);
-                        ret = true;
-                    }
-                }
-            }
+    for (const auto &target : midiCCTargets_[midiCC]) {
+        const auto &param = target.param_;
+        ParamValue pv = param->calcMidi(midiValue);
+        if (pv != param->current()) {
+            model()->changeParam(CS_MIDI, id(), target.module_->id(), param->id(), pv);
+            ret = true;
         }
     }
     return ret;
@@ -308,53 +474,162 @@ bool Rack::changeMidiCC(unsigned midiCC, unsigned midiValue) {
 
 void Rack::addMidiCCMapping(unsigned ccnum, const EntityId &moduleId, const EntityId &paramId) {
     auto module = getModule(moduleId);
-    if (module != nullptr) module->addMidiCCMapping(ccnum, paramId);
+    if (module == nullptr) return;
+    module->addMidiCCMapping(ccnum, paramId);
+
+    if (ccnum >= MAX_MIDI_CC) return;
+    auto param = module->getParam(paramId);
+    if (param == nullptr) return;
+    auto &targets = midiCCTargets_[ccnum];
+    for (const auto &target : targets) {
+        if (target.module_ == module && target.param_ == param) return; // already present
+    }
+    targets.push_back(MidiCCTarget{module, param});
 }
 
 void Rack::removeMidiCCMapping(unsigned ccnum, const EntityId &moduleId, const EntityId &paramId) {
     auto module = getModule(moduleId);
-    if (module != nullptr) module->removeMidiCCMapping(ccnum, paramId);
+    if (module == nullptr) return;
+    module->removeMidiCCMapping(ccnum, paramId);
+
+    if (ccnum >= MAX_MIDI_CC) return;
+    auto &targets = midiCCTargets_[ccnum];
+    for (auto it = targets.begin(); it != targets.end(); it++) {
+        if (it->module_ == module && it->param_->id() == paramId) {
+            targets.erase(it);
+            return;
+        }
+    }
 }
 
-
-bool Rack::changeModulation(unsigned bus, float value) {
-    bool ret = false;
+void Rack::rebuildMidiCCTargets() {
+    for (auto &targets : midiCCTargets_) {
+        targets.clear();
+    }
     for (const auto &m : modules_) {
         auto module = m.second;
-        if (module != nullptr) {
-            std::vector<EntityId> mmvec = module->getParamsForModulation(bus);
-            for (const auto &paramId : mmvec) {
+        if (module == nullptr) continue;
+        for (const auto &mm : module->getMidiMapping()) {
+            if (mm.first >= MAX_MIDI_CC) continue;
+            for (const auto &paramId : mm.second) {
                 auto param = module->getParam(paramId);
                 if (param != nullptr) {
-                    ParamValue pv = param->calcFloat(value);
-                    if (pv != param->current()) {
-                        model()->changeParam(CS_MODULATION, id(), module->id(), param->id(), pv);
-                        ret = true;
-                    }
+                    midiCCTargets_[mm.first].push_back(MidiCCTarget{module, param});
                 }
             }
         }
     }
+}
+
+
+static const float MODULATION_SETTLED = 0.0001f;
+
+bool Rack::changeModulation(unsigned bus, float value) {
+    if (bus >= MAX_MODULATION_BUS) return false;
+    modulationBus_[bus] = value;
+    modulationBusChanged_[bus] = true;
+    return true;
+}
+
+bool Rack::processModulation() {
+    bool ret = false;
+    for (auto &target : modulationTargets_) {
+        if (modulationBusChanged_[target.bus_]) target.settled_ = false;
+        if (target.settled_) continue;
+
+        float goal = modulationBus_[target.bus_] * target.depth_;
+        float v = target.value_ + ((goal - target.value_) * (1.0f - target.slew_));
+        if (std::fabs(goal - v) < MODULATION_SETTLED) {
+            v = goal;
+            target.settled_ = true;
+        }
+        target.value_ = v;
+
+        const auto &param = target.param_;
+        ParamValue pv = param->calcFloat(v);
+        if (pv != param->current()) {
+            model()->changeParam(CS_MODULATION, id(), target.module_->id(), param->id(), pv);
+            ret = true;
+        }
+    }
+    for (auto &changed : modulationBusChanged_) {
+        changed = false;
+    }
     return ret;
 }
 
 void Rack::addModulationMapping(const std::string &src, unsigned bus, const EntityId &moduleId, const EntityId &paramId) {
     auto module = getModule(moduleId);
-    if (module != nullptr) module->addModulationMapping(src, bus, paramId);
+    if (module == nullptr) return;
+    module->addModulationMapping(src, bus, paramId);
+
+    if (bus >= MAX_MODULATION_BUS) return;
+    auto param = module->getParam(paramId);
+    if (param == nullptr) return;
+    for (const auto &target : modulationTargets_) {
+        if (target.bus_ == bus && target.module_ == module && target.param_ == param) return; // already present
+    }
+    modulationTargets_.push_back(ModulationTarget{bus, module, param, 1.0f, 0.0f, modulationBus_[bus], true});
 }
 
 void Rack::removeModulationMapping(const std::string &src, unsigned bus, const EntityId &moduleId, const EntityId &paramId) {
     auto module = getModule(moduleId);
-    if (module != nullptr) module->removeModulationMapping(src, bus, paramId);
+    if (module == nullptr) return;
+    module->removeModulationMapping(src, bus, paramId);
+
+    for (auto it = modulationTargets_.begin(); it != modulationTargets_.end(); it++) {
+        if (it->bus_ == bus && it->module_ == module && it->param_->id() == paramId) {
+            modulationTargets_.erase(it);
+            return;
+        }
+    }
+}
+
+bool Rack::modulationTarget(unsigned bus, const EntityId &moduleId, const EntityId &paramId, float depth, float slew) {
+    for (auto &target : modulationTargets_) {
+        if (target.bus_ == bus && target.module_->id() == moduleId && target.param_->id() == paramId) {
+            target.depth_ = depth;
+            target.slew_ = std::max(0.0f, std::min(slew, 0.999f));
+            target.settled_ = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Rack::rebuildModulationTargets() {
+    std::vector<ModulationTarget> targets;
+    for (const auto &m : modules_) {
+        auto module = m.second;
+        if (module == nullptr) continue;
+        for (const auto &mm : module->getModulationMapping()) {
+            unsigned bus = mm.first;
+            if (bus >= MAX_MODULATION_BUS) continue;
+            for (const auto &paramId : mm.second) {
+                auto param = module->getParam(paramId);
+                if (param == nullptr) continue;
+                ModulationTarget target{bus, module, param, 1.0f, 0.0f, modulationBus_[bus], true};
+                // keep depth/slew settings of existing targets
+                for (const auto &old : modulationTargets_) {
+                    if (old.bus_ == bus && old.module_->id() == module->id() && old.param_->id() == paramId) {
+                        target.depth_ = old.depth_;
+                        target.slew_ = old.slew_;
+                        target.value_ = old.value_;
+                        break;
+                    }
+                }
+                targets.push_back(target);
+            }
+        }
+    }
+    modulationTargets_ = targets;
 }
 
 
 
 void Rack::publishCurrentValues(const std::shared_ptr<Module> &module) const {
     if (module != nullptr) {
-        std::vector<std::shared_ptr<Parameter>> params = module->getParams();
-        std::vector<std::shared_ptr<Page>> pages = module->getPages();
-        for (const auto &p : params) {
+        for (const auto &p : module->params()) {
             model()->publishChanged(CS_LOCAL, *this, *module, *p);
         }
     }
@@ -371,9 +646,8 @@ void Rack::publishCurrentValues() const {
 void Rack::publishMetaData(const std::shared_ptr<Module> &module) const {
     if (module != nullptr) {
         model()->publishModule(CS_LOCAL, *this, *module);
-        std::vector<std::shared_ptr<Parameter>> params = module->getParams();
         std::vector<std::shared_ptr<Page>> pages = module->getPages();
-        for (const auto &p : params) {
+        for (const auto &p : module->params()) {
             model()->publishParam(CS_LOCAL, *this, *module, *p);
         }
         for (const auto &p : pages) {
@@ -483,19 +757,19 @@ bool Rack::loadModulePreset(RackPreset &rackPreset, const EntityId &moduleId, co
     }
 
 
-    rackPreset[moduleId] = ModulePreset(moduleType, presetValues, midimap,modmap);
+    rackPreset[moduleId] = ModulePreset(moduleType, std::move(presetValues), std::move(midimap), std::move(modmap));
 
     return true;
 }
 
-bool Rack::saveModulePreset(ModulePreset &modulepreset, cJSON *root) {
+bool Rack::saveModulePreset(const ModulePreset &modulepreset, cJSON *root) {
 
     cJSON_AddStringToObject(root, "moduleType", modulepreset.moduleType().c_str());
 
     cJSON *presetValues = cJSON_CreateObject();
     cJSON_AddItemToObject(root, "params", presetValues);
 
-    for (auto v : modulepreset.values()) {
+    for (const auto &v : modulepreset.values()) {
         switch (v.value().type()) {
             case ParamValue::T_String: {
                 cJSON_AddStringToObject(presetValues, v.paramId().c_str(), v.value().stringValue().c_str());
@@ -548,39 +822,44 @@ bool Rack::saveModulePreset(ModulePreset &modulepreset, cJSON *root) {
 
 bool Rack::updateModulePreset(std::shared_ptr<Module> module, ModulePreset &modulePreset) {
     bool ret = true;
-    module->dumpCurrentValues();
-    std::vector<std::shared_ptr<Parameter>> params = module->getParams();
+    const auto &store = module->store();
     std::vector<ModulePresetValue> presetValues;
-    for (const auto &p : params) {
-        presetValues.push_back(ModulePresetValue(p->id(), p->current()));
+    presetValues.reserve(store.size());
+    for (unsigned i = 0; i < store.size(); i++) {
+        presetValues.push_back(ModulePresetValue(store.ids_[i], store.current_[i]));
     }
 
-    modulePreset = ModulePreset(module->type(), presetValues, module->getMidiMapping(), module->getModulationMapping());
+    modulePreset = ModulePreset(module->type(), std::move(presetValues), module->getMidiMapping(), module->getModulationMapping());
     return ret;
 }
 
-bool Rack::applyModulePreset(std::shared_ptr<Module> module, const ModulePreset &modulePreset) {
+bool Rack::applyModulePreset(std::shared_ptr<Module> module, const ModulePreset &modulePreset, bool changedOnly) {
     bool ret = false;
 
 
     // restore parameter values
-    for (auto p : modulePreset.values()) {
+    for (const auto &p : modulePreset.values()) {
         if (p.value().type() == ParamValue::T_Float) {
+            if (changedOnly) {
+                auto param = module->getParam(p.paramId());
+                if (param == nullptr || param->current() == p.value()) continue;
+            }
             model()->changeParam(CS_PRESET, model()->localRack()->id(), module->id(), p.paramId(), p.value());
             ret |= true;
         } //iffloat
         //TODO: preset, support non numeric types
     }
-    for(const auto &param: module->getParams()) {
-        if (param->current().type() ==  ParamValue::T_Float) {
-            model()->changeParam(CS_PRESET, model()->localRack()->id(), module->id(), param->id(),
-                                 param->current().floatValue());
+    if (!changedOnly) {
+        // e.g. on startup, send all values, so the receiver is in sync even for values not in the preset
+        const auto &store = module->store();
+        for (unsigned i = 0; i < store.size(); i++) {
+            if (store.current_[i].type() == ParamValue::T_Float) {
+                model()->changeParam(CS_PRESET, model()->localRack()->id(), module->id(), store.ids_[i],
+                                     store.current_[i].floatValue());
+            }
         }
     }
 
-    module->setMidiMapping(modulePreset.midiMap());
-    module->setModulationMapping(modulePreset.modulationMap());
-
     return ret;
 }
 
@@ -10,6 +10,7 @@
 #include <vector>
 #include <memory>
 #include <set>
+#include <cstdint>
 
 class cJSON;
 
@@ -26,11 +27,12 @@ public:
     ModulePresetValue(const EntityId &paramId, const ParamValue &v) :
             paramId_(paramId), value_(v) { ; }
 
-    ModulePresetValue(const ModulePresetValue &src) : paramId_(src.paramId_), value_(src.value_) { ; }
+    ModulePresetValue(EntityId &&paramId, const ParamValue &v) :
+            paramId_(std::move(paramId)), value_(v) { ; }
 
-    const EntityId &paramId() { return paramId_; }
+    const EntityId &paramId() const { return paramId_; }
 
-    ParamValue value() { return value_; }
+    const ParamValue &value() const { return value_; }
 
 private:
     EntityId paramId_;
@@ -43,29 +45,16 @@ public:
     ModulePreset() { ; }
 
     ModulePreset(std::string moduleType,
-                 const std::vector<ModulePresetValue> &values,
-                 const MidiMap &midimap,
-                 const ModulationMap &modmap) :
-            moduleType_(moduleType),
-            values_(values),
-            midi_map_(midimap),
-            mod_map_(modmap) {
+                 std::vector<ModulePresetValue> values,
+                 MidiMap midimap,
+                 ModulationMap modmap) :
+            moduleType_(std::move(moduleType)),
+            midi_map_(std::move(midimap)),
+            mod_map_(std::move(modmap)),
+            values_(std::move(values)) {
         ;
     }
 
-    ModulePreset(const ModulePreset &src) : moduleType_(src.moduleType_),
-                                            midi_map_(src.midi_map_),
-                                            mod_map_(src.mod_map_),
-                                            values_(src.values_) { ; }
-
-    ModulePreset &operator=(const ModulePreset &src) {
-        moduleType_ = src.moduleType_;
-        midi_map_ = src.midi_map_;
-        mod_map_ = src.mod_map_;
-        values_ = src.values_;
-        return *this;
-    };
-
     const std::string &moduleType() const { return moduleType_; }
 
     const MidiMap &midiMap() const { return midi_map_; }
@@ -81,9 +70,52 @@ private:
     std::vector<ModulePresetValue> values_;
 };
 
+typedef std::unordered_map<EntityId, ModulePreset> RackPreset; // key = module id
+
+
+// modification time (to the ns), size and inode of a file, to check cached data is still current,
+// so an edit within the same second, of the same size, or a file replaced by a rename is seen, size -1 = no file
+struct FileStamp {
+    FileStamp() : mtime_(0), mtimeNs_(0), size_(-1), inode_(0) { ; }
+
+    static FileStamp of(const std::string &file);
+
+    bool operator==(const FileStamp &s) const {
+        return mtime_ == s.mtime_ && mtimeNs_ == s.mtimeNs_ && size_ == s.size_ && inode_ == s.inode_;
+    }
+
+    bool operator!=(const FileStamp &s) const { return !(*this == s); }
+
+    int64_t mtime_;
+    int64_t mtimeNs_;
+    int64_t size_;
+    int64_t inode_;
+};
+
+// module definition as parsed from its module.json, kept so it can be cached in the rack snapshot
+struct ModuleDefinition {
+    struct PageDefinition {
+        EntityId id_;
+        std::string displayName_;
+        std::vector<EntityId> paramIds_;
+    };
+
+    std::string moduleType_;
+    std::string file_;
+    FileStamp stamp_;
+
+    std::string displayName_;
+    std::vector<std::vector<ParamValue>> params_; // parameter create args
+    std::vector<PageDefinition> pages_;
+};
+
 
 class KontrolModel;
+class RackSnapshot;
+class PresetCache;
 
+static const unsigned MAX_MIDI_CC = 128;
+static const unsigned MAX_MODULATION_BUS = 32;
 
 class Rack : public Entity {
 public:
@@ -96,7 +128,12 @@ public:
                 dataDir_("./data/orac"),
                 mediaDir_("./media"),
                 userModuleDir_("./usermodules"),
-                moduleDir_("modules") {
+                moduleDir_("modules"),
+                snapshotLoaded_(false) {
+        for (unsigned bus = 0; bus < MAX_MODULATION_BUS; bus++) {
+            modulationBus_[bus] = 0.0f;
+            modulationBusChanged_[bus] = false;
+        }
     }
 
     void initPrefs();
@@ -111,6 +148,8 @@ public:
 
 
     bool loadModuleDefinitions(const EntityId &moduleId, const mec::Preferences &prefs);
+    // from file, uses the snapshot if it is still current
+    bool loadModuleDefinitions(const EntityId &moduleId, const std::string &filename);
 
     bool loadSettings(const std::string &filename);
     bool loadSettings(const mec::Preferences &prefs);
@@ -123,6 +162,16 @@ public:
     bool savePreset(std::string presetId);
     std::vector<std::string> getPresetList();
 
+    static bool parsePreset(const std::string &filename, RackPreset &rackPreset);
+
+    // binary snapshot of definitions, preset list and current preset, used to warm start
+    // written on save and clean shutdown, only parts whose source files are unchanged are used
+    bool saveSnapshot();
+
+    // settings, presets and snapshot are written in the background by FileWriter
+    // returns once all saves requested so far are on disk, e.g. on shutdown
+    static void flushSaves();
+
     const std::string &mainDir() const { return mainDir_; }
     const std::string &dataDir() const { return dataDir_; }
     const std::string &mediaDir() const { return mediaDir_; }
@@ -145,9 +194,13 @@ public:
     void removeMidiCCMapping(unsigned ccnum, const EntityId &moduleId, const EntityId &paramId);
 
 
+    // modulation is latched per bus, and applied to parameters once per tick by processModulation
     bool changeModulation(unsigned bus, float value);
+    bool processModulation();
     void addModulationMapping(const std::string &src, unsigned bus, const EntityId &moduleId, const EntityId &paramId);
     void removeModulationMapping(const std::string &src, unsigned bus, const EntityId &moduleId, const EntityId &paramId);
+    // depth : scales bus value, slew : 0 = immediate, towards 1 = slower (fraction of distance remaining per tick)
+    bool modulationTarget(unsigned bus, const EntityId &moduleId, const EntityId &paramId, float depth, float slew);
 
 
     static std::shared_ptr<KontrolModel> model();
@@ -172,14 +225,39 @@ public:
     unsigned port() const { return port_; }
 
 private:
-    typedef std::unordered_map<EntityId, ModulePreset> RackPreset;
-    bool loadFilePreset(const std::string &presetId);
+    bool loadFilePreset(const std::string &presetId, bool changedOnly);
     bool saveFilePreset(const std::string &presetId);
 
-    bool loadModulePreset(RackPreset &rackPreset, const EntityId &moduleId, const mec::Preferences &prefs);
-    bool saveModulePreset(ModulePreset &, cJSON *root);
+    static bool loadModulePreset(RackPreset &rackPreset, const EntityId &moduleId, const mec::Preferences &prefs);
+    static bool saveModulePreset(const ModulePreset &, cJSON *root);
     bool updateModulePreset(std::shared_ptr<Module> module, ModulePreset &modulePreset);
-    bool applyModulePreset(std::shared_ptr<Module> module, const ModulePreset &modulePreset);
+    // changedOnly, only parameters whose value differs are changed/published
+    bool applyModulePreset(std::shared_ptr<Module> module, const ModulePreset &modulePreset, bool changedOnly);
+    bool applyRackPreset(bool changedOnly);
+    std::shared_ptr<PresetCache> presetCache();
+
+    bool applyModuleDefinitions(const std::shared_ptr<Module> &module, const ModuleDefinition &def);
+    std::shared_ptr<RackSnapshot> snapshot();
+    std::string snapshotFile() const { return dataDir_ + "/kontrol.snapshot"; }
+    std::string presetFile(const std::string &presetId) const { return dataDir_ + "/presets/" + presetId + "/params.json"; }
+
+    // pre-resolved midi cc targets, so dispatch does not need to search modules/params
+    struct MidiCCTarget {
+        std::shared_ptr<Module> module_;
+        std::shared_ptr<Parameter> param_;
+    };
+    void rebuildMidiCCTargets();
+
+    struct ModulationTarget {
+        unsigned bus_;
+        std::shared_ptr<Module> module_;
+        std::shared_ptr<Parameter> param_;
+        float depth_;
+        float slew_;
+        float value_; // smoothed bus value, pre calcFloat
+        bool settled_;
+    };
+    void rebuildModulationTargets();
 
     // platform prefs
     std::string host_;
@@ -194,12 +272,23 @@ private:
     std::string currentPreset_;
 
     std::string settingsFile_;
+    std::string settingsPreset_; // current preset, as loaded/saved in settings file
     std::shared_ptr<mec::Preferences> settings_;
 
     std::map<EntityId, std::shared_ptr<Module>> modules_;
     std::unordered_map<std::string, std::set<std::string>> resources_;
     std::vector<std::string> presets_;
-    RackPreset rackPreset_;
+    std::shared_ptr<const RackPreset> rackPreset_; // shared with preset cache, replaced not modified
+    std::shared_ptr<PresetCache> presetCache_;
+    std::vector<MidiCCTarget> midiCCTargets_[MAX_MIDI_CC]; // index = cc num
+
+    float modulationBus_[MAX_MODULATION_BUS];
+    bool modulationBusChanged_[MAX_MODULATION_BUS];
+    std::vector<ModulationTarget> modulationTargets_;
+
+    std::unordered_map<EntityId, ModuleDefinition> moduleDefinitions_; // loaded from file, key = module id
+    std::shared_ptr<RackSnapshot> snapshot_;
+    bool snapshotLoaded_;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include "SlabPool.h"
+
+namespace Kontrol {
+
+SlabPool::SlabPool(std::initializer_list<unsigned> sizes, unsigned count) {
+    for (unsigned size : sizes) {
+        slabs_.push_back(std::unique_ptr<Slab>(new Slab(size, count)));
+    }
+    for (unsigned s = 0; s < slabs_.size(); s++) {
+        for (unsigned i = 0; i < count; i++) {
+            slabs_[s]->spare_.push_back(allocate(s));
+        }
+    }
+}
+
+SlabPool::Buffer *SlabPool::allocate(unsigned slab) {
+    std::unique_ptr<Buffer> b(new Buffer);
+    b->size_ = 0;
+    b->capacity_ = slabs_[slab]->capacity_;
+    b->slab_ = slab;
+    b->data_.reset(new char[b->capacity_]);
+    buffers_.push_back(std::move(b));
+    return buffers_.back().get();
+}
+
+SlabPool::Buffer *SlabPool::acquire(unsigned size) {
+    for (unsigned s = 0; s < slabs_.size(); s++) {
+        Slab &slab = *slabs_[s];
+        if (size > slab.capacity_) continue;
+        if (slab.spare_.empty()) {
+            Buffer *b = nullptr;
+            while (slab.free_.try_dequeue(b)) slab.spare_.push_back(b);
+        }
+        Buffer *b;
+        if (!slab.spare_.empty()) {
+            b = slab.spare_.back();
+            slab.spare_.pop_back();
+        } else {
+            b = allocate(s);
+        }
+        b->size_ = size;
+        return b;
+    }
+    return nullptr;
+}
+
+void SlabPool::release(Buffer *buffer) {
+    if (buffer != nullptr) slabs_[buffer->slab_]->free_.enqueue(buffer);
+}
+
+} //namespace
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+#include <readerwriterqueue.h>
+
+namespace Kontrol {
+
+// variable size buffers, in size classes, passed from a producer thread to a consumer thread
+// the producer acquires a buffer of the smallest class which fits, the consumer releases it back,
+// so messages are not clamped to one size, and small messages don't hold large buffers
+// a class grows if all its buffers are in use (e.g. a burst as a rack is published)
+class SlabPool {
+public:
+    struct Buffer {
+        unsigned size_;     // used
+        unsigned capacity_;
+        unsigned slab_;     // size class
+        std::unique_ptr<char[]> data_;
+    };
+
+    // sizes ascending, count = initial buffers in each class
+    SlabPool(std::initializer_list<unsigned> sizes, unsigned count);
+
+    // largest buffer
+    unsigned maxSize() const { return slabs_.back()->capacity_; }
+
+    // buffers allocated, in all classes
+    unsigned buffers() const { return (unsigned) buffers_.size(); }
+
+    // producer, nullptr if larger than maxSize
+    Buffer *acquire(unsigned size);
+    // consumer
+    void release(Buffer *buffer);
+
+private:
+    struct Slab {
+        explicit Slab(unsigned capacity, unsigned count) : capacity_(capacity), free_(count) { ; }
+
+        unsigned capacity_;
+        std::vector<Buffer *> spare_;                  // producer
+        moodycamel::ReaderWriterQueue<Buffer *> free_; // consumer to producer
+    };
+
+    Buffer *allocate(unsigned slab);
+
+    std::vector<std::unique_ptr<Slab>> slabs_;
+    std::vector<std::unique_ptr<Buffer>> buffers_; // all of them, grown by the producer
+};
+
+} //namespace
@@ -0,0 +1,347 @@
+#include "Snapshot.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#endif
+
+#include <mec_log.h>
+
+namespace Kontrol {
+
+static const char SNAPSHOT_MAGIC[4] = {'K', 'S', 'N', 'P'};
+static const size_t SNAPSHOT_HEADER_SIZE = 16; // magic, version, payload size, checksum
+
+FileStamp FileStamp::of(const std::string &file) {
+    FileStamp stamp;
+    struct stat st;
+    if (stat(file.c_str(), &st) == 0) {
+        stamp.mtime_ = (int64_t) st.st_mtime;
+#if defined(__APPLE__)
+        stamp.mtimeNs_ = (int64_t) st.st_mtimespec.tv_nsec;
+#elif !defined(_WIN32)
+        stamp.mtimeNs_ = (int64_t) st.st_mtim.tv_nsec;
+#endif
+        stamp.size_ = (int64_t) st.st_size;
+        stamp.inode_ = (int64_t) st.st_ino;
+    }
+    return stamp;
+}
+
+// FNV-1a
+static uint32_t checksum(const char *data, size_t size) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        h ^= (uint8_t) data[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// snapshot is only read on the machine that wrote it, so values are stored in native byte order
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(std::string &data) : data_(data) { ; }
+
+    void u32(uint32_t v) { data_.append((const char *) &v, sizeof(v)); }
+
+    void i64(int64_t v) { data_.append((const char *) &v, sizeof(v)); }
+
+    void f32(float v) { data_.append((const char *) &v, sizeof(v)); }
+
+    void str(const std::string &s) {
+        u32((uint32_t) s.size());
+        data_.append(s);
+    }
+
+    void stamp(const FileStamp &s) {
+        i64(s.mtime_);
+        i64(s.mtimeNs_);
+        i64(s.size_);
+        i64(s.inode_);
+    }
+
+    void value(const ParamValue &v) {
+        u32((uint32_t) v.type());
+        if (v.type() == ParamValue::T_String) str(v.stringValue());
+        else f32(v.floatValue());
+    }
+
+    void map(const std::unordered_map<unsigned, std::vector<EntityId>> &m) {
+        u32((uint32_t) m.size());
+        for (const auto &e : m) {
+            u32(e.first);
+            u32((uint32_t) e.second.size());
+            for (const auto &id : e.second) str(id);
+        }
+    }
+
+private:
+    std::string &data_;
+};
+
+// all reads are bounds checked, on overrun ok() becomes false and zero/empty values are returned
+class SnapshotReader {
+public:
+    SnapshotReader(const char *data, size_t size) : data_(data), size_(size), pos_(0), ok_(true) { ; }
+
+    bool ok() const { return ok_; }
+
+    uint32_t u32() {
+        uint32_t v = 0;
+        get(&v, sizeof(v));
+        return v;
+    }
+
+    int64_t i64() {
+        int64_t v = 0;
+        get(&v, sizeof(v));
+        return v;
+    }
+
+    float f32() {
+        float v = 0.0f;
+        get(&v, sizeof(v));
+        return v;
+    }
+
+    std::string str() {
+        uint32_t n = u32();
+        if (!ok_ || n > size_ - pos_) {
+            ok_ = false;
+            return std::string();
+        }
+        std::string s(data_ + pos_, n);
+        pos_ += n;
+        return s;
+    }
+
+    FileStamp stamp() {
+        FileStamp s;
+        s.mtime_ = i64();
+        s.mtimeNs_ = i64();
+        s.size_ = i64();
+        s.inode_ = i64();
+        return s;
+    }
+
+    ParamValue value() {
+        uint32_t t = u32();
+        if (t == ParamValue::T_String) return ParamValue(str());
+        return ParamValue(f32());
+    }
+
+    // element counts are bounded by remaining data, so a corrupt count cannot cause a huge allocation
+    uint32_t count() {
+        uint32_t n = u32();
+        if (n > size_ - pos_) ok_ = false;
+        return ok_ ? n : 0;
+    }
+
+    void map(std::unordered_map<unsigned, std::vector<EntityId>> &m) {
+        uint32_t n = count();
+        for (uint32_t i = 0; i < n && ok_; i++) {
+            unsigned key = u32();
+            uint32_t nids = count();
+            auto &ids = m[key];
+            for (uint32_t j = 0; j < nids && ok_; j++) ids.push_back(str());
+        }
+    }
+
+private:
+    void get(void *v, size_t n) {
+        if (!ok_ || n > size_ - pos_) {
+            ok_ = false;
+            return;
+        }
+        memcpy(v, data_ + pos_, n);
+        pos_ += n;
+    }
+
+    const char *data_;
+    size_t size_;
+    size_t pos_;
+    bool ok_;
+};
+
+
+void RackSnapshot::write(std::string &data) const {
+    SnapshotWriter w(data);
+
+    w.str(settingsFile_);
+    w.stamp(settingsStamp_);
+    w.str(settingsPreset_);
+
+    w.stamp(presetsDirStamp_);
+    w.u32((uint32_t) presets_.size());
+    for (const auto &p : presets_) w.str(p);
+
+    w.u32(presetCached_ ? 1 : 0);
+    w.stamp(presetStamp_);
+    w.u32((uint32_t) rackPreset_.size());
+    for (const auto &mp : rackPreset_) {
+        w.str(mp.first);
+        w.str(mp.second.moduleType());
+        w.u32((uint32_t) mp.second.values().size());
+        for (const auto &v : mp.second.values()) {
+            w.str(v.paramId());
+            w.value(v.value());
+        }
+        w.map(mp.second.midiMap());
+        w.map(mp.second.modulationMap());
+    }
+
+    w.u32((uint32_t) modules_.size());
+    for (const auto &m : modules_) {
+        const auto &def = m.second;
+        w.str(m.first);
+        w.str(def.moduleType_);
+        w.str(def.file_);
+        w.stamp(def.stamp_);
+        w.str(def.displayName_);
+        w.u32((uint32_t) def.params_.size());
+        for (const auto &args : def.params_) {
+            w.u32((uint32_t) args.size());
+            for (const auto &a : args) w.value(a);
+        }
+        w.u32((uint32_t) def.pages_.size());
+        for (const auto &page : def.pages_) {
+            w.str(page.id_);
+            w.str(page.displayName_);
+            w.u32((uint32_t) page.paramIds_.size());
+            for (const auto &id : page.paramIds_) w.str(id);
+        }
+    }
+}
+
+bool RackSnapshot::read(const char *data, size_t size) {
+    SnapshotReader r(data, size);
+
+    settingsFile_ = r.str();
+    settingsStamp_ = r.stamp();
+    settingsPreset_ = r.str();
+
+    presetsDirStamp_ = r.stamp();
+    uint32_t npresets = r.count();
+    for (uint32_t i = 0; i < npresets && r.ok(); i++) presets_.push_back(r.str());
+
+    presetCached_ = r.u32() != 0;
+    presetStamp_ = r.stamp();
+    uint32_t nmodulepresets = r.count();
+    for (uint32_t i = 0; i < nmodulepresets && r.ok(); i++) {
+        EntityId moduleId = r.str();
+        std::string moduleType = r.str();
+        std::vector<ModulePresetValue> values;
+        uint32_t nvalues = r.count();
+        for (uint32_t j = 0; j < nvalues && r.ok(); j++) {
+            EntityId paramId = r.str();
+            ParamValue v = r.value();
+            values.push_back(ModulePresetValue(std::move(paramId), v));
+        }
+        MidiMap midiMap;
+        ModulationMap modMap;
+        r.map(midiMap);
+        r.map(modMap);
+        rackPreset_[moduleId] = ModulePreset(std::move(moduleType), std::move(values),
+                                             std::move(midiMap), std::move(modMap));
+    }
+
+    uint32_t nmodules = r.count();
+    for (uint32_t i = 0; i < nmodules && r.ok(); i++) {
+        EntityId moduleId = r.str();
+        ModuleDefinition &def = modules_[moduleId];
+        def.moduleType_ = r.str();
+        def.file_ = r.str();
+        def.stamp_ = r.stamp();
+        def.displayName_ = r.str();
+        uint32_t nparams = r.count();
+        for (uint32_t j = 0; j < nparams && r.ok(); j++) {
+            std::vector<ParamValue> args;
+            uint32_t nargs = r.count();
+            for (uint32_t k = 0; k < nargs && r.ok(); k++) args.push_back(r.value());
+            def.params_.push_back(std::move(args));
+        }
+        uint32_t npages = r.count();
+        for (uint32_t j = 0; j < npages && r.ok(); j++) {
+            ModuleDefinition::PageDefinition page;
+            page.id_ = r.str();
+            page.displayName_ = r.str();
+            uint32_t nids = r.count();
+            for (uint32_t k = 0; k < nids && r.ok(); k++) page.paramIds_.push_back(r.str());
+            def.pages_.push_back(std::move(page));
+        }
+    }
+    return r.ok();
+}
+
+
+bool RackSnapshot::load(const std::string &file) {
+    bool ret = false;
+#ifndef _WIN32
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < SNAPSHOT_HEADER_SIZE) {
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t) st.st_size;
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return false;
+    const char *data = static_cast<const char *>(mapped);
+#else
+    std::ifstream infile(file.c_str(), std::ios::binary);
+    if (!infile) return false;
+    std::string buf((std::istreambuf_iterator<char>(infile)), std::istreambuf_iterator<char>());
+    size_t size = buf.size();
+    if (size < SNAPSHOT_HEADER_SIZE) return false;
+    const char *data = buf.data();
+#endif
+
+    uint32_t version, payloadSize, sum;
+    memcpy(&version, data + 4, sizeof(uint32_t));
+    memcpy(&payloadSize, data + 8, sizeof(uint32_t));
+    memcpy(&sum, data + 12, sizeof(uint32_t));
+    const char *payload = data + SNAPSHOT_HEADER_SIZE;
+
+    if (memcmp(data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        LOG_1("RackSnapshot::load invalid snapshot " << file);
+    } else if (version != FORMAT_VERSION) {
+        LOG_1("RackSnapshot::load snapshot version " << version << " not supported, ignoring " << file);
+    } else if (payloadSize != size - SNAPSHOT_HEADER_SIZE || checksum(payload, payloadSize) != sum) {
+        LOG_0("RackSnapshot::load corrupt snapshot " << file);
+    } else {
+        ret = read(payload, payloadSize);
+        if (!ret) LOG_0("RackSnapshot::load error reading snapshot " << file);
+    }
+
+#ifndef _WIN32
+    munmap(mapped, size);
+#endif
+    return ret;
+}
+
+void RackSnapshot::save(std::string &data) const {
+    std::string payload;
+    write(payload);
+
+    uint32_t version = FORMAT_VERSION;
+    uint32_t payloadSize = (uint32_t) payload.size();
+    uint32_t sum = checksum(payload.data(), payload.size());
+
+    data.reserve(SNAPSHOT_HEADER_SIZE + payload.size());
+    data.append(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    data.append((const char *) &version, sizeof(version));
+    data.append((const char *) &payloadSize, sizeof(payloadSize));
+    data.append((const char *) &sum, sizeof(sum));
+    data.append(payload);
+}
+
+} //namespace
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Rack.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace Kontrol {
+
+// binary snapshot of a local rack, so startup can avoid parsing json and scanning preset directories
+// each part records the stamp of the file(s) it came from, the rack only uses parts that are still current
+class RackSnapshot {
+public:
+    static const uint32_t FORMAT_VERSION = 2;
+
+    RackSnapshot() : presetCached_(false) { ; }
+
+    // file is memory mapped, and checked for magic, version, size and checksum
+    bool load(const std::string &file);
+    // complete file content, header and payload, written via FileWriter
+    void save(std::string &data) const;
+
+    std::string settingsFile_;
+    FileStamp settingsStamp_;
+    std::string settingsPreset_;
+
+    FileStamp presetsDirStamp_;
+    std::vector<std::string> presets_;
+
+    bool presetCached_; // rackPreset_ holds settingsPreset_
+    FileStamp presetStamp_;
+    RackPreset rackPreset_;
+
+    std::unordered_map<EntityId, ModuleDefinition> modules_; // key = module id
+
+private:
+    bool read(const char *data, size_t size);
+    void write(std::string &data) const;
+};
+
+} //namespace
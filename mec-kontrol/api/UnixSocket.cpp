@@ -0,0 +1,175 @@
+#include "UnixSocket.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#endif
+
+#include <mec_log.h>
+#include <mec_metrics.h>
+
+namespace Kontrol {
+
+static const char *UNIX_PREFIX = "unix:";
+static const std::size_t UNIX_PREFIX_LEN = 5;
+static const unsigned SEND_TIMEOUT_MS = 100;
+static const unsigned RECEIVE_TIMEOUT_MS = 250;
+
+bool isUnixEndpoint(const std::string &host) {
+    return host.compare(0, UNIX_PREFIX_LEN, UNIX_PREFIX) == 0;
+}
+
+std::string unixPath(const std::string &endpoint) {
+    return isUnixEndpoint(endpoint) ? endpoint.substr(UNIX_PREFIX_LEN) : endpoint;
+}
+
+std::string unixEndpoint(const std::string &path) {
+    return UNIX_PREFIX + path;
+}
+
+#ifdef __linux__
+
+static sockaddr_un unixAddress(const std::string &path) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("invalid unix socket path : " + path);
+    }
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    return addr;
+}
+
+UnixTransmitSocket::UnixTransmitSocket(const std::string &path) : path_(path) {
+    unixAddress(path); // validates
+    socket_ = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (socket_ < 0) throw std::runtime_error("unable to create unix socket");
+    // autobind, so the receiver can tell senders apart
+    sa_family_t family = AF_UNIX;
+    if (bind(socket_, (sockaddr *) &family, sizeof(family)) < 0) {
+        int err = errno;
+        close(socket_);
+        throw std::runtime_error("unable to autobind unix socket : " + std::string(strerror(err)));
+    }
+    // unix datagram queues are short (e.g. 10 packets on linux), so a burst waits for the receiver,
+    // but not for a receiver which has stopped reading
+    timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = SEND_TIMEOUT_MS * 1000;
+    setsockopt(socket_, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+UnixTransmitSocket::~UnixTransmitSocket() {
+    close(socket_);
+}
+
+bool UnixTransmitSocket::Send(const char *data, std::size_t size) {
+    static mec::Counter &dropped = mec::Metrics::counter("kontrol.send.unix.dropped");
+    sockaddr_un addr = unixAddress(path_);
+    // not connected, like udp the receiver need not be listening yet, and may restart
+    if (sendto(socket_, data, size, 0, (sockaddr *) &addr, sizeof(addr)) < 0) {
+        dropped.inc();
+        return false;
+    }
+    return true;
+}
+
+// 0 if a receiver is bound to the address, ECONNREFUSED if the socket is stale (no one is bound to it)
+static int probe(const sockaddr_un &addr) {
+    int s = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (s < 0) return errno;
+    int err = connect(s, (const sockaddr *) &addr, sizeof(addr)) < 0 ? errno : 0;
+    close(s);
+    return err;
+}
+
+UnixReceiveSocket::UnixReceiveSocket(const std::string &path) : path_(path) {
+    sockaddr_un addr = unixAddress(path);
+    socket_ = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (socket_ < 0) throw std::runtime_error("unable to create unix socket");
+    // a stale socket, from a previous run, but never anything else at the path, or a socket still in use
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            close(socket_);
+            throw std::runtime_error("unix socket path " + path + " exists, and is not a socket");
+        }
+        int err = probe(addr);
+        if (err != ECONNREFUSED) {
+            close(socket_);
+            if (err == 0) throw std::runtime_error("unix socket " + path + " is in use");
+            throw std::runtime_error("unable to check unix socket " + path + " : " + strerror(err));
+        }
+        unlink(path.c_str());
+    }
+    if (bind(socket_, (sockaddr *) &addr, sizeof(addr)) < 0) {
+        int err = errno;
+        close(socket_);
+        throw std::runtime_error("unable to bind unix socket " + path + " : " + strerror(err));
+    }
+    // so a receive thread sees it is stopped, even if its wake is lost
+    timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = RECEIVE_TIMEOUT_MS * 1000;
+    setsockopt(socket_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+}
+
+UnixReceiveSocket::~UnixReceiveSocket() {
+    close(socket_);
+    unlink(path_.c_str());
+}
+
+std::size_t UnixReceiveSocket::ReceiveFrom(IpEndpointName &origin, char *data, std::size_t size) {
+    std::string sender;
+    return ReceiveFrom(origin, sender, data, size);
+}
+
+std::size_t UnixReceiveSocket::ReceiveFrom(IpEndpointName &origin, std::string &sender, char *data, std::size_t size) {
+    sockaddr_un from;
+    socklen_t fromLen = sizeof(from);
+    memset(&from, 0, sizeof(from));
+    ssize_t result = recvfrom(socket_, data, size, 0, (sockaddr *) &from, &fromLen);
+    if (result < 0) return 0;
+
+    std::size_t pathLen = fromLen > sizeof(sa_family_t) ? fromLen - sizeof(sa_family_t) : 0;
+    origin.address = 0x7f000001; // 127.0.0.1
+    origin.port = 0;
+    // autobound addresses are abstract, starting with a nul, shown as @
+    sender.assign(from.sun_path, pathLen);
+    if (!sender.empty() && sender[0] == '\0') sender[0] = '@';
+    return (std::size_t) result;
+}
+
+#else
+
+// without linux's autobind, a receiver can't tell senders apart
+UnixTransmitSocket::UnixTransmitSocket(const std::string &path) : socket_(-1), path_(path) {
+    throw std::runtime_error("unix sockets are not supported");
+}
+
+UnixTransmitSocket::~UnixTransmitSocket() { ; }
+
+bool UnixTransmitSocket::Send(const char *, std::size_t) { return false; }
+
+UnixReceiveSocket::UnixReceiveSocket(const std::string &path) : socket_(-1), path_(path) {
+    throw std::runtime_error("unix sockets are not supported");
+}
+
+UnixReceiveSocket::~UnixReceiveSocket() { ; }
+
+std::size_t UnixReceiveSocket::ReceiveFrom(IpEndpointName &, char *, std::size_t) { return 0; }
+
+std::size_t UnixReceiveSocket::ReceiveFrom(IpEndpointName &, std::string &, char *, std::size_t) { return 0; }
+
+#endif
+
+} //namespace
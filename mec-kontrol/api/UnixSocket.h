@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include <ip/IpEndpointName.h>
+
+namespace Kontrol {
+
+// AF_UNIX datagram sockets, for clients on the same host (e.g. mec, pd and a display on one box)
+// a drop in for oscpack's udp sockets, without the ip stack, checksums or ports
+// a unix endpoint is used in place of a host, as unix:/path, with port 0
+bool isUnixEndpoint(const std::string &host);
+// path of a unix endpoint
+std::string unixPath(const std::string &endpoint);
+std::string unixEndpoint(const std::string &path);
+
+// throws std::runtime_error if the socket can't be created, as oscpack does
+// linux only, senders are told apart by their autobound address, elsewhere the constructors throw
+class UnixTransmitSocket {
+public:
+    explicit UnixTransmitSocket(const std::string &path);
+    ~UnixTransmitSocket();
+
+    // a packet is dropped (as udp would) if the receiver is not listening, or is full for more than a short timeout
+    bool Send(const char *data, std::size_t size);
+
+private:
+    UnixTransmitSocket(const UnixTransmitSocket &) = delete;
+    UnixTransmitSocket &operator=(const UnixTransmitSocket &) = delete;
+
+    int socket_;
+    std::string path_;
+};
+
+// the path is (re)created, and removed when closed
+// a path which is not a socket, or a socket another receiver is still bound to, is an error
+class UnixReceiveSocket {
+public:
+    explicit UnixReceiveSocket(const std::string &path);
+    ~UnixReceiveSocket();
+
+    // blocking, 0 on the receive timeout (errno EAGAIN), or an error (errno set)
+    // unix senders have no ip address, so origin is loopback, port 0
+    std::size_t ReceiveFrom(IpEndpointName &origin, char *data, std::size_t size);
+    // sender is the address of the sending socket, which identifies it (autobound, @ then 5 hex digits)
+    std::size_t ReceiveFrom(IpEndpointName &origin, std::string &sender, char *data, std::size_t size);
+
+    const std::string &path() const { return path_; }
+
+private:
+    UnixReceiveSocket(const UnixReceiveSocket &) = delete;
+    UnixReceiveSocket &operator=(const UnixReceiveSocket &) = delete;
+
+    int socket_;
+    std::string path_;
+};
+
+} //namespace
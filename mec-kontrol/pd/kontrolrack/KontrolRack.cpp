@@ -13,6 +13,8 @@
 #include <algorithm>
 #include <clocale>
 
+#include <FileWriter.h>
+
 #if ! DISABLE_TTUI
     #include "devices/TerminalTedium.h"
 #endif 
@@ -143,9 +145,15 @@ void KontrolRack_tick(t_KontrolRack *x) {
         x->device_->poll();
     }
 
+    // apply modulation received since last tick, in one pass
+    auto rack = x->model_->getLocalRack();
+    if (rack) {
+        rack->processModulation();
+    }
+
     if (x->osc_broadcaster_ && x->osc_receiver_
         && x->pollCount_ % OSC_PING_FREQUENCY == 0) {
-        x->osc_broadcaster_->sendPing(x->osc_receiver_->port());
+        x->osc_broadcaster_->sendPing(x->osc_receiver_->port(), x->osc_receiver_->endpoint());
     }
 
     clock_delay(x->x_clock, 1);
@@ -154,6 +162,10 @@ void KontrolRack_tick(t_KontrolRack *x) {
 
 void KontrolRack_free(t_KontrolRack *x) {
     clock_free(x->x_clock);
+    auto rack = x->model_->getLocalRack();
+    if (rack) rack->saveSnapshot();
+    // saves are written in the background, make sure they are complete before pd exits
+    Kontrol::Rack::flushSaves();
     x->model_->deleteRack(Kontrol::CS_LOCAL, x->model_->localRackId());
     x->model_->clearCallbacks();
     if (x->osc_receiver_) x->osc_receiver_->stop();
@@ -166,12 +178,28 @@ void KontrolRack_free(t_KontrolRack *x) {
     delete x->param_monitors_;
 }
 
+// a port, or a unix:/path endpoint
+static void KontrolRack_endpointArg(t_atom *arg, std::string &endpoint, unsigned &port) {
+    if (arg->a_type == A_SYMBOL) {
+        endpoint = atom_getsymbol(arg)->s_name;
+        port = 0;
+    } else {
+        endpoint.clear();
+        port = (unsigned) atom_getfloat(arg);
+    }
+}
+
+static void KontrolRack_listenOn(t_KontrolRack *x, const std::string &endpoint, unsigned port);
+static void KontrolRack_connectTo(t_KontrolRack *x, const std::string &endpoint, unsigned port);
+
 void *KontrolRack_new(t_symbol* sym, int argc, t_atom *argv) {
     t_KontrolRack *x = (t_KontrolRack *) pd_new(KontrolRack_class);
     x->param_monitors_ = new std::unordered_map<t_symbol *, t_KontrolMonitor*>();
 
-    int clientport = 0;
-    int serverport = 0;
+    unsigned clientport = 0;
+    unsigned serverport = 0;
+    std::string clientendpoint;
+    std::string serverendpoint;
     std::string device = "organelle";
     int argcount = 0;
 
@@ -186,17 +214,17 @@ void *KontrolRack_new(t_symbol* sym, int argc, t_atom *argv) {
                 clientport = atom_getfloat(arg);
             }
         } else if (arg->a_type == A_SYMBOL) {
-            // new format: [device] [serverport] [clientport]
+            // new format: [device] [serverport] [clientport], ports may be unix:/path
             t_symbol* sym = atom_getsymbol(arg);
             device = sym->s_name;
             argcount++;
             if(argcount < argc) {
                 arg = argv + argcount;
-                serverport = atom_getfloat(arg);
+                KontrolRack_endpointArg(arg, serverendpoint, serverport);
                 argcount++;
                 if(argcount < argc) {
                     arg = argv + argcount;
-                    clientport = atom_getfloat(arg);
+                    KontrolRack_endpointArg(arg, clientendpoint, clientport);
                 }
             }
         }
@@ -206,11 +234,16 @@ void *KontrolRack_new(t_symbol* sym, int argc, t_atom *argv) {
     x->osc_receiver_ = nullptr;
     x->single_module_mode_ = false;
     x->monitor_enable_ = false;
+    x->modulation_rate_ = Kontrol::OSCBroadcaster::MODULATION_RATE_MS;
 
     x->pollCount_ = 0;
     x->model_ = Kontrol::KontrolModel::model();
 
-    x->model_->createLocalRack((unsigned int) clientport);
+    if (Kontrol::isUnixEndpoint(clientendpoint)) {
+        x->model_->createLocalRack(0, clientendpoint);
+    } else {
+        x->model_->createLocalRack(clientport);
+    }
     x->model_->localRack()->initPrefs();
 
     if(device=="organelle") {
@@ -244,8 +277,8 @@ void *KontrolRack_new(t_symbol* sym, int argc, t_atom *argv) {
 
     x->model_->addCallback("pd.send", std::make_shared<PdCallback>(x));
 
-    KontrolRack_listen(x, clientport);
-    KontrolRack_connect(x, serverport);
+    KontrolRack_listenOn(x, clientendpoint, clientport);
+    KontrolRack_connectTo(x, serverendpoint, serverport);
 
     x->x_clock = clock_new(x, (t_method) KontrolRack_tick);
     clock_setunit(x->x_clock, TICK_MS, 0);
@@ -267,10 +300,10 @@ EXTERN void KontrolRack_setup(void) {
 
     class_addmethod(KontrolRack_class,
                     (t_method) KontrolRack_listen, gensym("listen"),
-                    A_DEFFLOAT, A_NULL);
+                    A_GIMME, A_NULL);
     class_addmethod(KontrolRack_class,
                     (t_method) KontrolRack_connect, gensym("connect"),
-                    A_DEFFLOAT, A_NULL);
+                    A_GIMME, A_NULL);
 
     class_addmethod(KontrolRack_class,
                     (t_method) KontrolRack_knob1Raw, gensym("knob1Raw"),
@@ -310,6 +343,18 @@ EXTERN void KontrolRack_setup(void) {
                     (t_method) KontrolRack_modulate, gensym("modulate"),
                     A_DEFSYMBOL, A_DEFFLOAT, A_DEFFLOAT, A_NULL);
 
+    class_addmethod(KontrolRack_class,
+                    (t_method) KontrolRack_modulationtarget, gensym("modulationtarget"),
+                    A_GIMME, A_NULL);
+
+    class_addmethod(KontrolRack_class,
+                    (t_method) KontrolRack_modulationrate, gensym("modulationrate"),
+                    A_DEFFLOAT, A_NULL);
+
+    class_addmethod(KontrolRack_class,
+                    (t_method) KontrolRack_filesync, gensym("filesync"),
+                    A_DEFSYMBOL, A_NULL);
+
     class_addmethod(KontrolRack_class,
                     (t_method) KontrolRack_loadsettings, gensym("loadsettings"),
                     A_DEFSYMBOL, A_NULL);
@@ -606,10 +651,10 @@ void KontrolRack_monitorenable(t_KontrolRack *x, t_floatarg f) {
     x->monitor_enable_ = enable;
 }
 
-void KontrolRack_connect(t_KontrolRack *x, t_floatarg f) {
-    if (f > 0) {
-        std::string host = "127.0.0.1";
-        unsigned port = (unsigned) f;
+static void KontrolRack_connectTo(t_KontrolRack *x, const std::string &endpoint, unsigned port) {
+    bool unixSocket = Kontrol::isUnixEndpoint(endpoint);
+    if (port > 0 || unixSocket) {
+        std::string host = unixSocket ? endpoint : "127.0.0.1";
         std::string srcId = host + ":" + std::to_string(port);
         std::string id = "pd.osc:" + srcId;
         x->model_->removeCallback(id);
@@ -617,21 +662,23 @@ void KontrolRack_connect(t_KontrolRack *x, t_floatarg f) {
                 Kontrol::ChangeSource(Kontrol::ChangeSource::REMOTE, srcId),
                 OSC_PING_FREQUENCY_SEC,
                 false);
+        p->modulationRate(x->modulation_rate_);
         if (p->connect(host, port)) {
             post("client connected %s", id.c_str());
             x->model_->addCallback(id, p);
             x->osc_broadcaster_ = p;
             if (x->osc_receiver_) {
-                x->osc_broadcaster_->sendPing(x->osc_receiver_->port());
+                x->osc_broadcaster_->sendPing(x->osc_receiver_->port(), x->osc_receiver_->endpoint());
             }
         }
     }
 }
 
-void KontrolRack_listen(t_KontrolRack *x, t_floatarg f) {
-    if (f > 0) {
+static void KontrolRack_listenOn(t_KontrolRack *x, const std::string &endpoint, unsigned port) {
+    bool unixSocket = Kontrol::isUnixEndpoint(endpoint);
+    if (port > 0 || unixSocket) {
         auto p = std::make_shared<Kontrol::OSCReceiver>(x->model_);
-        if (p->listen((unsigned) f)) {
+        if (unixSocket ? p->listen(endpoint) : p->listen(port)) {
             x->osc_receiver_ = p;
         }
     } else {
@@ -639,6 +686,20 @@ void KontrolRack_listen(t_KontrolRack *x, t_floatarg f) {
     }
 }
 
+void KontrolRack_connect(t_KontrolRack *x, t_symbol *, int argc, t_atom *argv) {
+    std::string endpoint;
+    unsigned port = 0;
+    if (argc > 0) KontrolRack_endpointArg(argv, endpoint, port);
+    KontrolRack_connectTo(x, endpoint, port);
+}
+
+void KontrolRack_listen(t_KontrolRack *x, t_symbol *, int argc, t_atom *argv) {
+    std::string endpoint;
+    unsigned port = 0;
+    if (argc > 0) KontrolRack_endpointArg(argv, endpoint, port);
+    KontrolRack_listenOn(x, endpoint, port);
+}
+
 void KontrolRack_enc(t_KontrolRack *x, t_floatarg f) {
     if (x->device_) x->device_->changeEncoder(0, f);
 }
@@ -828,6 +889,46 @@ void KontrolRack_modulate(t_KontrolRack *x, t_symbol* src, t_floatarg bus, t_flo
     }
 }
 
+// modulationtarget bus modId paramId depth [slew]
+void KontrolRack_modulationtarget(t_KontrolRack *x, t_symbol *s, int argc, t_atom *argv) {
+    if (argc < 4
+        || argv[0].a_type != A_FLOAT
+        || argv[1].a_type != A_SYMBOL
+        || argv[2].a_type != A_SYMBOL
+        || argv[3].a_type != A_FLOAT) {
+        post("error modulationtarget bus modid paramid depth [slew]");
+        return;
+    }
+    auto rack = x->model_->getLocalRack();
+    if (!rack) { post("No local rack found"); return;}
+
+    unsigned bus = (unsigned) atom_getfloat(&argv[0]);
+    std::string modId = atom_getsymbol(&argv[1])->s_name;
+    std::string paramId = atom_getsymbol(&argv[2])->s_name;
+    float depth = atom_getfloat(&argv[3]);
+    float slew = argc > 4 ? atom_getfloat(&argv[4]) : 0.0f;
+    if (!rack->modulationTarget(bus, modId, paramId, depth, slew)) {
+        post("modulationtarget: no mapping for bus %d %s %s", bus, modId.c_str(), paramId.c_str());
+    }
+}
+
+void KontrolRack_modulationrate(t_KontrolRack *x, t_floatarg f) {
+    x->modulation_rate_ = f > 0 ? (unsigned) f : 0;
+    if (x->osc_broadcaster_) {
+        x->osc_broadcaster_->modulationRate(x->modulation_rate_);
+    }
+}
+
+// filesync none|file|dir, how far preset/settings writes are synced to disk, default file
+void KontrolRack_filesync(t_KontrolRack *x, t_symbol *policy) {
+    std::string p = policy != nullptr && policy->s_name != nullptr ? policy->s_name : "";
+    auto writer = Kontrol::FileWriter::writer();
+    if (p == "none") writer->syncPolicy(Kontrol::FileWriter::SYNC_NONE);
+    else if (p == "file") writer->syncPolicy(Kontrol::FileWriter::SYNC_FILE);
+    else if (p == "dir") writer->syncPolicy(Kontrol::FileWriter::SYNC_DIR);
+    else post("error filesync none|file|dir");
+}
+
 
 void KontrolRack_setparam(t_KontrolRack* x, t_symbol* modId, t_symbol* paramId, t_floatarg value) {
     auto rack = Kontrol::KontrolModel::model()->getLocalRack();
@@ -27,6 +27,7 @@ typedef struct _KontrolRack {
     t_symbol* active_module_;
     bool single_module_mode_;
     bool monitor_enable_; // Enable monitoring control changes within PD, and forwarding to KontrolModel.
+    unsigned modulation_rate_; // ms between modulation updates sent to osc clients
 
     std::unordered_map<t_symbol *, t_KontrolMonitor*> *param_monitors_;
 } t_KontrolRack;
@@ -40,8 +41,9 @@ void *KontrolRack_new(t_symbol*, int argc, t_atom *argv);
 EXTERN void KontrolRack_setup(void);
 
 
-void KontrolRack_listen(t_KontrolRack *x, t_floatarg f);
-void KontrolRack_connect(t_KontrolRack *x, t_floatarg f);
+// port, or unix:/path for same host clients
+void KontrolRack_listen(t_KontrolRack *x, t_symbol *s, int argc, t_atom *argv);
+void KontrolRack_connect(t_KontrolRack *x, t_symbol *s, int argc, t_atom *argv);
 
 void KontrolRack_enc(t_KontrolRack *x, t_floatarg f);
 void KontrolRack_encbut(t_KontrolRack *x, t_floatarg f);
@@ -55,6 +57,9 @@ void KontrolRack_pgm(t_KontrolRack *x, t_floatarg f);
 
 
 void KontrolRack_modulate(t_KontrolRack *x, t_symbol* src, t_floatarg bus, t_floatarg value);
+void KontrolRack_modulationtarget(t_KontrolRack *x, t_symbol *s, int argc, t_atom *argv);
+void KontrolRack_modulationrate(t_KontrolRack *x, t_floatarg f);
+void KontrolRack_filesync(t_KontrolRack *x, t_symbol *policy);
 
 void KontrolRack_loadsettings(t_KontrolRack *x, t_symbol *settings);
 void KontrolRack_savesettings(t_KontrolRack *x, t_symbol *settings);
@@ -3,6 +3,7 @@
 #include <osc/OscOutboundPacketStream.h>
 //#include <cmath>
 #include <algorithm>
+#include <cstring>
 
 #include "../../m_pd.h"
 
@@ -27,6 +28,7 @@ static const unsigned MOTHER_WRITE_POLL_WAIT_TIMEOUT = 1000;
 
 static const unsigned ORGANELLE_NUM_TEXTLINES = 4;
 static const unsigned ORGANELLE_NUM_PARAMS = 4;
+static const unsigned ORGANELLE_MAX_FPS = 25;
 
 enum OrganelleModes {
     OM_PARAMETER,
@@ -1009,7 +1011,10 @@ void OModuleSelectMenu::clicked(unsigned idx) {
 
 // Organelle implmentation
 
-Organelle::Organelle() : messageQueue_(OscMsg::MAX_N_OSC_MSGS) {
+Organelle::Organelle() : frame_(ORGANELLE_NUM_TEXTLINES + 1, ORGANELLE_MAX_FPS), // lines are 1 based
+                         flipPending_(false),
+                         wipe_(false),
+                         messageQueue_(OscMsg::MAX_N_OSC_MSGS) {
 }
 
 Organelle::~Organelle() {
@@ -1046,6 +1051,11 @@ bool Organelle::init() {
     return false;
 }
 
+void Organelle::poll() {
+    KontrolDevice::poll();
+    flushDisplay(false, flipPending_);
+}
+
 void *organelle_write_thread_func(void *aObj) {
     post("start organelle write thead");
     auto *pThis = static_cast<Organelle *>(aObj);
@@ -1113,6 +1123,11 @@ void Organelle::sendGoHome() {
 
 
 void Organelle::displayPopup(const std::string &text, bool dblline) {
+    // the popup is drawn over the lines, so they must be sent first
+    flushDisplay(true, false);
+    flipPending_ = true;
+    wipe_ = true;
+
     if (dblline) {
         {
             osc::OutboundPacketStream ops(screenBuf_, OUTPUT_BUFFER_SIZE);
@@ -1189,17 +1204,7 @@ std::string Organelle::asDisplayString(const Kontrol::Parameter &param, unsigned
 }
 
 void Organelle::clearDisplay() {
-    osc::OutboundPacketStream ops(screenBuf_, OUTPUT_BUFFER_SIZE);
-    //ops << osc::BeginMessage( "/oled/gClear" )
-    //    << 1
-    //    << osc::EndMessage;
-    ops << osc::BeginMessage("/oled/gFillArea")
-        << PATCH_SCREEN
-        << 0 << 8
-        << 128 << 45
-        << 0
-        << osc::EndMessage;
-    send(ops.Data(), ops.Size());
+    frame_.clear();
 }
 
 void Organelle::displayParamLine(unsigned line, const Kontrol::Parameter &param) {
@@ -1208,52 +1213,102 @@ void Organelle::displayParamLine(unsigned line, const Kontrol::Parameter &param)
 }
 
 void Organelle::displayLine(unsigned line, const char *disp) {
-    if (socket_ == nullptr) return;
+    frame_.line(line, disp ? disp : "");
+}
 
-    int x = ((line - 1) * 11) + ((line > 0) * 9);
-    {
+void Organelle::invertLine(unsigned line) {
+    frame_.invert(line);
+}
+
+void Organelle::flipDisplay() {
+    flushDisplay(false, flipPending_);
+}
+
+// bundle element size, for a message of up to 6 ints and a string
+static unsigned oscElementSize(const char *addr, const std::string &str) {
+    return 4 + ((strlen(addr) + 4) & ~3u) + 12 + (6 * 4) + ((str.size() + 4) & ~3u);
+}
+
+// changed lines are sent as one bundle, with the flip
+bool Organelle::flushDisplay(bool force, bool flip) {
+    if (socket_ == nullptr) return false;
+
+    if (wipe_ && frame_.changed()) {
+        wipe_ = false;
+        frame_.invalidate();
+        force = true;
+        // the whole patch screen, invalidate only resends non empty lines
         osc::OutboundPacketStream ops(screenBuf_, OUTPUT_BUFFER_SIZE);
         ops << osc::BeginMessage("/oled/gFillArea")
             << PATCH_SCREEN
-            << 0 << x
-            << 128 << 10
+            << 0 << 8
+            << 128 << 45
             << 0
             << osc::EndMessage;
         send(ops.Data(), ops.Size());
     }
-    {
-        osc::OutboundPacketStream ops(screenBuf_, OUTPUT_BUFFER_SIZE);
-        ops << osc::BeginMessage("/oled/gPrintln")
-            << PATCH_SCREEN
-            << 2 << x
-            << 8 << 1
-            << disp
-            << osc::EndMessage;
-        send(ops.Data(), ops.Size());
-    }
 
+    bool changed = frame_.flush(changes_, force);
+    if (!changed && !flip) return false;
 
-}
-
-void Organelle::invertLine(unsigned line) {
     osc::OutboundPacketStream ops(screenBuf_, OUTPUT_BUFFER_SIZE);
+    unsigned n = 0;
+    // a new bundle, if the next message may not fit
+    auto next = [&](const char *addr, const std::string &str) {
+        if (n > 0 && ops.Size() + oscElementSize(addr, str) > OUTPUT_BUFFER_SIZE) {
+            ops << osc::EndBundle;
+            send(ops.Data(), ops.Size());
+            n = 0;
+        }
+        if (n == 0) {
+            ops.Clear();
+            ops << osc::BeginBundleImmediate;
+        }
+        n++;
+    };
 
-    int x = ((line - 1) * 11) + ((line > 0) * 9);
-    ops << osc::BeginMessage("/oled/gInvertArea")
-        << PATCH_SCREEN
-        << 0 << x - 1
-        << 128 << 10
-        << osc::EndMessage;
-
-    send(ops.Data(), ops.Size());
-
-}
+    try {
+        for (const auto &l : changes_.lines_) {
+            int x = ((l.line_ - 1) * 11) + ((l.line_ > 0) * 9);
+            bool redraw = l.text_.text_ != l.previous_.text_;
+            if (redraw) {
+                next("/oled/gFillArea", "");
+                ops << osc::BeginMessage("/oled/gFillArea")
+                    << PATCH_SCREEN
+                    << 0 << x
+                    << 128 << 10
+                    << 0
+                    << osc::EndMessage;
+                if (!l.text_.text_.empty()) {
+                    next("/oled/gPrintln", l.text_.text_);
+                    ops << osc::BeginMessage("/oled/gPrintln")
+                        << PATCH_SCREEN
+                        << 2 << x
+                        << 8 << 1
+                        << l.text_.text_.c_str()
+                        << osc::EndMessage;
+                }
+            }
+            // the fill clears the inversion
+            if (redraw ? l.text_.inverted_ : l.text_.inverted_ != l.previous_.inverted_) {
+                next("/oled/gInvertArea", "");
+                ops << osc::BeginMessage("/oled/gInvertArea")
+                    << PATCH_SCREEN
+                    << 0 << x - 1
+                    << 128 << 10
+                    << osc::EndMessage;
+            }
+        }
 
-void Organelle::flipDisplay() {
-    osc::OutboundPacketStream ops(screenBuf_, OUTPUT_BUFFER_SIZE);
-    ops << osc::BeginMessage("/oled/gFlip")
-        << PATCH_SCREEN
-        << osc::EndMessage;
-    send(ops.Data(), ops.Size());
+        next("/oled/gFlip", "");
+        ops << osc::BeginMessage("/oled/gFlip")
+            << PATCH_SCREEN
+            << osc::EndMessage;
+        ops << osc::EndBundle;
+        send(ops.Data(), ops.Size());
+        flipPending_ = false;
+    } catch (const osc::Exception &e) {
+        post("organelle display update too large : %s", e.what());
+    }
+    return changed;
 }
-
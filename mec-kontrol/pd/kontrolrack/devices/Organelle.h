@@ -3,6 +3,7 @@
 #include "KontrolDevice.h"
 
 #include <KontrolModel.h>
+#include <DisplayFrame.h>
 
 #include <ip/UdpSocket.h>
 
@@ -17,12 +18,14 @@ public:
 
     //KontrolDevice
     virtual bool init() override;
+    virtual void poll() override;
 
     void displayPopup(const std::string &text,bool dblLine);
     void displayParamLine(unsigned line, const Kontrol::Parameter &p);
     void displayLine(unsigned line, const char *);
     void invertLine(unsigned line);
     void clearDisplay();
+    // sends the display changes and flips, rate capped, so changes may be left for poll
     void flipDisplay();
 
     void writePoll();
@@ -33,17 +36,25 @@ public:
 private:
     void send(const char *data, unsigned size);
     void stop() override ;
+    bool flushDisplay(bool force, bool flip);
+
+    static const unsigned OUTPUT_BUFFER_SIZE = 1024;
 
     struct OscMsg {
         static const int MAX_N_OSC_MSGS = 64;
-        static const int MAX_OSC_MESSAGE_SIZE = 128;
+        static const int MAX_OSC_MESSAGE_SIZE = OUTPUT_BUFFER_SIZE; // display bundles
         int size_;
         char buffer_[MAX_OSC_MESSAGE_SIZE];
     };
 
-    static const unsigned OUTPUT_BUFFER_SIZE = 1024;
     static char screenBuf_[OUTPUT_BUFFER_SIZE];
 
+    // modes draw lines into the frame, popups are drawn over it
+    Kontrol::DisplayFrame frame_;
+    Kontrol::DisplayFrame::Changes changes_;
+    bool flipPending_;
+    bool wipe_; // after a popup, the screen is cleared and redrawn when the modes next draw
+
 
     bool connect();
 
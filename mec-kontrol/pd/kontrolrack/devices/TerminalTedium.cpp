@@ -23,6 +23,8 @@ static constexpr unsigned TT_THREAD_SLEEP=100;
 
 static const unsigned MENU_DISPLAY=0;
 static const unsigned PARAM_DISPLAY=1;
+static const unsigned TT_NUM_LINES=6;
+static const unsigned TT_MAX_FPS=25;
 
 // TODO
 // check POT = 4096?
@@ -1014,7 +1016,9 @@ void TToduleSelectMenu::clicked(unsigned idx) {
 
 // TerminalTedium implmentation
 
-TerminalTedium::TerminalTedium() : messageQueue_(TTMsg::MAX_N_TT_MSGS) {
+TerminalTedium::TerminalTedium() : menuFrame_(TT_NUM_LINES, TT_MAX_FPS),
+                                   paramFrame_(TT_NUM_LINES, TT_MAX_FPS),
+                                   messageQueue_(TTMsg::MAX_N_TT_MSGS) {
 }
 
 TerminalTedium::~TerminalTedium() {
@@ -1095,15 +1099,23 @@ void TerminalTedium::displayTitle(const std::string &module, const std::string &
 }
 
 
+Kontrol::DisplayFrame *TerminalTedium::frame(unsigned display) {
+    switch (display) {
+        case MENU_DISPLAY : return &menuFrame_;
+        case PARAM_DISPLAY : return &paramFrame_;
+        default: return nullptr;
+    }
+}
+
 void TerminalTedium::clearDisplay(unsigned display) {
-    TTMsg msg(TTMsg::DISPLAY_CLEAR, display);
-    messageQueue_.enqueue(msg);
+    auto f = frame(display);
+    if (f) f->clear();
 }
 
 
 void TerminalTedium::displayLine(unsigned display, unsigned line, const std::string& str) {
-    TTMsg msg(TTMsg::DISPLAY_LINE, display, line, str.c_str(), str.size() );
-    messageQueue_.enqueue(msg);
+    auto f = frame(display);
+    if (f) f->line(line, str);
 }
 
 void TerminalTedium::flipDisplay(unsigned display) {
@@ -1112,13 +1124,12 @@ void TerminalTedium::flipDisplay(unsigned display) {
 }
 
 void TerminalTedium::invertLine(unsigned display,unsigned line) {
-    TTMsg msg(TTMsg::INVERT_LINE, display,line);
-    messageQueue_.enqueue(msg);
+    auto f = frame(display);
+    if (f) f->invert(line);
 }
 
 
 
-
 void TerminalTedium::changePot(unsigned pot, float value) {
     // we dont go to the mode
     // Kontrol::Device::rack(src, rack);
@@ -1254,80 +1265,50 @@ void *terminaltedium_write_thread_func(void *aObj) {
     return nullptr;
 }
 
-void TerminalTedium::writePoll() {
-    static char lines [2][6][40];
-    static bool dirty [2][6];
-    static unsigned clr[2][6];
-    bool render = false;
-    for (int d = 0; d < 2; d++) {
-        for (int i = 0; i < 6; i++) {
-            dirty[d][i] = false;
-            lines[d][i][0] = 0;
-            clr[d][i] = 1;
-        }
+// on the writer thread, wipe clears the display (e.g. of the splash) the next time the modes draw
+void TerminalTedium::flushDisplay(unsigned display, bool &wipe) {
+    auto f = frame(display);
+    bool force = false;
+    if (wipe && f->changed()) {
+        wipe = false;
+        device_.displayClear(display);
+        f->invalidate();
+        force = true;
+    }
+    if (!f->flush(changes_, force)) return;
+
+    for (const auto &l : changes_.lines_) {
+        unsigned clr = l.text_.inverted_ ? 0 : 1;
+        device_.clearLine(display, !clr, l.line_);
+        if (!l.text_.text_.empty()) device_.textLine(display, clr, l.line_, 0, l.text_.text_.c_str());
     }
+    device_.displayPaint();
+}
+
+void TerminalTedium::writePoll() {
+    bool wipe[2] = {true, true};
     device_.gBitmap(MENU_DISPLAY,0, 0, "./orac.pbm");
     device_.gBitmap(PARAM_DISPLAY,0, 0, "./orac.pbm");
     device_.displayPaint();
     sleep(1);
+    bool pending = false;
     while (running_) {
         TTMsg msg;
+        // changes held back by the rate cap are sent when it allows
+        auto timeout = pending ? std::chrono::milliseconds(1000 / TT_MAX_FPS)
+                               : std::chrono::milliseconds(TT_WRITE_POLL_WAIT_TIMEOUT);
+        bool render = messageQueue_.wait_dequeue_timed(msg, timeout);
+        if (render) {
+            // render once the queue is empty
+            while (messageQueue_.try_dequeue(msg));
+        }
+        if (!running_) break;
 
-        if (messageQueue_.wait_dequeue_timed(msg, std::chrono::milliseconds(TT_WRITE_POLL_WAIT_TIMEOUT))) {
-            // store lines to be displayed, and render only when queue is empty
-            do {
-                switch (msg.type_) {
-                case TTMsg::RENDER: {
-                    render = true;
-                    break;
-                }
-                case TTMsg::DISPLAY_CLEAR: {
-                    // do display clear immediately, otherwise we dont know order!
-                    device_.displayClear(msg.display_);
-                    for (int i = 0; i < 6; i++) {
-                        dirty[msg.display_][i] = false;
-                        lines[msg.display_][i][0] = 0;
-                        clr[msg.display_][i] = 1;
-                    }
-                    break;
-                }
-                case TTMsg::DISPLAY_LINE: {
-                    if (msg.display_ < 2 && msg.line_ < 6) {
-                        strncpy(lines[msg.display_][msg.line_], msg.buffer_, msg.size_);
-                        lines[msg.display_][msg.line_][msg.size_]=0;
-                        dirty[msg.display_][msg.line_] = true;
-                    }
-                    break;
-                }
-                case TTMsg::INVERT_LINE: {
-                    if (msg.display_ < 2 && msg.line_ < 6) {
-                        clr[msg.display_][msg.line_] = ! clr[msg.display_][msg.line_];
-                        dirty[msg.display_][msg.line_] = true;
-                    }
-                    break;
-                }
-                default: {
-                    ;
-                }
-                } // switch
-            } while (messageQueue_.try_dequeue(msg));
-
-
-            if (render) {
-                for (int d = 0; d < 2; d++) {
-                    for (int i = 0; i < 6; i++) {
-                        if (dirty[d][i] && lines[d][i][0] > 0) {
-                            device_.clearLine(d, !clr[d][i],i);
-                            device_.textLine(d, clr[d][i], i, 0, lines[d][i]);
-                            dirty[d][i] = false;
-                        }
-                    }
-                }
-                device_.displayPaint();
-                render = false;
-            }
-        } // if wait
+        if (render || pending) {
+            flushDisplay(MENU_DISPLAY, wipe[MENU_DISPLAY]);
+            flushDisplay(PARAM_DISPLAY, wipe[PARAM_DISPLAY]);
+            pending = menuFrame_.changed() || paramFrame_.changed();
+        }
         usleep(TT_THREAD_SLEEP);
     } // running
 }
-
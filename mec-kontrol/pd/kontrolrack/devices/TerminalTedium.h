@@ -2,6 +2,7 @@
 
 #include "KontrolDevice.h"
 #include <KontrolModel.h>
+#include <DisplayFrame.h>
 
 #include <cstring>
 #include <string>
@@ -56,37 +57,28 @@ private:
     bool encoderMenu_=false;
     int  encoderMenuTime_=-1;
 
+    // modes draw into a frame per display, the writer thread sends only the changed lines
+    Kontrol::DisplayFrame *frame(unsigned display);
+    void flushDisplay(unsigned display, bool &wipe);
+    Kontrol::DisplayFrame menuFrame_;
+    Kontrol::DisplayFrame paramFrame_;
+    Kontrol::DisplayFrame::Changes changes_;
+
     // gpio will cause havoc on audio thread, so has to be on a different thread!
     struct TTMsg {
 
         static const int MAX_N_TT_MSGS = 64;
-        static const int MAX_TT_MESSAGE_SIZE = 128;
         enum MsgType {
             RENDER,
-            DISPLAY_CLEAR,
-            DISPLAY_LINE,
-            INVERT_LINE,
             MAX_TYPE
         } type_;
 
 
-        TTMsg() : type_(MAX_TYPE), display_(-1), line_(-1), size_(0) {;}
-        TTMsg(MsgType t) : type_(t), display_(-1), line_(-1), size_(0) {;}
+        TTMsg() : type_(MAX_TYPE), display_(-1) {;}
+        TTMsg(MsgType t) : type_(t), display_(-1) {;}
         TTMsg(MsgType t, int d) : TTMsg(t)  { display_ = d;}
-        TTMsg(MsgType t, int d, int l ) : TTMsg(t)  { display_ = d; line_ = l;}
-        TTMsg(MsgType t, int d, int l, const char* str, int sz ) : TTMsg(t) {
-            display_ = d;
-            line_ = l;
-            size_ = (sz >= MAX_TT_MESSAGE_SIZE ? MAX_TT_MESSAGE_SIZE - 1 : sz );
-            strncpy(buffer_, str, size_);
-            buffer_[size_] = 0;
-
-        }
 
         int display_;
-        int line_;
-        int size_;
-        char buffer_[MAX_TT_MESSAGE_SIZE];
     };
 
 
@@ -0,0 +1,125 @@
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+
+#include <mec_log.h>
+#include <KontrolModel.h>
+
+// startup benchmark : time from creating the local rack, to modules defined and current preset applied
+// cold = parsing module definitions, scanning presets and parsing preset json
+// warm = using rack snapshot written on previous save/shutdown
+
+static const unsigned NUM_MODULES = 8;
+static const unsigned NUM_PARAMS = 48;
+static const unsigned NUM_PRESETS = 32;
+static const unsigned NUM_RUNS = 10;
+
+static std::string moduleFile(const std::string &dir, unsigned m) {
+    return dir + "/module" + std::to_string(m) + ".json";
+}
+
+static void writeModuleDefinition(const std::string &file) {
+    std::ofstream out(file.c_str());
+    out << "{ \"display\" : \"Bench\",\n  \"parameters\" : [\n";
+    for (unsigned p = 0; p < NUM_PARAMS; p++) {
+        out << "    [\"pct\", \"p" << p << "\", \"Param " << p << "\", 0, 100, 50]"
+            << (p + 1 < NUM_PARAMS ? ",\n" : "\n");
+    }
+    out << "  ],\n  \"pages\" : [\n";
+    for (unsigned pg = 0; pg < NUM_PARAMS / 4; pg++) {
+        out << "    [\"pg" << pg << "\", \"Page " << pg << "\", [";
+        for (unsigned p = 0; p < 4; p++) {
+            out << "\"p" << (pg * 4 + p) << "\"" << (p < 3 ? ", " : "");
+        }
+        out << "]]" << (pg + 1 < NUM_PARAMS / 4 ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+static std::shared_ptr<Kontrol::Rack> startRack(const std::string &dir, unsigned port) {
+    auto model = Kontrol::KontrolModel::model();
+    auto rack = model->createLocalRack(port);
+    rack->dataDir(dir);
+    for (unsigned m = 0; m < NUM_MODULES; m++) {
+        std::string moduleId = "m" + std::to_string(m);
+        model->createModule(Kontrol::CS_LOCAL, rack->id(), moduleId, "bench", "bench");
+        model->loadModuleDefinitions(rack->id(), moduleId, moduleFile(dir, m));
+    }
+    rack->loadSettings("bench.json");
+    return rack;
+}
+
+static double timeStartup(const std::string &dir, unsigned &port, bool cold,
+                          std::shared_ptr<Kontrol::Rack> &rack) {
+    double total = 0.0;
+    for (unsigned i = 0; i < NUM_RUNS; i++) {
+        // only keep the last rack, so earlier racks are not loading presets in the background
+        if (rack) Kontrol::KontrolModel::model()->deleteRack(Kontrol::CS_LOCAL, rack->id());
+        rack.reset();
+        if (cold) std::remove((dir + "/kontrol.snapshot").c_str());
+        auto start = std::chrono::steady_clock::now();
+        rack = startRack(dir, port++);
+        auto end = std::chrono::steady_clock::now();
+        total += std::chrono::duration<double, std::milli>(end - start).count();
+    }
+    return total / NUM_RUNS;
+}
+
+int main(int argc, char **argv) {
+    std::string dir = argc > 1 ? argv[1] : "./b_startup_data";
+    mkdir(dir.c_str(), S_IRWXU | S_IRWXG | S_IRWXO);
+    mkdir((dir + "/presets").c_str(), S_IRWXU | S_IRWXG | S_IRWXO);
+    for (unsigned m = 0; m < NUM_MODULES; m++) {
+        writeModuleDefinition(moduleFile(dir, m));
+    }
+
+    // create presets with distinct values, the last one saved becomes current
+    auto model = Kontrol::KontrolModel::model();
+    unsigned port = 9000;
+    auto rack = startRack(dir, port++);
+    for (unsigned pr = 0; pr < NUM_PRESETS; pr++) {
+        for (const auto &module : rack->getModules()) {
+            for (const auto &param : module->params()) {
+                model->changeParam(Kontrol::CS_LOCAL, rack->id(), module->id(), param->id(),
+                                   Kontrol::ParamValue((float) ((pr * 7) % 100)));
+            }
+        }
+        rack->savePreset("preset" + std::to_string(pr));
+    }
+    rack->saveSettings("bench.json");
+    Kontrol::Rack::flushSaves();
+    model->deleteRack(Kontrol::CS_LOCAL, rack->id());
+    rack.reset();
+
+    std::shared_ptr<Kontrol::Rack> coldRack, warmRack;
+    double cold = timeStartup(dir, port, true, coldRack);
+    assert(coldRack->saveSnapshot());
+    Kontrol::Rack::flushSaves();
+    double warm = timeStartup(dir, port, false, warmRack);
+
+    // both paths must produce the same rack
+    assert(coldRack->currentPreset() == warmRack->currentPreset());
+    assert(coldRack->getPresetList() == warmRack->getPresetList());
+    for (const auto &module : coldRack->getModules()) {
+        auto warmModule = warmRack->getModule(module->id());
+        assert(warmModule != nullptr);
+        assert(warmModule->displayName() == module->displayName());
+        assert(warmModule->getPages().size() == module->getPages().size());
+        assert(warmModule->params().size() == module->params().size());
+        for (const auto &param : module->params()) {
+            auto warmParam = warmModule->getParam(param->id());
+            assert(warmParam != nullptr);
+            assert(warmParam->current() == param->current());
+        }
+    }
+
+    std::cout << "startup (" << NUM_MODULES << " modules, " << NUM_PARAMS << " params, "
+              << NUM_PRESETS << " presets), average of " << NUM_RUNS << " runs" << std::endl;
+    std::cout << "cold : " << cold << " ms" << std::endl;
+    std::cout << "warm : " << warm << " ms" << std::endl;
+    return 0;
+}
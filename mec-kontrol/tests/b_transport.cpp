@@ -0,0 +1,164 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+#include <mec_log.h>
+#include <ip/UdpSocket.h>
+#include <osc/OscOutboundPacketStream.h>
+#include <PacketReceiver.h>
+#include <UnixSocket.h>
+
+// transport benchmark, udp loopback against AF_UNIX datagrams, for a /Kontrol/changed packet
+// socket : send and receive on one thread, the cost of the kernel path alone
+// round trip : between two receivers, the echo thread returns each packet as it is received,
+// as the kontrol device would apply and broadcast a change, includes waking the receive threads
+// (on a single core this is dominated by scheduling, rather than the transport)
+
+static const unsigned NUM_TRIPS = 20000;
+static const unsigned WARMUP_TRIPS = 1000;
+static const unsigned BUFFER_SIZE = 2048;
+
+struct Result {
+    double avgUs;
+    double maxUs;
+    double cpuUs; // process cpu, all threads, per trip
+};
+
+static double cpuTime() {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+typedef std::function<void(const char *, unsigned)> SendFn;
+
+static Result roundTrips(Kontrol::PacketReceiver &ping, Kontrol::PacketReceiver &pong,
+                         const SendFn &toPong, const SendFn &toPing, const char *data, unsigned size) {
+    std::atomic<bool> running(true);
+    std::thread echo([&]() {
+        while (running) {
+            auto p = pong.wait(std::chrono::milliseconds(100));
+            if (p == nullptr) continue;
+            toPing(p->data_.get(), p->size_);
+            pong.release(p);
+        }
+    });
+
+    Result r = {0.0, 0.0, 0.0};
+    double total = 0.0;
+    double cpuStart = 0.0;
+    for (unsigned i = 0; i < WARMUP_TRIPS + NUM_TRIPS; i++) {
+        if (i == WARMUP_TRIPS) cpuStart = cpuTime();
+        auto start = std::chrono::steady_clock::now();
+        toPong(data, size);
+        auto p = ping.wait(std::chrono::seconds(1));
+        auto end = std::chrono::steady_clock::now();
+        if (p == nullptr) {
+            LOG_0("round trip timed out");
+            break;
+        }
+        ping.release(p);
+        if (i < WARMUP_TRIPS) continue;
+        double us = std::chrono::duration<double, std::micro>(end - start).count();
+        total += us;
+        if (us > r.maxUs) r.maxUs = us;
+    }
+    r.cpuUs = (cpuTime() - cpuStart) / NUM_TRIPS;
+    r.avgUs = total / NUM_TRIPS;
+
+    running = false;
+    echo.join();
+    return r;
+}
+
+// send, then receive on the same thread
+template<typename TX, typename RX>
+static Result socketTrips(TX &tx, RX &rx, const char *data, unsigned size) {
+    char buffer[BUFFER_SIZE];
+    IpEndpointName origin;
+    Result r = {0.0, 0.0, 0.0};
+    double total = 0.0;
+    double cpuStart = 0.0;
+    for (unsigned i = 0; i < WARMUP_TRIPS + NUM_TRIPS; i++) {
+        if (i == WARMUP_TRIPS) cpuStart = cpuTime();
+        auto start = std::chrono::steady_clock::now();
+        tx.Send(data, size);
+        rx.ReceiveFrom(origin, buffer, BUFFER_SIZE);
+        auto end = std::chrono::steady_clock::now();
+        if (i < WARMUP_TRIPS) continue;
+        double us = std::chrono::duration<double, std::micro>(end - start).count();
+        total += us;
+        if (us > r.maxUs) r.maxUs = us;
+    }
+    r.cpuUs = (cpuTime() - cpuStart) / NUM_TRIPS;
+    r.avgUs = total / NUM_TRIPS;
+    return r;
+}
+
+static void report(const char *name, const Result &r) {
+    fprintf(stderr, "%-18s avg %8.2f us  max %8.2f us  cpu %8.2f us\n", name, r.avgUs, r.maxUs, r.cpuUs);
+}
+
+int main(int argc, char **argv) {
+    unsigned port = argc > 1 ? (unsigned) std::stoi(argv[1]) : 9300;
+    std::string dir = argc > 2 ? argv[2] : "/tmp";
+
+    char buffer[BUFFER_SIZE];
+    osc::OutboundPacketStream ops(buffer, BUFFER_SIZE);
+    ops << osc::BeginBundleImmediate
+        << osc::BeginMessage("/Kontrol/changed")
+        << "127.0.0.1:4000"
+        << "s1"
+        << "t_cutoff"
+        << 0.5f
+        << osc::EndMessage
+        << osc::EndBundle;
+    unsigned size = (unsigned) ops.Size();
+
+    fprintf(stderr, "%u trips, of %u bytes\n", NUM_TRIPS, size);
+
+    {
+        UdpReceiveSocket rx(IpEndpointName(IpEndpointName::ANY_ADDRESS, port));
+        UdpTransmitSocket tx(IpEndpointName("127.0.0.1", port));
+        report("udp socket", socketTrips(tx, rx, buffer, size));
+    }
+
+    {
+        std::string path = dir + "/b_transport." + std::to_string(getpid());
+        Kontrol::UnixReceiveSocket rx(path);
+        Kontrol::UnixTransmitSocket tx(path);
+        report("unix socket", socketTrips(tx, rx, buffer, size));
+    }
+
+    {
+        Kontrol::PacketReceiver ping("b.ping", 16, BUFFER_SIZE);
+        Kontrol::PacketReceiver pong("b.pong", 16, BUFFER_SIZE);
+        if (!ping.listen(port) || !pong.listen(port + 1)) return -1;
+        UdpTransmitSocket pongSocket(IpEndpointName("127.0.0.1", port + 1));
+        UdpTransmitSocket pingSocket(IpEndpointName("127.0.0.1", port));
+        SendFn toPong = [&](const char *d, unsigned s) { pongSocket.Send(d, s); };
+        SendFn toPing = [&](const char *d, unsigned s) { pingSocket.Send(d, s); };
+        report("udp round trip", roundTrips(ping, pong, toPong, toPing, buffer, size));
+    }
+
+    {
+        std::string pingPath = dir + "/b_transport.ping." + std::to_string(getpid());
+        std::string pongPath = dir + "/b_transport.pong." + std::to_string(getpid());
+        Kontrol::PacketReceiver ping("b.ping", 16, BUFFER_SIZE);
+        Kontrol::PacketReceiver pong("b.pong", 16, BUFFER_SIZE);
+        if (!ping.listenUnix(pingPath) || !pong.listenUnix(pongPath)) return -1;
+        Kontrol::UnixTransmitSocket pongSocket(pongPath);
+        Kontrol::UnixTransmitSocket pingSocket(pingPath);
+        SendFn toPong = [&](const char *d, unsigned s) { pongSocket.Send(d, s); };
+        SendFn toPing = [&](const char *d, unsigned s) { pingSocket.Send(d, s); };
+        report("unix round trip", roundTrips(ping, pong, toPong, toPing, buffer, size));
+    }
+
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include <cassert>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <osc/OscOutboundPacketStream.h>
+#include <ip/UdpSocket.h>
+
+#include <mec_log.h>
+#include <mec_metrics.h>
+#include <KontrolModel.h>
+#include <OSCBroadcaster.h>
+#include <OSCReceiver.h>
+
+// messages larger than a packet are sent in chunks, which may arrive duplicated or out of order
+
+static const unsigned PORT = 9240;
+static const unsigned NUM_PARAMS = 500;
+
+class PageListener : public Kontrol::KontrolCallback {
+public:
+    void rack(Kontrol::ChangeSource, const Kontrol::Rack &) override { ; }
+    void module(Kontrol::ChangeSource, const Kontrol::Rack &, const Kontrol::Module &) override { ; }
+    void page(Kontrol::ChangeSource, const Kontrol::Rack &, const Kontrol::Module &,
+              const Kontrol::Page &p) override { pages_[p.id()] = p.paramIds(); }
+    void param(Kontrol::ChangeSource, const Kontrol::Rack &, const Kontrol::Module &,
+               const Kontrol::Parameter &) override { ; }
+    void changed(Kontrol::ChangeSource, const Kontrol::Rack &, const Kontrol::Module &,
+                 const Kontrol::Parameter &) override { ; }
+    void resource(Kontrol::ChangeSource, const Kontrol::Rack &, const std::string &,
+                  const std::string &) override { ; }
+    void deleteRack(Kontrol::ChangeSource, const Kontrol::Rack &) override { ; }
+
+    std::map<std::string, std::vector<Kontrol::EntityId>> pages_;
+};
+
+static std::vector<char> pageMessage(const std::string &rackId, const std::string &pageId, unsigned numParams) {
+    std::vector<char> buf(Kontrol::OSCBroadcaster::OUTPUT_BUFFER_SIZE);
+    osc::OutboundPacketStream ops(buf.data(), buf.size());
+    ops << osc::BeginBundleImmediate
+        << osc::BeginMessage("/Kontrol/page")
+        << rackId.c_str() << "m1" << pageId.c_str() << "Page";
+    for (unsigned i = 0; i < numParams; i++) {
+        ops << ("parameter_" + std::to_string(i)).c_str();
+    }
+    ops << osc::EndMessage
+        << osc::EndBundle;
+    buf.resize(ops.Size());
+    return buf;
+}
+
+static unsigned numChunks(const std::vector<char> &msg) {
+    return (unsigned) ((msg.size() + Kontrol::OSCBroadcaster::CHUNK_SIZE - 1) / Kontrol::OSCBroadcaster::CHUNK_SIZE);
+}
+
+static void sendChunk(UdpTransmitSocket &socket, int32_t id, const std::vector<char> &msg, unsigned idx) {
+    unsigned offset = idx * Kontrol::OSCBroadcaster::CHUNK_SIZE;
+    unsigned n = std::min((unsigned) msg.size() - offset, (unsigned) Kontrol::OSCBroadcaster::CHUNK_SIZE);
+    char buf[Kontrol::OSCBroadcaster::MAX_PACKET_SIZE];
+    osc::OutboundPacketStream ops(buf, sizeof(buf));
+    ops << osc::BeginBundleImmediate
+        << osc::BeginMessage("/Kontrol/chunk")
+        << id
+        << (int32_t) msg.size()
+        << (int32_t) offset
+        << osc::Blob(msg.data() + offset, (osc::osc_bundle_element_size_t) n)
+        << osc::EndMessage
+        << osc::EndBundle;
+    socket.Send(ops.Data(), ops.Size());
+}
+
+// packets from one socket arrive in order, so once the marker page is seen, all before it have been processed
+static void sync(UdpTransmitSocket &socket, Kontrol::OSCReceiver &recv, PageListener &listener,
+                 const std::string &rackId, const std::string &marker) {
+    std::vector<char> msg = pageMessage(rackId, marker, 1);
+    socket.Send(msg.data(), msg.size());
+    for (unsigned i = 0; i < 500 && listener.pages_.count(marker) == 0; i++) {
+        recv.wait(std::chrono::milliseconds(10));
+        recv.poll();
+    }
+    assert(listener.pages_.count(marker) == 1);
+}
+
+int main(int argc, char **argv) {
+    LOG_0("test chunk started");
+    auto model = Kontrol::KontrolModel::model();
+    auto listener = std::make_shared<PageListener>();
+    model->addCallback("listener", listener);
+    auto rack = model->createRack(Kontrol::CS_LOCAL, "r1", "127.0.0.1", 1);
+    model->createModule(Kontrol::CS_LOCAL, rack->id(), "m1", "Module", "test");
+
+    Kontrol::OSCReceiver recv(model);
+    assert(recv.listen(PORT));
+    UdpTransmitSocket socket(IpEndpointName("127.0.0.1", PORT));
+
+    mec::Counter &chunked = mec::Metrics::counter("kontrol.recv.chunked");
+    mec::Counter &dropped = mec::Metrics::counter("kontrol.recv.chunks.dropped");
+    mec::Counter &duplicates = mec::Metrics::counter("kontrol.recv.chunks.duplicate");
+
+    // a gap, filled with enough duplicates to cover its bytes, is not complete
+    std::vector<char> gap = pageMessage(rack->id(), "gap", NUM_PARAMS);
+    assert(gap.size() > Kontrol::OSCBroadcaster::MAX_PACKET_SIZE);
+    unsigned n = numChunks(gap);
+    for (unsigned i = 0; i < n; i++) sendChunk(socket, 1, gap, 0);
+    for (unsigned i = 1; i < n - 1; i++) sendChunk(socket, 1, gap, i);
+    sync(socket, recv, *listener, rack->id(), "marker1");
+    assert(listener->pages_.count("gap") == 0);
+    assert(chunked.value() == 0);
+    assert(duplicates.value() == n - 1);
+
+    // out of order and duplicated, replaces the incomplete transfer
+    std::vector<char> big = pageMessage(rack->id(), "big", NUM_PARAMS);
+    for (unsigned i = n; i > 0; i--) {
+        sendChunk(socket, 2, big, i - 1);
+        if (i > 1) sendChunk(socket, 2, big, i - 1);
+    }
+    sync(socket, recv, *listener, rack->id(), "marker2");
+    assert(dropped.value() == 1);
+    assert(chunked.value() == 1);
+    assert(listener->pages_["big"].size() == NUM_PARAMS);
+    for (unsigned i = 0; i < NUM_PARAMS; i++) {
+        assert(listener->pages_["big"][i] == "parameter_" + std::to_string(i));
+    }
+
+    // a late duplicate of a completed transfer
+    unsigned dups = (unsigned) duplicates.value();
+    sendChunk(socket, 2, big, 0);
+    sync(socket, recv, *listener, rack->id(), "marker3");
+    assert(duplicates.value() == dups + 1);
+    assert(chunked.value() == 1);
+
+    recv.stop();
+    LOG_0("test completed");
+    return 0;
+}
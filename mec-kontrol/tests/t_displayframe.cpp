@@ -0,0 +1,97 @@
+#include <cassert>
+
+#include <mec_log.h>
+#include <DisplayFrame.h>
+
+int main(int argc, char **argv) {
+    LOG_0("test displayframe started");
+
+    typedef std::chrono::steady_clock clock;
+    Kontrol::DisplayFrame frame(5, 10);
+    Kontrol::DisplayFrame::Changes changes;
+    auto t = clock::now();
+
+    // nothing drawn, nothing to send
+    assert(!frame.flush(changes, false, t));
+    assert(changes.empty());
+
+    frame.line(0, "one");
+    frame.line(1, "two");
+    frame.line(7, "outside");
+    assert(frame.flush(changes, false, t));
+    assert(changes.lines_.size() == 2);
+    assert(changes.lines_[0].line_ == 0 && changes.lines_[0].text_.text_ == "one");
+    assert(changes.lines_[1].line_ == 1 && changes.lines_[1].text_.text_ == "two");
+
+    // redrawing the same page, (as the modes do) sends nothing
+    t += std::chrono::milliseconds(200);
+    assert(!frame.changed());
+    frame.clear();
+    frame.line(0, "one");
+    frame.line(1, "two");
+    assert(frame.changed());
+    assert(!frame.flush(changes, false, t));
+    assert(!frame.changed());
+
+    // only the changed line, and the line which was cleared
+    t += std::chrono::milliseconds(200);
+    frame.clear();
+    frame.line(0, "one");
+    frame.line(2, "three");
+    assert(frame.flush(changes, false, t));
+    assert(changes.lines_.size() == 2);
+    assert(changes.lines_[0].line_ == 1 && changes.lines_[0].text_.text_.empty());
+    assert(changes.lines_[0].previous_.text_ == "two");
+    assert(changes.lines_[1].line_ == 2);
+    assert(changes.frame_.size() == 5 && changes.frame_[0].text_ == "one" && changes.frame_[2].text_ == "three");
+
+    // rate capped at 10 fps, changes are kept for the next flush
+    frame.invert(2);
+    assert(!frame.flush(changes, false, t + std::chrono::milliseconds(50)));
+    assert(frame.flush(changes, false, t + std::chrono::milliseconds(100)));
+    assert(changes.lines_.size() == 1 && changes.lines_[0].text_.inverted_);
+    frame.invert(2);
+    assert(frame.flush(changes, true, t + std::chrono::milliseconds(110)));
+    assert(changes.lines_.size() == 1 && !changes.lines_[0].text_.inverted_);
+
+    // fields
+    t += std::chrono::seconds(1);
+    Kontrol::DisplayFrame::Text value;
+    value.text_ = "0.50";
+    value.aux_ = "hz";
+    value.value_ = 0.5f;
+    frame.field("P1Value", value);
+    assert(frame.flush(changes, false, t));
+    assert(changes.lines_.empty() && changes.fields_.size() == 1);
+    assert(changes.fields_[0].name_ == "P1Value" && changes.fields_[0].text_ == value);
+    assert(frame.field("P1Value") == value);
+
+    t += std::chrono::seconds(1);
+    frame.field("P1Value", value);
+    assert(!frame.flush(changes, false, t));
+    frame.clearFields();
+    assert(frame.flush(changes, false, t));
+    assert(changes.fields_.size() == 1 && changes.fields_[0].text_.text_.empty());
+
+    // already shown by the device, not sent
+    t += std::chrono::seconds(1);
+    value.value_ = 0.75f;
+    frame.field("P1Ctrl", value, true);
+    assert(!frame.flush(changes, false, t));
+    value.value_ = 0.5f;
+    frame.field("P1Ctrl", value);
+    assert(frame.flush(changes, false, t));
+    assert(changes.fields_.size() == 1 && changes.fields_[0].text_.value_ == 0.5f);
+    frame.clearFields();
+    frame.flush(changes, true, t);
+
+    // everything drawn is resent after invalidate
+    t += std::chrono::seconds(1);
+    frame.field("P1Value", value);
+    frame.invalidate();
+    assert(frame.flush(changes, false, t));
+    assert(changes.lines_.size() == 2 && changes.fields_.size() == 1 && changes.fields_[0].name_ == "P1Value");
+
+    LOG_0("test completed");
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+#include <mec_log.h>
+#include <KontrolModel.h>
+
+// count heap allocations, to check float changes do not allocate
+// per thread, as the log writer thread allocates in the background
+static thread_local unsigned long allocCount = 0;
+
+void *operator new(std::size_t n) {
+    allocCount++;
+    void *p = std::malloc(n == 0 ? 1 : n);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+class NullCallback : public Kontrol::KontrolCallback {
+public:
+    void rack(Kontrol::ChangeSource, const Kontrol::Rack &) override { ; }
+
+    void module(Kontrol::ChangeSource, const Kontrol::Rack &, const Kontrol::Module &) override { ; }
+
+    void page(Kontrol::ChangeSource, const Kontrol::Rack &, const Kontrol::Module &,
+              const Kontrol::Page &) override { ; }
+
+    void param(Kontrol::ChangeSource, const Kontrol::Rack &, const Kontrol::Module &,
+               const Kontrol::Parameter &) override { ; }
+
+    void changed(Kontrol::ChangeSource, const Kontrol::Rack &, const Kontrol::Module &,
+                 const Kontrol::Parameter &param) override {
+        lastValue_ = param.current().floatValue();
+    }
+
+    void resource(Kontrol::ChangeSource, const Kontrol::Rack &,
+                  const std::string &, const std::string &) override { ; }
+
+    void deleteRack(Kontrol::ChangeSource, const Kontrol::Rack &) override { ; }
+
+    float lastValue_ = 0.0f;
+};
+
+int main(int argc, char **argv) {
+    LOG_0("test paramvalue started");
+
+    // string values are interned, so equal strings compare equal, and share storage
+    Kontrol::ParamValue s1(std::string("sample.wav"));
+    Kontrol::ParamValue s2("sample.wav");
+    Kontrol::ParamValue s3("other.wav");
+    assert(s1 == s2);
+    assert(s1 != s3);
+    assert(&s1.stringValue() == &s2.stringValue());
+    assert(s3.stringValue() == "other.wav");
+    assert(Kontrol::ParamValue().stringValue().empty());
+    assert(Kontrol::ParamValue(1.0f) != s1);
+
+    // the intern table is bounded, strings past it are held by their values, and still compare equal
+    std::vector<std::string> names;
+    for (unsigned i = 0; i < 10000; i++) names.push_back("file" + std::to_string(i) + ".wav");
+    std::vector<unsigned> interned;
+    for (unsigned i = 0; i < names.size(); i++) {
+        Kontrol::ParamValue a(names[i]), b(names[i]);
+        assert(a == b);
+        assert(a != Kontrol::ParamValue(names[(i + 1) % names.size()]));
+        assert(b.stringValue() == names[i]);
+        if (&a.stringValue() == &b.stringValue()) interned.push_back(i);
+    }
+    assert(!interned.empty() && interned.size() < names.size());
+    LOG_0("interned strings : " << interned.size() << " of " << names.size());
+
+    // lookups of interned strings do not allocate
+    unsigned long internAllocs = allocCount;
+    for (unsigned i : interned) {
+        Kontrol::ParamValue v(names[i]);
+        assert(v.type() == Kontrol::ParamValue::T_String);
+    }
+    assert(allocCount == internAllocs);
+
+    auto model = Kontrol::KontrolModel::model();
+    auto cb = std::make_shared<NullCallback>();
+    model->addCallback("null", cb);
+
+    std::string host = "localhost";
+    unsigned port = 9001;
+    Kontrol::EntityId rackId = Kontrol::Rack::createId(host, port);
+    Kontrol::EntityId moduleId = "module1";
+    Kontrol::EntityId paramId = "level";
+    model->createRack(Kontrol::CS_LOCAL, rackId, host, port);
+    model->createModule(Kontrol::CS_LOCAL, rackId, moduleId, "Module", "module");
+    std::vector<Kontrol::ParamValue> args = {
+            Kontrol::ParamValue("float"), Kontrol::ParamValue(paramId), Kontrol::ParamValue("Level"),
+            Kontrol::ParamValue(0.0f), Kontrol::ParamValue(1.0f), Kontrol::ParamValue(0.0f)
+    };
+    auto param = model->createParam(Kontrol::CS_LOCAL, rackId, moduleId, args);
+    assert(param != nullptr);
+
+    // a float parameter change must not touch the heap
+    unsigned long before = allocCount;
+    for (unsigned i = 0; i < 100; i++) {
+        Kontrol::ParamValue v(float(i) / 100.0f);
+        Kontrol::ParamValue copy = v;
+        model->changeParam(Kontrol::CS_LOCAL, rackId, moduleId, paramId, copy);
+    }
+    unsigned long allocs = allocCount - before;
+    LOG_0("allocations for 100 float changes : " << allocs);
+    assert(allocs == 0);
+    assert(cb->lastValue_ == 0.99f);
+
+    model->clearCallbacks();
+    LOG_0("test completed");
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include <cassert>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+
+#include <mec_log.h>
+#include <KontrolModel.h>
+
+// a preset switch must apply the preset, even if the cache has not loaded it yet
+
+static const unsigned NUM_PRESETS = 16;
+
+static void writeModuleDefinition(const std::string &file) {
+    std::ofstream out(file.c_str());
+    out << "{ \"display\" : \"Test\",\n"
+        << "  \"parameters\" : [ [\"pct\", \"level\", \"Level\", 0, 100, 50] ],\n"
+        << "  \"pages\" : [ [\"pg\", \"Page\", [\"level\"]] ]\n}\n";
+}
+
+static std::shared_ptr<Kontrol::Rack> startRack(const std::string &dir, unsigned port) {
+    auto model = Kontrol::KontrolModel::model();
+    auto rack = model->createLocalRack(port);
+    rack->dataDir(dir);
+    model->createModule(Kontrol::CS_LOCAL, rack->id(), "m", "test", "test");
+    model->loadModuleDefinitions(rack->id(), "m", dir + "/module.json");
+    rack->loadSettings("test.json");
+    return rack;
+}
+
+static float level(const std::shared_ptr<Kontrol::Rack> &rack) {
+    return rack->getModule("m")->getParam("level")->current().floatValue();
+}
+
+static void copyFile(const std::string &from, const std::string &to) {
+    std::ifstream in(from.c_str(), std::ios::binary);
+    std::ofstream out(to.c_str(), std::ios::binary);
+    out << in.rdbuf();
+}
+
+int main(int argc, char **argv) {
+    LOG_0("test presetcache started");
+    std::string dir = argc > 1 ? argv[1] : "./t_presetcache_data";
+    mkdir(dir.c_str(), S_IRWXU | S_IRWXG | S_IRWXO);
+    mkdir((dir + "/presets").c_str(), S_IRWXU | S_IRWXG | S_IRWXO);
+    writeModuleDefinition(dir + "/module.json");
+    std::remove((dir + "/kontrol.snapshot").c_str());
+
+    auto model = Kontrol::KontrolModel::model();
+    unsigned port = 9100;
+    auto rack = startRack(dir, port++);
+    for (unsigned pr = 0; pr < NUM_PRESETS; pr++) {
+        model->changeParam(Kontrol::CS_LOCAL, rack->id(), "m", "level", Kontrol::ParamValue((float) pr));
+        rack->savePreset("preset" + std::to_string(pr));
+    }
+    rack->saveSettings("test.json");
+    Kontrol::Rack::flushSaves();
+    model->deleteRack(Kontrol::CS_LOCAL, rack->id());
+    rack.reset();
+
+    // switch straight after startup, whilst the background preload may still be running
+    rack = startRack(dir, port++);
+    assert(level(rack) == (float) (NUM_PRESETS - 1));
+    for (unsigned pr = 0; pr < NUM_PRESETS; pr++) {
+        assert(rack->loadPreset("preset" + std::to_string(pr)));
+        assert(rack->currentPreset() == "preset" + std::to_string(pr));
+        assert(level(rack) == (float) pr);
+    }
+
+    // a preset the cache has never seen (e.g. copied in since startup)
+    mkdir((dir + "/presets/copied").c_str(), S_IRWXU | S_IRWXG | S_IRWXO);
+    copyFile(dir + "/presets/preset3/params.json", dir + "/presets/copied/params.json");
+    assert(rack->loadPreset("copied"));
+    assert(level(rack) == 3.0f);
+
+    // no such preset, the current one is kept
+    assert(!rack->loadPreset("missing"));
+    assert(rack->currentPreset() == "copied");
+
+    model->deleteRack(Kontrol::CS_LOCAL, rack->id());
+    LOG_0("test completed");
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include <cassert>
+
+#include <mec_log.h>
+#include <SlabPool.h>
+
+int main(int argc, char **argv) {
+    LOG_0("test slabpool started");
+
+    Kontrol::SlabPool pool({128, 1024}, 2);
+    assert(pool.maxSize() == 1024);
+    assert(pool.buffers() == 4);
+
+    // smallest class which fits
+    auto *a = pool.acquire(100);
+    assert(a != nullptr && a->capacity_ == 128 && a->size_ == 100);
+    auto *b = pool.acquire(129);
+    assert(b != nullptr && b->capacity_ == 1024);
+    assert(pool.acquire(1025) == nullptr);
+
+    // class grows when all its buffers are in use
+    auto *c = pool.acquire(10);
+    auto *d = pool.acquire(10);
+    assert(c->capacity_ == 128 && d->capacity_ == 128);
+    assert(pool.buffers() == 5);
+
+    // released buffers are reused, rather than allocating
+    pool.release(a);
+    pool.release(c);
+    pool.release(d);
+    auto *e = pool.acquire(128);
+    auto *f = pool.acquire(1);
+    auto *g = pool.acquire(64);
+    assert(e->capacity_ == 128 && f->capacity_ == 128 && g->capacity_ == 128);
+    assert(pool.buffers() == 5);
+
+    pool.release(b);
+    pool.release(e);
+    pool.release(f);
+    pool.release(g);
+
+    LOG_0("test completed");
+    return 0;
+}
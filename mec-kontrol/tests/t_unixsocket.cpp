@@ -0,0 +1,79 @@
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <mec_log.h>
+#include <UnixSocket.h>
+
+// a receiver only replaces a stale socket, and tells senders apart by their address
+
+static bool opens(const std::string &path) {
+    try {
+        Kontrol::UnixReceiveSocket rx(path);
+        return true;
+    } catch (std::runtime_error &) {
+        return false;
+    }
+}
+
+// bound, then closed without removing the path, as a crashed receiver would leave it
+static void staleSocket(const std::string &path) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    int s = socket(AF_UNIX, SOCK_DGRAM, 0);
+    assert(s >= 0);
+    assert(bind(s, (sockaddr *) &addr, sizeof(addr)) == 0);
+    close(s);
+}
+
+int main(int argc, char **argv) {
+    LOG_0("test unixsocket started");
+    std::string path = "/tmp/t_unixsocket.sock";
+    std::remove(path.c_str());
+
+    {
+        Kontrol::UnixReceiveSocket rx(path);
+        // in use by rx
+        assert(!opens(path));
+
+        Kontrol::UnixTransmitSocket a(path);
+        Kontrol::UnixTransmitSocket b(path);
+        char data[16];
+        IpEndpointName origin;
+        std::string fromA, fromB, again;
+        assert(a.Send("a", 1));
+        assert(rx.ReceiveFrom(origin, fromA, data, sizeof(data)) == 1 && data[0] == 'a');
+        assert(origin.port == 0);
+        assert(b.Send("b", 1));
+        assert(rx.ReceiveFrom(origin, fromB, data, sizeof(data)) == 1 && data[0] == 'b');
+        assert(a.Send("a", 1));
+        assert(rx.ReceiveFrom(origin, again, data, sizeof(data)) == 1);
+        assert(!fromA.empty() && !fromB.empty());
+        assert(fromA != fromB);
+        assert(fromA == again);
+    }
+
+    // removed when closed
+    assert(opens(path));
+
+    // left by a previous run
+    staleSocket(path);
+    assert(opens(path));
+
+    // never anything other than a socket
+    std::ofstream(path.c_str()) << "not a socket";
+    assert(!opens(path));
+    std::remove(path.c_str());
+
+    LOG_0("test completed");
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include "mec_configreader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <sstream>
+
+#include "mec_log.h"
+
+namespace mec {
+
+static std::string lowerCase(const std::string &s) {
+    std::string r = s;
+    std::transform(r.begin(), r.end(), r.begin(), [](unsigned char c) { return (char) std::tolower(c); });
+    return r;
+}
+
+static std::string str(double d) {
+    std::ostringstream s;
+    s << d;
+    return s.str();
+}
+
+static const char *typeName(Preferences::Type t) {
+    switch (t) {
+        case Preferences::P_NULL :
+            return "null";
+        case Preferences::P_BOOL :
+            return "bool";
+        case Preferences::P_NUMBER :
+            return "number";
+        case Preferences::P_STRING :
+            return "string";
+        case Preferences::P_ARRAY :
+            return "array";
+        case Preferences::P_OBJECT :
+            return "object";
+    }
+    return "unknown";
+}
+
+ConfigReader::ConfigReader(const Preferences &prefs, const std::string &path) :
+        prefs_(prefs), path_(path), errors_(0) {
+}
+
+bool ConfigReader::exists(const std::string &key) const {
+    return prefs_.valid() && prefs_.exists(key);
+}
+
+void ConfigReader::error(const std::string &key, const std::string &msg) {
+    LOG_0("config error : " << path(key) << " " << msg);
+    errors_++;
+}
+
+bool ConfigReader::check(const std::string &key, Preferences::Type type) {
+    known(key);
+    if (!exists(key)) return false;
+    Preferences::Type t = prefs_.getType(key);
+    if (t != type) {
+        error(key, std::string("expected ") + typeName(type) + " found " + typeName(t) + ", using default");
+        return false;
+    }
+    return true;
+}
+
+void ConfigReader::read(const std::string &key, bool &v, bool def) {
+    v = def;
+    if (check(key, Preferences::P_BOOL)) v = prefs_.getBool(key, def);
+}
+
+void ConfigReader::read(const std::string &key, int &v, int def, int min, int max) {
+    v = def;
+    if (!check(key, Preferences::P_NUMBER)) return;
+    double d = prefs_.getDouble(key, def);
+    if (d != std::floor(d)) {
+        error(key, "expected integer found " + str(d) + ", using default");
+    } else if (d < min || d > max) {
+        error(key, str(d) + " out of range [" + str(min) + "," + str(max)
+                   + "], using default");
+    } else {
+        v = (int) d;
+    }
+}
+
+void ConfigReader::read(const std::string &key, unsigned &v, unsigned def, unsigned min, unsigned max) {
+    v = def;
+    if (!check(key, Preferences::P_NUMBER)) return;
+    double d = prefs_.getDouble(key, def);
+    if (d != std::floor(d)) {
+        error(key, "expected integer found " + str(d) + ", using default");
+    } else if (d < min || d > max) {
+        error(key, str(d) + " out of range [" + str(min) + "," + str(max)
+                   + "], using default");
+    } else {
+        v = (unsigned) d;
+    }
+}
+
+void ConfigReader::read(const std::string &key, float &v, float def, float min, float max) {
+    v = def;
+    if (!check(key, Preferences::P_NUMBER)) return;
+    double d = prefs_.getDouble(key, def);
+    if (d < min || d > max) {
+        error(key, str(d) + " out of range [" + str(min) + "," + str(max)
+                   + "], using default");
+    } else {
+        v = (float) d;
+    }
+}
+
+void ConfigReader::read(const std::string &key, std::string &v, const std::string &def) {
+    v = def;
+    if (check(key, Preferences::P_STRING)) v = prefs_.getString(key, def);
+}
+
+void ConfigReader::read(const std::string &key, std::vector<int> &v) {
+    v.clear();
+    if (!check(key, Preferences::P_ARRAY)) return;
+    Preferences::Array array(prefs_.getArray(key));
+    for (int i = 0; i < array.getSize(); i++) {
+        if (array.getType(i) != Preferences::P_NUMBER) {
+            error(key + "[" + std::to_string(i) + "]", "expected number, ignored");
+            continue;
+        }
+        v.push_back(array.getInt(i));
+    }
+}
+
+void ConfigReader::read(const std::string &key, std::vector<float> &v) {
+    v.clear();
+    if (!check(key, Preferences::P_ARRAY)) return;
+    Preferences::Array array(prefs_.getArray(key));
+    for (int i = 0; i < array.getSize(); i++) {
+        if (array.getType(i) != Preferences::P_NUMBER) {
+            error(key + "[" + std::to_string(i) + "]", "expected number, ignored");
+            continue;
+        }
+        v.push_back((float) array.getDouble(i));
+    }
+}
+
+void ConfigReader::read(const std::string &key, std::vector<std::string> &v) {
+    v.clear();
+    if (!check(key, Preferences::P_ARRAY)) return;
+    Preferences::Array array(prefs_.getArray(key));
+    for (int i = 0; i < array.getSize(); i++) {
+        if (array.getType(i) != Preferences::P_STRING) {
+            error(key + "[" + std::to_string(i) + "]", "expected string, ignored");
+            continue;
+        }
+        v.push_back(array.getString(i));
+    }
+}
+
+Preferences ConfigReader::object(const std::string &key) {
+    if (!check(key, Preferences::P_OBJECT)) return Preferences(nullptr);
+    return Preferences(prefs_.getSubTree(key));
+}
+
+void ConfigReader::known(const std::string &key) {
+    known_.insert(lowerCase(key));
+}
+
+void ConfigReader::knownPrefix(const std::string &prefix) {
+    knownPrefixes_.push_back(lowerCase(prefix));
+}
+
+bool ConfigReader::done() {
+    if (!prefs_.valid()) return errors_ == 0;
+    for (const auto &key : prefs_.getKeys()) {
+        if (key.empty() || key[0] == '_') continue;
+        std::string lkey = lowerCase(key);
+        if (known_.find(lkey) != known_.end()) continue;
+        bool found = false;
+        for (const auto &prefix : knownPrefixes_) {
+            if (lkey.compare(0, prefix.size(), prefix) == 0) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) LOG_0("config warning : " << path(key) << " unknown key, ignored");
+    }
+    return errors_ == 0;
+}
+
+}
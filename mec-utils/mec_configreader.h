@@ -0,0 +1,72 @@
+#pragma once
+
+#include "mec_prefs.h"
+
+#include <climits>
+#include <cfloat>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace mec {
+
+// reads a preferences object into typed fields, so values are looked up once at load, rather than on use
+// - each key is declared with its type and default, and optionally its valid range
+// - values of the wrong type or out of range are reported (with their path) and the default is used
+// - keys not declared are reported as unknown, keys starting with '_' are disabled, so ignored
+// note: keys are case insensitive, as they are for Preferences
+class ConfigReader {
+public:
+    ConfigReader(const Preferences &prefs, const std::string &path);
+
+    const std::string &path() const { return path_; }
+    std::string path(const std::string &key) const { return path_ + "." + key; }
+
+    bool exists(const std::string &key) const;
+
+    void read(const std::string &key, bool &v, bool def);
+    void read(const std::string &key, int &v, int def, int min = INT_MIN, int max = INT_MAX);
+    void read(const std::string &key, unsigned &v, unsigned def, unsigned min = 0, unsigned max = UINT_MAX);
+    void read(const std::string &key, float &v, float def, float min = -FLT_MAX, float max = FLT_MAX);
+    void read(const std::string &key, std::string &v, const std::string &def);
+    void read(const std::string &key, std::vector<int> &v);
+    void read(const std::string &key, std::vector<float> &v);
+    void read(const std::string &key, std::vector<std::string> &v);
+
+    // sub object, to be read with its own ConfigReader, not valid() if missing (or not an object)
+    Preferences object(const std::string &key);
+
+    // optional sub object, loaded by T::load(prefs, path), config is nullptr if not present
+    template<class T>
+    bool read(const std::string &key, std::shared_ptr<T> &config) {
+        config.reset();
+        known(key);
+        if (!exists(key)) return true;
+        Preferences prefs(object(key));
+        if (!prefs.valid()) return false;
+        config = std::make_shared<T>();
+        return config->load(prefs, path(key));
+    }
+
+    // keys which are read elsewhere, or no longer used
+    void known(const std::string &key);
+    void knownPrefix(const std::string &prefix);
+
+    // reports unknown keys, false if any value was invalid
+    bool done();
+
+    unsigned errors() const { return errors_; }
+
+private:
+    bool check(const std::string &key, Preferences::Type type);
+    void error(const std::string &key, const std::string &msg);
+
+    const Preferences &prefs_;
+    std::string path_;
+    std::set<std::string> known_; // lower case
+    std::vector<std::string> knownPrefixes_;
+    unsigned errors_;
+};
+
+}
@@ -0,0 +1,123 @@
+#include "mec_filewatcher.h"
+
+#include <chrono>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#   include <poll.h>
+#   include <unistd.h>
+#   include <sys/inotify.h>
+#endif
+
+#include "mec_log.h"
+#include "mec_threads.h"
+
+namespace mec {
+
+const unsigned FileWatcher::POLL_MS;
+const unsigned FileWatcher::SETTLE_MS;
+
+static long long fileStamp(const std::string &file) {
+    struct stat st;
+    if (stat(file.c_str(), &st) != 0) return -1;
+    return ((long long) st.st_mtime << 32) ^ (long long) st.st_size;
+}
+
+FileWatcher::FileWatcher() : running_(false), fd_(-1), stamp_(-1) {
+}
+
+FileWatcher::~FileWatcher() {
+    stop();
+}
+
+void *file_watcher_thread_func(void *pWatcher) {
+    ThreadRegistration registration("config.watch");
+    FileWatcher *pThis = static_cast<FileWatcher *>(pWatcher);
+    pThis->watchPoll();
+    return nullptr;
+}
+
+bool FileWatcher::start(const std::string &file, Callback callback) {
+    stop();
+    file_ = file;
+    callback_ = callback;
+    size_t sep = file.find_last_of('/');
+    dir_ = sep == std::string::npos ? "." : file.substr(0, sep);
+    name_ = sep == std::string::npos ? file : file.substr(sep + 1);
+    stamp_ = fileStamp(file_);
+
+#ifdef __linux__
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ < 0 || inotify_add_watch(fd_, dir_.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+        LOG_0("FileWatcher unable to watch " << dir_ << ", polling instead");
+        if (fd_ >= 0) close(fd_);
+        fd_ = -1;
+    }
+#endif
+
+    running_ = true;
+    watcher_thread_ = std::thread(file_watcher_thread_func, this);
+    return true;
+}
+
+void FileWatcher::stop() {
+    running_ = false;
+    if (watcher_thread_.joinable()) watcher_thread_.join();
+#ifdef __linux__
+    if (fd_ >= 0) close(fd_);
+#endif
+    fd_ = -1;
+}
+
+// waits up to POLL_MS, true if the file was written
+bool FileWatcher::changed() {
+#ifdef __linux__
+    if (fd_ >= 0) {
+        struct pollfd pfd = {fd_, POLLIN, 0};
+        if (poll(&pfd, 1, POLL_MS) <= 0) return false;
+        bool ret = false;
+        char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+        ssize_t len;
+        while ((len = read(fd_, buf, sizeof(buf))) > 0) {
+            for (char *p = buf; p < buf + len;) {
+                const struct inotify_event *event = (const struct inotify_event *) p;
+                if (event->len > 0 && name_ == event->name) ret = true;
+                p += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        return ret;
+    }
+#endif
+    std::this_thread::sleep_for(std::chrono::milliseconds(POLL_MS));
+    long long stamp = fileStamp(file_);
+    if (stamp == stamp_) return false;
+    stamp_ = stamp;
+    return true;
+}
+
+void FileWatcher::watchPoll() {
+    while (running_) {
+        if (!changed()) continue;
+
+        // wait for writes to settle, before calling back once
+        auto settle = std::chrono::steady_clock::now() + std::chrono::milliseconds(SETTLE_MS);
+        while (running_ && std::chrono::steady_clock::now() < settle) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(SETTLE_MS / 5));
+#ifdef __linux__
+            if (fd_ >= 0) {
+                char buf[4096];
+                while (read(fd_, buf, sizeof(buf)) > 0) {
+                    settle = std::chrono::steady_clock::now() + std::chrono::milliseconds(SETTLE_MS);
+                }
+            }
+#endif
+        }
+        stamp_ = fileStamp(file_);
+        if (running_ && stamp_ >= 0) {
+            LOG_1("FileWatcher " << file_ << " changed");
+            callback_();
+        }
+    }
+}
+
+}
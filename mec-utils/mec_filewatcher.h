@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace mec {
+
+// watches a file for changes, calling back (on the watcher thread) once the file has settled
+// the directory is watched rather than the file, so editors that save by rename are detected
+// uses inotify on linux, otherwise polls the file's modification time
+class FileWatcher {
+public:
+    typedef std::function<void()> Callback;
+
+    static const unsigned POLL_MS = 500;
+    static const unsigned SETTLE_MS = 250; // editors often write in several steps
+
+    FileWatcher();
+    ~FileWatcher();
+
+    bool start(const std::string &file, Callback callback);
+    void stop();
+
+    void watchPoll();
+
+private:
+    bool changed();
+
+    std::string file_;
+    std::string dir_;
+    std::string name_;
+    Callback callback_;
+    std::atomic<bool> running_;
+    std::thread watcher_thread_;
+    int fd_;
+    long long stamp_; // fallback, mtime and size
+};
+
+}
@@ -0,0 +1,327 @@
+#include "mec_log.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#   include <syslog.h>
+#endif
+
+#include <readerwriterqueue.h>
+
+#include "mec_metrics.h"
+#include "mec_threads.h"
+
+namespace mec {
+
+const unsigned Logger::MAX_LINE;
+const unsigned Logger::QUEUE_SIZE;
+const unsigned Logger::DRAIN_MS;
+const int Logger::DEFAULT_LEVEL;
+
+struct LogRecord {
+    int level_;
+    const Logger::Subsystem *subsystem_;
+    unsigned len_;
+    char text_[Logger::MAX_LINE];
+};
+
+// one per logging thread, written by that thread, read by the writer thread
+struct LogQueue {
+    LogQueue() : queue_(Logger::QUEUE_SIZE), closed_(false) { ; }
+
+    moodycamel::ReaderWriterQueue<LogRecord> queue_;
+    std::atomic<bool> closed_; // thread has exited, remove once empty
+};
+
+// formats into a fixed buffer, truncating rather than allocating
+class LineBuf : public std::streambuf {
+public:
+    void reset() { setp(buf_, buf_ + Logger::MAX_LINE); }
+
+    unsigned size() const { return (unsigned) (pptr() - pbase()); }
+
+    const char *data() const { return buf_; }
+
+protected:
+    int overflow(int c) override { return traits_type::not_eof(c); }
+
+private:
+    char buf_[Logger::MAX_LINE];
+};
+
+class LogWriter {
+public:
+    LogWriter() : running_(true), defaultLevel_(Logger::DEFAULT_LEVEL),
+                  output_(Logger::L_CONSOLE), file_(nullptr),
+                  dropped_(Metrics::counter("log.dropped")) {
+        writer_thread_ = std::thread(&LogWriter::writePoll, this);
+    }
+
+    // never deleted, so logging from static destructors remains safe
+    static LogWriter &writer() {
+        static LogWriter *writer = nullptr;
+        static std::once_flag once;
+        std::call_once(once, []() {
+            writer = new LogWriter();
+            std::atexit([]() { LogWriter::writer().stop(); });
+        });
+        return *writer;
+    }
+
+    Logger::Subsystem &subsystem(const std::string &name) {
+        std::lock_guard<std::mutex> lock(levelMutex_);
+        auto &s = subsystems_[name];
+        if (!s) s.reset(new Logger::Subsystem(name, defaultLevel_));
+        return *s;
+    }
+
+    void defaultLevel(int level) {
+        std::lock_guard<std::mutex> lock(levelMutex_);
+        defaultLevel_ = level;
+        for (auto &s : subsystems_) s.second->level_ = level;
+    }
+
+    bool output(Logger::Output output, const std::string &file) {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        FILE *f = nullptr;
+        if (output == Logger::L_FILE) {
+            f = fopen(file.c_str(), "a");
+            if (!f) {
+                fprintf(stderr, "unable to open log file %s\n", file.c_str());
+                return false;
+            }
+        }
+        closeOutput();
+        output_ = output;
+        file_ = f;
+#ifndef _WIN32
+        if (output_ == Logger::L_SYSLOG) openlog("mec", LOG_PID, LOG_USER);
+#else
+        if (output_ == Logger::L_SYSLOG) output_ = Logger::L_CONSOLE;
+#endif
+        return true;
+    }
+
+    std::ostream &begin() {
+        ThreadLog *tl = threadLog();
+        if (!tl) {
+            // thread exiting, its log is gone
+            exitMutex_.lock();
+            tl = &exitLog_;
+        }
+        tl->buf_.reset();
+        tl->os_.clear();
+        return tl->os_;
+    }
+
+    void end(int level, const Logger::Subsystem &subsystem) {
+        ThreadLog *tl = threadLog();
+        LogRecord r;
+        r.level_ = level;
+        r.subsystem_ = &subsystem;
+        if (!tl) {
+            r.len_ = exitLog_.buf_.size();
+            memcpy(r.text_, exitLog_.buf_.data(), r.len_);
+            exitMutex_.unlock();
+        } else {
+            r.len_ = tl->buf_.size();
+            memcpy(r.text_, tl->buf_.data(), r.len_);
+            if (running_) {
+                if (!tl->queue_->queue_.try_enqueue(r)) dropped_.inc();
+                return;
+            }
+        }
+        // after exit (or thread exit), write directly
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        write(r);
+        flushOutput();
+    }
+
+    void flush() {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        drain();
+    }
+
+    unsigned long dropped() const { return (unsigned long) dropped_.value(); }
+
+    void writePoll() {
+        ThreadRegistration registration("log");
+        while (running_) {
+            flush();
+            std::this_thread::sleep_for(std::chrono::milliseconds(Logger::DRAIN_MS));
+        }
+    }
+
+private:
+    struct ThreadLog {
+        ThreadLog() : os_(&buf_), queue_(std::make_shared<LogQueue>()) { ; }
+
+        LineBuf buf_;
+        std::ostream os_;
+        std::shared_ptr<LogQueue> queue_;
+    };
+
+    // closes the threads queue when the thread exits, the writer removes it once drained
+    struct ThreadLogOwner {
+        ~ThreadLogOwner() {
+            if (log_) log_->queue_->closed_ = true;
+            delete log_;
+            log_ = nullptr;
+            done_ = true;
+        }
+
+        ThreadLog *log_ = nullptr;
+        bool done_ = false;
+    };
+
+    // nullptr once the thread is exiting
+    ThreadLog *threadLog() {
+        static thread_local ThreadLogOwner owner;
+        if (!owner.log_ && !owner.done_) {
+            // first use on this thread, register its queue
+            owner.log_ = new ThreadLog();
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            queues_.push_back(owner.log_->queue_);
+        }
+        return owner.log_;
+    }
+
+    void stop() {
+        running_ = false;
+        if (writer_thread_.joinable()) writer_thread_.join();
+        flush();
+    }
+
+    // writeMutex_ held
+    void drain() {
+        std::vector<std::shared_ptr<LogQueue>> queues;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            queues = queues_;
+        }
+        bool written = false;
+        LogRecord r;
+        for (auto &q : queues) {
+            while (q->queue_.try_dequeue(r)) {
+                write(r);
+                written = true;
+            }
+        }
+        if (written) flushOutput();
+
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        for (auto it = queues_.begin(); it != queues_.end();) {
+            if ((*it)->closed_ && (*it)->queue_.peek() == nullptr) {
+                it = queues_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // writeMutex_ held
+    void write(const LogRecord &r) {
+        switch (output_) {
+            case Logger::L_FILE : {
+                fwrite(r.text_, 1, r.len_, file_);
+                fputc('\n', file_);
+                break;
+            }
+#ifndef _WIN32
+            case Logger::L_SYSLOG : {
+                int priority = r.level_ == 0 ? LOG_ERR : (r.level_ == 1 ? LOG_INFO : LOG_DEBUG);
+                syslog(priority, "%s: %.*s", r.subsystem_->name_.c_str(), (int) r.len_, r.text_);
+                break;
+            }
+#endif
+            default: {
+                FILE *f = r.level_ == 0 ? stderr : stdout;
+                fwrite(r.text_, 1, r.len_, f);
+                fputc('\n', f);
+                break;
+            }
+        }
+    }
+
+    void flushOutput() {
+        if (output_ == Logger::L_FILE) {
+            fflush(file_);
+        } else if (output_ == Logger::L_CONSOLE) {
+            fflush(stdout);
+            fflush(stderr);
+        }
+    }
+
+    void closeOutput() {
+        if (file_) fclose(file_);
+        file_ = nullptr;
+#ifndef _WIN32
+        if (output_ == Logger::L_SYSLOG) closelog();
+#endif
+    }
+
+    std::atomic<bool> running_;
+    std::thread writer_thread_;
+
+    std::mutex levelMutex_;
+    std::map<std::string, std::unique_ptr<Logger::Subsystem>> subsystems_;
+    int defaultLevel_;
+
+    std::mutex queueMutex_;
+    std::vector<std::shared_ptr<LogQueue>> queues_;
+
+    std::mutex exitMutex_;
+    ThreadLog exitLog_;
+
+    std::mutex writeMutex_; // output and draining
+    Logger::Output output_;
+    FILE *file_;
+    Counter &dropped_;
+};
+
+
+Logger::Subsystem &Logger::subsystem(const std::string &name) {
+    return LogWriter::writer().subsystem(name);
+}
+
+int Logger::level(const std::string &subsystem) {
+    return Logger::subsystem(subsystem).level_;
+}
+
+void Logger::level(const std::string &subsystem, int level) {
+    Logger::subsystem(subsystem).level_ = level;
+}
+
+void Logger::defaultLevel(int level) {
+    LogWriter::writer().defaultLevel(level);
+}
+
+bool Logger::output(Output output, const std::string &file) {
+    return LogWriter::writer().output(output, file);
+}
+
+std::ostream &Logger::begin() {
+    return LogWriter::writer().begin();
+}
+
+void Logger::end(int level, const Subsystem &subsystem) {
+    LogWriter::writer().end(level, subsystem);
+}
+
+void Logger::flush() {
+    LogWriter::writer().flush();
+}
+
+unsigned long Logger::dropped() {
+    return LogWriter::writer().dropped();
+}
+
+}
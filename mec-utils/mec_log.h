@@ -1,21 +1,100 @@
 #pragma once
 
-// this will be replaced with a logging method, that can be replaced by a platform
-// probably based on 'printf' type formating
+// logging, LOG_0 errors, LOG_1 information, LOG_2 debug, LOG_3 trace
+// e.g. LOG_1("device opened " << name << " port " << port);
+//
+// the message is only formatted if its level is enabled, into a per thread buffer (without allocation),
+// then queued (lock free, per thread) to a background thread which writes it
+// so a log call never waits on i/o, or on another thread, and is safe on a realtime thread
+// if a thread logs faster than the messages can be written, messages are dropped (and counted)
+//
+// levels
+// - compile time: MEC_LOG_LEVEL (default 1), LOG_ above this compile to nothing
+// - run time: per subsystem, see Logger::level(), default 1
+// MEC_LOG_SUBSYSTEM names the subsystem of a translation unit (default "mec"), usually set per library
 
-// define to null to omit logging
+#include <atomic>
 #include <iostream>
+#include <memory>
+#include <string>
 
-#define LOG_0(x) std::cerr << x << std::endl
-// #define LOG_0(x)
+#ifndef MEC_LOG_LEVEL
+#   define MEC_LOG_LEVEL 1
+#endif
 
-#define LOG_1(x) std::cout << x << std::endl
-// #define LOG_1(x)
+#ifndef MEC_LOG_SUBSYSTEM
+#   define MEC_LOG_SUBSYSTEM "mec"
+#endif
 
-// #define LOG_2(x) std::cout << x << std::endl
-#define LOG_2(x)
+namespace mec {
 
-// #define LOG_3(x) std::cout << x << std::endl
-#define LOG_3(x)
+class Logger {
+public:
+    enum Output {
+        L_CONSOLE,  // level 0 to stderr, others to stdout
+        L_FILE,
+        L_SYSLOG
+    };
 
+    static const unsigned MAX_LINE = 256; // longer messages are truncated
+    static const unsigned QUEUE_SIZE = 256; // per thread
+    static const unsigned DRAIN_MS = 5;
+    static const int DEFAULT_LEVEL = 1;
 
+    struct Subsystem {
+        Subsystem(const std::string &name, int level) : name_(name), level_(level) { ; }
+
+        const std::string name_;
+        std::atomic<int> level_;
+    };
+
+    // created on first use, at the default level
+    static Subsystem &subsystem(const std::string &name);
+
+    static int level(const std::string &subsystem);
+    static void level(const std::string &subsystem, int level);
+    // all subsystems, including those not yet used
+    static void defaultLevel(int level);
+
+    static bool output(Output output, const std::string &file = "");
+
+    // used by LOG_ macros
+    static std::ostream &begin();
+    static void end(int level, const Subsystem &subsystem);
+
+    // writes queued messages now, e.g. before a crash or exit
+    static void flush();
+    static unsigned long dropped();
+};
+
+}
+
+#define MEC_LOG(lvl, x) do { \
+        static mec::Logger::Subsystem &mec_log_subsystem_ = mec::Logger::subsystem(MEC_LOG_SUBSYSTEM); \
+        if (mec_log_subsystem_.level_.load(std::memory_order_relaxed) >= (lvl)) { \
+            mec::Logger::begin() << x; \
+            mec::Logger::end((lvl), mec_log_subsystem_); \
+        } \
+    } while (0)
+
+#define MEC_LOG_NONE do { } while (0)
+
+#define LOG_0(x) MEC_LOG(0, x)
+
+#if MEC_LOG_LEVEL >= 1
+#   define LOG_1(x) MEC_LOG(1, x)
+#else
+#   define LOG_1(x) MEC_LOG_NONE
+#endif
+
+#if MEC_LOG_LEVEL >= 2
+#   define LOG_2(x) MEC_LOG(2, x)
+#else
+#   define LOG_2(x) MEC_LOG_NONE
+#endif
+
+#if MEC_LOG_LEVEL >= 3
+#   define LOG_3(x) MEC_LOG(3, x)
+#else
+#   define LOG_3(x) MEC_LOG_NONE
+#endif
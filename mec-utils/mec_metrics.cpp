@@ -0,0 +1,130 @@
+#include "mec_metrics.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace mec {
+
+const unsigned Histogram::BUCKETS;
+
+Histogram::Histogram() : count_(0), sum_(0), max_(0) {
+    for (unsigned i = 0; i < BUCKETS; i++) buckets_[i] = 0;
+}
+
+void Histogram::record(uint64_t v) {
+    unsigned bucket = 0;
+    for (uint64_t b = v; b > 0 && bucket < BUCKETS - 1; b >>= 1) bucket++;
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(v, std::memory_order_relaxed);
+    uint64_t m = max_.load(std::memory_order_relaxed);
+    while (v > m && !max_.compare_exchange_weak(m, v, std::memory_order_relaxed)) { ; }
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    // not atomic as a whole, values may be a few records apart
+    Snapshot s;
+    s.count_ = count_.load(std::memory_order_relaxed);
+    s.sum_ = sum_.load(std::memory_order_relaxed);
+    s.max_ = max_.load(std::memory_order_relaxed);
+    for (unsigned i = 0; i < BUCKETS; i++) s.buckets_[i] = buckets_[i].load(std::memory_order_relaxed);
+    return s;
+}
+
+uint64_t Histogram::Snapshot::percentile(double p) const {
+    uint64_t total = 0;
+    for (unsigned i = 0; i < BUCKETS; i++) total += buckets_[i];
+    if (total == 0) return 0;
+    uint64_t target = (uint64_t) (p * double(total));
+    uint64_t n = 0;
+    for (unsigned i = 0; i < BUCKETS; i++) {
+        n += buckets_[i];
+        if (n > target) {
+            uint64_t upper = i == 0 ? 0 : (uint64_t(1) << i) - 1;
+            return upper < max_ ? upper : max_;
+        }
+    }
+    return max_;
+}
+
+
+class MetricsRegistry {
+public:
+    // never deleted, metrics may be updated during static destruction
+    static MetricsRegistry &registry() {
+        static MetricsRegistry *registry_ = new MetricsRegistry();
+        return *registry_;
+    }
+
+    template<class T>
+    T &get(std::map<std::string, std::unique_ptr<T>> &metrics, const std::string &name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto &m = metrics[name];
+        if (!m) m.reset(new T());
+        return *m;
+    }
+
+    void snapshot(std::vector<Metrics::Sample> &samples) {
+        samples.clear();
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &c : counters_) {
+            uint64_t count = c.second->value();
+            add(samples, c.first, Metrics::Sample::K_COUNTER, double(count), (int64_t) count);
+        }
+        for (const auto &g : gauges_) {
+            add(samples, g.first, Metrics::Sample::K_GAUGE, double(g.second->value()));
+            add(samples, g.first + ".peak", Metrics::Sample::K_GAUGE, double(g.second->peak()));
+        }
+        for (const auto &h : histograms_) {
+            Histogram::Snapshot s = h.second->snapshot();
+            add(samples, h.first + ".count", Metrics::Sample::K_HISTOGRAM, double(s.count_));
+            add(samples, h.first + ".mean", Metrics::Sample::K_HISTOGRAM, s.mean());
+            add(samples, h.first + ".p50", Metrics::Sample::K_HISTOGRAM, double(s.percentile(0.5)));
+            add(samples, h.first + ".p99", Metrics::Sample::K_HISTOGRAM, double(s.percentile(0.99)));
+            add(samples, h.first + ".max", Metrics::Sample::K_HISTOGRAM, double(s.max_));
+        }
+        std::sort(samples.begin(), samples.end(),
+                  [](const Metrics::Sample &a, const Metrics::Sample &b) { return a.name_ < b.name_; });
+    }
+
+    std::map<std::string, std::unique_ptr<Counter>> counters_;
+    std::map<std::string, std::unique_ptr<Gauge>> gauges_;
+    std::map<std::string, std::unique_ptr<Histogram>> histograms_;
+
+private:
+    static void add(std::vector<Metrics::Sample> &samples, const std::string &name,
+                    Metrics::Sample::Kind kind, double value, int64_t count = 0) {
+        Metrics::Sample s;
+        s.name_ = name;
+        s.kind_ = kind;
+        s.value_ = value;
+        s.count_ = count;
+        samples.push_back(s);
+    }
+
+    std::mutex mutex_;
+};
+
+
+Counter &Metrics::counter(const std::string &name) {
+    MetricsRegistry &r = MetricsRegistry::registry();
+    return r.get(r.counters_, name);
+}
+
+Gauge &Metrics::gauge(const std::string &name) {
+    MetricsRegistry &r = MetricsRegistry::registry();
+    return r.get(r.gauges_, name);
+}
+
+Histogram &Metrics::histogram(const std::string &name) {
+    MetricsRegistry &r = MetricsRegistry::registry();
+    return r.get(r.histograms_, name);
+}
+
+void Metrics::snapshot(std::vector<Sample> &samples) {
+    MetricsRegistry::registry().snapshot(samples);
+}
+
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+// runtime metrics : counters, gauges and histograms
+// looked up by name once (e.g. in a constructor, or a function static), then updated lock free,
+// so cheap enough to leave on, including on realtime threads
+// e.g.
+//  static mec::Counter &dropped = mec::Metrics::counter("osct3d.queue.dropped");
+//  dropped.inc();
+// names are dot separated, published as /mec/stats/osct3d/queue/dropped (see mec-app stats)
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mec {
+
+// monotonic, e.g. messages sent, rate is derived by the reader
+class Counter {
+public:
+    Counter() : value_(0) { ; }
+
+    void inc(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_;
+};
+
+// current value, e.g. queue depth, client count, with its peak
+class Gauge {
+public:
+    Gauge() : value_(0), peak_(0) { ; }
+
+    void set(int64_t v) {
+        value_.store(v, std::memory_order_relaxed);
+        updatePeak(v);
+    }
+
+    void add(int64_t n) { updatePeak(value_.fetch_add(n, std::memory_order_relaxed) + n); }
+
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+    int64_t peak() const { return peak_.load(std::memory_order_relaxed); }
+
+private:
+    void updatePeak(int64_t v) {
+        int64_t p = peak_.load(std::memory_order_relaxed);
+        while (v > p && !peak_.compare_exchange_weak(p, v, std::memory_order_relaxed)) { ; }
+    }
+
+    std::atomic<int64_t> value_;
+    std::atomic<int64_t> peak_;
+};
+
+// distribution of a value, e.g. processing time in microseconds
+// power of 2 buckets, so percentiles are approximate (within a factor of 2)
+class Histogram {
+public:
+    static const unsigned BUCKETS = 32; // bucket n holds [2^(n-1), 2^n), last holds the remainder
+
+    Histogram();
+
+    void record(uint64_t v);
+
+    struct Snapshot {
+        uint64_t count_;
+        uint64_t sum_;
+        uint64_t max_;
+        uint64_t buckets_[BUCKETS];
+
+        double mean() const { return count_ > 0 ? double(sum_) / double(count_) : 0.0; }
+
+        // upper bound of the bucket containing the percentile (0..1)
+        uint64_t percentile(double p) const;
+    };
+
+    Snapshot snapshot() const;
+
+private:
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+    std::atomic<uint64_t> buckets_[BUCKETS];
+};
+
+// records the lifetime of the scope, in microseconds
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram &histogram) : histogram_(histogram), start_(std::chrono::steady_clock::now()) { ; }
+
+    ~ScopedTimer() {
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_);
+        histogram_.record((uint64_t) us.count());
+    }
+
+private:
+    Histogram &histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+
+class Metrics {
+public:
+    // created on first use, never deleted, so references may be kept
+    // the same name always returns the same metric (e.g. shared by instances)
+    static Counter &counter(const std::string &name);
+    static Gauge &gauge(const std::string &name);
+    static Histogram &histogram(const std::string &name);
+
+    struct Sample {
+        enum Kind {
+            K_COUNTER,
+            K_GAUGE,
+            K_HISTOGRAM
+        };
+
+        std::string name_;
+        Kind kind_;
+        double value_;
+        int64_t count_; // counters, exact (value_ is not, beyond 2^53)
+    };
+
+    // current value of all metrics, sorted by name
+    // gauges add name.peak, histograms are name.count, .mean, .p50, .p99, .max
+    static void snapshot(std::vector<Sample> &samples);
+};
+
+}
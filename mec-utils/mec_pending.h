@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace mec {
+
+// hands a replacement object (e.g. a rebuilt processing stage) from one thread to another
+// the producer publishes, the consumer takes it at a point it knows is safe, e.g. between processing cycles
+// take is a single atomic load when nothing is pending, so can be called every cycle
+// a value published before the previous one is taken replaces it
+template<class T>
+class Pending {
+public:
+    Pending() : pending_(false) { ; }
+
+    void publish(const std::shared_ptr<T> &value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        value_ = value;
+        pending_.store(true, std::memory_order_release);
+    }
+
+    bool take(std::shared_ptr<T> &value) {
+        if (!pending_.load(std::memory_order_acquire)) return false;
+        std::lock_guard<std::mutex> lock(mutex_);
+        value = value_;
+        value_.reset();
+        pending_.store(false, std::memory_order_release);
+        return true;
+    }
+
+    bool pending() const { return pending_.load(std::memory_order_acquire); }
+
+private:
+    std::mutex mutex_;
+    std::shared_ptr<T> value_;
+    std::atomic<bool> pending_;
+};
+
+}
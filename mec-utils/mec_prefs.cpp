@@ -18,6 +18,12 @@ Preferences::Preferences(void *p) :
         valid_(jsonData_ != nullptr) {
 }
 
+Preferences::Preferences(Preferences &&other) :
+        jsonData_(other.jsonData_), owned_(other.owned_), valid_(other.valid_) {
+    other.jsonData_ = nullptr;
+    other.owned_ = false;
+    other.valid_ = false;
+}
 
 Preferences::~Preferences() {
     if (jsonData_ && owned_) cJSON_Delete((cJSON *) jsonData_);
@@ -19,6 +19,8 @@ public:
 
     Preferences(void *subtree);
     Preferences(const std::string &file);
+    // moved, not copied, as the tree may be owned
+    Preferences(Preferences &&other);
     virtual ~Preferences();
 
     std::vector<std::string> getKeys() const;
@@ -0,0 +1,227 @@
+#include "mec_threads.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <sstream>
+
+#ifndef _WIN32
+#   include <pthread.h>
+#   include <sched.h>
+#   include <sys/mman.h>
+#   include <alloca.h>
+#   include <unistd.h>
+#endif
+
+#include "mec_configreader.h"
+#include "mec_log.h"
+
+namespace mec {
+
+bool ThreadConfig::load(const Preferences &prefs, const std::string &path) {
+    ConfigReader r(prefs, path);
+    std::string policy;
+    r.read("policy", policy, "");
+    if (policy.empty()) {
+        policy_ = P_DEFAULT;
+    } else if (policy == "other") {
+        policy_ = P_OTHER;
+    } else if (policy == "fifo") {
+        policy_ = P_FIFO;
+    } else if (policy == "rr") {
+        policy_ = P_RR;
+    } else {
+        LOG_0("config error : " << r.path("policy") << " expected other, fifo or rr, ignored");
+        policy_ = P_DEFAULT;
+    }
+    r.read("priority", priority_, 0, 0, 99);
+    std::vector<int> cpus;
+    r.read("cpus", cpus);
+#ifndef _WIN32
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    long online = (long) std::thread::hardware_concurrency();
+#endif
+    if (online <= 0) online = 1;
+    cpus_.clear();
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= online) {
+            LOG_0("config error : " << r.path("cpus") << " cpu " << cpu
+                                    << " not in 0 to " << (online - 1) << ", ignored");
+            continue;
+        }
+        cpus_.push_back(cpu);
+    }
+    return r.done();
+}
+
+
+std::shared_ptr<ThreadRegistry> ThreadRegistry::registry() {
+    // never deleted, threads may exit during static destruction
+    static std::shared_ptr<ThreadRegistry> *registry_ = new std::shared_ptr<ThreadRegistry>(new ThreadRegistry());
+    return *registry_;
+}
+
+const ThreadConfig *ThreadRegistry::findConfig(const std::string &name) const {
+    for (const auto &c : configs_) {
+        if (c.first == name) return &c.second;
+    }
+    return nullptr;
+}
+
+void ThreadRegistry::config(const std::string &name, const ThreadConfig &config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool found = false;
+    for (auto &c : configs_) {
+        if (c.first == name) {
+            c.second = config;
+            found = true;
+        }
+    }
+    if (!found) configs_.push_back(std::make_pair(name, config));
+
+    for (const auto &t : threads_) {
+        if (t.name_ == name) apply(t, config);
+    }
+}
+
+void ThreadRegistry::add(const std::string &name) {
+#ifndef _WIN32
+    Entry entry;
+    entry.name_ = name;
+    entry.handle_ = pthread_self();
+#ifdef __linux__
+    // shows in top/ps, limited to 15 chars
+    pthread_setname_np(entry.handle_, name.substr(0, 15).c_str());
+#endif
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    threads_.push_back(entry);
+    if (prefaultStack_ > 0) prefault(prefaultStack_);
+    const ThreadConfig *config = findConfig(name);
+    if (config) apply(entry, *config);
+#endif
+}
+
+void ThreadRegistry::remove() {
+#ifndef _WIN32
+    std::lock_guard<std::mutex> lock(mutex_);
+    pthread_t self = pthread_self();
+    threads_.erase(std::remove_if(threads_.begin(), threads_.end(),
+                                  [self](const Entry &e) { return pthread_equal(e.handle_, self); }),
+                   threads_.end());
+#endif
+}
+
+bool ThreadRegistry::lockMemory(size_t prefaultStack) {
+#ifdef __linux__
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        LOG_0("ThreadRegistry unable to lock memory, errno " << errno);
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    prefaultStack_ = prefaultStack;
+    if (prefaultStack_ > 0) prefault(prefaultStack_);
+    LOG_1("ThreadRegistry memory locked, stack prefault " << prefaultStack_);
+    return true;
+#else
+    LOG_0("ThreadRegistry memory locking not supported on this platform");
+    return false;
+#endif
+}
+
+void ThreadRegistry::prefault(size_t size) {
+#ifndef _WIN32
+    // touch each page of the stack we may use, so it is mapped (and locked) now
+    volatile char *stack = static_cast<volatile char *>(alloca(size));
+    for (size_t i = 0; i < size; i += 4096) stack[i] = 0;
+#endif
+}
+
+bool ThreadRegistry::apply(const Entry &entry, const ThreadConfig &config) {
+#ifndef _WIN32
+    bool ret = true;
+    if (config.policy_ != ThreadConfig::P_DEFAULT) {
+        int policy = SCHED_OTHER;
+        switch (config.policy_) {
+            case ThreadConfig::P_FIFO :
+                policy = SCHED_FIFO;
+                break;
+            case ThreadConfig::P_RR :
+                policy = SCHED_RR;
+                break;
+            default:
+                break;
+        }
+        struct sched_param param;
+        param.sched_priority = policy == SCHED_OTHER ? 0 : config.priority_;
+        int rc = pthread_setschedparam(entry.handle_, policy, &param);
+        if (rc != 0) {
+            LOG_0("thread " << entry.name_ << " unable to set scheduling, error " << rc
+                            << (rc == EPERM ? " (needs CAP_SYS_NICE or rtprio limit)" : ""));
+            ret = false;
+        }
+    }
+    if (!config.cpus_.empty()) {
+#ifdef __linux__
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (int cpu : config.cpus_) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &cpus);
+        }
+        int rc = pthread_setaffinity_np(entry.handle_, sizeof(cpus), &cpus);
+        if (rc != 0) {
+            LOG_0("thread " << entry.name_ << " unable to set cpu affinity, error " << rc);
+            ret = false;
+        }
+#else
+        LOG_0("thread " << entry.name_ << " cpu affinity not supported on this platform");
+        ret = false;
+#endif
+    }
+    LOG_1("thread " << entry.name_ << " : " << describe(entry.handle_));
+    return ret;
+#else
+    return false;
+#endif
+}
+
+std::string ThreadRegistry::describe(std::thread::native_handle_type handle) {
+    std::ostringstream s;
+#ifndef _WIN32
+    int policy;
+    struct sched_param param;
+    if (pthread_getschedparam(handle, &policy, &param) == 0) {
+        switch (policy) {
+            case SCHED_FIFO :
+                s << "fifo";
+                break;
+            case SCHED_RR :
+                s << "rr";
+                break;
+            default:
+                s << "other";
+                break;
+        }
+        s << " priority " << param.sched_priority;
+    }
+#ifdef __linux__
+    cpu_set_t cpus;
+    if (pthread_getaffinity_np(handle, sizeof(cpus), &cpus) == 0) {
+        s << " cpus";
+        for (int i = 0; i < CPU_SETSIZE; i++) {
+            if (CPU_ISSET(i, &cpus)) s << " " << i;
+        }
+    }
+#endif
+#endif
+    return s.str();
+}
+
+void ThreadRegistry::report() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &t : threads_) {
+        LOG_0("thread " << t.name_ << " : " << describe(t.handle_));
+    }
+}
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mec_prefs.h"
+
+namespace mec {
+
+// scheduling for a named thread, fields left at their defaults are not changed
+struct ThreadConfig {
+    enum Policy {
+        P_DEFAULT, // as created
+        P_OTHER,
+        P_FIFO,
+        P_RR
+    };
+
+    ThreadConfig(Policy policy = P_DEFAULT, int priority = 0) : policy_(policy), priority_(priority) { ; }
+
+    Policy policy_;
+    int priority_;
+    std::vector<int> cpus_; // affinity, empty = any
+
+    bool load(const Preferences &prefs, const std::string &path);
+};
+
+// mec threads register by name (on the thread itself), so they can be given a scheduling policy,
+// priority and cpu affinity from config, regardless of which library created them
+// config may be set before or after a thread registers, it is applied to all threads of that name
+class ThreadRegistry {
+public:
+    static std::shared_ptr<ThreadRegistry> registry();
+
+    void config(const std::string &name, const ThreadConfig &config);
+
+    // calling thread
+    void add(const std::string &name);
+    void remove();
+
+    // locks all current and future memory, and prefaults stacks (of this thread, and threads added later)
+    // so a realtime thread never page faults
+    bool lockMemory(size_t prefaultStack);
+
+    // logs the scheduling each thread actually has
+    void report();
+
+private:
+    ThreadRegistry() : prefaultStack_(0) { ; }
+
+    struct Entry {
+        std::string name_;
+        std::thread::native_handle_type handle_;
+    };
+
+    const ThreadConfig *findConfig(const std::string &name) const;
+    static bool apply(const Entry &entry, const ThreadConfig &config);
+    static std::string describe(std::thread::native_handle_type handle);
+    static void prefault(size_t size);
+
+    std::mutex mutex_;
+    std::vector<Entry> threads_;
+    std::vector<std::pair<std::string, ThreadConfig>> configs_;
+    size_t prefaultStack_;
+};
+
+// registers the current thread for its lifetime, e.g. at the top of a thread function
+class ThreadRegistration {
+public:
+    explicit ThreadRegistration(const std::string &name) { ThreadRegistry::registry()->add(name); }
+
+    ~ThreadRegistration() { ThreadRegistry::registry()->remove(); }
+};
+
+}
@@ -1,4 +0,0 @@
-#pragma once
-
-#include <thread>
-void makeThreadRealtime(std::thread& thread);